@@ -462,6 +462,15 @@
 /*	Convert body content that claims to be 8-bit into quoted-printable,
 /*	before header_checks, body_checks, Milters, and before after-queue
 /*	content filters.
+/* .PP
+/*	Available in Postfix 3.11 and later:
+/* .IP "\fBcleanup_address_cache_size (1000)\fR"
+/*	The maximal number of address rewriting, canonical mapping and
+/*	virtual alias expansion results that a \fBcleanup\fR(8) process
+/*	remembers.
+/* .IP "\fBcleanup_connection_reuse_time (0s)\fR"
+/*	The amount of time that a \fBcleanup\fR(8) server connection
+/*	may stay idle between messages, before it is closed.
 /* FILES
 /*	/etc/postfix/canonical*, canonical mapping table
 /*	/etc/postfix/virtual*, virtual mapping table
@@ -511,12 +520,15 @@
 #include <signal.h>
 #include <unistd.h>
 #include <stdlib.h>
+#include <string.h>
+#include <limits.h>
 
 /* Utility library. */
 
 #include <msg.h>
 #include <vstring.h>
 #include <dict.h>
+#include <iostuff.h>
 
 /* Global library. */
 
@@ -536,21 +548,24 @@
 
 #include "cleanup.h"
 
-/* cleanup_service - process one request to inject a message into the queue */
+ /*
+  * The single-server skeleton counts connections toward $max_use, but one
+  * connection may carry many messages. We count messages instead.
+  */
+static int cleanup_use_count;
 
-static void cleanup_service(VSTREAM *src, char *unused_service, char **argv)
+#define CLEANUP_USE_LIMIT_REACHED() \
+	(var_use_limit > 0 && cleanup_use_count >= var_use_limit)
+
+/* cleanup_service_message - inject one message into the queue */
+
+static int cleanup_service_message(VSTREAM *src, VSTRING *buf)
 {
-    VSTRING *buf = vstring_alloc(100);
     CLEANUP_STATE *state;
     int     flags;
     int     type = 0;
     int     status;
-
-    /*
-     * Sanity check. This service takes no command-line arguments.
-     */
-    if (argv[0])
-	msg_fatal("unexpected command-line argument: %s", argv[0]);
+    int     in_sync;
 
     /*
      * Open a queue file and initialize state.
@@ -624,15 +639,58 @@ static void cleanup_service(VSTREAM *src, char *unused_service, char **argv)
     /*
      * Finish this message, and report the result status to the client.
      */
+    in_sync = (type == REC_TYPE_END && vstream_ferror(src) == 0
+	       && (state->errs & CLEANUP_STAT_BAD) == 0);
     status = cleanup_flush(state);		/* in case state is modified */
-    attr_print(src, ATTR_FLAG_NONE,
-	       SEND_ATTR_INT(MAIL_ATTR_STATUS, status),
-	       SEND_ATTR_STR(MAIL_ATTR_WHY,
-			     (state->flags & CLEANUP_FLAG_SMTP_REPLY)
-			     && state->smtp_reply ? state->smtp_reply :
-			     state->reason ? state->reason : ""),
-	       ATTR_TYPE_END);
+    if (attr_print(src, ATTR_FLAG_NONE,
+		   SEND_ATTR_INT(MAIL_ATTR_STATUS, status),
+		   SEND_ATTR_STR(MAIL_ATTR_WHY,
+				 (state->flags & CLEANUP_FLAG_SMTP_REPLY)
+				 && state->smtp_reply ? state->smtp_reply :
+				 state->reason ? state->reason : ""),
+		   ATTR_TYPE_END) != 0
+	|| vstream_fflush(src) != 0)
+	in_sync = 0;
     cleanup_free(state);
+    return (in_sync ? 0 : -1);
+}
+
+/* cleanup_service - process one or more messages from the same client */
+
+static void cleanup_service(VSTREAM *src, char *unused_service, char **argv)
+{
+    VSTRING *buf = vstring_alloc(100);
+
+    /*
+     * Sanity check. This service takes no command-line arguments.
+     */
+    if (argv[0])
+	msg_fatal("unexpected command-line argument: %s", argv[0]);
+
+    /*
+     * After a message completes without protocol error, the client may ask
+     * for another queue file over the same connection. This saves a
+     * connection setup and a master(8) process selection per message. Stop
+     * when the client closes the connection, when it stays idle for too
+     * long, or when a lookup table has changed, or when this process has
+     * handled $max_use messages (the next pre_accept() call will restart
+     * this process).
+     */
+    for (;;) {
+	if (cleanup_use_count < INT_MAX)
+	    cleanup_use_count++;
+	if (cleanup_service_message(src, buf) != 0
+	    || var_cleanup_reuse_time <= 0
+	    || CLEANUP_USE_LIMIT_REACHED()
+	    || dict_changed_name() != 0
+	    || (vstream_peek(src) <= 0
+		&& read_wait(vstream_fileno(src), var_cleanup_reuse_time) < 0)
+	    || attr_scan(src, ATTR_FLAG_STRICT,
+			 RECV_ATTR_STR(MAIL_ATTR_REQ, buf),
+			 ATTR_TYPE_END) != 1
+	    || strcmp(vstring_str(buf), CLEANUP_REQ_NEXT) != 0)
+	    break;
+    }
 
     /*
      * Cleanup.
@@ -640,7 +698,7 @@ static void cleanup_service(VSTREAM *src, char *unused_service, char **argv)
     vstring_free(buf);
 }
 
-/* pre_accept - see if tables have changed */
+/* pre_accept - see if tables have changed, or if we are done */
 
 static void pre_accept(char *unused_name, char **unused_argv)
 {
@@ -648,10 +706,24 @@ static void pre_accept(char *unused_name, char **unused_argv)
 
     if ((table = dict_changed_name()) != 0) {
 	msg_info("table %s has changed -- restarting", table);
+	cleanup_memo_stats();
+	exit(0);
+    }
+    if (CLEANUP_USE_LIMIT_REACHED()) {
+	if (msg_verbose)
+	    msg_info("%d messages handled -- restarting", cleanup_use_count);
+	cleanup_memo_stats();
 	exit(0);
     }
 }
 
+/* pre_exit - log statistics */
+
+static void pre_exit(char *unused_name, char **unused_argv)
+{
+    cleanup_memo_stats();
+}
+
 MAIL_VERSION_STAMP_DECLARE;
 
 /* main - the main program */
@@ -682,6 +754,7 @@ int     main(int argc, char **argv)
 		       CA_MAIL_SERVER_PRE_INIT(cleanup_pre_jail),
 		       CA_MAIL_SERVER_POST_INIT(cleanup_post_jail),
 		       CA_MAIL_SERVER_PRE_ACCEPT(pre_accept),
+		       CA_MAIL_SERVER_EXIT(pre_exit),
 		       CA_MAIL_SERVER_IN_FLOW_DELAY,
 		       CA_MAIL_SERVER_UNLIMITED,
 		       0);
@@ -284,6 +284,21 @@ extern int cleanup_map11_tree(CLEANUP_STATE *, TOK822 *, MAPS *, int);
   */
 ARGV   *cleanup_map1n_internal(CLEANUP_STATE *, const char *, MAPS *, int);
 
+ /*
+  * cleanup_memo.c
+  */
+extern void cleanup_memo_init(int);
+extern const ARGV *cleanup_memo_find(const char *, const char *, int,
+				             const char *, int *);
+extern void cleanup_memo_enter(const char *, const char *, int,
+			               const char *, const ARGV *, int);
+extern int cleanup_memo_maps_ok(MAPS *);
+extern void cleanup_memo_stats(void);
+
+#define CLEANUP_MEMO_REWRITE	"rewrite"
+#define CLEANUP_MEMO_MAP11	"map11"
+#define CLEANUP_MEMO_MAP1N	"map1n"
+
  /*
   * cleanup_masquerade.c
   */
@@ -36,6 +36,7 @@
 /*
 /*	cleanup_map11_external() looks up the external (quoted) string
 /*	form of an address in the maps specified via the \fImaps\fR argument.
+/*	Results are cached with cleanup_memo(3), if the tables allow.
 /*
 /*	cleanup_map11_internal() is a wrapper around the
 /*	cleanup_map11_external() routine that transforms from
@@ -91,10 +92,10 @@
 #define STR		vstring_str
 #define MAX_RECURSION	10
 
-/* cleanup_map11_external - one-to-one table lookups */
+/* cleanup_map11_lookup - one-to-one table lookups */
 
-int     cleanup_map11_external(CLEANUP_STATE *state, VSTRING *addr,
-			               MAPS *maps, int propagate)
+static int cleanup_map11_lookup(CLEANUP_STATE *state, VSTRING *addr,
+				        MAPS *maps, int propagate, int *cacheable)
 {
     int     count;
     int     expand_to_self;
@@ -112,9 +113,11 @@ int     cleanup_map11_external(CLEANUP_STATE *state, VSTRING *addr,
 	if ((new_addr = mail_addr_map_opt(maps, STR(addr), propagate,
 					  MA_FORM_EXTERNAL, MA_FORM_EXTERNAL,
 					  MA_FORM_EXTERNAL)) != 0) {
-	    if (new_addr->argc > 1)
+	    if (new_addr->argc > 1) {
 		msg_warn("%s: multi-valued %s entry for %s",
 			 state->queue_id, maps->title, STR(addr));
+		*cacheable = 0;
+	    }
 	    saved_addr = mystrdup(STR(addr));
 	    did_rewrite |= strcmp(new_addr->argv[0], STR(addr));
 	    vstring_strcpy(addr, new_addr->argv[0]);
@@ -128,6 +131,7 @@ int     cleanup_map11_external(CLEANUP_STATE *state, VSTRING *addr,
 		     "message not accepted, try again later",
 		     state->queue_id, maps->title, STR(addr));
 	    state->errs |= CLEANUP_STAT_WRITE;
+	    *cacheable = 0;
 	    return (did_rewrite);
 	} else {
 	    return (did_rewrite);
@@ -136,6 +140,43 @@ int     cleanup_map11_external(CLEANUP_STATE *state, VSTRING *addr,
     msg_warn("%s: unreasonable %s map nesting for %s -- "
 	     "message not accepted, try again later",
 	     state->queue_id, maps->title, STR(addr));
+    *cacheable = 0;
+    return (did_rewrite);
+}
+
+/* cleanup_map11_external - one-to-one table lookups, with cache */
+
+int     cleanup_map11_external(CLEANUP_STATE *state, VSTRING *addr,
+			               MAPS *maps, int propagate)
+{
+    const ARGV *memo;
+    ARGV   *save;
+    char   *saved_addr;
+    int     did_rewrite;
+    int     cacheable = cleanup_memo_maps_ok(maps);
+
+    /*
+     * Don't remember results that were logged as a problem, so that the
+     * problem is logged again with the next message.
+     */
+    if (cacheable
+	&& (memo = cleanup_memo_find(CLEANUP_MEMO_MAP11, maps->title,
+				     propagate, STR(addr),
+				     &did_rewrite)) != 0) {
+	vstring_strcpy(addr, memo->argv[0]);
+	return (did_rewrite);
+    }
+    saved_addr = mystrdup(STR(addr));
+    did_rewrite = cleanup_map11_lookup(state, addr, maps, propagate,
+				       &cacheable);
+    if (cacheable) {
+	save = argv_alloc(1);
+	argv_add(save, STR(addr), ARGV_END);
+	cleanup_memo_enter(CLEANUP_MEMO_MAP11, maps->title, propagate,
+			   saved_addr, save, did_rewrite);
+	argv_free(save);
+    }
+    myfree(saved_addr);
     return (did_rewrite);
 }
 
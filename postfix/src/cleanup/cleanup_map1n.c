@@ -18,7 +18,8 @@
 /*	left-hand side appears in its own expansion.
 /*
 /*	cleanup_map1n_internal() is the interface for addresses in
-/*	internal (unquoted) form.
+/*	internal (unquoted) form. Results are cached with cleanup_memo(3),
+/*	if the tables allow.
 /* DIAGNOSTICS
 /*	When the maximal expansion or recursion limit is reached,
 /*	the alias is not expanded and the CLEANUP_STAT_DEFER error
@@ -72,10 +73,10 @@
 
 #include "cleanup.h"
 
-/* cleanup_map1n_internal - one-to-many table lookups */
+/* cleanup_map1n_lookup - one-to-many table lookups */
 
-ARGV   *cleanup_map1n_internal(CLEANUP_STATE *state, const char *addr,
-			               MAPS *maps, int propagate)
+static ARGV *cleanup_map1n_lookup(CLEANUP_STATE *state, const char *addr,
+				        MAPS *maps, int propagate, int *cacheable)
 {
     ARGV   *argv;
     ARGV   *lookup;
@@ -118,6 +119,7 @@ ARGV   *cleanup_map1n_internal(CLEANUP_STATE *state, const char *addr,
 		     state->queue_id, maps->title, addr);
 	    state->errs |= CLEANUP_STAT_DEFER;
 	    UPDATE(state->reason, "4.6.0 Alias expansion error");
+	    *cacheable = 0;
 	    UNEXPAND(argv, addr);
 	    RETURN(argv);
 	}
@@ -134,6 +136,7 @@ ARGV   *cleanup_map1n_internal(CLEANUP_STATE *state, const char *addr,
 			 state->queue_id, maps->title, addr);
 		state->errs |= CLEANUP_STAT_DEFER;
 		UPDATE(state->reason, "4.6.0 Alias expansion error");
+		*cacheable = 0;
 		UNEXPAND(argv, addr);
 		RETURN(argv);
 	    }
@@ -147,6 +150,7 @@ ARGV   *cleanup_map1n_internal(CLEANUP_STATE *state, const char *addr,
 			     state->queue_id, maps->title, lookup->argv[i]);
 			state->errs |= CLEANUP_STAT_DEFER;
 			UPDATE(state->reason, "4.6.0 Alias expansion error");
+			*cacheable = 0;
 			UNEXPAND(argv, addr);
 			RETURN(argv);
 		    }
@@ -171,6 +175,7 @@ ARGV   *cleanup_map1n_internal(CLEANUP_STATE *state, const char *addr,
 			 state->queue_id, maps->title, addr);
 		state->errs |= CLEANUP_STAT_WRITE;
 		UPDATE(state->reason, "4.6.0 Alias expansion error");
+		*cacheable = 0;
 		UNEXPAND(argv, addr);
 		RETURN(argv);
 	    } else {
@@ -180,3 +185,27 @@ ARGV   *cleanup_map1n_internal(CLEANUP_STATE *state, const char *addr,
     }
     RETURN(argv);
 }
+
+/* cleanup_map1n_internal - one-to-many table lookups, with cache */
+
+ARGV   *cleanup_map1n_internal(CLEANUP_STATE *state, const char *addr,
+			               MAPS *maps, int propagate)
+{
+    const ARGV *memo;
+    ARGV   *argv;
+    int     cacheable = cleanup_memo_maps_ok(maps);
+
+    /*
+     * Return a copy, because the caller will destroy the result. Don't
+     * remember results that were logged as a problem.
+     */
+    if (cacheable
+	&& (memo = cleanup_memo_find(CLEANUP_MEMO_MAP1N, maps->title,
+				     propagate, addr, (int *) 0)) != 0)
+	return (argv_addv((ARGV *) 0, (const char *const *) memo->argv));
+    argv = cleanup_map1n_lookup(state, addr, maps, propagate, &cacheable);
+    if (cacheable)
+	cleanup_memo_enter(CLEANUP_MEMO_MAP1N, maps->title, propagate,
+			   addr, argv, 0);
+    return (argv);
+}
@@ -0,0 +1,264 @@
+/*++
+/* NAME
+/*	cleanup_memo 3
+/* SUMMARY
+/*	address rewriting result cache
+/* SYNOPSIS
+/*	#include "cleanup.h"
+/*
+/*	void	cleanup_memo_init(cache_size)
+/*	int	cache_size;
+/*
+/*	const ARGV *cleanup_memo_find(kind, name, flags, addr, changed)
+/*	const char *kind;
+/*	const char *name;
+/*	int	flags;
+/*	const char *addr;
+/*	int	*changed;
+/*
+/*	void	cleanup_memo_enter(kind, name, flags, addr, result, changed)
+/*	const char *kind;
+/*	const char *name;
+/*	int	flags;
+/*	const char *addr;
+/*	const ARGV *result;
+/*	int	changed;
+/*
+/*	int	cleanup_memo_maps_ok(maps)
+/*	MAPS	*maps;
+/*
+/*	void	cleanup_memo_stats(void)
+/* DESCRIPTION
+/*	This module remembers the results of address rewriting by
+/*	trivial-rewrite(8), and of canonical and virtual alias table
+/*	lookups, so that an address that appears several times in
+/*	the same message (envelope sender, From:, Sender:, Return-Path:)
+/*	or in a later message handled by the same process is looked
+/*	up only once. The least-recently used result is discarded
+/*	when the cache is full.
+/*
+/*	The cache persists for the lifetime of the process. This
+/*	is safe because a cleanup(8) process terminates when a
+/*	lookup table file has changed, and because results are
+/*	entered only after a lookup completed without error or
+/*	warning. Tables whose changes the process cannot detect,
+/*	such as ldap:, mysql:, proxy: or tcp:, are not cached.
+/*
+/*	cleanup_memo_init() creates the cache. With a cache size
+/*	of zero, caching is disabled, and cleanup_memo_find()
+/*	always returns a null pointer.
+/*
+/*	cleanup_memo_find() looks up a result that was saved with
+/*	cleanup_memo_enter(), and returns a null pointer if none
+/*	is available.
+/*
+/*	cleanup_memo_enter() saves a copy of a result.
+/*
+/*	cleanup_memo_maps_ok() returns non-zero when the results
+/*	of the specified tables may be cached: every table is a
+/*	file with change detection, or its content is loaded into
+/*	memory when the table is opened.
+/*
+/*	cleanup_memo_stats() logs cache hit statistics.
+/*
+/*	Arguments:
+/* .IP cache_size
+/*	The maximal number of cached results.
+/* .IP kind
+/*	The kind of lookup, for example "rewrite" or "map11".
+/* .IP name
+/*	The address rewriting context, or the lookup table title.
+/* .IP flags
+/*	Lookup options, such as address extension propagation.
+/* .IP addr
+/*	The lookup key.
+/* .IP changed
+/*	Whether the lookup changed the address. This is stored
+/*	and returned as is.
+/* .IP result
+/*	One or more addresses.
+/* .IP maps
+/*	Lookup tables.
+/* LICENSE
+/* .ad
+/* .fi
+/*	The Secure Mailer license must be distributed with this software.
+/*--*/
+
+/* System library. */
+
+#include <sys_defs.h>
+#include <string.h>
+
+/* Utility library. */
+
+#include <msg.h>
+#include <mymalloc.h>
+#include <vstring.h>
+#include <argv.h>
+#include <ctable.h>
+#include <dict.h>
+#include <dict_cidr.h>
+#include <dict_pcre.h>
+#include <dict_regexp.h>
+#include <dict_static.h>
+#include <dict_inline.h>
+#include <dict_thash.h>
+#include <dict_fail.h>
+
+/* Application-specific. */
+
+#include "cleanup.h"
+
+ /*
+  * A cache entry is created empty when a key is looked up for the first
+  * time, and is filled in when the caller has a result that may be reused.
+  * An entry that stays empty is recycled like any other.
+  */
+typedef struct {
+    ARGV   *result;			/* null, or one or more addresses */
+    int     changed;			/* lookup changed the address */
+} CLEANUP_MEMO;
+
+static CTABLE *cleanup_memo_cache;
+static VSTRING *cleanup_memo_key;
+static int cleanup_memo_hits;
+static int cleanup_memo_misses;
+
+#define STR(x)	vstring_str(x)
+
+/* cleanup_memo_pagein - create empty cache entry */
+
+static void *cleanup_memo_pagein(const char *unused_key, void *unused_context)
+{
+    CLEANUP_MEMO *memo;
+
+    memo = (CLEANUP_MEMO *) mymalloc(sizeof(*memo));
+    memo->result = 0;
+    memo->changed = 0;
+    return ((void *) memo);
+}
+
+/* cleanup_memo_pageout - destroy cache entry */
+
+static void cleanup_memo_pageout(void *data, void *unused_context)
+{
+    CLEANUP_MEMO *memo = (CLEANUP_MEMO *) data;
+
+    if (memo->result)
+	argv_free(memo->result);
+    myfree((void *) memo);
+}
+
+/* cleanup_memo_init - create cache */
+
+void    cleanup_memo_init(int cache_size)
+{
+    if (cache_size <= 0)
+	return;
+    cleanup_memo_cache = ctable_create(cache_size, cleanup_memo_pagein,
+				       cleanup_memo_pageout, (void *) 0);
+    cleanup_memo_key = vstring_alloc(100);
+}
+
+/* cleanup_memo_locate - look up or create cache entry */
+
+static CLEANUP_MEMO *cleanup_memo_locate(const char *kind, const char *name,
+				               int flags, const char *addr)
+{
+
+    /*
+     * The address goes last, so that it can contain any character.
+     */
+    vstring_sprintf(cleanup_memo_key, "%s\n%s\n%d\n%s",
+		    kind, name, flags, addr);
+    return ((CLEANUP_MEMO *) ctable_locate(cleanup_memo_cache,
+					   STR(cleanup_memo_key)));
+}
+
+/* cleanup_memo_find - look up saved result */
+
+const ARGV *cleanup_memo_find(const char *kind, const char *name, int flags,
+			              const char *addr, int *changed)
+{
+    CLEANUP_MEMO *memo;
+
+    if (cleanup_memo_cache == 0)
+	return (0);
+    memo = cleanup_memo_locate(kind, name, flags, addr);
+    if (memo->result == 0) {
+	cleanup_memo_misses += 1;
+	return (0);
+    }
+    cleanup_memo_hits += 1;
+    if (msg_verbose)
+	msg_info("cleanup_memo_find: %s %s %s -> %s",
+		 kind, name, addr, memo->result->argv[0]);
+    if (changed)
+	*changed = memo->changed;
+    return (memo->result);
+}
+
+/* cleanup_memo_enter - save result */
+
+void    cleanup_memo_enter(const char *kind, const char *name, int flags,
+			           const char *addr, const ARGV *result,
+			           int changed)
+{
+    CLEANUP_MEMO *memo;
+
+    if (cleanup_memo_cache == 0)
+	return;
+    memo = cleanup_memo_locate(kind, name, flags, addr);
+    if (memo->result)
+	argv_free(memo->result);
+    memo->result = argv_addv((ARGV *) 0, (const char *const *) result->argv);
+    memo->changed = changed;
+}
+
+/* cleanup_memo_maps_ok - can we cache results from these tables */
+
+int     cleanup_memo_maps_ok(MAPS *maps)
+{
+    static const char *const loaded_types[] = {
+	DICT_TYPE_CIDR, DICT_TYPE_PCRE, DICT_TYPE_REGEXP, DICT_TYPE_STATIC,
+	DICT_TYPE_INLINE, DICT_TYPE_THASH, DICT_TYPE_FAIL, 0,
+    };
+    const char *const * cpp;
+    char  **map_name;
+    DICT   *dict;
+
+    /*
+     * dict_changed_name() detects changes only for tables that have a file
+     * handle. A multi-writer table may change without a new time stamp.
+     * Tables that are loaded into memory when opened never change in this
+     * process. Anything else, for example a network or proxied table, may
+     * change at any time.
+     */
+    if (cleanup_memo_cache == 0)
+	return (0);
+    for (map_name = maps->argv->argv; *map_name; map_name++) {
+	if ((dict = dict_handle(*map_name)) == 0)
+	    return (0);
+	if (dict->stat_fd >= 0 && (dict->flags & DICT_FLAG_MULTI_WRITER) == 0)
+	    continue;
+	for (cpp = loaded_types; *cpp; cpp++)
+	    if (strcmp(dict->type, *cpp) == 0)
+		break;
+	if (*cpp == 0)
+	    return (0);
+    }
+    return (1);
+}
+
+/* cleanup_memo_stats - log cache statistics */
+
+void    cleanup_memo_stats(void)
+{
+    int     total = cleanup_memo_hits + cleanup_memo_misses;
+
+    if (total > 0)
+	msg_info("statistics: address cache hits=%d miss=%d success=%d%%",
+		 cleanup_memo_hits, cleanup_memo_misses,
+		 cleanup_memo_hits * 100 / total);
+}
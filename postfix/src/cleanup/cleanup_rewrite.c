@@ -28,7 +28,7 @@
 /*	cleanup_rewrite_init() performs one-time initialization.
 /*
 /*	cleanup_rewrite_external() rewrites the external (quoted) string
-/*	form of an address.
+/*	form of an address. Results are cached with cleanup_memo(3).
 /*
 /*	cleanup_rewrite_internal() is a wrapper around the
 /*	cleanup_rewrite_external() routine that transforms from
@@ -66,6 +66,7 @@
 
 #include <msg.h>
 #include <vstring.h>
+#include <argv.h>
 
 /* Global library. */
 
@@ -84,7 +85,20 @@
 int     cleanup_rewrite_external(const char *context_name, VSTRING *result,
 				         const char *addr)
 {
-    rewrite_clnt(context_name, addr, result);
+    const ARGV *memo;
+    ARGV   *save;
+
+    if ((memo = cleanup_memo_find(CLEANUP_MEMO_REWRITE, context_name, 0,
+				  addr, (int *) 0)) != 0) {
+	vstring_strcpy(result, memo->argv[0]);
+    } else {
+	rewrite_clnt(context_name, addr, result);
+	save = argv_alloc(1);
+	argv_add(save, STR(result), ARGV_END);
+	cleanup_memo_enter(CLEANUP_MEMO_REWRITE, context_name, 0,
+			   addr, save, 0);
+	argv_free(save);
+    }
     return (strcmp(STR(result), addr) != 0);
 }
 
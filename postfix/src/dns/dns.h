@@ -353,6 +353,17 @@ extern int dns_rr_filter_execute(DNS_RR **);
   */
 const char *dns_str_resflags(unsigned long);
 
+ /*
+  * dns_prefetch.c.
+  */
+typedef struct DNS_PREFETCH DNS_PREFETCH;
+
+extern DNS_PREFETCH *dns_prefetch_create(void);
+extern void dns_prefetch_add(DNS_PREFETCH *, const char *, unsigned);
+extern int dns_prefetch_wait(DNS_PREFETCH *, int);
+extern void dns_prefetch_reset(DNS_PREFETCH *);
+extern void dns_prefetch_free(DNS_PREFETCH *);
+
  /*
   * dns_sec.c.
   */
@@ -0,0 +1,392 @@
+/*++
+/* NAME
+/*	dns_prefetch 3
+/* SUMMARY
+/*	concurrent DNS resolver cache warming
+/* SYNOPSIS
+/*	#include <dns.h>
+/*
+/*	DNS_PREFETCH *dns_prefetch_create(void)
+/*
+/*	void	dns_prefetch_add(
+/*	DNS_PREFETCH *pf,
+/*	const char *name,
+/*	unsigned type)
+/*
+/*	int	dns_prefetch_wait(
+/*	DNS_PREFETCH *pf,
+/*	int	timeout)
+/*
+/*	void	dns_prefetch_reset(
+/*	DNS_PREFETCH *pf)
+/*
+/*	void	dns_prefetch_free(
+/*	DNS_PREFETCH *pf)
+/* DESCRIPTION
+/*	This module sends a batch of DNS queries to the first
+/*	nameserver in the resolver configuration without waiting
+/*	for each reply in turn. The replies are not parsed; their
+/*	only purpose is to load the answers into the cache of a
+/*	local recursive resolver, so that subsequent blocking
+/*	dns_lookup() calls for the same names complete without
+/*	network round trips. The total latency of a batch is thus
+/*	that of the slowest query, instead of the sum of all queries.
+/*
+/*	dns_prefetch_create() creates a prefetch context with its
+/*	own UDP socket. When the resolver configuration cannot be
+/*	initialized, or when the first nameserver is not an IPv4
+/*	address, the context is created in a disabled state, and
+/*	all other operations are no-ops.
+/*
+/*	dns_prefetch_add() sends a query for the specified name and
+/*	record type, unless an identical query was already sent
+/*	since the last dns_prefetch_reset() call.
+/*
+/*	dns_prefetch_wait() receives replies until all outstanding
+/*	queries are answered or until the timeout (in seconds)
+/*	expires. The result is the number of queries that were
+/*	still unanswered. Those queries are forgotten, so that a
+/*	lost reply delays only one dns_prefetch_wait() call.
+/*
+/*	dns_prefetch_reset() forgets all queries that were sent,
+/*	including queries that are still outstanding.
+/*
+/*	dns_prefetch_free() destroys a prefetch context.
+/* DIAGNOSTICS
+/*	Problems are logged with msg_warn(); they disable the
+/*	context instead of returning an error, because prefetch
+/*	is only an optimization.
+/* SEE ALSO
+/*	dns_lookup(3) domain name service lookup
+/* LICENSE
+/* .ad
+/* .fi
+/*	The Secure Mailer license must be distributed with this software.
+/*--*/
+
+/* System library. */
+
+#include <sys_defs.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/time.h>
+
+#ifdef USE_SYS_SELECT_H
+#include <sys/select.h>
+#endif
+
+/* Utility library. */
+
+#include <mymalloc.h>
+#include <msg.h>
+#include <vstring.h>
+#include <htable.h>
+#include <iostuff.h>
+#include <myrand.h>
+
+/* DNS library. */
+
+#include <dns.h>
+
+ /*
+  * Use the same resolver API as dns_lookup.c, but with a private resolver
+  * state, so that prefetching does not interfere with dns_lookup() options.
+  */
+#ifdef USE_RES_NCALLS
+#define DNS_RES_NINIT		res_ninit
+#define DNS_RES_NMKQUERY	res_nmkquery
+#define DNS_RES_NCLOSE		res_nclose
+#else
+#define DNS_RES_NINIT(statp)	res_init()
+#define DNS_RES_NMKQUERY(statp, op, dname, class, type, data, datalen, \
+		newrr, buf, buflen) \
+	res_mkquery((op), (dname), (class), (type), (data), (datalen), \
+		(newrr), (buf), (buflen))
+#define DNS_RES_NCLOSE(statp)	((void) 0)
+#endif
+
+ /*
+  * Outstanding query IDs are tracked in a bitmap, so that a reply can be
+  * matched with one bit test.
+  */
+#define DNS_PREFETCH_IDS	65536
+#define DNS_PREFETCH_ID_BYTES	(DNS_PREFETCH_IDS / 8)
+#define DNS_PREFETCH_ID_TEST(pf, id) ((pf)->ids[(id) >> 3] & (1 << ((id) & 7)))
+#define DNS_PREFETCH_ID_SET(pf, id) ((pf)->ids[(id) >> 3] |= (1 << ((id) & 7)))
+#define DNS_PREFETCH_ID_CLR(pf, id) ((pf)->ids[(id) >> 3] &= ~(1 << ((id) & 7)))
+
+struct DNS_PREFETCH {
+    int     sock;			/* UDP socket, or -1 if disabled */
+    struct sockaddr_in server;		/* first nameserver */
+    HTABLE *sent;			/* "type/name" queries sent */
+    int     pending;			/* unanswered queries */
+    unsigned char *ids;			/* outstanding query IDs */
+    VSTRING *key;			/* scratch */
+#ifdef USE_RES_NCALLS
+    struct __res_state res_state;	/* private resolver state */
+#endif
+};
+
+#ifdef USE_RES_NCALLS
+#define DNS_PREFETCH_RES(pf)	(&(pf)->res_state)
+#define DNS_PREFETCH_NSADDR(pf)	((pf)->res_state.nsaddr_list[0])
+#define DNS_PREFETCH_NSCOUNT(pf) ((pf)->res_state.nscount)
+#else
+#define DNS_PREFETCH_RES(pf)	(&_res)
+#define DNS_PREFETCH_NSADDR(pf)	(_res.nsaddr_list[0])
+#define DNS_PREFETCH_NSCOUNT(pf) (_res.nscount)
+#endif
+
+/* dns_prefetch_create - create prefetch context */
+
+DNS_PREFETCH *dns_prefetch_create(void)
+{
+    DNS_PREFETCH *pf = (DNS_PREFETCH *) mymalloc(sizeof(*pf));
+
+    pf->sock = -1;
+    pf->sent = htable_create(13);
+    pf->pending = 0;
+    pf->ids = (unsigned char *) mymalloc(DNS_PREFETCH_ID_BYTES);
+    memset(pf->ids, 0, DNS_PREFETCH_ID_BYTES);
+    pf->key = vstring_alloc(100);
+#ifdef USE_RES_NCALLS
+    memset(&pf->res_state, 0, sizeof(pf->res_state));
+#endif
+
+    /*
+     * Prefetching is an optimization; if anything is amiss, run without it.
+     */
+    if (DNS_RES_NINIT(DNS_PREFETCH_RES(pf)) < 0) {
+	msg_warn("dns_prefetch: name service initialization failure");
+    } else if (DNS_PREFETCH_NSCOUNT(pf) < 1
+	       || DNS_PREFETCH_NSADDR(pf).sin_family != AF_INET) {
+	if (msg_verbose)
+	    msg_info("dns_prefetch: no IPv4 nameserver - prefetch disabled");
+    } else if ((pf->sock = socket(AF_INET, SOCK_DGRAM, 0)) < 0) {
+	msg_warn("dns_prefetch: socket: %m");
+    } else if (pf->sock >= FD_SETSIZE) {
+	msg_warn("dns_prefetch: descriptor %d does not fit FD_SETSIZE %d",
+		 pf->sock, FD_SETSIZE);
+	(void) close(pf->sock);
+	pf->sock = -1;
+    } else {
+	pf->server = DNS_PREFETCH_NSADDR(pf);
+	non_blocking(pf->sock, NON_BLOCKING);
+	close_on_exec(pf->sock, CLOSE_ON_EXEC);
+    }
+    return (pf);
+}
+
+/* dns_prefetch_add - send one query, unless already sent */
+
+void    dns_prefetch_add(DNS_PREFETCH *pf, const char *name, unsigned type)
+{
+    const char *myname = "dns_prefetch_add";
+    unsigned char query[PACKETSZ];
+    HEADER *hp = (HEADER *) query;
+    int     len;
+    int     id;
+
+    if (pf->sock < 0)
+	return;
+
+    /*
+     * Skip queries that were already sent.
+     */
+    vstring_sprintf(pf->key, "%u/%s", type, name);
+    if (htable_locate(pf->sent, vstring_str(pf->key)) != 0)
+	return;
+    (void) htable_enter(pf->sent, vstring_str(pf->key), (void *) 0);
+
+    /*
+     * Pick an ID that is not outstanding. With at most a few dozen queries
+     * per batch, this terminates quickly.
+     */
+    if (pf->pending >= DNS_PREFETCH_IDS / 2)
+	return;
+    do {
+	id = myrand() & (DNS_PREFETCH_IDS - 1);
+    } while (DNS_PREFETCH_ID_TEST(pf, id));
+
+    if ((len = DNS_RES_NMKQUERY(DNS_PREFETCH_RES(pf), QUERY, name, C_IN,
+				type, (unsigned char *) 0, 0,
+				(unsigned char *) 0, query,
+				sizeof(query))) < 0) {
+	if (msg_verbose)
+	    msg_info("%s: res_nmkquery(%s, %s) failed",
+		     myname, name, dns_strtype(type));
+	return;
+    }
+    hp->id = htons(id);
+    if (sendto(pf->sock, (void *) query, len, 0,
+	       (struct sockaddr *) &pf->server, sizeof(pf->server)) != len) {
+	if (errno != EAGAIN)
+	    msg_warn("%s: sendto: %m", myname);
+	return;
+    }
+    DNS_PREFETCH_ID_SET(pf, id);
+    pf->pending += 1;
+    if (msg_verbose)
+	msg_info("%s: %s %s id=%d", myname, dns_strtype(type), name, id);
+}
+
+/* dns_prefetch_wait - receive replies until done or timeout */
+
+int     dns_prefetch_wait(DNS_PREFETCH *pf, int timeout)
+{
+    unsigned char reply[PACKETSZ];
+    HEADER *hp = (HEADER *) reply;
+    struct sockaddr_in from;
+    SOCKADDR_SIZE from_len;
+    struct timeval deadline;
+    struct timeval now;
+    struct timeval left;
+    fd_set  read_fds;
+    ssize_t len;
+    int     id;
+    int     count;
+
+    if (pf->sock < 0 || pf->pending == 0)
+	return (0);
+
+    /*
+     * With a whole-second clock, the time to wait would be anywhere between
+     * timeout-1 and timeout seconds, and read_wait() would round up any
+     * time that is left after a reply. Instead, wait with microsecond
+     * precision. dns_prefetch_create() ensures that the socket fits an
+     * fd_set.
+     */
+    GETTIMEOFDAY(&deadline);
+    deadline.tv_sec += timeout;
+    while (pf->pending > 0) {
+	from_len = sizeof(from);
+	if ((len = recvfrom(pf->sock, (void *) reply, sizeof(reply), 0,
+			    (struct sockaddr *) &from, &from_len)) < 0) {
+	    if (errno != EAGAIN && errno != EINTR) {
+		msg_warn("dns_prefetch_wait: recvfrom: %m");
+		break;
+	    }
+	    GETTIMEOFDAY(&now);
+	    left.tv_sec = deadline.tv_sec - now.tv_sec;
+	    left.tv_usec = deadline.tv_usec - now.tv_usec;
+	    if (left.tv_usec < 0) {
+		left.tv_usec += 1000000;
+		left.tv_sec -= 1;
+	    }
+	    if (left.tv_sec < 0)
+		break;
+	    FD_ZERO(&read_fds);
+	    FD_SET(pf->sock, &read_fds);
+	    if (select(pf->sock + 1, &read_fds, (fd_set *) 0, (fd_set *) 0,
+		       &left) == 0)
+		break;
+	    continue;
+	}
+	if (len < HFIXEDSZ
+	    || from.sin_addr.s_addr != pf->server.sin_addr.s_addr
+	    || from.sin_port != pf->server.sin_port)
+	    continue;
+	id = ntohs(hp->id);
+	if (DNS_PREFETCH_ID_TEST(pf, id)) {
+	    DNS_PREFETCH_ID_CLR(pf, id);
+	    pf->pending -= 1;
+	}
+    }
+    if ((count = pf->pending) > 0) {
+	if (msg_verbose)
+	    msg_info("dns_prefetch_wait: %d replies still outstanding",
+		     count);
+	memset(pf->ids, 0, DNS_PREFETCH_ID_BYTES);
+	pf->pending = 0;
+    }
+    return (count);
+}
+
+/* dns_prefetch_reset - forget all queries */
+
+void    dns_prefetch_reset(DNS_PREFETCH *pf)
+{
+    if (pf->sent->used > 0) {
+	htable_free(pf->sent, (void (*) (void *)) 0);
+	pf->sent = htable_create(13);
+    }
+    if (pf->pending > 0) {
+	memset(pf->ids, 0, DNS_PREFETCH_ID_BYTES);
+	pf->pending = 0;
+    }
+}
+
+/* dns_prefetch_free - destroy prefetch context */
+
+void    dns_prefetch_free(DNS_PREFETCH *pf)
+{
+    if (pf->sock >= 0)
+	(void) close(pf->sock);
+    htable_free(pf->sent, (void (*) (void *)) 0);
+    myfree((void *) pf->ids);
+    vstring_free(pf->key);
+#ifdef USE_RES_NCALLS
+    DNS_RES_NCLOSE(&pf->res_state);
+#endif
+    myfree((void *) pf);
+}
+
+#ifdef TEST
+
+ /*
+  * Proof-of-concept test program. Prefetch the named queries, then report
+  * how many replies arrived in time.
+  */
+#include <stdlib.h>
+#include <msg_vstream.h>
+#include <mymalloc.h>
+
+static NORETURN usage(const char *myname)
+{
+    msg_fatal("usage: %s [-v] [-t timeout] type:name...", myname);
+}
+
+int     main(int argc, char **argv)
+{
+    DNS_PREFETCH *pf;
+    int     timeout = 5;
+    unsigned type;
+    char   *name;
+    char   *cp;
+    int     ch;
+
+    msg_vstream_init(argv[0], VSTREAM_ERR);
+    while ((ch = GETOPT(argc, argv, "t:v")) > 0) {
+	switch (ch) {
+	case 't':
+	    timeout = atoi(optarg);
+	    break;
+	case 'v':
+	    msg_verbose++;
+	    break;
+	default:
+	    usage(argv[0]);
+	}
+    }
+    if (optind == argc)
+	usage(argv[0]);
+    pf = dns_prefetch_create();
+    for ( /* void */ ; optind < argc; optind++) {
+	cp = mystrdup(argv[optind]);
+	if ((name = strchr(cp, ':')) == 0)
+	    usage(argv[0]);
+	*name++ = 0;
+	if ((type = dns_type(cp)) == 0)
+	    msg_fatal("invalid query type: %s", cp);
+	dns_prefetch_add(pf, name, type);
+	myfree(cp);
+    }
+    msg_info("%d replies outstanding", dns_prefetch_wait(pf, timeout));
+    dns_prefetch_free(pf);
+    exit(0);
+}
+
+#endif
@@ -7,6 +7,9 @@
 /* .fi
 /*	\fBfsstone\fR [\fB-cr\fR] [\fB-s \fIsize\fR]
 /*		\fImsg_count files_per_dir\fR
+/*
+/*	\fBfsstone\fR \fB-q \fIlayout\fR [\fB-d \fIdepth\fR]
+/*		[\fB-s \fIsize\fR] \fImsg_count files_per_dir\fR
 /* DESCRIPTION
 /*	The \fBfsstone\fR command measures the cost of creating, renaming
 /*	and deleting queue files versus appending messages to existing
@@ -16,9 +19,31 @@
 /*	and arranges for at most \fIfiles_per_dir\fR simultaneous files
 /*	in the same directory.
 /*
+/*	With \fB-q\fR, the program instead compares Postfix queue
+/*	directory layouts, using the same mail_queue(3) and
+/*	mail_scan_dir(3) routines as Postfix itself. It creates
+/*	\fBincoming\fR, \fBactive\fR and \fBdeferred\fR
+/*	subdirectories in the current directory, and fills the
+/*	\fBdeferred\fR queue with a backlog of \fIfiles_per_dir\fR
+/*	files. For each of \fImsg_count\fR simulated messages, it
+/*	creates a file with a long queue ID in \fBincoming\fR, moves
+/*	it through \fBactive\fR into \fBdeferred\fR, and deletes
+/*	the oldest \fBdeferred\fR file. Finally, it scans the
+/*	\fBdeferred\fR queue once. The program reports the average
+/*	time per create, rename, unlink and scanned file. Files are
+/*	not fsync()ed, so that directory operation costs dominate.
+/*	Queue IDs use synthetic inode numbers.
+/*
 /*	Options:
 /* .IP \fB-c\fR
 /*	Create and delete files.
+/* .IP "\fB-d \fIdepth\fR"
+/*	The number of hashed subdirectory levels (default: 1). See
+/*	the \fBhash_queue_depth\fR parameter.
+/* .IP "\fB-q \fIlayout\fR"
+/*	Simulate a queue with the specified directory layout:
+/*	\fBflat\fR (no hashing), or one of the \fBhash_queue_style\fR
+/*	values \fBclassic\fR or \fBfanout\fR.
 /* .IP \fB-r\fR
 /*	Rename files twice (requires \fB-c\fR).
 /* .IP \fB-s \fIsize\fR
@@ -27,10 +52,11 @@
 /*	Problems are reported to the standard error stream.
 /* BUGS
 /*	The \fB-r\fR option renames files within the same directory.
-/*	For a more realistic simulation, the program should rename files
-/*	<i>between</i> directories, and should also have an option to use
-/*	<i>hashed</i> directories as implemented with, for example, the
-/*	\fBdir_forest\fR(3) module.
+/*	Use \fB-q\fR for a simulation that renames files between
+/*	(hashed) queue directories.
+/*
+/*	With \fB-q\fR, the queue directories are left behind
+/*	(empty) after the program terminates.
 /* LICENSE
 /* .ad
 /* .fi
@@ -50,15 +76,24 @@
 #include <unistd.h>
 #include <string.h>
 #include <sys/time.h>
+#include <fcntl.h>
+#include <errno.h>
 
 /* Utility library. */
 
 #include <msg.h>
 #include <msg_vstream.h>
+#include <mymalloc.h>
+#include <vstring.h>
+#include <scan_dir.h>
 
 /* Global directory. */
 
 #include <mail_version.h>
+#include <mail_params.h>
+#define MAIL_QUEUE_INTERNAL
+#include <mail_queue.h>
+#include <mail_scan_dir.h>
 
 /* rename_file - rename a file */
 
@@ -149,11 +184,146 @@ static void remove_silent(int seq)
     (void) remove(path);
 }
 
+/* elapsed_us - microseconds since start */
+
+static double elapsed_us(struct timeval *start)
+{
+    struct timeval now;
+
+    GETTIMEOFDAY(&now);
+    return ((now.tv_sec - start->tv_sec) * 1e6
+	    + (now.tv_usec - start->tv_usec));
+}
+
+/* queue_file_id - generate long queue ID */
+
+static const char *queue_file_id(VSTRING *buf, unsigned long inum)
+{
+    static VSTRING *sec_buf;
+    static VSTRING *usec_buf;
+    static VSTRING *inum_buf;
+    struct timeval tv;
+
+    if (sec_buf == 0) {
+	sec_buf = vstring_alloc(10);
+	usec_buf = vstring_alloc(10);
+	inum_buf = vstring_alloc(10);
+    }
+    GETTIMEOFDAY(&tv);
+    vstring_sprintf(buf, "%s%s%c%s",
+		    MQID_LG_ENCODE_SEC(sec_buf, tv.tv_sec),
+		    MQID_LG_ENCODE_USEC(usec_buf, tv.tv_usec),
+		    MQID_LG_INUM_SEP,
+		    MQID_LG_ENCODE_INUM(inum_buf, inum));
+    return (vstring_str(buf));
+}
+
+/* queue_create - create queue file */
+
+static void queue_create(const char *queue, const char *id, int size)
+{
+    static VSTRING *path_buf;
+    const char *path;
+    char    buf[1024];
+    int     fd;
+    int     i;
+
+    if (path_buf == 0)
+	path_buf = vstring_alloc(100);
+    path = mail_queue_path(path_buf, queue, id);
+    if ((fd = open(path, O_CREAT | O_EXCL | O_WRONLY, 0600)) < 0
+	&& (errno != ENOENT || mail_queue_mkdirs(path) != 0
+	    || (fd = open(path, O_CREAT | O_EXCL | O_WRONLY, 0600)) < 0))
+	msg_fatal("open %s: %m", path);
+    memset(buf, 'x', sizeof(buf));
+    for (i = 0; i < size; i++)
+	if (write(fd, buf, sizeof(buf)) != sizeof(buf))
+	    msg_fatal("write %s: %m", path);
+    if (close(fd))
+	msg_fatal("close %s: %m", path);
+}
+
+/* queue_bench - compare queue directory layouts */
+
+static void queue_bench(int op_count, int backlog, int size)
+{
+    VSTRING *id_buf = vstring_alloc(30);
+    char  **ids = (char **) mymalloc(sizeof(*ids) * backlog);
+    unsigned long inum = 1000;
+    double  create_us = 0;
+    double  rename_us = 0;
+    double  unlink_us = 0;
+    double  scan_us;
+    struct timeval start;
+    SCAN_DIR *scan;
+    const char *id;
+    int     count;
+    int     n;
+
+    /*
+     * Populate the deferred queue with a backlog.
+     */
+    for (n = 0; n < backlog; n++) {
+	id = queue_file_id(id_buf, inum++);
+	queue_create(MAIL_QUEUE_DEFERRED, id, size);
+	ids[n] = mystrdup(id);
+    }
+
+    /*
+     * Simulate arrival, deferral, and expiration of mail messages.
+     */
+    for (n = 0; n < op_count; n++) {
+	id = queue_file_id(id_buf, inum++);
+	GETTIMEOFDAY(&start);
+	queue_create(MAIL_QUEUE_INCOMING, id, size);
+	create_us += elapsed_us(&start);
+	GETTIMEOFDAY(&start);
+	if (mail_queue_rename(id, MAIL_QUEUE_INCOMING, MAIL_QUEUE_ACTIVE)
+	    || mail_queue_rename(id, MAIL_QUEUE_ACTIVE, MAIL_QUEUE_DEFERRED))
+	    msg_fatal("rename %s: %m", id);
+	rename_us += elapsed_us(&start);
+	GETTIMEOFDAY(&start);
+	if (mail_queue_remove(MAIL_QUEUE_DEFERRED, ids[n % backlog]))
+	    msg_fatal("remove %s: %m", ids[n % backlog]);
+	unlink_us += elapsed_us(&start);
+	myfree(ids[n % backlog]);
+	ids[n % backlog] = mystrdup(id);
+    }
+
+    /*
+     * Scan the deferred queue as the queue manager would.
+     */
+    GETTIMEOFDAY(&start);
+    scan = scan_dir_open(MAIL_QUEUE_DEFERRED);
+    for (count = 0; mail_scan_dir_next(scan) != 0; count++)
+	 /* void */ ;
+    scan_dir_close(scan);
+    scan_us = elapsed_us(&start);
+    if (count != backlog)
+	msg_warn("scan found %d files, expected %d", count, backlog);
+
+    printf("create: %.2f us/op\n", create_us / op_count);
+    printf("rename: %.2f us/op\n", rename_us / (2 * op_count));
+    printf("unlink: %.2f us/op\n", unlink_us / op_count);
+    printf("scan:   %.2f us/file (%d files)\n", scan_us / count, count);
+
+    /*
+     * Clean up the backlog.
+     */
+    for (n = 0; n < backlog; n++) {
+	(void) mail_queue_remove(MAIL_QUEUE_DEFERRED, ids[n]);
+	myfree(ids[n]);
+    }
+    myfree((void *) ids);
+    vstring_free(id_buf);
+}
+
 /* usage - explain */
 
 static void usage(char *myname)
 {
-    msg_fatal("usage: %s [-cr] [-s size] messages directory_entries", myname);
+    msg_fatal("usage: %s [-cr] [-q layout [-d depth]] [-s size] "
+	      "messages directory_entries", myname);
 }
 
 MAIL_VERSION_STAMP_DECLARE;
@@ -168,6 +338,8 @@ int     main(int argc, char **argv)
     int     seq;
     int     ch;
     int     size = 2;
+    char   *layout = 0;
+    int     depth = 1;
 
     /*
      * Fingerprint executables and core dumps.
@@ -175,11 +347,18 @@ int     main(int argc, char **argv)
     MAIL_VERSION_STAMP_ALLOCATE;
 
     msg_vstream_init(argv[0], VSTREAM_ERR);
-    while ((ch = GETOPT(argc, argv, "crs:")) != EOF) {
+    while ((ch = GETOPT(argc, argv, "cd:q:rs:")) != EOF) {
 	switch (ch) {
 	case 'c':
 	    do_create++;
 	    break;
+	case 'd':
+	    if ((depth = atoi(optarg)) <= 0)
+		usage(argv[0]);
+	    break;
+	case 'q':
+	    layout = optarg;
+	    break;
 	case 'r':
 	    do_rename++;
 	    break;
@@ -192,13 +371,32 @@ int     main(int argc, char **argv)
 	}
     }
 
-    if (argc - optind != 2 || (do_rename && !do_create))
+    if (argc - optind != 2 || (do_rename && !do_create)
+	|| (layout != 0 && (do_create || do_rename)))
 	usage(argv[0]);
     if ((op_count = atoi(argv[optind])) <= 0)
 	usage(argv[0]);
     if ((max_file = atoi(argv[optind + 1])) <= 0)
 	usage(argv[0]);
 
+    /*
+     * Simulate a Postfix queue with the requested layout, without reading
+     * main.cf.
+     */
+    if (layout != 0) {
+	if (strcmp(layout, "flat") == 0) {
+	    var_hash_queue_names = "";
+	    var_hash_queue_style = DEF_HASH_QUEUE_STYLE;
+	} else {
+	    var_hash_queue_names = "incoming, active, deferred";
+	    var_hash_queue_style = layout;
+	}
+	var_hash_queue_depth = depth;
+	(void) mail_queue_hash_style();
+	queue_bench(op_count, max_file, size);
+	return (0);
+    }
+
     /*
      * Populate the directory with little files.
      */
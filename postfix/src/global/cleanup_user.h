@@ -47,6 +47,12 @@
 #define CLEANUP_FLAG_MASK_EXTRA \
 	(CLEANUP_FLAG_HOLD | CLEANUP_FLAG_DISCARD)
 
+ /*
+  * After the completion status, a client may request another queue file
+  * over the same connection, instead of closing the connection.
+  */
+#define CLEANUP_REQ_NEXT	"next_message"
+
  /*
   * Diagnostics.
   * 
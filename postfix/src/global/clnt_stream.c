@@ -22,6 +22,9 @@
 /*	void	clnt_stream_recover(clnt_stream)
 /*	CLNT_STREAM *clnt_stream;
 /*
+/*	long	clnt_stream_serial(clnt_stream)
+/*	CLNT_STREAM *clnt_stream;
+/*
 /*	void	clnt_stream_free(clnt_stream)
 /*	CLNT_STREAM *clnt_stream;
 /* DESCRIPTION
@@ -43,6 +46,11 @@
 /*	clnt_stream_recover() recovers from a server-initiated disconnect
 /*	that happened in the middle of an I/O operation.
 /*
+/*	clnt_stream_serial() returns a number that changes each time
+/*	a new connection is made. This allows a client to remember
+/*	a property of the server at the other end of the current
+/*	connection.
+/*
 /*	clnt_stream_free() destroys of the specified client endpoint.
 /*
 /*	Arguments:
@@ -109,6 +117,7 @@ struct CLNT_STREAM {
     int     timeout;			/* time before client disconnect */
     int     ttl;			/* time before client disconnect */
     CLNT_STREAM_HANDSHAKE_FN handshake;
+    long    serial;			/* connection count */
     char   *class;			/* server class */
     char   *service;			/* server name */
 };
@@ -173,6 +182,7 @@ static void clnt_stream_open(CLNT_STREAM *clnt_stream)
      */
     clnt_stream->vstream = mail_connect_wait(clnt_stream->class,
 					     clnt_stream->service);
+    clnt_stream->serial += 1;
     close_on_exec(vstream_fileno(clnt_stream->vstream), CLOSE_ON_EXEC);
     event_enable_read(vstream_fileno(clnt_stream->vstream), clnt_stream_event,
 		      (void *) clnt_stream);
@@ -245,6 +255,13 @@ VSTREAM *clnt_stream_access(CLNT_STREAM *clnt_stream)
     return (clnt_stream->vstream);
 }
 
+/* clnt_stream_serial - identify current connection */
+
+long    clnt_stream_serial(CLNT_STREAM *clnt_stream)
+{
+    return (clnt_stream->serial);
+}
+
 /* clnt_stream_create - create client stream connection */
 
 CLNT_STREAM *clnt_stream_create(const char *class, const char *service,
@@ -258,6 +275,7 @@ CLNT_STREAM *clnt_stream_create(const char *class, const char *service,
      */
     clnt_stream = (CLNT_STREAM *) mymalloc(sizeof(*clnt_stream));
     clnt_stream->vstream = 0;
+    clnt_stream->serial = 0;
     clnt_stream->timeout = timeout;
     clnt_stream->ttl = ttl;
     clnt_stream->handshake = handshake;
@@ -27,6 +27,7 @@ extern CLNT_STREAM *clnt_stream_create(const char *, const char *, int, int,
 extern VSTREAM *clnt_stream_access(CLNT_STREAM *);
 extern const char *clnt_stream_path(CLNT_STREAM *);
 extern void clnt_stream_recover(CLNT_STREAM *);
+extern long clnt_stream_serial(CLNT_STREAM *);
 extern void clnt_stream_free(CLNT_STREAM *);
 
 /* LICENSE
@@ -139,7 +139,8 @@ int     mail_copy(const char *sender,
 {
     const char *myname = "mail_copy";
     VSTRING *buf;
-    char   *bp;
+    const char *bp;
+    ssize_t len;
     off_t   orig_length;
     int     read_error;
     int     write_error;
@@ -222,22 +223,23 @@ int     mail_copy(const char *sender,
      * software.
      * 
      * XXX Rely on the front-end services to enforce record size limits.
+     * 
+     * Use rec_get_view() so that most records are copied straight from the
+     * queue file read buffer. The result is not null-terminated.
      */
-#define VSTREAM_FWRITE_BUF(s,b) \
-	vstream_fwrite((s),vstring_str(b),VSTRING_LEN(b))
-
     prev_type = REC_TYPE_NORM;
-    while ((type = rec_get(src, buf, 0)) > 0) {
+    while ((type = rec_get_view(src, buf, 0, REC_FLAG_DEFAULT,
+				&bp, &len)) > 0) {
 	if (type != REC_TYPE_NORM && type != REC_TYPE_CONT)
 	    break;
-	bp = vstring_str(buf);
-	if (prev_type == REC_TYPE_NORM) {
-	    if ((flags & MAIL_COPY_QUOTE) && *bp == 'F' && !strncmp(bp, "From ", 5))
+	if (prev_type == REC_TYPE_NORM && len > 0) {
+	    if ((flags & MAIL_COPY_QUOTE) && *bp == 'F' && len >= 5
+		&& !strncmp(bp, "From ", 5))
 		VSTREAM_PUTC('>', dst);
 	    if ((flags & MAIL_COPY_DOT) && *bp == '.')
 		VSTREAM_PUTC('.', dst);
 	}
-	if (VSTRING_LEN(buf) && VSTREAM_FWRITE_BUF(dst, buf) != VSTRING_LEN(buf))
+	if (len && vstream_fwrite(dst, bp, len) != len)
 	    break;
 	if (type == REC_TYPE_NORM && vstream_fputs(eol, dst) == VSTREAM_EOF)
 	    break;
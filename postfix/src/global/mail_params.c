@@ -56,6 +56,7 @@
 /*	char	*var_db_type;
 /*	char	*var_hash_queue_names;
 /*	int	var_hash_queue_depth;
+/*	char	*var_hash_queue_style;
 /*	int	var_trigger_timeout;
 /*	char	*var_rcpt_delim;
 /*	int	var_fork_tries;
@@ -86,6 +87,7 @@
 /*	int	var_fault_inj_code;
 /*	char   *var_bounce_service;
 /*	char   *var_cleanup_service;
+/*	int	var_cleanup_reuse_time;
 /*	char   *var_defer_service;
 /*	char   *var_pickup_service;
 /*	char   *var_queue_service;
@@ -296,6 +298,7 @@ int     var_ipc_ttl_limit;
 char   *var_db_type;
 char   *var_hash_queue_names;
 int     var_hash_queue_depth;
+char   *var_hash_queue_style;
 int     var_trigger_timeout;
 char   *var_rcpt_delim;
 int     var_fork_tries;
@@ -326,6 +329,7 @@ int     var_debug_peer_level;
 int     var_fault_inj_code;
 char   *var_bounce_service;
 char   *var_cleanup_service;
+int     var_cleanup_reuse_time;
 char   *var_defer_service;
 char   *var_pickup_service;
 char   *var_queue_service;
@@ -824,6 +828,7 @@ void    mail_params_init()
 	VAR_MAIL_RELEASE, DEF_MAIL_RELEASE, &var_mail_release, 1, 0,
 	VAR_DB_TYPE, DEF_DB_TYPE, &var_db_type, 1, 0,
 	VAR_HASH_QUEUE_NAMES, DEF_HASH_QUEUE_NAMES, &var_hash_queue_names, 1, 0,
+	VAR_HASH_QUEUE_STYLE, DEF_HASH_QUEUE_STYLE, &var_hash_queue_style, 1, 0,
 	VAR_RCPT_DELIM, DEF_RCPT_DELIM, &var_rcpt_delim, 0, 0,
 	VAR_RELAY_DOMAINS, DEF_RELAY_DOMAINS, &var_relay_domains, 0, 0,
 	VAR_FFLUSH_DOMAINS, DEF_FFLUSH_DOMAINS, &var_fflush_domains, 0, 0,
@@ -899,6 +904,7 @@ void    mail_params_init()
 	VAR_FLOCK_STALE, DEF_FLOCK_STALE, &var_flock_stale, 1, 0,
 	VAR_DAEMON_TIMEOUT, DEF_DAEMON_TIMEOUT, &var_daemon_timeout, 1, 0,
 	VAR_IN_FLOW_DELAY, DEF_IN_FLOW_DELAY, &var_in_flow_delay, 0, 10,
+	VAR_CLEANUP_REUSE_TIME, DEF_CLEANUP_REUSE_TIME, &var_cleanup_reuse_time, 0, 0,
 	0,
     };
     static const CONFIG_BOOL_TABLE bool_defaults[] = {
@@ -723,6 +723,14 @@ extern bool var_stat_home_dir;
 #define DEF_DUP_FILTER_LIMIT	1000
 extern int var_dup_filter_limit;
 
+ /*
+  * Cleanup server: maximal number of cached address rewriting and canonical
+  * or virtual alias lookup results.
+  */
+#define VAR_CLEANUP_ADDR_CACHE	"cleanup_address_cache_size"
+#define DEF_CLEANUP_ADDR_CACHE	1000
+extern int var_cleanup_addr_cache;
+
  /*
   * Transport Layer Security (TLS) protocol support.
   */
@@ -923,6 +931,13 @@ extern char *var_defer_xports;
 #define DEF_QMGR_CLOG_WARN_TIME	"300s"
 extern int var_qmgr_clog_warn_time;
 
+ /*
+  * Queue manager: split the queue over multiple queue manager processes.
+  */
+#define VAR_QMGR_SHARD_SERVICES	"qmgr_shard_services"
+#define DEF_QMGR_SHARD_SERVICES	""
+extern char *var_qmgr_shard_services;
+
  /*
   * Master: default process count limit per mail subsystem.
   */
@@ -937,6 +952,20 @@ extern int var_proc_limit;
 #define DEF_THROTTLE_TIME	"60s"
 extern int var_throttle_time;
 
+ /*
+  * Master: number of idle processes to keep ready per service.
+  */
+#define VAR_SERVICE_MIN_IDLE	"service_min_idle"
+#define DEF_SERVICE_MIN_IDLE	0
+extern int var_service_min_idle;
+
+ /*
+  * Master: give each inet service process its own SO_REUSEPORT listener.
+  */
+#define VAR_SERVICE_REUSEPORT	"service_reuseport_listeners"
+#define DEF_SERVICE_REUSEPORT	0
+extern bool var_service_reuseport;
+
  /*
   * Master: what master.cf services are turned off.
   */
@@ -1006,7 +1035,8 @@ extern int var_debug_peer_level;
 
  /*
   * Queue management: what queues are hashed behind a forest of
-  * subdirectories, and how deep the forest is.
+  * subdirectories, how deep the forest is, and how the subdirectory names
+  * are derived from the queue ID.
   */
 #define VAR_HASH_QUEUE_NAMES	"hash_queue_names"
 #define DEF_HASH_QUEUE_NAMES	"deferred, defer"
@@ -1016,6 +1046,10 @@ extern char *var_hash_queue_names;
 #define DEF_HASH_QUEUE_DEPTH	1
 extern int var_hash_queue_depth;
 
+#define VAR_HASH_QUEUE_STYLE	"hash_queue_style"
+#define DEF_HASH_QUEUE_STYLE	"classic"
+extern char *var_hash_queue_style;
+
  /*
   * Short queue IDs contain the time in microseconds and file inode number.
   * Long queue IDs also contain the time in seconds.
@@ -2892,6 +2926,13 @@ extern char *var_bounce_service;
 #define DEF_CLEANUP_SERVICE		MAIL_SERVICE_CLEANUP
 extern char *var_cleanup_service;
 
+ /*
+  * How long a cleanup server connection may stay idle between messages.
+  */
+#define VAR_CLEANUP_REUSE_TIME		"cleanup_connection_reuse_time"
+#define DEF_CLEANUP_REUSE_TIME		"0s"
+extern int var_cleanup_reuse_time;
+
 #define VAR_DEFER_SERVICE		"defer_service_name"
 #define DEF_DEFER_SERVICE		MAIL_SERVICE_DEFER
 extern char *var_defer_service;
@@ -2996,6 +3037,18 @@ extern int var_verify_poll_count;
 #define DEF_VERIFY_POLL_DELAY		"3s"
 extern int var_verify_poll_delay;
 
+#define VAR_VERIFY_MMAP_FILE		"address_verify_shared_cache_file"
+#define DEF_VERIFY_MMAP_FILE		""
+extern char *var_verify_mmap_file;
+
+#define VAR_VERIFY_MMAP_SLOTS		"address_verify_shared_cache_slots"
+#define DEF_VERIFY_MMAP_SLOTS		100000
+extern int var_verify_mmap_slots;
+
+#define VAR_VERIFY_STAT_TIME		"address_verify_status_update_time"
+#define DEF_VERIFY_STAT_TIME		"600s"
+extern int var_verify_stat_time;
+
 #define VAR_VRFY_LOCAL_XPORT		"address_verify_local_transport"
 #define DEF_VRFY_LOCAL_XPORT		"$" VAR_LOCAL_TRANSPORT
 extern char *var_vrfy_local_xport;
@@ -3214,6 +3267,14 @@ extern char *var_smtpd_policy_def_action;
 #define DEF_SMTPD_POLICY_CONTEXT	""
 extern char *var_smtpd_policy_context;
 
+#define VAR_SMTPD_POLICY_CACHE_ATTRS	"smtpd_policy_service_cache_attributes"
+#define DEF_SMTPD_POLICY_CACHE_ATTRS	""
+extern char *var_smtpd_policy_cache_attrs;
+
+#define VAR_SMTPD_POLICY_CACHE_TTL	"smtpd_policy_service_cache_ttl"
+#define DEF_SMTPD_POLICY_CACHE_TTL	"60s"
+extern int var_smtpd_policy_cache_ttl;
+
 #define CHECK_POLICY_SERVICE		"check_policy_service"
 
  /*
@@ -3699,6 +3760,14 @@ extern int var_conc_cohort_limit;
 #define DEF_CONC_FDBACK_DEBUG	0
 extern bool var_conc_feedback_debug;
 
+#define VAR_CONC_FDBACK_MODE	"default_destination_concurrency_feedback_mode"
+#define _CONC_FDBACK_MODE	"_destination_concurrency_feedback_mode"
+#define DEF_CONC_FDBACK_MODE	CONC_FDBACK_MODE_SUCCESS
+extern char *var_conc_feedback_mode;
+
+#define CONC_FDBACK_MODE_SUCCESS "success"
+#define CONC_FDBACK_MODE_LATENCY "latency"
+
 #define VAR_DEST_RATE_DELAY	"default_destination_rate_delay"
 #define _DEST_RATE_DELAY	"_destination_rate_delay"
 #define DEF_DEST_RATE_DELAY	"0s"
@@ -3796,6 +3865,14 @@ extern int var_psc_cache_ret;
 #define DEF_PSC_CACHE_SCAN	"12h"
 extern int var_psc_cache_scan;
 
+#define VAR_PSC_MMAP_FILE	"postscreen_cache_mmap_file"
+#define DEF_PSC_MMAP_FILE	""
+extern char *var_psc_mmap_file;
+
+#define VAR_PSC_MMAP_SLOTS	"postscreen_cache_mmap_slots"
+#define DEF_PSC_MMAP_SLOTS	100000
+extern int var_psc_mmap_slots;
+
 #define VAR_PSC_GREET_WAIT	"postscreen_greet_wait"
 #define DEF_PSC_GREET_WAIT	"${stress?{2}:{6}}s"
 extern int var_psc_greet_wait;
@@ -4327,6 +4404,24 @@ extern char *var_smtp_dns_re_filter;
 #define DEF_SMTPD_DNS_RE_FILTER		""
 extern char *var_smtpd_dns_re_filter;
 
+ /*
+  * Concurrent DNS queries for restriction lists.
+  */
+#define VAR_SMTPD_DNS_PREFETCH		"smtpd_dns_prefetch"
+#define DEF_SMTPD_DNS_PREFETCH		0
+extern bool var_smtpd_dns_prefetch;
+
+#define VAR_SMTPD_DNS_PREFETCH_TMOUT	"smtpd_dns_prefetch_timeout"
+#define DEF_SMTPD_DNS_PREFETCH_TMOUT	"2s"
+extern int var_smtpd_dns_prefetch_tmout;
+
+ /*
+  * Release shared resources while an SMTP client is idle.
+  */
+#define VAR_SMTPD_IDLE_RELEASE		"smtpd_idle_release_time"
+#define DEF_SMTPD_IDLE_RELEASE		"0s"
+extern int var_smtpd_idle_release;
+
  /*
   * Backwards compatibility.
   */
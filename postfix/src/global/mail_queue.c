@@ -44,6 +44,11 @@
 /*
 /*	int	mail_queue_id_ok(queue_id)
 /*	const char *queue_id;
+/*
+/*	int	mail_queue_hash_style()
+/*
+/*	int	mail_queue_subdir_style(name)
+/*	const char *name;
 /* DESCRIPTION
 /*	This module encapsulates access to the mail queue hierarchy.
 /*	Unlike most other modules, this one does not abort the program
@@ -86,10 +91,25 @@
 /*	non-zero (true) if the name contains no nasty characters.
 /*
 /*	mail_queue_id_ok() does the same thing for mail queue ID names.
+/*
+/*	mail_queue_hash_style() returns the hashed queue directory
+/*	layout selected with the hash_queue_style parameter:
+/*	MAIL_QUEUE_STYLE_CLASSIC (subdirectory names are single
+/*	characters of the queue ID) or MAIL_QUEUE_STYLE_FANOUT
+/*	(subdirectory names are two upper-case hexadecimal digits of
+/*	a hash of the full queue ID, for a 256-way fan-out per level).
+/*
+/*	mail_queue_subdir_style() returns the layout that a hashed
+/*	queue subdirectory name belongs to, or zero if the name is
+/*	not a hashed queue subdirectory name. This allows queue
+/*	scanners to descend into subdirectories without stat() calls,
+/*	and to recognize subdirectories that were created with a
+/*	different layout.
 /* DIAGNOSTICS
 /*	Panic: invalid queue name or id given to mail_queue_path(),
 /*	mail_queue_rename(), or mail_queue_remove().
-/*	Fatal error: out of memory.
+/*	Fatal error: out of memory, invalid hash_queue_style setting,
+/*	or hash_queue_depth too large for the fan-out layout.
 /* LICENSE
 /* .ad
 /* .fi
@@ -130,6 +150,7 @@
 #include <split_at.h>
 #include <sane_fsops.h>
 #include <valid_hostname.h>
+#include <name_code.h>
 
 /* Global library. */
 
@@ -140,6 +161,80 @@
 
 #define STR	vstring_str
 
+#define IS_UC_HEX(c)	(ISDIGIT(c) || ((c) >= 'A' && (c) <= 'F'))
+
+static const NAME_CODE mail_queue_styles[] = {
+    "classic", MAIL_QUEUE_STYLE_CLASSIC,
+    "fanout", MAIL_QUEUE_STYLE_FANOUT,
+    0, 0,
+};
+
+/* mail_queue_hash_style - look up hashed queue layout */
+
+int     mail_queue_hash_style(void)
+{
+    static int style = 0;
+
+    if (style == 0) {
+	if ((style = name_code(mail_queue_styles, NAME_CODE_FLAG_NONE,
+			       var_hash_queue_style)) == 0)
+	    msg_fatal("unknown %s value: \"%s\"",
+		      VAR_HASH_QUEUE_STYLE, var_hash_queue_style);
+	if (style == MAIL_QUEUE_STYLE_FANOUT
+	    && var_hash_queue_depth > MAIL_QUEUE_FANOUT_MAXDEPTH)
+	    msg_fatal("%s: value %d is too large with %s = %s (max: %d)",
+		      VAR_HASH_QUEUE_DEPTH, var_hash_queue_depth,
+		      VAR_HASH_QUEUE_STYLE, var_hash_queue_style,
+		      MAIL_QUEUE_FANOUT_MAXDEPTH);
+    }
+    return (style);
+}
+
+/* mail_queue_subdir_style - classify hashed queue subdirectory name */
+
+int     mail_queue_subdir_style(const char *name)
+{
+
+    /*
+     * Queue file names are much longer than this, and flush logfile names
+     * are in lower case, so there is no need to stat() anything here.
+     */
+    if (name[0] != 0 && name[1] == 0)
+	return (MAIL_QUEUE_STYLE_CLASSIC);
+    if (IS_UC_HEX(name[0]) && IS_UC_HEX(name[1]) && name[2] == 0)
+	return (MAIL_QUEUE_STYLE_FANOUT);
+    return (0);
+}
+
+/* mail_queue_fanout - hashed fan-out directory path */
+
+static const char *mail_queue_fanout(VSTRING *buf, const char *queue_id,
+				             int depth)
+{
+    const unsigned char *cp;
+    unsigned int hash = 2166136261U;
+    int     level;
+
+    /*
+     * FNV-1a over the entire queue ID, followed by a finalizer that spreads
+     * the low-entropy inode and time bits over all output bytes. The hash
+     * must not be seeded: all programs must agree on the same layout.
+     */
+    for (cp = (const unsigned char *) queue_id; *cp; cp++)
+	hash = ((hash ^ *cp) * 16777619U) & 0xffffffffU;
+    hash ^= hash >> 16;
+    hash = (hash * 0x85ebca6bU) & 0xffffffffU;
+    hash ^= hash >> 13;
+    hash = (hash * 0xc2b2ae35U) & 0xffffffffU;
+    hash ^= hash >> 16;
+
+    VSTRING_RESET(buf);
+    for (level = 0; level < depth; level++)
+	vstring_sprintf_append(buf, "%02X/", (hash >> (8 * level)) & 0xff);
+    VSTRING_TERMINATE(buf);
+    return (STR(buf));
+}
+
 /* mail_queue_dir - construct mail queue directory name */
 
 const char *mail_queue_dir(VSTRING *buf, const char *queue_name,
@@ -185,6 +280,11 @@ const char *mail_queue_dir(VSTRING *buf, const char *queue_name,
      */
     for (cpp = hash_queue_names->argv; *cpp; cpp++) {
 	if (strcasecmp(*cpp, queue_name) == 0) {
+	    if (mail_queue_hash_style() == MAIL_QUEUE_STYLE_FANOUT) {
+		vstring_strcat(buf, mail_queue_fanout(hash_buf, queue_id,
+						      var_hash_queue_depth));
+		break;
+	    }
 	    if (MQID_FIND_LG_INUM_SEPARATOR(delim, queue_id)) {
 		if (usec_buf == 0)
 		    usec_buf = vstring_alloc(20);
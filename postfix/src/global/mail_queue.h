@@ -62,6 +62,19 @@ extern int mail_queue_mkdirs(const char *);
 extern int mail_queue_name_ok(const char *);
 extern int mail_queue_id_ok(const char *);
 
+ /*
+  * Hashed queue directory layouts. The classic layout uses single-character
+  * subdirectory names taken from the queue ID; the fan-out layout uses
+  * two-digit upper-case hexadecimal names taken from a hash of the queue ID.
+  */
+#define MAIL_QUEUE_STYLE_CLASSIC	1
+#define MAIL_QUEUE_STYLE_FANOUT		2
+
+#define MAIL_QUEUE_FANOUT_MAXDEPTH	4
+
+extern int mail_queue_hash_style(void);
+extern int mail_queue_subdir_style(const char *);
+
  /*
   * MQID - Mail Queue ID format definitions. Needed only by code that creates
   * or parses queue ID strings.
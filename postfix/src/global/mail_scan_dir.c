@@ -12,6 +12,8 @@
 /*	The \fBmail_scan_dir_next\fR() routine is a wrapper around
 /*	scan_dir_next() that understands the structure of a Postfix
 /*	mail queue.  The result is a queue ID or a null pointer.
+/*	Hashed subdirectories of either layout (see mail_queue(3))
+/*	are searched recursively.
 /* SEE ALSO
 /*	scan_dir(3) directory scanner
 /* LICENSE
@@ -36,6 +38,7 @@
 
 /* Global library. */
 
+#include <mail_queue.h>
 #include <mail_scan_dir.h>
 
 /* mail_scan_dir_next - return next queue file */
@@ -45,15 +48,16 @@ char   *mail_scan_dir_next(SCAN_DIR *scan)
     char   *name;
 
     /*
-     * Exploit the fact that mail queue subdirectories have one-letter names,
-     * so we don't have to stat() every file in sight. This is a win because
-     * many dirent implementations do not return file type information.
+     * Exploit the fact that mail queue subdirectories have one-letter or
+     * two-digit hexadecimal names, so we don't have to stat() every file in
+     * sight. This is a win because many dirent implementations do not
+     * return file type information.
      */
     for (;;) {
 	if ((name = scan_dir_next(scan)) == 0) {
 	    if (scan_dir_pop(scan) == 0)
 		return (0);
-	} else if (strlen(name) == 1) {
+	} else if (mail_queue_subdir_style(name) != 0) {
 	    scan_dir_push(scan, name);
 	} else {
 	    return (name);
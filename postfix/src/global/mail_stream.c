@@ -62,6 +62,12 @@
 /*	and receives queue ID information from the command. The result
 /*	is a null pointer when the initial handshake fails. At finish
 /*	time, the daemon is expected to send a completion status.
+/*	When the cleanup_connection_reuse_time parameter is non-zero,
+/*	a connection that completed a message without error is kept
+/*	open for that amount of time, and the next mail_stream_service()
+/*	call with the same class and service asks the daemon for a
+/*	new queue ID over that connection. A connection that was closed
+/*	by the daemon in the meantime is replaced with a new one.
 /*
 /*	mail_stream_cleanup() cancels the operation that was started with
 /*	any of the mail_stream_xxx() routines, and destroys the argument.
@@ -130,6 +136,7 @@
 #include <vstream.h>
 #include <stringops.h>
 #include <argv.h>
+#include <iostuff.h>
 #include <sane_fsops.h>
 #include <warn_stat.h>
 
@@ -147,6 +154,14 @@
 
 static VSTRING *id_buf;
 
+ /*
+  * A cleanup server connection that is kept open for the next message.
+  */
+static VSTREAM *cached_stream;
+static char *cached_class;
+static char *cached_service;
+static time_t cached_expire;
+
 #define FREE_AND_WIPE(free, arg) do { if (arg) free(arg); arg = 0; } while (0)
 
 #define STR(x)	vstring_str(x)
@@ -392,6 +407,25 @@ static int mail_stream_finish_ipc(MAIL_STREAM *info, VSTRING *why)
 			      ATTR_TYPE_END) != 1))
 	status = CLEANUP_STAT_WRITE;
 
+    /*
+     * Keep a connection to a Postfix service open for the next message, if
+     * the protocol is still in sync. The daemon decides for itself how long
+     * it will wait.
+     */
+    else if (var_cleanup_reuse_time > 0 && info->class && info->service
+	     && vstream_ferror(info->stream) == 0) {
+	if (cached_stream)
+	    (void) vstream_fclose(cached_stream);
+	FREE_AND_WIPE(myfree, cached_class);
+	FREE_AND_WIPE(myfree, cached_service);
+	cached_stream = info->stream;
+	cached_class = info->class;
+	cached_service = info->service;
+	cached_expire = time((time_t *) 0) + var_cleanup_reuse_time;
+	info->stream = 0;
+	info->class = info->service = 0;
+    }
+
     /*
      * Cleanup.
      */
@@ -435,6 +469,38 @@ MAIL_STREAM *mail_stream_file(const char *queue, const char *class,
     return (info);
 }
 
+/* mail_stream_reuse - request new queue ID over cached connection */
+
+static VSTREAM *mail_stream_reuse(const char *class, const char *name)
+{
+    VSTREAM *stream;
+
+    /*
+     * If the stream is readable before we send anything, then assume the
+     * remote end disconnected.
+     */
+    if ((stream = cached_stream) == 0)
+	return (0);
+    cached_stream = 0;
+    if (strcmp(cached_class, class) != 0
+	|| strcmp(cached_service, name) != 0
+	|| time((time_t *) 0) >= cached_expire
+	|| readable(vstream_fileno(stream)) != 0
+	|| attr_print(stream, ATTR_FLAG_NONE,
+		      SEND_ATTR_STR(MAIL_ATTR_REQ, CLEANUP_REQ_NEXT),
+		      ATTR_TYPE_END) != 0
+	|| vstream_fflush(stream) != 0
+	|| attr_scan(stream, ATTR_FLAG_STRICT,
+		     RECV_ATTR_STREQ(MAIL_ATTR_PROTO, MAIL_ATTR_PROTO_CLEANUP),
+		     RECV_ATTR_STR(MAIL_ATTR_QUEUEID, id_buf), 0) != 1) {
+	if (msg_verbose)
+	    msg_info("not reusing connection to %s/%s", class, name);
+	(void) vstream_fclose(stream);
+	return (0);
+    }
+    return (stream);
+}
+
 /* mail_stream_service - destination is service */
 
 MAIL_STREAM *mail_stream_service(const char *class, const char *name)
@@ -445,23 +511,24 @@ MAIL_STREAM *mail_stream_service(const char *class, const char *name)
     if (id_buf == 0)
 	id_buf = vstring_alloc(10);
 
-    stream = mail_connect_wait(class, name);
-    if (attr_scan(stream, ATTR_FLAG_STRICT,
-		  RECV_ATTR_STREQ(MAIL_ATTR_PROTO, MAIL_ATTR_PROTO_CLEANUP),
-		  RECV_ATTR_STR(MAIL_ATTR_QUEUEID, id_buf), 0) != 1) {
-	vstream_fclose(stream);
-	return (0);
-    } else {
-	info = (MAIL_STREAM *) mymalloc(sizeof(*info));
-	info->stream = stream;
-	info->finish = mail_stream_finish_ipc;
-	info->close = vstream_fclose;
-	info->queue = 0;
-	info->id = mystrdup(vstring_str(id_buf));
-	info->class = 0;
-	info->service = 0;
-	return (info);
+    if ((stream = mail_stream_reuse(class, name)) == 0) {
+	stream = mail_connect_wait(class, name);
+	if (attr_scan(stream, ATTR_FLAG_STRICT,
+		   RECV_ATTR_STREQ(MAIL_ATTR_PROTO, MAIL_ATTR_PROTO_CLEANUP),
+		      RECV_ATTR_STR(MAIL_ATTR_QUEUEID, id_buf), 0) != 1) {
+	    vstream_fclose(stream);
+	    return (0);
+	}
     }
+    info = (MAIL_STREAM *) mymalloc(sizeof(*info));
+    info->stream = stream;
+    info->finish = mail_stream_finish_ipc;
+    info->close = vstream_fclose;
+    info->queue = 0;
+    info->id = mystrdup(vstring_str(id_buf));
+    info->class = mystrdup(class);
+    info->service = mystrdup(name);
+    return (info);
 }
 
 /* mail_stream_command - destination is command */
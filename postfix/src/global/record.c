@@ -17,6 +17,14 @@
 /*	ssize_t	maxsize;
 /*	int	flags;
 /*
+/*	int	rec_get_view(stream, buf, maxsize, flags, data, len)
+/*	VSTREAM	*stream;
+/*	VSTRING	*buf;
+/*	ssize_t	maxsize;
+/*	int	flags;
+/*	const char **data;
+/*	ssize_t	*len;
+/*
 /*	int	rec_put(stream, type, data, len)
 /*	VSTREAM	*stream;
 /*	int	type;
@@ -92,6 +100,16 @@
 /*	enables the REC_FLAG_FOLLOW_PTR, REC_FLAG_SKIP_DTXT
 /*	and REC_FLAG_SEEK_END features.
 /*
+/*	rec_get_view() is like rec_get_raw(), but avoids copying
+/*	record content when a record is entirely contained in the
+/*	stream's read buffer. Upon success, the record content is
+/*	returned via the \fIdata\fR and \fIlen\fR arguments. This
+/*	points either into the stream's read buffer, or into the
+/*	\fIbuf\fR argument, when the record spans a buffer boundary
+/*	or needs special processing. The content is not null-terminated,
+/*	and is valid only until the next operation on \fIstream\fR or
+/*	\fIbuf\fR.
+/*
 /*	REC_GET_HIDDEN_TYPE() is an unsafe macro that returns
 /*	non-zero when the specified record type is "not exposed"
 /*	by rec_get().
@@ -318,6 +336,65 @@ int     rec_get_raw(VSTREAM *stream, VSTRING *buf, ssize_t maxsize, int flags)
     return (type);
 }
 
+/* rec_get_view - retrieve record, avoid copying */
+
+int     rec_get_view(VSTREAM *stream, VSTRING *buf, ssize_t maxsize,
+		             int flags, const char **data, ssize_t *len)
+{
+    const char *myname = "rec_get_view";
+    const unsigned char *start;
+    const unsigned char *end;
+    const unsigned char *cp;
+    ssize_t avail;
+    ssize_t rec_len;
+    unsigned shift;
+    int     type;
+
+    /*
+     * Fast path: decode the record in place when the read buffer contains
+     * the entire record. Leave malformed records, records that span a
+     * buffer boundary, and records that need special processing to
+     * rec_get_raw(), so that there is only one copy of that code.
+     */
+    if ((avail = vstream_peek(stream)) >= 2) {
+	start = (const unsigned char *) vstream_peek_data(stream);
+	end = start + avail;
+	type = start[0];
+	if (!(type == REC_TYPE_PTR && (flags & REC_FLAG_FOLLOW_PTR))
+	    && !(type == REC_TYPE_DTXT && (flags & REC_FLAG_SKIP_DTXT))
+	    && !(type == REC_TYPE_END && (flags & REC_FLAG_SEEK_END))) {
+	    for (rec_len = 0, shift = 0, cp = start + 1; cp < end
+		 && shift < (int) (NBBY * sizeof(int)); cp++, shift += 7) {
+		rec_len |= (*cp & 0177) << shift;
+		if ((*cp & 0200) == 0) {
+		    cp++;
+		    if (rec_len >= 0 && (maxsize == 0 || rec_len <= maxsize)
+			&& end - cp >= rec_len) {
+			if (msg_verbose > 2)
+			    msg_info("%s: type %c len %ld data %.*s", myname,
+				     type, (long) rec_len,
+				     (int) (rec_len < 10 ? rec_len : 10), cp);
+			*data = (const char *) cp;
+			*len = rec_len;
+			vstream_peek_skip(stream, cp + rec_len - start);
+			return (type);
+		    }
+		    break;
+		}
+	    }
+	}
+    }
+
+    /*
+     * Slow path.
+     */
+    if ((type = rec_get_raw(stream, buf, maxsize, flags)) >= 0) {
+	*data = vstring_str(buf);
+	*len = VSTRING_LEN(buf);
+    }
+    return (type);
+}
+
 /* rec_goto - follow PTR record */
 
 int     rec_goto(VSTREAM *stream, const char *buf)
@@ -413,3 +490,148 @@ int     rec_pad(VSTREAM *stream, int type, ssize_t len)
     return (rec_fprintf(stream, type, "%*s",
 			width < 1 ? 1 : width, "0"));
 }
+
+#ifdef TEST
+
+ /*
+  * Test program. Without file arguments, write a sequence of records to a
+  * scratch file, read them back with rec_get() and with rec_get_view()
+  * through a small buffer so that some records span a buffer boundary,
+  * and report whether each record was returned in place or copied. With
+  * file arguments, time rec_get() and rec_get_view() over each (queue)
+  * file, repeated as specified with the -n option.
+  */
+#include <stdlib.h>
+#include <fcntl.h>
+#include <sys/time.h>
+#include <msg_vstream.h>
+
+#define TEST_FILE	"record.data"
+#define TEST_BUFSIZE	128
+
+static void self_test(void)
+{
+    static const ssize_t lengths[] = {
+	0, 1, 2, 10, 20, 30, 40, 0, 50, 60, 100, 126, 127, 128, 129, 300,
+	5, 0,
+    };
+    VSTREAM *fp;
+    VSTREAM *fp2;
+    VSTRING *buf = vstring_alloc(100);
+    VSTRING *buf2 = vstring_alloc(100);
+    const char *data;
+    ssize_t len;
+    int     type;
+    int     type2;
+    int     n;
+    int     i;
+
+    /*
+     * Generate records with distinct content.
+     */
+    if ((fp = vstream_fopen(TEST_FILE, O_CREAT | O_TRUNC | O_WRONLY, 0600)) == 0)
+	msg_fatal("open %s: %m", TEST_FILE);
+    for (n = 0; n < (int) (sizeof(lengths) / sizeof(lengths[0])); n++) {
+	VSTRING_RESET(buf);
+	for (i = 0; i < lengths[n]; i++)
+	    VSTRING_ADDCH(buf, 'a' + (n + i) % 26);
+	REC_PUT_BUF(fp, n % 2 ? REC_TYPE_CONT : REC_TYPE_NORM, buf);
+	if (n == 5)
+	    rec_fputs(fp, REC_TYPE_DTXT, "deleted");
+    }
+    rec_fputs(fp, REC_TYPE_END, "");
+    rec_fputs(fp, REC_TYPE_NORM, "after end");
+    if (vstream_fclose(fp))
+	msg_fatal("write %s: %m", TEST_FILE);
+
+    /*
+     * Read the records back in two ways, and compare.
+     */
+    if ((fp = vstream_fopen(TEST_FILE, O_RDONLY, 0)) == 0
+	|| (fp2 = vstream_fopen(TEST_FILE, O_RDONLY, 0)) == 0)
+	msg_fatal("open %s: %m", TEST_FILE);
+    vstream_control(fp, CA_VSTREAM_CTL_BUFSIZE(TEST_BUFSIZE),
+		    CA_VSTREAM_CTL_END);
+    for (;;) {
+	type = rec_get_view(fp, buf, 0, REC_FLAG_DEFAULT, &data, &len);
+	type2 = rec_get(fp2, buf2, 0);
+	if (type != type2)
+	    msg_fatal("type mismatch: %d != %d", type, type2);
+	if (type < 0)
+	    break;
+	if (len != VSTRING_LEN(buf2) || memcmp(data, vstring_str(buf2), len) != 0)
+	    msg_fatal("content mismatch for type %c length %ld",
+		      type, (long) VSTRING_LEN(buf2));
+	vstream_printf("type %c len %ld %s\n", type, (long) len,
+		       data == vstring_str(buf) ? "copy" : "view");
+    }
+    vstream_printf("result %d\n", type);
+    vstream_fflush(VSTREAM_OUT);
+    (void) vstream_fclose(fp);
+    (void) vstream_fclose(fp2);
+    (void) unlink(TEST_FILE);
+    vstring_free(buf);
+    vstring_free(buf2);
+}
+
+#define TV_USEC(tv)	((tv).tv_sec * 1000000.0 + (tv).tv_usec)
+
+static void bench(const char *path, int count)
+{
+    VSTREAM *fp;
+    VSTRING *buf = vstring_alloc(100);
+    struct timeval start, done;
+    const char *data;
+    ssize_t len;
+    long    records;
+    int     pass;
+    int     n;
+
+    if ((fp = vstream_fopen(path, O_RDONLY, 0)) == 0)
+	msg_fatal("open %s: %m", path);
+    for (pass = 0; pass < 2; pass++) {
+	records = 0;
+	GETTIMEOFDAY(&start);
+	for (n = 0; n < count; n++) {
+	    if (vstream_fseek(fp, (off_t) 0, SEEK_SET) < 0)
+		msg_fatal("seek %s: %m", path);
+	    while ((pass == 0 ? rec_get(fp, buf, 0) :
+		    rec_get_view(fp, buf, 0, REC_FLAG_DEFAULT,
+				 &data, &len)) > 0)
+		records++;
+	}
+	GETTIMEOFDAY(&done);
+	vstream_printf("%s: %s: %ld records, %.1f ns/record\n", path,
+		       pass == 0 ? "rec_get" : "rec_get_view", records,
+		       records ? 1000.0 * (TV_USEC(done) - TV_USEC(start))
+		       / records : 0.0);
+    }
+    vstream_fflush(VSTREAM_OUT);
+    (void) vstream_fclose(fp);
+    vstring_free(buf);
+}
+
+int     main(int argc, char **argv)
+{
+    int     count = 1000;
+    int     ch;
+
+    msg_vstream_init(argv[0], VSTREAM_ERR);
+    while ((ch = GETOPT(argc, argv, "n:")) > 0) {
+	switch (ch) {
+	case 'n':
+	    if ((count = atoi(optarg)) <= 0)
+		msg_fatal("bad count: %s", optarg);
+	    break;
+	default:
+	    msg_fatal("usage: %s [-n count] [file...]", argv[0]);
+	}
+    }
+    if (optind == argc)
+	self_test();
+    for (/* void */ ; optind < argc; optind++)
+	bench(argv[optind], count);
+    return (0);
+}
+
+#endif
@@ -33,6 +33,7 @@
   * Functional interface.
   */
 extern int rec_get_raw(VSTREAM *, VSTRING *, ssize_t, int);
+extern int rec_get_view(VSTREAM *, VSTRING *, ssize_t, int, const char **, ssize_t *);
 extern int rec_put(VSTREAM *, int, const char *, ssize_t);
 extern int rec_put_type(VSTREAM *, int, off_t);
 extern int PRINTFLIKE(3, 4) rec_fprintf(VSTREAM *, int, const char *,...);
@@ -28,6 +28,18 @@
 /*	const char *address;
 /*	RESOLVE_REPLY *reply;
 /*
+/*	void	resolve_clnt_query_batch(sender, count, addresses, replies)
+/*	const char *sender;
+/*	int	count;
+/*	const char **addresses;
+/*	RESOLVE_REPLY *replies;
+/*
+/*	void	resolve_clnt_verify_batch(sender, count, addresses, replies)
+/*	const char *sender;
+/*	int	count;
+/*	const char **addresses;
+/*	RESOLVE_REPLY *replies;
+/*
 /*	void	resolve_clnt_free(reply)
 /*	RESOLVE_REPLY *reply;
 /* DESCRIPTION
@@ -48,6 +60,22 @@
 /*	resolve_clnt_verify_from() implements an alternative version that can
 /*	be used for address verification.
 /*
+/*	resolve_clnt_query_batch() and resolve_clnt_verify_batch()
+/*	resolve \fIcount\fR addresses (1..RESOLVE_BATCH_LIMIT) for
+/*	the same sender with one client-server round trip, and store
+/*	the results in the corresponding elements of the \fIreplies\fR
+/*	array. Each element must be initialized with resolve_clnt_init().
+/*	When the server does not support batch requests, or when the
+/*	batch request fails, the addresses are resolved one at a time.
+/*	After such a failure, batch requests are suspended on that
+/*	connection for the next RESOLVE_BATCH_RETRY_COUNT calls or
+/*	RESOLVE_BATCH_RETRY_TIME seconds, whichever comes first, so
+/*	that an older server does not log a warning for every batch,
+/*	while a transient failure does not disable batching for the
+/*	lifetime of the connection.
+/*	The batch result flags may include RESOLVE_FLAG_DOMAIN (see
+/*	below). These functions bypass the one-entry cache.
+/*
 /*	In the resolver reply, the flags member is the bit-wise OR of
 /*	zero or more of the following:
 /* .IP RESOLVE_FLAG_FINAL
@@ -63,6 +91,12 @@
 /*	The address resolved to something that has invalid syntax.
 /* .IP RESOLVE_FLAG_FAIL
 /*	The request could not be completed.
+/* .IP RESOLVE_FLAG_DOMAIN
+/*	Batch requests only. The result is the same for every address
+/*	in the recipient domain whose local-part is a dot-atom made of
+/*	letters, digits, and the characters ``+-=_'', not starting
+/*	with ``-''; the server did not change the address. This allows
+/*	a client to cache results by (sender, domain).
 /* .PP
 /*	In addition, the address domain class is returned by setting
 /*	one of the following flags (this is preliminary code awaiting
@@ -142,6 +176,24 @@ static VSTRING *last_sender;
 static VSTRING *last_addr;
 static RESOLVE_REPLY last_reply;
 
+ /*
+  * The connection on which a batch request was not answered. An older server
+  * will also reject the next batch request, so don't ask it again for a
+  * while. The failure may also have been transient, so ask again after a
+  * bounded number of calls or amount of time.
+  */
+static long batch_fail_serial = -1;
+static int batch_fail_skips;
+static time_t batch_fail_time;
+
+#define RESOLVE_BATCH_RETRY_COUNT	100
+#define RESOLVE_BATCH_RETRY_TIME	60
+
+#define BATCH_SUSPENDED() \
+	(clnt_stream_serial(rewrite_clnt_stream) == batch_fail_serial \
+	 && batch_fail_skips++ < RESOLVE_BATCH_RETRY_COUNT \
+	 && time((time_t *) 0) < batch_fail_time + RESOLVE_BATCH_RETRY_TIME)
+
 /* resolve_clnt_init - initialize reply */
 
 void    resolve_clnt_init(RESOLVE_REPLY *reply)
@@ -293,6 +345,116 @@ void    resolve_clnt(const char *class, const char *sender,
     last_expire = time((time_t *) 0) + 30;	/* XXX make configurable */
 }
 
+/* resolve_clnt_batch - resolve multiple addresses in one round trip */
+
+void    resolve_clnt_batch(const char *class, const char *sender,
+			           int count, const char **addr,
+			           RESOLVE_REPLY *reply)
+{
+    const char *myname = "resolve_clnt_batch";
+    const char *batch_class;
+    VSTREAM *stream;
+    int     server_flags;
+    int     server_count;
+    int     suspended = 0;
+    int     n;
+
+    if (strcmp(class, RESOLVE_REGULAR) == 0)
+	batch_class = RESOLVE_REGULAR_BATCH;
+    else if (strcmp(class, RESOLVE_VERIFY) == 0)
+	batch_class = RESOLVE_VERIFY_BATCH;
+    else
+	msg_panic("%s: unknown request class: %s", myname, class);
+    if (count < 1 || count > RESOLVE_BATCH_LIMIT)
+	msg_panic("%s: bad address count: %d", myname, count);
+    for (n = 0; n < count; n++)
+	if (addr[n] == STR(reply[n].recipient))
+	    msg_panic("%s: result clobbers input", myname);
+
+    /*
+     * Send all addresses as one request, then receive all results. Any
+     * problem, including an old server that does not know about batch
+     * requests and hangs up, sends us to the one-at-a-time fallback below,
+     * which knows how to retry and complain.
+     */
+    if (rewrite_clnt_stream == 0)
+	rewrite_clnt_stream = clnt_stream_create(MAIL_CLASS_PRIVATE,
+						 var_rewrite_service,
+						 var_ipc_idle_limit,
+						 var_ipc_ttl_limit,
+						 resolve_clnt_handshake);
+
+    errno = 0;
+    if ((stream = clnt_stream_access(rewrite_clnt_stream)) != 0
+	&& (suspended = BATCH_SUSPENDED()) == 0
+	&& attr_print(stream, ATTR_FLAG_MORE,
+		      SEND_ATTR_STR(MAIL_ATTR_REQ, batch_class),
+		      SEND_ATTR_STR(MAIL_ATTR_SENDER, sender),
+		      SEND_ATTR_INT(MAIL_ATTR_NREQ, count),
+		      ATTR_TYPE_END) == 0) {
+	for (n = 0; n < count; n++)
+	    if (attr_print(stream, n < count - 1 ?
+			   ATTR_FLAG_MORE : ATTR_FLAG_NONE,
+			   SEND_ATTR_STR(MAIL_ATTR_ADDR, addr[n]),
+			   ATTR_TYPE_END) != 0)
+		break;
+	if (n == count
+	    && vstream_fflush(stream) == 0
+	    && attr_scan(stream, ATTR_FLAG_STRICT | ATTR_FLAG_MORE,
+			 RECV_ATTR_INT(MAIL_ATTR_FLAGS, &server_flags),
+			 RECV_ATTR_INT(MAIL_ATTR_NREQ, &server_count),
+			 ATTR_TYPE_END) == 2
+	    && server_count == count) {
+	    for (n = 0; n < count; n++) {
+		if (attr_scan(stream, n < count - 1 ?
+			      ATTR_FLAG_STRICT | ATTR_FLAG_MORE :
+			      ATTR_FLAG_STRICT,
+			   RECV_ATTR_STR(MAIL_ATTR_TRANSPORT, reply[n].transport),
+			      RECV_ATTR_STR(MAIL_ATTR_NEXTHOP, reply[n].nexthop),
+			      RECV_ATTR_STR(MAIL_ATTR_RECIP, reply[n].recipient),
+			      RECV_ATTR_INT(MAIL_ATTR_FLAGS, &reply[n].flags),
+			      ATTR_TYPE_END) != 4
+		    || STR(reply[n].transport)[0] == 0
+		    || (STR(reply[n].recipient)[0] == 0 && *addr[n] != 0))
+		    break;
+		if (msg_verbose)
+		    msg_info("%s: `%s' -> `%s' -> transp=`%s' host=`%s' rcpt=`%s' flags=0x%x",
+			     myname, sender, addr[n], STR(reply[n].transport),
+			     STR(reply[n].nexthop), STR(reply[n].recipient),
+			     reply[n].flags);
+	    }
+	    if (n == count) {
+		/* Server-requested disconnect. */
+		if (server_flags != 0)
+		    clnt_stream_recover(rewrite_clnt_stream);
+		return;
+	    }
+	}
+    }
+
+    /*
+     * Skip the batch request on a connection where it was not answered
+     * recently. Otherwise, fall back to one request per address, and
+     * remember the connection that the fallback ends up using.
+     */
+    if (suspended) {
+	if (msg_verbose)
+	    msg_info("%s: no batch support on this connection", myname);
+    } else {
+	if (msg_verbose || (errno && errno != EPIPE && errno != ENOENT))
+	    msg_warn("%s: problem talking to service %s: %m",
+		     myname, var_rewrite_service);
+	clnt_stream_recover(rewrite_clnt_stream);
+    }
+    for (n = 0; n < count; n++)
+	resolve_clnt(class, sender, addr[n], reply + n);
+    batch_fail_serial = clnt_stream_serial(rewrite_clnt_stream);
+    if (!suspended) {
+	batch_fail_skips = 0;
+	batch_fail_time = time((time_t *) 0);
+    }
+}
+
 /* resolve_clnt_free - destroy reply */
 
 void    resolve_clnt_free(RESOLVE_REPLY *reply)
@@ -326,6 +488,7 @@ static void resolve(char *class, char *addr, RESOLVE_REPLY *reply)
 	RESOLVE_FLAG_ROUTED, "FLAG_ROUTED",
 	RESOLVE_FLAG_ERROR, "FLAG_ERROR",
 	RESOLVE_FLAG_FAIL, "FLAG_FAIL",
+	RESOLVE_FLAG_DOMAIN, "FLAG_DOMAIN",
 	RESOLVE_CLASS_LOCAL, "CLASS_LOCAL",
 	RESOLVE_CLASS_ALIAS, "CLASS_ALIAS",
 	RESOLVE_CLASS_VIRTUAL, "CLASS_VIRTUAL",
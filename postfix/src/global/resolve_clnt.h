@@ -21,11 +21,16 @@
   */
 #define RESOLVE_REGULAR	"resolve"
 #define RESOLVE_VERIFY	"verify"
+#define RESOLVE_REGULAR_BATCH	"resolve_batch"
+#define RESOLVE_VERIFY_BATCH	"verify_batch"
+
+#define RESOLVE_BATCH_LIMIT	1000	/* max addresses per batch request */
 
 #define RESOLVE_FLAG_FINAL	(1<<0)	/* final delivery */
 #define RESOLVE_FLAG_ROUTED	(1<<1)	/* routed destination */
 #define RESOLVE_FLAG_ERROR	(1<<2)	/* bad destination syntax */
 #define RESOLVE_FLAG_FAIL	(1<<3)	/* request failed */
+#define RESOLVE_FLAG_DOMAIN	(1<<4)	/* result depends on domain only */
 
 #define RESOLVE_CLASS_LOCAL	(1<<8)	/* mydestination/inet_interfaces */
 #define RESOLVE_CLASS_ALIAS	(1<<9)	/* virtual_alias_domains */
@@ -50,6 +55,8 @@ typedef struct RESOLVE_REPLY {
 extern void resolve_clnt_init(RESOLVE_REPLY *);
 extern void resolve_clnt(const char *, const char *, const char *, RESOLVE_REPLY *);
 extern void resolve_clnt_free(RESOLVE_REPLY *);
+extern void resolve_clnt_batch(const char *, const char *, int,
+			               const char **, RESOLVE_REPLY *);
 
 #define RESOLVE_NULL_FROM	""
 
@@ -57,6 +64,10 @@ extern void resolve_clnt_free(RESOLVE_REPLY *);
 	resolve_clnt(RESOLVE_REGULAR, (f), (a), (r))
 #define resolve_clnt_verify_from(f, a, r) \
 	resolve_clnt(RESOLVE_VERIFY, (f), (a), (r))
+#define resolve_clnt_query_batch(f, n, a, r) \
+	resolve_clnt_batch(RESOLVE_REGULAR, (f), (n), (a), (r))
+#define resolve_clnt_verify_batch(f, n, a, r) \
+	resolve_clnt_batch(RESOLVE_VERIFY, (f), (n), (a), (r))
 
 #define RESOLVE_CLNT_ASSIGN(reply, transport, nexthop, recipient) { \
 	(reply).transport = (transport); \
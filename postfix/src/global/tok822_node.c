@@ -25,6 +25,12 @@
 /*
 /*	tok822_free() releases the memory used for the specified token
 /*	and conveniently returns a null pointer value.
+/*
+/*	To avoid malloc() and free() calls for every token of every
+/*	address list, released tokens are kept on a free list
+/*	(together with their string memory) for reuse by
+/*	tok822_alloc(). The free list size is limited, and very
+/*	large string buffers are not kept.
 /* LICENSE
 /* .ad
 /* .fi
@@ -50,21 +56,53 @@
 
 #include "tok822.h"
 
+ /*
+  * Released tokens, linked through their next field. Single-character and
+  * container tokens have no string value and are kept separately, so that
+  * tok822_alloc() can reuse a string buffer whenever it needs one.
+  */
+static TOK822 *tok822_free_plain;
+static TOK822 *tok822_free_string;
+static int tok822_free_count;
+
+#define TOK822_FREE_LIMIT	10240	/* max number of released tokens */
+#define TOK822_FREE_STRSIZE	1024	/* max kept string buffer size */
+
+#define CONTAINER_TOKEN(x) \
+	((x) == TOK822_ADDR || (x) == TOK822_STARTGRP)
+
 /* tok822_alloc - allocate and initialize token */
 
 TOK822 *tok822_alloc(int type, const char *strval)
 {
     TOK822 *tp;
+    int     need_string = !(type < TOK822_MINTOK || CONTAINER_TOKEN(type));
 
-#define CONTAINER_TOKEN(x) \
-	((x) == TOK822_ADDR || (x) == TOK822_STARTGRP)
-
-    tp = (TOK822 *) mymalloc(sizeof(*tp));
+    /*
+     * Reuse a released token if one is available.
+     */
+    if (need_string && tok822_free_string != 0) {
+	tp = tok822_free_string;
+	tok822_free_string = tp->next;
+	tok822_free_count -= 1;
+	if (strval == 0) {
+	    VSTRING_RESET(tp->vstr);
+	    VSTRING_TERMINATE(tp->vstr);
+	} else {
+	    vstring_strcpy(tp->vstr, strval);
+	}
+    } else if (!need_string && tok822_free_plain != 0) {
+	tp = tok822_free_plain;
+	tok822_free_plain = tp->next;
+	tok822_free_count -= 1;
+    } else {
+	tp = (TOK822 *) mymalloc(sizeof(*tp));
+	tp->vstr = (need_string == 0 ? 0 :
+		    strval == 0 ? vstring_alloc(10) :
+		    vstring_strcpy(vstring_alloc(strlen(strval) + 1), strval));
+    }
     tp->type = type;
     tp->next = tp->prev = tp->head = tp->tail = tp->owner = 0;
-    tp->vstr = (type < TOK822_MINTOK || CONTAINER_TOKEN(type) ? 0 :
-		strval == 0 ? vstring_alloc(10) :
-		vstring_strcpy(vstring_alloc(strlen(strval) + 1), strval));
     return (tp);
 }
 
@@ -72,8 +110,23 @@ TOK822 *tok822_alloc(int type, const char *strval)
 
 TOK822 *tok822_free(TOK822 *tp)
 {
-    if (tp->vstr)
+    if (tp->vstr && VSTRING_LEN(tp->vstr) + vstring_avail(tp->vstr)
+	> TOK822_FREE_STRSIZE) {
 	vstring_free(tp->vstr);
-    myfree((void *) tp);
+	tp->vstr = 0;
+    }
+    if (tok822_free_count >= TOK822_FREE_LIMIT) {
+	if (tp->vstr)
+	    vstring_free(tp->vstr);
+	myfree((void *) tp);
+    } else if (tp->vstr) {
+	tp->next = tok822_free_string;
+	tok822_free_string = tp;
+	tok822_free_count += 1;
+    } else {
+	tp->next = tok822_free_plain;
+	tok822_free_plain = tp;
+	tok822_free_count += 1;
+    }
     return (0);
 }
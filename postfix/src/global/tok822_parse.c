@@ -269,7 +269,7 @@ static void strip_address(VSTRING *vp, ssize_t start, TOK822 *addr)
 
 VSTRING *tok822_externalize(VSTRING *vp, TOK822 *tree, int flags)
 {
-    VSTRING *tmp;
+    static VSTRING *tmp;
     TOK822 *tp;
     ssize_t start;
     TOK822 *addr;
@@ -342,13 +342,13 @@ VSTRING *tok822_externalize(VSTRING *vp, TOK822 *tree, int flags)
 	     */
 	case TOK822_ADDR:
 	    addr = tp;
-	    tmp = vstring_alloc(100);
-	    tok822_internalize(tmp, tp->head, TOK822_STR_TERM);
+	    if (tmp == 0)
+		tmp = vstring_alloc(100);
+	    tok822_internalize(tmp, tp->head, TOK822_STR_WIPE | TOK822_STR_TERM);
 	    addr_len = VSTRING_LEN(vp);
 	    quote_822_local_flags(vp, vstring_str(tmp),
 				  QUOTE_FLAG_8BITCLEAN | QUOTE_FLAG_APPEND);
 	    addr_len = VSTRING_LEN(vp) - addr_len;
-	    vstring_free(tmp);
 	    break;
 	case TOK822_ATOM:
 	case TOK822_COMMENT:
@@ -634,7 +634,14 @@ static TOK822 *tok822_group(int group_type, TOK822 *left, TOK822 *right, int syn
 	group = tok822_alloc(group_type, (char *) 0);
 	tok822_sub_append(group, first);
 	tok822_append(left, group);
-	tok822_append(group, right);
+
+	/*
+	 * Don't use tok822_append() to reconnect the tokens on the right. It
+	 * would update the owner of every token up to the end of the list,
+	 * making the parser quadratic in the number of addresses. Those
+	 * tokens already have the same owner as the group.
+	 */
+	GLUE(group, right);
 	if (sync_type) {
 	    sync = tok822_alloc(sync_type, (char *) 0);
 	    tok822_append(left, sync);
@@ -655,7 +662,10 @@ TOK822 *tok822_scan_addr(const char *addr)
 
 #ifdef TEST
 
+#include <sys/time.h>
+#include <stdlib.h>
 #include <unistd.h>
+#include <mymalloc.h>
 #include <vstream.h>
 #include <readlline.h>
 
@@ -685,19 +695,74 @@ static void tok822_print(TOK822 *list, int indent)
     }
 }
 
-int     main(int unused_argc, char **unused_argv)
+/* tok822_time - time the processing of one address header */
+
+static void tok822_time(VSTRING *vp, const char *str, int count)
+{
+    struct timeval start, done;
+    TOK822 *tree;
+    TOK822 **addr_list;
+    TOK822 **tpp;
+    int     addr_count = 0;
+    int     n;
+
+    /*
+     * Do what cleanup(8) does with an address header: parse, visit each
+     * address, and convert the result back to header form.
+     */
+    GETTIMEOFDAY(&start);
+    for (n = 0; n < count; n++) {
+	tree = tok822_parse(str);
+	addr_list = tok822_grep(tree, TOK822_ADDR);
+	for (addr_count = 0, tpp = addr_list; *tpp; tpp++, addr_count++)
+	    tok822_internalize(vp, tpp[0]->head, TOK822_STR_DEFL);
+	myfree((void *) addr_list);
+	tok822_externalize(vp, tree, TOK822_STR_HEAD);
+	tok822_free_tree(tree);
+    }
+    GETTIMEOFDAY(&done);
+    vstream_printf("%d addresses x %d: %.3f us/address\n",
+		   addr_count, count,
+		   ((done.tv_sec - start.tv_sec) * 1e6
+		    + (done.tv_usec - start.tv_usec))
+		   / ((double) count * (addr_count ? addr_count : 1)));
+    vstream_fflush(VSTREAM_OUT);
+}
+
+int     main(int argc, char **argv)
 {
     VSTRING *vp = vstring_alloc(100);
     TOK822 *list;
     VSTRING *buf = vstring_alloc(100);
+    int     count = 0;
+    int     ch;
 
 #define TEST_TOKEN_LIMIT 20
 
+    /*
+     * With -t, time the processing of each input line instead of showing
+     * the result. See tok822_parse_bench.in.
+     */
+    while ((ch = GETOPT(argc, argv, "t:")) > 0) {
+	switch (ch) {
+	case 't':
+	    if ((count = atoi(optarg)) <= 0)
+		msg_fatal("bad iteration count: %s", optarg);
+	    break;
+	default:
+	    msg_fatal("usage: %s [-t count]", argv[0]);
+	}
+    }
+
     while (readlline(buf, VSTREAM_IN, (int *) 0)) {
 	while (VSTRING_LEN(buf) > 0 && vstring_end(buf)[-1] == '\n') {
 	    vstring_end(buf)[-1] = 0;
 	    vstring_truncate(buf, VSTRING_LEN(buf) - 1);
 	}
+	if (count > 0) {
+	    tok822_time(vp, vstring_str(buf), count);
+	    continue;
+	}
 	if (!isatty(vstream_fileno(VSTREAM_IN)))
 	    vstream_printf(">>>%s<<<\n\n", vstring_str(buf));
 	list = tok822_parse_limit(vstring_str(buf), TEST_TOKEN_LIMIT);
@@ -0,0 +1,652 @@
+/*++
+/* NAME
+/*	verify_mmap 3
+/* SUMMARY
+/*	shared address verification result cache
+/* SYNOPSIS
+/*	#include <verify_mmap.h>
+/*
+/*	VERIFY_MMAP *verify_mmap_open(path, slots, open_flags)
+/*	const char *path;
+/*	int	slots;
+/*	int	open_flags;
+/*
+/*	int	verify_mmap_lookup(cache, addr, addr_status, why)
+/*	VERIFY_MMAP *cache;
+/*	const char *addr;
+/*	int	*addr_status;
+/*	VSTRING	*why;
+/*
+/*	void	verify_mmap_update(cache, addr, addr_status, fresh_until, why)
+/*	VERIFY_MMAP *cache;
+/*	const char *addr;
+/*	int	addr_status;
+/*	time_t	fresh_until;
+/*	const char *why;
+/*
+/*	void	verify_mmap_delete(cache, addr)
+/*	VERIFY_MMAP *cache;
+/*	const char *addr;
+/*
+/*	void	verify_mmap_close(cache)
+/*	VERIFY_MMAP *cache;
+/* DESCRIPTION
+/*	This module maintains a fixed-size file with address
+/*	verification results that is mapped into memory by the
+/*	verify(8) server and by its clients. The verify(8) server
+/*	publishes results that are not due for a refresh probe;
+/*	a client such as smtpd(8) looks up an address in the
+/*	shared memory, and asks the verify(8) server only when the
+/*	address is not found. Lookups require no system call and
+/*	no lock.
+/*
+/*	The cache is an open-addressing hash table. An address
+/*	hashes to a small window of adjacent slots; the hash is
+/*	seeded with a random value that is stored in the file, so
+/*	that remote clients cannot predict collisions. An update
+/*	replaces a matching entry, or uses a free slot in the window,
+/*	or replaces the entry in the window that becomes stale
+/*	first. Addresses that are too long for a slot are not
+/*	cached, and long status texts are truncated.
+/*
+/*	Each slot has a sequence number that is odd while the slot
+/*	is being updated, and a checksum of its content. A reader
+/*	that finds an odd or changed sequence number, or a bad
+/*	checksum, treats the slot as a cache miss. There must be
+/*	only one writer process.
+/*
+/*	verify_mmap_open() opens the named cache file. With
+/*	O_RDWR|O_CREAT, the file is opened for update, and it is
+/*	created or replaced with an empty file when it does not
+/*	have the specified number of slots. The new file is created
+/*	under a temporary name and renamed into place; a replaced
+/*	file is marked as retired, so that readers that still use
+/*	it will no longer find any entries. With O_RDONLY, the file
+/*	is opened for lookups only, and the number of slots is taken
+/*	from the file; the result is a null pointer when the file
+/*	does not exist or has an unexpected format. The file is
+/*	opened with the privileges of the caller.
+/*
+/*	verify_mmap_lookup() looks up the specified address. The
+/*	result is non-zero when a fresh entry was found; in that
+/*	case the address status and text are stored in the
+/*	\fIaddr_status\fR and \fIwhy\fR arguments. Otherwise, these
+/*	arguments are not modified.
+/*
+/*	verify_mmap_update() saves the address status and text for
+/*	the specified address. The entry is used until the time
+/*	specified with \fIfresh_until\fR.
+/*
+/*	verify_mmap_delete() removes the entry for the specified
+/*	address, if it exists.
+/*
+/*	verify_mmap_close() unmaps the cache file and releases
+/*	storage.
+/*
+/*	Addresses are compared after replacing ":" with "_", as
+/*	done by the verify(8) server.
+/* DIAGNOSTICS
+/*	Fatal errors: out of memory, file system errors, update
+/*	of a read-only cache.
+/* SEE ALSO
+/*	verify(8) address verification server
+/*	verify_clnt(3) address verification client
+/* LICENSE
+/* .ad
+/* .fi
+/*	The Secure Mailer license must be distributed with this software.
+/*--*/
+
+/* System library. */
+
+#include <sys_defs.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdio.h>			/* rename */
+#include <string.h>
+#include <stddef.h>
+#include <limits.h>
+#include <stdint.h>
+
+#ifndef MAP_FAILED
+#define MAP_FAILED	((void *) -1)
+#endif
+
+#ifndef O_ACCMODE
+#define O_ACCMODE	(O_RDONLY | O_WRONLY | O_RDWR)
+#endif
+
+/* Utility library. */
+
+#include <msg.h>
+#include <mymalloc.h>
+#include <myflock.h>
+#include <iostuff.h>
+#include <ldseed.h>
+#include <vstring.h>
+
+/* Global library. */
+
+#include <verify_mmap.h>
+
+ /*
+  * File format. All fields are in host byte order; the file is not meant to
+  * be shared between different machines. Slots are 512 bytes, and never
+  * straddle a page boundary.
+  */
+#define VERIFY_MMAP_MAGIC	"VRFYMAP"
+#define VERIFY_MMAP_VERSION	1
+#define VERIFY_MMAP_ADDR_LEN	256	/* including null terminator */
+#define VERIFY_MMAP_TEXT_LEN	236	/* including null terminator */
+#define VERIFY_MMAP_WINDOW	8	/* slots per lookup */
+
+typedef struct {
+    char    magic[8];			/* VERIFY_MMAP_MAGIC */
+    uint32_t version;			/* VERIFY_MMAP_VERSION */
+    uint32_t slot_size;			/* sizeof(VERIFY_MMAP_SLOT) */
+    uint32_t slots;			/* number of slots */
+    volatile uint32_t retired;		/* file was replaced */
+    uint64_t seed;			/* hash seed */
+    uint32_t spare[8];
+} VERIFY_MMAP_HEAD;
+
+typedef struct {
+    volatile uint32_t seq;		/* odd: update in progress */
+    uint32_t check;			/* content checksum */
+    int32_t status;			/* address status */
+    uint32_t fresh_until;		/* time of refresh */
+    uint16_t addr_len;			/* 0 (free), or address length */
+    uint16_t text_len;			/* text length */
+    char    addr[VERIFY_MMAP_ADDR_LEN];	/* address */
+    char    text[VERIFY_MMAP_TEXT_LEN];	/* status text */
+} VERIFY_MMAP_SLOT;
+
+struct VERIFY_MMAP {
+    char   *path;			/* cache file name */
+    int     fd;				/* open file */
+    int     writable;			/* opened for update */
+    size_t  size;			/* mapped size */
+    VERIFY_MMAP_HEAD *head;		/* mapped file header */
+    VERIFY_MMAP_SLOT *slots;		/* mapped slot array */
+    uint32_t nslots;			/* number of slots */
+};
+
+#define VERIFY_MMAP_SIZE(n) \
+	(sizeof(VERIFY_MMAP_HEAD) + (size_t) (n) * sizeof(VERIFY_MMAP_SLOT))
+
+ /*
+  * Lock-free readers need the writer's stores to become visible in program
+  * order. Without compiler support, a reader may see a torn update; the
+  * checksum still turns that into a cache miss, which is harmless.
+  */
+#if defined(__GNUC__) && ((__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 1))
+#define VERIFY_MMAP_BARRIER()	__sync_synchronize()
+#else
+#define VERIFY_MMAP_BARRIER()	((void) 0)
+#endif
+
+#define VERIFY_MMAP_READ_TRIES	3
+
+ /*
+  * FNV-1a, 64-bit. We can't use hash_fnv(3), because that is seeded per
+  * process, and the slot positions must be the same in all processes.
+  */
+#define VERIFY_MMAP_FNV_BASIS	0xcbf29ce484222325ULL
+#define VERIFY_MMAP_FNV_PRIME	0x100000001b3ULL
+
+/* verify_mmap_fnv - hash a byte string */
+
+static uint64_t verify_mmap_fnv(uint64_t hash, const void *data, size_t len)
+{
+    const unsigned char *cp = (const unsigned char *) data;
+
+    while (len-- > 0) {
+	hash ^= *cp++;
+	hash *= VERIFY_MMAP_FNV_PRIME;
+    }
+    return (hash);
+}
+
+/* verify_mmap_check - compute slot checksum */
+
+static uint32_t verify_mmap_check(const VERIFY_MMAP_SLOT *slot)
+{
+    uint64_t hash;
+    size_t  addr_len;
+    size_t  text_len;
+
+    hash = verify_mmap_fnv(VERIFY_MMAP_FNV_BASIS, &slot->status,
+			   sizeof(slot->status));
+    hash = verify_mmap_fnv(hash, &slot->fresh_until,
+			   sizeof(slot->fresh_until));
+    hash = verify_mmap_fnv(hash, &slot->addr_len, sizeof(slot->addr_len));
+    hash = verify_mmap_fnv(hash, &slot->text_len, sizeof(slot->text_len));
+    if ((addr_len = slot->addr_len) >= VERIFY_MMAP_ADDR_LEN
+	|| (text_len = slot->text_len) >= VERIFY_MMAP_TEXT_LEN)
+	return (~(uint32_t) slot->check);	/* never matches */
+    hash = verify_mmap_fnv(hash, slot->addr, addr_len);
+    hash = verify_mmap_fnv(hash, slot->text, text_len);
+    return ((uint32_t) (hash ^ (hash >> 32)));
+}
+
+/* verify_mmap_key - convert address to lookup key */
+
+static size_t verify_mmap_key(const char *addr, char *key)
+{
+    size_t  len;
+
+    /* FIX 200501 IPv6 patch did not neuter ":" in address literals. */
+    for (len = 0; addr[len] != 0; len++) {
+	if (len >= VERIFY_MMAP_ADDR_LEN - 1)
+	    return (0);
+	key[len] = (addr[len] == ':' ? '_' : addr[len]);
+    }
+    key[len] = 0;
+    return (len);
+}
+
+/* verify_mmap_slot - map lookup key to first slot of lookup window */
+
+static uint32_t verify_mmap_slot(VERIFY_MMAP *cache, const char *key,
+				         size_t len)
+{
+    uint64_t hash;
+
+    hash = verify_mmap_fnv(VERIFY_MMAP_FNV_BASIS ^ cache->head->seed,
+			   key, len);
+    return ((uint32_t) (hash % cache->nslots));
+}
+
+/* verify_mmap_read - lock-free read of one slot */
+
+static int verify_mmap_read(VERIFY_MMAP_SLOT *slot, VERIFY_MMAP_SLOT *copy)
+{
+    uint32_t seq;
+    int     tries;
+
+    for (tries = 0; tries < VERIFY_MMAP_READ_TRIES; tries++) {
+	if ((seq = slot->seq) & 1)
+	    continue;
+	VERIFY_MMAP_BARRIER();
+	memcpy((void *) copy, (void *) slot, sizeof(*copy));
+	VERIFY_MMAP_BARRIER();
+	if (slot->seq == seq && copy->check == verify_mmap_check(copy))
+	    return (copy->addr_len != 0);
+    }
+    return (0);
+}
+
+/* verify_mmap_write - update one slot */
+
+static void verify_mmap_write(VERIFY_MMAP_SLOT *slot, const char *key,
+			              size_t addr_len, int status,
+			              time_t fresh_until, const char *text)
+{
+    uint32_t seq = slot->seq | 1;
+    size_t  text_len;
+
+    /*
+     * Keep the sequence number odd while the slot content is inconsistent.
+     * If we die here, the slot stays odd until it is reclaimed.
+     */
+    slot->seq = seq;
+    VERIFY_MMAP_BARRIER();
+    slot->status = status;
+    slot->fresh_until = (fresh_until > (time_t) UINT32_MAX ? UINT32_MAX :
+			 fresh_until < 0 ? 0 : (uint32_t) fresh_until);
+    slot->addr_len = addr_len;
+    memcpy(slot->addr, key, addr_len);
+    slot->addr[addr_len] = 0;
+    if ((text_len = strlen(text)) >= VERIFY_MMAP_TEXT_LEN)
+	text_len = VERIFY_MMAP_TEXT_LEN - 1;
+    slot->text_len = text_len;
+    memcpy(slot->text, text, text_len);
+    slot->text[text_len] = 0;
+    slot->check = verify_mmap_check(slot);
+    VERIFY_MMAP_BARRIER();
+    slot->seq = seq + 1;
+}
+
+/* verify_mmap_find - find slot for lookup key, with the cache writable */
+
+static VERIFY_MMAP_SLOT *verify_mmap_find(VERIFY_MMAP *cache, const char *key,
+					          size_t len, int create)
+{
+    VERIFY_MMAP_SLOT *slot;
+    VERIFY_MMAP_SLOT *free_slot = 0;
+    VERIFY_MMAP_SLOT *oldest = 0;
+    uint32_t pos;
+    int     n;
+
+    /*
+     * Examine the whole window. There are no tombstones; a free slot does
+     * not terminate the search.
+     */
+    pos = verify_mmap_slot(cache, key, len);
+    for (n = 0; n < VERIFY_MMAP_WINDOW; n++, pos = (pos + 1) % cache->nslots) {
+	slot = cache->slots + pos;
+	if ((slot->seq & 1) != 0 || slot->addr_len == 0
+	    || verify_mmap_check(slot) != slot->check) {
+	    if (free_slot == 0)
+		free_slot = slot;
+	} else if (slot->addr_len == len && memcmp(slot->addr, key, len) == 0) {
+	    return (slot);
+	} else if (oldest == 0 || slot->fresh_until < oldest->fresh_until) {
+	    oldest = slot;
+	}
+    }
+    if (create == 0)
+	return (0);
+    if (free_slot != 0)
+	return (free_slot);
+    if (msg_verbose)
+	msg_info("%s: %s: evicting slot %lu", cache->path, key,
+		 (unsigned long) (oldest - cache->slots));
+    return (oldest);
+}
+
+/* verify_mmap_create - create new cache file and rename it into place */
+
+static void verify_mmap_create(const char *path, int slots)
+{
+    VERIFY_MMAP_HEAD head;
+    VSTRING *tmp_buf = vstring_alloc(100);
+    const char *tmp_path;
+    int     fd;
+
+    tmp_path = vstring_str(vstring_sprintf(tmp_buf, "%s.%ld",
+					   path, (long) getpid()));
+    memset((void *) &head, 0, sizeof(head));
+    memcpy(head.magic, VERIFY_MMAP_MAGIC, sizeof(VERIFY_MMAP_MAGIC));
+    head.version = VERIFY_MMAP_VERSION;
+    head.slot_size = sizeof(VERIFY_MMAP_SLOT);
+    head.slots = slots;
+    ldseed(&head.seed, sizeof(head.seed));
+
+    if ((fd = open(tmp_path, O_RDWR | O_CREAT | O_TRUNC, 0600)) < 0)
+	msg_fatal("open %s: %m", tmp_path);
+    if (ftruncate(fd, (off_t) VERIFY_MMAP_SIZE(slots)) < 0)
+	msg_fatal("truncate %s: %m", tmp_path);
+    if (write(fd, (void *) &head, sizeof(head)) != sizeof(head))
+	msg_fatal("write %s: %m", tmp_path);
+    if (close(fd) < 0)
+	msg_fatal("close %s: %m", tmp_path);
+    if (rename(tmp_path, path) < 0)
+	msg_fatal("rename %s to %s: %m", tmp_path, path);
+    vstring_free(tmp_buf);
+}
+
+/* verify_mmap_valid - validate file header */
+
+static int verify_mmap_valid(VERIFY_MMAP_HEAD *head, off_t size)
+{
+    return (memcmp(head->magic, VERIFY_MMAP_MAGIC,
+		   sizeof(VERIFY_MMAP_MAGIC)) == 0
+	    && head->version == VERIFY_MMAP_VERSION
+	    && head->slot_size == sizeof(VERIFY_MMAP_SLOT)
+	    && head->slots > 0
+	    && head->slots <= INT_MAX / sizeof(VERIFY_MMAP_SLOT)
+	    && size == VERIFY_MMAP_SIZE(head->slots));
+}
+
+/* verify_mmap_open - open cache file */
+
+VERIFY_MMAP *verify_mmap_open(const char *path, int slots, int open_flags)
+{
+    VERIFY_MMAP *cache;
+    VERIFY_MMAP_HEAD head;
+    static const uint32_t retired = 1;
+    struct stat fst;
+    struct stat st;
+    int     writable = ((open_flags & O_ACCMODE) != O_RDONLY);
+    void   *ptr;
+    int     fd;
+
+    /*
+     * Readers use whatever the writer has created, and don't complain when
+     * the writer has not yet created the file.
+     */
+    if (!writable) {
+	if ((fd = open(path, O_RDONLY, 0)) < 0) {
+	    if (errno != ENOENT)
+		msg_warn("open %s: %m", path);
+	    return (0);
+	}
+	if (fstat(fd, &fst) < 0)
+	    msg_fatal("fstat %s: %m", path);
+	if (read(fd, (void *) &head, sizeof(head)) != sizeof(head)
+	    || !verify_mmap_valid(&head, fst.st_size) || head.retired) {
+	    msg_warn("%s: unexpected cache file size or format -- ignoring",
+		     path);
+	    (void) close(fd);
+	    return (0);
+	}
+	slots = head.slots;
+    }
+
+    /*
+     * The writer replaces a file with the wrong size or format. A reader
+     * that still has the old file mapped will find no entries.
+     */
+    else {
+	if (slots <= 0 || slots > INT_MAX / sizeof(VERIFY_MMAP_SLOT))
+	    msg_fatal("%s: bad cache size: %d slots", path, slots);
+	for (;;) {
+	    if ((fd = open(path, O_RDWR | O_CREAT, 0600)) < 0)
+		msg_fatal("open %s: %m", path);
+	    if (myflock(fd, INTERNAL_LOCK, MYFLOCK_OP_EXCLUSIVE) < 0)
+		msg_fatal("lock %s: %m", path);
+	    if (fstat(fd, &fst) < 0)
+		msg_fatal("fstat %s: %m", path);
+	    if (stat(path, &st) < 0 || st.st_dev != fst.st_dev
+		|| st.st_ino != fst.st_ino) {
+		(void) close(fd);
+		continue;
+	    }
+	    if (read(fd, (void *) &head, sizeof(head)) == sizeof(head)
+		&& verify_mmap_valid(&head, fst.st_size)
+		&& head.slots == slots && !head.retired)
+		break;
+	    if (fst.st_size != 0) {
+		msg_warn("%s: cache file size or format has changed "
+			 "-- creating new file with %d slots", path, slots);
+		if (fst.st_size >= sizeof(head)
+		    && pwrite(fd, &retired, sizeof(retired),
+			      offsetof(VERIFY_MMAP_HEAD, retired)) < 0)
+		    msg_warn("%s: mark cache file as retired: %m", path);
+	    }
+	    verify_mmap_create(path, slots);
+	    (void) close(fd);
+	}
+	if (myflock(fd, INTERNAL_LOCK, MYFLOCK_OP_NONE) < 0)
+	    msg_fatal("unlock %s: %m", path);
+    }
+    if ((ptr = mmap((void *) 0, VERIFY_MMAP_SIZE(slots),
+		    writable ? PROT_READ | PROT_WRITE : PROT_READ,
+		    MAP_SHARED, fd, (off_t) 0)) == MAP_FAILED)
+	msg_fatal("mmap %s: %m", path);
+    close_on_exec(fd, CLOSE_ON_EXEC);
+
+    cache = (VERIFY_MMAP *) mymalloc(sizeof(*cache));
+    cache->path = mystrdup(path);
+    cache->fd = fd;
+    cache->writable = writable;
+    cache->size = VERIFY_MMAP_SIZE(slots);
+    cache->head = (VERIFY_MMAP_HEAD *) ptr;
+    cache->slots = (VERIFY_MMAP_SLOT *) (cache->head + 1);
+    cache->nslots = slots;
+    return (cache);
+}
+
+/* verify_mmap_lookup - look up fresh address status */
+
+int     verify_mmap_lookup(VERIFY_MMAP *cache, const char *addr,
+			           int *addr_status, VSTRING *why)
+{
+    char    key[VERIFY_MMAP_ADDR_LEN];
+    VERIFY_MMAP_SLOT copy;
+    size_t  len;
+    uint32_t pos;
+    int     n;
+
+    if (cache->head->retired || (len = verify_mmap_key(addr, key)) == 0)
+	return (0);
+    pos = verify_mmap_slot(cache, key, len);
+    for (n = 0; n < VERIFY_MMAP_WINDOW; n++, pos = (pos + 1) % cache->nslots) {
+	if (verify_mmap_read(cache->slots + pos, &copy)
+	    && copy.addr_len == len
+	    && memcmp(copy.addr, key, len) == 0) {
+	    if (copy.fresh_until <= (uint32_t) time((time_t *) 0)) {
+		if (msg_verbose)
+		    msg_info("%s: %s: stale slot %lu", cache->path, addr,
+			     (unsigned long) pos);
+		return (0);
+	    }
+	    if (msg_verbose)
+		msg_info("%s: %s: hit slot %lu", cache->path, addr,
+			 (unsigned long) pos);
+	    *addr_status = copy.status;
+	    vstring_strncpy(why, copy.text, copy.text_len);
+	    return (1);
+	}
+    }
+    return (0);
+}
+
+/* verify_mmap_update - save address status */
+
+void    verify_mmap_update(VERIFY_MMAP *cache, const char *addr,
+			           int addr_status, time_t fresh_until,
+			           const char *why)
+{
+    char    key[VERIFY_MMAP_ADDR_LEN];
+    VERIFY_MMAP_SLOT *slot;
+    size_t  len;
+
+    if (cache->writable == 0)
+	msg_panic("verify_mmap_update: %s: cache is read-only", cache->path);
+    if ((len = verify_mmap_key(addr, key)) == 0)
+	return;
+    slot = verify_mmap_find(cache, key, len, 1);
+    verify_mmap_write(slot, key, len, addr_status, fresh_until, why);
+}
+
+/* verify_mmap_delete - remove address status */
+
+void    verify_mmap_delete(VERIFY_MMAP *cache, const char *addr)
+{
+    char    key[VERIFY_MMAP_ADDR_LEN];
+    VERIFY_MMAP_SLOT *slot;
+    size_t  len;
+
+    if (cache->writable == 0)
+	msg_panic("verify_mmap_delete: %s: cache is read-only", cache->path);
+    if ((len = verify_mmap_key(addr, key)) == 0)
+	return;
+    if ((slot = verify_mmap_find(cache, key, len, 0)) != 0)
+	verify_mmap_write(slot, "", 0, 0, 0, "");
+}
+
+/* verify_mmap_close - unmap and release storage */
+
+void    verify_mmap_close(VERIFY_MMAP *cache)
+{
+    if (munmap((void *) cache->head, cache->size) < 0)
+	msg_warn("munmap %s: %m", cache->path);
+    (void) close(cache->fd);
+    myfree(cache->path);
+    myfree((void *) cache);
+}
+
+#ifdef TEST
+
+ /*
+  * Test program. Update the cache with one handle, and look up addresses
+  * with a separate read-only handle, as the verify(8) server and its
+  * clients do. Commands are:
+  *
+  * update address status ttl text
+  *
+  * delete address
+  *
+  * lookup address
+  */
+#include <stdlib.h>
+#include <msg_vstream.h>
+#include <vstring_vstream.h>
+#include <stringops.h>
+
+#define STR(x)	vstring_str(x)
+
+int     main(int argc, char **argv)
+{
+    VERIFY_MMAP *writer;
+    VERIFY_MMAP *reader;
+    VSTRING *buf = vstring_alloc(100);
+    VSTRING *why = vstring_alloc(100);
+    char   *cp;
+    char   *cmd;
+    char   *addr;
+    char   *status;
+    char   *ttl;
+    int     addr_status;
+
+    msg_vstream_init(argv[0], VSTREAM_ERR);
+    if (argc != 3)
+	msg_fatal("usage: %s file slots", argv[0]);
+    if (verify_mmap_open(argv[1], atoi(argv[2]), O_RDONLY) != 0)
+	msg_fatal("%s: read-only open of non-existent file succeeded",
+		  argv[1]);
+    writer = verify_mmap_open(argv[1], atoi(argv[2]), O_RDWR | O_CREAT);
+    if ((reader = verify_mmap_open(argv[1], 0, O_RDONLY)) == 0)
+	msg_fatal("%s: read-only open failed", argv[1]);
+
+    while (vstring_get_nonl(buf, VSTREAM_IN) != VSTREAM_EOF) {
+	cp = STR(buf);
+	vstream_printf("> %s\n", cp);
+	if ((cmd = mystrtok(&cp, CHARS_SPACE)) == 0 || *cmd == '#')
+	    continue;
+	if ((addr = mystrtok(&cp, CHARS_SPACE)) == 0) {
+	    msg_warn("missing address");
+	} else if (strcmp(cmd, "update") == 0) {
+	    if ((status = mystrtok(&cp, CHARS_SPACE)) == 0
+		|| (ttl = mystrtok(&cp, CHARS_SPACE)) == 0)
+		msg_warn("usage: update address status ttl text");
+	    else
+		verify_mmap_update(writer, addr, atoi(status),
+				   time((time_t *) 0) + atoi(ttl), cp);
+	} else if (strcmp(cmd, "delete") == 0) {
+	    verify_mmap_delete(writer, addr);
+	} else if (strcmp(cmd, "lookup") == 0) {
+	    if (verify_mmap_lookup(reader, addr, &addr_status, why))
+		vstream_printf("%s: status=%d text=%s\n",
+			       addr, addr_status, STR(why));
+	    else
+		vstream_printf("%s: not found\n", addr);
+	} else {
+	    msg_warn("unknown command: %s", cmd);
+	}
+	vstream_fflush(VSTREAM_OUT);
+    }
+
+    /*
+     * Replace the file with a different size. The old reader must no longer
+     * find any entries.
+     */
+    verify_mmap_close(writer);
+    writer = verify_mmap_open(argv[1], atoi(argv[2]) + 1, O_RDWR | O_CREAT);
+    vstream_printf("after resize: %s\n",
+		   verify_mmap_lookup(reader, "a@example.com", &addr_status,
+				      why) ? "found" : "not found");
+    vstream_fflush(VSTREAM_OUT);
+    verify_mmap_close(reader);
+    verify_mmap_close(writer);
+    vstring_free(buf);
+    vstring_free(why);
+    return (0);
+}
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef _VERIFY_MMAP_H_INCLUDED_
+#define _VERIFY_MMAP_H_INCLUDED_
+
+/*++
+/* NAME
+/*	verify_mmap 3h
+/* SUMMARY
+/*	shared address verification result cache
+/* SYNOPSIS
+/*	#include <verify_mmap.h>
+/* DESCRIPTION
+/* .nf
+
+ /*
+  * System library.
+  */
+#include <time.h>
+
+ /*
+  * Utility library.
+  */
+#include <vstring.h>
+
+ /*
+  * External interface.
+  */
+typedef struct VERIFY_MMAP VERIFY_MMAP;
+
+extern VERIFY_MMAP *verify_mmap_open(const char *, int, int);
+extern int verify_mmap_lookup(VERIFY_MMAP *, const char *, int *, VSTRING *);
+extern void verify_mmap_update(VERIFY_MMAP *, const char *, int, time_t,
+			               const char *);
+extern void verify_mmap_delete(VERIFY_MMAP *, const char *);
+extern void verify_mmap_close(VERIFY_MMAP *);
+
+/* LICENSE
+/* .ad
+/* .fi
+/*	The Secure Mailer license must be distributed with this software.
+/*--*/
+
+#endif
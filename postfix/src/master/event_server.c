@@ -127,6 +127,12 @@
 /*	is available. A token is consumed for each connection request.
 /* .IP CA_MAIL_SERVER_SOLITARY
 /*	This service must be configured with process limit of 1.
+/* .IP "CA_MAIL_SERVER_SOLITARY_FLAG(int *)"
+/*	Store a non-zero value when this service is configured with
+/*	a process limit of 1 (or when it runs in stand-alone mode),
+/*	zero otherwise. Use this instead of CA_MAIL_SERVER_SOLITARY
+/*	when a service can share its state among multiple processes,
+/*	but must know when it has to.
 /* .IP CA_MAIL_SERVER_UNLIMITED
 /*	This service must be configured with process limit of 0.
 /* .IP CA_MAIL_SERVER_PRIVILEGED
@@ -804,6 +810,9 @@ NORETURN event_server_main(int argc, char **argv, MULTI_SERVER_FN service,...)
 		msg_fatal("service %s requires a process limit of 1",
 			  service_name);
 	    break;
+	case MAIL_SERVER_SOLITARY_FLAG:
+	    *va_arg(ap, int *) = (stream != 0 || alone);
+	    break;
 	case MAIL_SERVER_UNLIMITED:
 	    if (stream == 0 && !zerolimit)
 		msg_fatal("service %s requires a process limit of 0",
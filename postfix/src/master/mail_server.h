@@ -47,6 +47,7 @@
 #define MAIL_SERVER_BOUNCE_INIT	22
 #define MAIL_SERVER_RETIRE_ME	23
 #define MAIL_SERVER_POST_ACCEPT	24
+#define MAIL_SERVER_SOLITARY_FLAG	25
 
 typedef void (*MAIL_SERVER_INIT_FN) (char *, char **);
 typedef int (*MAIL_SERVER_LOOP_FN) (char *, char **);
@@ -80,6 +81,7 @@ typedef void (*MAIL_SERVER_SLOW_EXIT_FN) (char *, char **);
 #define CA_MAIL_SERVER_SLOW_EXIT(v)	MAIL_SERVER_SLOW_EXIT, CHECK_VAL(MAIL_SERVER, MAIL_SERVER_SLOW_EXIT_FN, (v))
 #define CA_MAIL_SERVER_BOUNCE_INIT(v, w) MAIL_SERVER_BOUNCE_INIT, CHECK_PTR(MAIL_SERVER, char, (v)), CHECK_PPTR(MAIL_SERVER, char, (w))
 #define CA_MAIL_SERVER_RETIRE_ME	MAIL_SERVER_RETIRE_ME
+#define CA_MAIL_SERVER_SOLITARY_FLAG(v)	MAIL_SERVER_SOLITARY_FLAG, CHECK_PTR(MAIL_SERVER, int, (v))
 
 CHECK_VAL_HELPER_DCL(MAIL_SERVER, MAIL_SERVER_SLOW_EXIT_FN);
 CHECK_VAL_HELPER_DCL(MAIL_SERVER, MAIL_SERVER_LOOP_FN);
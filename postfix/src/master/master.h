@@ -49,6 +49,14 @@ typedef struct MASTER_SERV {
     int     avail_proc;			/* idle processes */
     int     total_proc;			/* number of processes */
     int     throttle_delay;		/* failure recovery parameter */
+    int     reuseport;			/* per-process listeners */
+    int     min_idle;			/* configured idle process floor */
+    int     idle_target;		/* adaptive idle process target */
+    time_t  idle_adapt_time;		/* last on-demand spawn */
+    int     demand_spawns;		/* on-demand spawns since report */
+    double  demand_delay_sum;		/* spawn to first connection */
+    double  demand_delay_max;		/* spawn to first connection */
+    time_t  demand_report_time;		/* last spawn latency report */
     int     status_fd[2];		/* child status reports */
     struct BINHASH *children;		/* linkage */
     struct MASTER_SERV *next;		/* linkage */
@@ -88,6 +96,17 @@ typedef struct MASTER_SERV {
   */
 #define MASTER_DEF_MIN_IDLE	1	/* preferred # of idle processes */
 
+ /*
+  * Warm process pool policy. A service with a non-zero min_idle setting
+  * keeps at least that many idle processes; each on-demand spawn (all
+  * processes busy) raises the target by one, up to MASTER_IDLE_MAX_SCALE
+  * times min_idle, and the target decays by one per MASTER_IDLE_DECAY
+  * seconds without on-demand spawns.
+  */
+#define MASTER_IDLE_MAX_SCALE	4	/* idle target upper bound factor */
+#define MASTER_IDLE_DECAY	60	/* seconds per target decrement */
+#define MASTER_IDLE_REPORT	300	/* spawn latency logging interval */
+
  /*
   * Structure of child process.
   */
@@ -99,6 +118,7 @@ typedef struct MASTER_PROC {
     int     avail;			/* availability */
     MASTER_SERV *serv;			/* parent linkage */
     int     use_count;			/* number of service requests */
+    double  start_time;			/* on-demand spawn time, or zero */
 } MASTER_PROC;
 
  /*
@@ -169,6 +189,7 @@ extern void master_wakeup_cleanup(MASTER_SERV *);
   */
 extern void master_listen_init(MASTER_SERV *);
 extern void master_listen_cleanup(MASTER_SERV *);
+extern int master_listen_reuseport(MASTER_SERV *, int);
 
  /*
   * master_avail.c
@@ -177,12 +198,17 @@ extern void master_avail_listen(MASTER_SERV *);
 extern void master_avail_cleanup(MASTER_SERV *);
 extern void master_avail_more(MASTER_SERV *, MASTER_PROC *);
 extern void master_avail_less(MASTER_SERV *, MASTER_PROC *);
+extern void master_avail_latency(MASTER_SERV *, MASTER_PROC *);
 
  /*
   * master_spawn.c
   */
 extern struct BINHASH *master_child_table;
-extern void master_spawn(MASTER_SERV *);
+extern void master_spawn(MASTER_SERV *, int);
+
+#define MASTER_SPAWN_DEMAND	0	/* all processes busy */
+#define MASTER_SPAWN_PREFORK	1	/* replenish idle pool */
+
 extern void master_reap_child(void);
 extern void master_delete_children(MASTER_SERV *);
 
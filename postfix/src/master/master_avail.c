@@ -19,6 +19,10 @@
 /*	void	master_avail_less(serv, proc)
 /*	MASTER_SERV *serv;
 /*	MASTER_PROC *proc;
+/*
+/*	void	master_avail_latency(serv, proc)
+/*	MASTER_SERV *serv;
+/*	MASTER_PROC *proc;
 /* DESCRIPTION
 /*	This module implements the process creation policy. As long as
 /*	the allowed number of processes for the given service is not
@@ -31,6 +35,13 @@
 /*	servers are asked to restart at their convenience, and new
 /*	servers are created with stress mode enabled.
 /*
+/*	A service with a non-zero service_min_idle setting keeps a
+/*	pool of idle processes, so that a connection burst does not
+/*	have to wait for process creation and initialization. The
+/*	pool grows when a connection request finds no idle process,
+/*	and shrinks back toward the configured minimum when such
+/*	on-demand process creation stops.
+/*
 /*	master_avail_listen() ensures that someone monitors the service's
 /*	listen socket for connection requests (as long as resources
 /*	to handle connection requests are available).  This function may
@@ -51,6 +62,11 @@
 /*	has become unavailable for servicing new connection requests.
 /*	This function updates the process availability status and
 /*	counter, and implicitly calls master_avail_listen().
+/*
+/*	master_avail_latency() should be called when a process that
+/*	was created on demand accepts its first connection. It updates
+/*	the service's spawn latency statistics, and periodically logs
+/*	a summary.
 /* DIAGNOSTICS
 /*	Panic: internal inconsistencies.
 /* BUGS
@@ -70,6 +86,7 @@
 /* System libraries. */
 
 #include <sys_defs.h>
+#include <sys/time.h>
 
 /* Utility library. */
 
@@ -115,10 +132,36 @@ static void master_avail_event(int event, void *context)
 		master_restart_service(serv, NO_CONF_RELOAD);
 	    serv->stress_expire_time = now + 1000;
 	}
-	master_spawn(serv);
+
+	/*
+	 * A client is waiting and the idle pool is empty. Grow the pool so
+	 * that the next burst finds a warm process.
+	 */
+	if (serv->min_idle > 0) {
+	    if (serv->idle_target < MASTER_IDLE_MAX_SCALE * serv->min_idle
+		&& MASTER_LIMIT_OK(serv->max_proc, serv->idle_target))
+		serv->idle_target++;
+	    serv->idle_adapt_time = event_time();
+	}
+	master_spawn(serv, MASTER_SPAWN_DEMAND);
     }
 }
 
+/* master_avail_prespawn - replenish the idle process pool */
+
+static void master_avail_prespawn(int unused_event, void *context)
+{
+    MASTER_SERV *serv = (MASTER_SERV *) context;
+
+    /*
+     * Things may have changed since this call was scheduled.
+     */
+    if (!MASTER_THROTTLED(serv)
+	&& serv->avail_proc < serv->idle_target
+	&& MASTER_LIMIT_OK(serv->max_proc, serv->total_proc))
+	master_spawn(serv, MASTER_SPAWN_PREFORK);
+}
+
 /* master_avail_listen - enforce the socket monitoring policy */
 
 void    master_avail_listen(MASTER_SERV *serv)
@@ -162,6 +205,26 @@ void    master_avail_listen(MASTER_SERV *serv)
 	    }
 	}
     }
+
+    /*
+     * Keep the idle process pool at its target size, one process per event
+     * loop iteration. We can't call master_spawn() from here, so we use a
+     * zero-delay timer instead. Services with a conditional wakeup timer are
+     * not prespawned, as that would turn on their wakeup timer.
+     */
+    if (serv->min_idle > 0) {
+	now = event_time();
+	if (serv->idle_target > serv->min_idle
+	    && now - serv->idle_adapt_time >= MASTER_IDLE_DECAY) {
+	    serv->idle_target--;
+	    serv->idle_adapt_time = now;
+	}
+	if (!MASTER_THROTTLED(serv)
+	    && (serv->flags & MASTER_FLAG_CONDWAKE) == 0
+	    && serv->avail_proc < serv->idle_target
+	    && MASTER_LIMIT_OK(serv->max_proc, serv->total_proc))
+	    event_request_timer(master_avail_prespawn, (void *) serv, 0);
+    }
     if (listen_flag && !MASTER_LISTENING(serv)) {
 	if (msg_verbose)
 	    msg_info("%s: enable events %s", myname, serv->name);
@@ -186,6 +249,7 @@ void    master_avail_cleanup(MASTER_SERV *serv)
 
     master_delete_children(serv);		/* XXX calls
 						 * master_avail_listen */
+    event_cancel_timer(master_avail_prespawn, (void *) serv);
 
     /*
      * This code is redundant because master_delete_children() throttles the
@@ -249,3 +313,44 @@ void    master_avail_less(MASTER_SERV *serv, MASTER_PROC *proc)
     proc->avail = MASTER_STAT_TAKEN;
     master_avail_listen(serv);
 }
+
+/* master_avail_latency - account for on-demand process creation delay */
+
+void    master_avail_latency(MASTER_SERV *serv, MASTER_PROC *proc)
+{
+    struct timeval tv;
+    double  delay;
+    time_t  now;
+
+    /*
+     * Caution: this is called from master_status_event(), and must not
+     * invoke code in other master_XXX modules.
+     */
+    GETTIMEOFDAY(&tv);
+    delay = tv.tv_sec + tv.tv_usec / 1000000.0 - proc->start_time;
+    proc->start_time = 0;
+    if (delay < 0)
+	delay = 0;
+    serv->demand_spawns++;
+    serv->demand_delay_sum += delay;
+    if (delay > serv->demand_delay_max)
+	serv->demand_delay_max = delay;
+
+    /*
+     * Don't flood the logfile.
+     */
+    now = event_time();
+    if (msg_verbose || (serv->min_idle > 0
+		  && now - serv->demand_report_time >= MASTER_IDLE_REPORT)) {
+	msg_info("service \"%s\" (%s): %d on-demand process start(s), "
+		 "time to first connection avg %.3fs max %.3fs, "
+		 "idle target %d", serv->ext_name, serv->name,
+		 serv->demand_spawns,
+		 serv->demand_delay_sum / serv->demand_spawns,
+		 serv->demand_delay_max, serv->idle_target);
+	serv->demand_spawns = 0;
+	serv->demand_delay_sum = 0;
+	serv->demand_delay_max = 0;
+	serv->demand_report_time = now;
+    }
+}
@@ -140,6 +140,12 @@ void    master_config(void)
 	    serv->wakeup_time = entry->wakeup_time;
 	    serv->max_proc = entry->max_proc;
 	    serv->throttle_delay = entry->throttle_delay;
+	    serv->reuseport = entry->reuseport;
+	    serv->min_idle = entry->min_idle;
+	    if (serv->idle_target < serv->min_idle)
+		serv->idle_target = serv->min_idle;
+	    if (serv->idle_target > MASTER_IDLE_MAX_SCALE * serv->min_idle)
+		serv->idle_target = MASTER_IDLE_MAX_SCALE * serv->min_idle;
 	    SWAP(char *, serv->ext_name, entry->ext_name);
 	    SWAP(char *, serv->path, entry->path);
 	    SWAP(ARGV *, serv->args, entry->args);
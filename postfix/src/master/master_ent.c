@@ -257,6 +257,82 @@ static int get_int_ent(char **bufp, char *name, char *def_val, int min_val)
     return (n);
 }
 
+/* get_override_ent - master.cf -o name=value override for master */
+
+static const char *get_override_ent(ARGV *args, const char *param,
+				            const char *def_val)
+{
+    char  **cpp;
+    char   *opt;
+    char   *name;
+    char   *value;
+    const char *err;
+    const char *result = def_val;
+    static VSTRING *buf;
+
+    /*
+     * Some master.cf "-o name=value" overrides are for the master itself.
+     * They are also passed to the child process, where they are harmless.
+     * The last instance wins.
+     */
+    if (buf == 0)
+	buf = vstring_alloc(10);
+    for (cpp = args->argv; *cpp; cpp++) {
+	if (strcmp(*cpp, "-o") == 0 && cpp[1] != 0)
+	    opt = *++cpp;
+	else if (strncmp(*cpp, "-o", 2) == 0)
+	    opt = *cpp + 2;
+	else
+	    continue;
+	if (strncmp(opt, param, strlen(param)) != 0
+	    || opt[strlen(param)] != '=')
+	    continue;
+	opt = mystrdup(opt);
+	if ((err = split_nameval(opt, &name, &value)) != 0)
+	    fatal_with_context("%s: \"%s\"", err, *cpp);
+	result = vstring_str(vstring_strcpy(buf, mail_conf_eval(value)));
+	myfree(opt);
+    }
+    return (result);
+}
+
+/* get_min_idle_ent - per-service idle process floor */
+
+static int get_min_idle_ent(ARGV *args, int type)
+{
+    const char *value;
+
+    /*
+     * The main.cf setting applies only to inet services, so that it does
+     * not keep idle processes for every internal service. Other services
+     * need an explicit master.cf override.
+     */
+    if ((value = get_override_ent(args, VAR_SERVICE_MIN_IDLE,
+				  (char *) 0)) == 0)
+	return (type == MASTER_SERV_TYPE_INET ? var_service_min_idle : 0);
+    if (!alldig(value))
+	fatal_with_context("bad \"-o %s\" value: \"%s\"",
+			   VAR_SERVICE_MIN_IDLE, value);
+    return (atoi(value));
+}
+
+/* get_reuseport_ent - per-service private listener sockets */
+
+static int get_reuseport_ent(ARGV *args)
+{
+    const char *value;
+
+    if ((value = get_override_ent(args, VAR_SERVICE_REUSEPORT,
+				  (char *) 0)) == 0)
+	return (var_service_reuseport);
+    if (strcasecmp(value, CONFIG_BOOL_YES) == 0)
+	return (1);
+    if (strcasecmp(value, CONFIG_BOOL_NO) == 0)
+	return (0);
+    fatal_with_context("bad \"-o %s\" value: \"%s\"",
+		       VAR_SERVICE_REUSEPORT, value);
+}
+
 /* get_master_ent - read entry from configuration file */
 
 MASTER_SERV *get_master_ent()
@@ -278,6 +354,8 @@ MASTER_SERV *get_master_ent()
     char   *atmp;
     const char *parse_err;
     static char *saved_interfaces = 0;
+    ssize_t sock_count_pos;
+    int     sock_count;
     char   *err;
 
     if (master_fp == 0)
@@ -576,10 +654,7 @@ MASTER_SERV *get_master_ent()
     } else
 	serv->stress_param_val = 0;
     serv->stress_expire_time = 0;
-    if (serv->listen_fd_count > 1)
-	argv_add(serv->args, "-s",
-	    vstring_str(vstring_sprintf(junk, "%d", serv->listen_fd_count)),
-		 (char *) 0);
+    sock_count_pos = serv->args->argc;
     while ((cp = mystrtokq(&bufp, master_blanks, CHARS_BRACE)) != 0) {
 	if (*cp == CHARS_BRACE[0]
 	    && (err = extpar(&cp, CHARS_BRACE, EXTPAR_FLAG_STRIP)) != 0)
@@ -588,6 +663,39 @@ MASTER_SERV *get_master_ent()
     }
     argv_terminate(serv->args);
 
+    /*
+     * With SO_REUSEPORT listeners, each child process receives the shared
+     * listener sockets followed by the same number of private listener
+     * sockets. The "-s" option is inserted where it always was, but only
+     * now do we know the socket count.
+     */
+    serv->reuseport = get_reuseport_ent(serv->args);
+    if (serv->reuseport && serv->type != MASTER_SERV_TYPE_INET) {
+	msg_warn("%s: ignoring \"%s = yes\" for non-inet service",
+		 master_conf_context(), VAR_SERVICE_REUSEPORT);
+	serv->reuseport = 0;
+    }
+    sock_count = serv->listen_fd_count * (serv->reuseport ? 2 : 1);
+    if (sock_count > 1) {
+	argv_insert_one(serv->args, sock_count_pos,
+			vstring_str(vstring_sprintf(junk, "%d", sock_count)));
+	argv_insert_one(serv->args, sock_count_pos, "-s");
+    }
+
+    /*
+     * Warm process pool. The adaptive target starts at the configured
+     * floor, and never exceeds the process limit.
+     */
+    serv->min_idle = get_min_idle_ent(serv->args, serv->type);
+    if (serv->max_proc > 0 && serv->min_idle > serv->max_proc)
+	serv->min_idle = serv->max_proc;
+    serv->idle_target = serv->min_idle;
+    serv->idle_adapt_time = 0;
+    serv->demand_spawns = 0;
+    serv->demand_delay_sum = 0;
+    serv->demand_delay_max = 0;
+    serv->demand_report_time = 0;
+
     /*
      * Cleanup.
      */
@@ -617,6 +725,8 @@ void    print_master_ent(MASTER_SERV *serv)
     msg_info("listen_fd_count: %d", serv->listen_fd_count);
     msg_info("wakeup: %d", serv->wakeup_time);
     msg_info("max_proc: %d", serv->max_proc);
+    msg_info("min_idle: %d", serv->min_idle);
+    msg_info("reuseport: %d", serv->reuseport);
     msg_info("path: %s", serv->path);
     for (cpp = serv->args->argv; *cpp; cpp++)
 	msg_info("arg[%d]: %s", (int) (cpp - serv->args->argv), *cpp);
@@ -11,6 +11,10 @@
 /*
 /*	void	master_listen_cleanup(serv)
 /*	MASTER_SERV *serv;
+/*
+/*	int	master_listen_reuseport(serv, fd)
+/*	MASTER_SERV *serv;
+/*	int	fd;
 /* DESCRIPTION
 /*	master_listen_init() turns on the listener implemented by the
 /*	named process. FIFOs and UNIX-domain sockets are created with
@@ -18,7 +22,15 @@
 /*
 /*	master_listen_cleanup() turns off the listener implemented by the
 /*	named process.
+/*
+/*	master_listen_reuseport() creates a new non-blocking listener
+/*	socket with SO_REUSEPORT, bound to the same address as the
+/*	specified INET listener. The kernel distributes new connections
+/*	over all listeners for that address. The result is -1 in case
+/*	of error. This function is called in a child process, after
+/*	fork() and before exec().
 /* DIAGNOSTICS
+/*	master_listen_reuseport() logs a warning in case of error.
 /* BUGS
 /* SEE ALSO
 /*	inet_listen(3), internet-domain listener
@@ -163,6 +175,61 @@ void    master_listen_init(MASTER_SERV *serv)
     }
 }
 
+/* master_listen_reuseport - create private listener for one process */
+
+int     master_listen_reuseport(MASTER_SERV *serv, int fd)
+{
+    const char *myname = "master_listen_reuseport";
+    struct sockaddr_storage ss;
+    struct sockaddr *sa = (struct sockaddr *) &ss;
+    SOCKADDR_SIZE sa_len = sizeof(ss);
+    int     sock;
+    int     on = 1;
+
+    /*
+     * Bind to the address of the shared listener, so that we don't have to
+     * look up the service endpoint again. Both sockets have SO_REUSEPORT
+     * (see inet_listen()), so the kernel balances connections over them.
+     */
+    if (getsockname(fd, sa, &sa_len) < 0) {
+	msg_warn("%s: getsockname: %m", myname);
+	return (-1);
+    }
+    if ((sock = socket(sa->sa_family, SOCK_STREAM, 0)) < 0) {
+	msg_warn("%s: socket: %m", myname);
+	return (-1);
+    }
+#ifdef HAS_IPV6
+#if defined(IPV6_V6ONLY) && !defined(BROKEN_AI_PASSIVE_NULL_HOST)
+    if (sa->sa_family == AF_INET6
+	&& setsockopt(sock, IPPROTO_IPV6, IPV6_V6ONLY,
+		      (void *) &on, sizeof(on)) < 0)
+	msg_warn("%s: setsockopt(IPV6_V6ONLY): %m", myname);
+#endif
+#endif
+    if (setsockopt(sock, SOL_SOCKET, SO_REUSEADDR,
+		   (void *) &on, sizeof(on)) < 0)
+	msg_warn("%s: setsockopt(SO_REUSEADDR): %m", myname);
+#if defined(SO_REUSEPORT_LB)
+    if (setsockopt(sock, SOL_SOCKET, SO_REUSEPORT_LB,
+		   (void *) &on, sizeof(on)) < 0)
+	msg_warn("%s: setsockopt(SO_REUSEPORT_LB): %m", myname);
+#elif defined(SO_REUSEPORT)
+    if (setsockopt(sock, SOL_SOCKET, SO_REUSEPORT,
+		   (void *) &on, sizeof(on)) < 0)
+	msg_warn("%s: setsockopt(SO_REUSEPORT): %m", myname);
+#endif
+    if (bind(sock, sa, sa_len) < 0
+	|| listen(sock, serv->max_proc > var_proc_limit ?
+		  serv->max_proc : var_proc_limit) < 0) {
+	msg_warn("%s: bind/listen: %m", myname);
+	(void) close(sock);
+	return (-1);
+    }
+    non_blocking(sock, NON_BLOCKING);
+    return (sock);
+}
+
 /* master_listen_cleanup - disable connection requests */
 
 void    master_listen_cleanup(MASTER_SERV *serv)
@@ -184,3 +251,235 @@ void    master_listen_cleanup(MASTER_SERV *serv)
 	serv->listen_fd[n] = -1;
     }
 }
+
+#ifdef TEST
+
+ /*
+  * Proof-of-concept test and benchmark. Start a number of server processes
+  * that accept connections on a shared listener, optionally with a private
+  * SO_REUSEPORT listener per process, then make connections from a number
+  * of client processes, and report the results. Each server sends one byte
+  * and closes the connection, so that TIME_WAIT state ends up on the server
+  * side and does not exhaust the client's ephemeral ports.
+  */
+#include <sys/wait.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <events.h>
+#include <connect.h>
+#include <msg_vstream.h>
+#include <vstream.h>
+
+static int accept_count;
+static int report_fd;
+
+/* bench_term - report accept count and terminate */
+
+static void bench_term(int unused_sig)
+{
+    (void) write(report_fd, (void *) &accept_count, sizeof(accept_count));
+    _exit(0);
+}
+
+/* bench_accept - accept and serve one connection */
+
+static void bench_accept(int unused_event, void *context)
+{
+    int     listen_fd = CAST_ANY_PTR_TO_INT(context);
+    int     fd;
+
+    if ((fd = inet_accept(listen_fd)) < 0)
+	return;					/* another process won */
+    accept_count++;
+    (void) write(fd, "x", 1);
+    (void) close(fd);
+}
+
+/* bench_server - server process */
+
+static NORETURN bench_server(MASTER_SERV *serv, int listen_fd, int ready_fd)
+{
+    int     private_fd;
+
+    signal(SIGTERM, bench_term);
+    event_enable_read(listen_fd, bench_accept, CAST_INT_TO_VOID_PTR(listen_fd));
+    if (serv->reuseport) {
+	if ((private_fd = master_listen_reuseport(serv, listen_fd)) < 0)
+	    msg_fatal("cannot create private listener");
+	event_enable_read(private_fd, bench_accept,
+			  CAST_INT_TO_VOID_PTR(private_fd));
+    }
+    (void) write(ready_fd, "", 1);
+    (void) close(ready_fd);
+    for (;;)
+	event_loop(-1);
+}
+
+/* bench_client - client process */
+
+static NORETURN bench_client(const char *addr, int count)
+{
+    char    ch;
+    int     fd;
+
+    while (count-- > 0) {
+	if ((fd = inet_connect(addr, BLOCKING, 10)) < 0)
+	    msg_fatal("connect %s: %m", addr);
+	if (read(fd, &ch, 1) != 1)
+	    msg_fatal("read %s: %m", addr);
+	(void) close(fd);
+    }
+    _exit(0);
+}
+
+/* usage - explain */
+
+static NORETURN usage(const char *myname)
+{
+    msg_fatal("usage: %s [-c clients] [-n connections] [-p servers] [-r] [-t]",
+	      myname);
+}
+
+int     main(int argc, char **argv)
+{
+    MASTER_SERV serv;
+    MAI_HOSTADDR_STR hostaddr;
+    MAI_SERVPORT_STR portnum;
+    struct sockaddr_storage ss;
+    SOCKADDR_SIZE ss_len = sizeof(ss);
+    struct timeval start;
+    struct timeval stop;
+    double  elapsed;
+    int     clients = 4;
+    int     connections = 1000;
+    int     servers = 4;
+    int     timing = 0;
+    int     listen_fd;
+    int     ready_pipe[2];
+    int     report_pipe[2];
+    pid_t  *server_pids;
+    char   *addr;
+    char    ch;
+    int     count;
+    int     total = 0;
+    int     min_count = -1;
+    int     max_count = 0;
+    int     n;
+
+    msg_vstream_init(argv[0], VSTREAM_ERR);
+    memset((void *) &serv, 0, sizeof(serv));
+    serv.max_proc = 100;
+    var_proc_limit = 100;
+    while ((n = GETOPT(argc, argv, "c:n:p:rt")) > 0) {
+	switch (n) {
+	case 'c':
+	    if ((clients = atoi(optarg)) <= 0)
+		usage(argv[0]);
+	    break;
+	case 'n':
+	    if ((connections = atoi(optarg)) <= 0)
+		usage(argv[0]);
+	    break;
+	case 'p':
+	    if ((servers = atoi(optarg)) <= 0)
+		usage(argv[0]);
+	    break;
+	case 'r':
+	    serv.reuseport = 1;
+	    break;
+	case 't':
+	    timing = 1;
+	    break;
+	default:
+	    usage(argv[0]);
+	}
+    }
+
+    /*
+     * Shared listener on a kernel-assigned loopback port.
+     */
+    listen_fd = inet_listen("127.0.0.1:0", 1024, NON_BLOCKING);
+    if (getsockname(listen_fd, (struct sockaddr *) &ss, &ss_len) < 0)
+	msg_fatal("getsockname: %m");
+    SOCKADDR_TO_HOSTADDR((struct sockaddr *) &ss, ss_len,
+			 &hostaddr, &portnum, 0);
+    addr = concatenate(hostaddr.buf, ":", portnum.buf, (char *) 0);
+
+    /*
+     * Start the servers, and wait until all listeners exist.
+     */
+    if (pipe(ready_pipe) < 0 || pipe(report_pipe) < 0)
+	msg_fatal("pipe: %m");
+    server_pids = (pid_t *) mymalloc(servers * sizeof(*server_pids));
+    for (n = 0; n < servers; n++) {
+	switch (server_pids[n] = fork()) {
+	case -1:
+	    msg_fatal("fork: %m");
+	case 0:
+	    (void) close(ready_pipe[0]);
+	    (void) close(report_pipe[0]);
+	    report_fd = report_pipe[1];
+	    bench_server(&serv, listen_fd, ready_pipe[1]);
+	}
+    }
+    (void) close(ready_pipe[1]);
+    (void) close(report_pipe[1]);
+    for (n = 0; n < servers; n++)
+	if (read(ready_pipe[0], &ch, 1) != 1)
+	    msg_fatal("server startup failed");
+
+    /*
+     * Run the clients.
+     */
+    GETTIMEOFDAY(&start);
+    for (n = 0; n < clients; n++) {
+	switch (fork()) {
+	case -1:
+	    msg_fatal("fork: %m");
+	case 0:
+	    bench_client(addr, connections / clients
+			 + (n < connections % clients));
+	}
+    }
+    for (n = 0; n < clients; n++) {
+	if (wait((WAIT_STATUS_T *) 0) < 0)
+	    msg_fatal("wait: %m");
+    }
+    GETTIMEOFDAY(&stop);
+
+    /*
+     * Collect the server statistics.
+     */
+    for (n = 0; n < servers; n++)
+	(void) kill(server_pids[n], SIGTERM);
+    for (n = 0; n < servers; n++) {
+	if (read(report_pipe[0], (void *) &count, sizeof(count))
+	    != sizeof(count))
+	    msg_fatal("server report failed");
+	total += count;
+	if (min_count < 0 || count < min_count)
+	    min_count = count;
+	if (count > max_count)
+	    max_count = count;
+    }
+    while (wait((WAIT_STATUS_T *) 0) > 0)
+	 /* void */ ;
+    vstream_printf("%s listeners, %d servers, %d clients: "
+		   "%d connections accepted\n",
+		   serv.reuseport ? "reuseport" : "shared",
+		   servers, clients, total);
+    if (timing) {
+	elapsed = stop.tv_sec - start.tv_sec
+	    + (stop.tv_usec - start.tv_usec) / 1000000.0;
+	vstream_printf("%.3f seconds, %.0f connections/s, "
+		       "per-server min %d max %d\n", elapsed,
+		       total / elapsed, min_count, max_count);
+    }
+    vstream_fflush(VSTREAM_OUT);
+    myfree(addr);
+    myfree((void *) server_pids);
+    exit(total == connections ? 0 : 1);
+}
+
+#endif
@@ -6,8 +6,9 @@
 /* SYNOPSIS
 /*	#include "master.h"
 /*
-/*	void	master_spawn(serv)
+/*	void	master_spawn(serv, how)
 /*	MASTER_SERV *serv;
+/*	int	how;
 /*
 /*	void	master_reap_child()
 /*
@@ -22,7 +23,16 @@
 /*	master_spawn() spawns off a child process for the specified service,
 /*	making the child process available for servicing connection requests.
 /*	It is an error to call this function then the specified service is
-/*	throttled.
+/*	throttled. Specify MASTER_SPAWN_DEMAND when all processes are
+/*	busy and a client is waiting, or MASTER_SPAWN_PREFORK when the
+/*	process replenishes the service's idle pool. For an on-demand
+/*	spawn, the time of birth is remembered so that master_avail(3)
+/*	can report the delay until the process accepts its first
+/*	connection.
+/*
+/*	When the service is configured with SO_REUSEPORT listeners,
+/*	each child process also receives its own listener sockets,
+/*	after the shared ones.
 /*
 /*	master_reap_child() cleans up all dead child processes.  One typically
 /*	runs this function at a convenient moment after receiving a SIGCHLD
@@ -54,6 +64,7 @@
 
 #include <sys_defs.h>
 #include <sys/wait.h>
+#include <sys/time.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <syslog.h>			/* closelog() */
@@ -136,12 +147,15 @@ static void master_throttle(MASTER_SERV *serv)
 
 /* master_spawn - spawn off new child process if we can */
 
-void    master_spawn(MASTER_SERV *serv)
+void    master_spawn(MASTER_SERV *serv, int how)
 {
     const char *myname = "master_spawn";
     MASTER_PROC *proc;
     MASTER_PID pid;
     int     n;
+    int     fd;
+    int     target;
+    struct timeval tv;
     static unsigned master_generation = 0;
     static VSTRING *env_gen = 0;
 
@@ -156,7 +170,8 @@ void    master_spawn(MASTER_SERV *serv)
      */
     if (!MASTER_LIMIT_OK(serv->max_proc, serv->total_proc))
 	msg_panic("%s: at process limit %d", myname, serv->total_proc);
-    if (serv->avail_proc > 0)
+    if (serv->avail_proc > 0 && (how == MASTER_SPAWN_DEMAND
+				 || serv->avail_proc >= serv->idle_target))
 	msg_panic("%s: processes available: %d", myname, serv->avail_proc);
     if (serv->flags & MASTER_FLAG_THROTTLE)
 	msg_panic("%s: throttled service: %s", myname, serv->path);
@@ -222,6 +237,27 @@ void    master_spawn(MASTER_SERV *serv)
 			  myname, serv->listen_fd[n]);
 	    (void) close(serv->listen_fd[n]);
 	}
+
+	/*
+	 * With SO_REUSEPORT listeners, give the child its own listener for
+	 * each shared one, so that the kernel can hand new connections to
+	 * this process without waking up all other processes. If that
+	 * fails, pass the shared listener twice; the child won't notice.
+	 */
+	if (serv->reuseport) {
+	    for (n = 0; n < serv->listen_fd_count; n++) {
+		target = MASTER_LISTEN_FD + serv->listen_fd_count + n;
+		if ((fd = master_listen_reuseport(serv,
+						  MASTER_LISTEN_FD + n)) < 0)
+		    fd = MASTER_LISTEN_FD + n;
+		if (fd != target) {
+		    if (DUP2(fd, target) < 0)
+			msg_fatal("%s: dup2 listen_fd %d: %m", myname, fd);
+		    if (fd != MASTER_LISTEN_FD + n)
+			(void) close(fd);
+		}
+	    }
+	}
 	vstring_sprintf(env_gen, "%s=%o", MASTER_GEN_NAME, master_generation);
 	if (putenv(vstring_str(env_gen)) < 0)
 	    msg_fatal("%s: putenv: %m", myname);
@@ -247,6 +283,12 @@ void    master_spawn(MASTER_SERV *serv)
 	proc->gen = master_generation;
 	proc->use_count = 0;
 	proc->avail = 0;
+	if (how == MASTER_SPAWN_DEMAND) {
+	    GETTIMEOFDAY(&tv);
+	    proc->start_time = tv.tv_sec + tv.tv_usec / 1000000.0;
+	} else {
+	    proc->start_time = 0;
+	}
 	binhash_enter(master_child_table, (void *) &pid,
 		      sizeof(pid), (void *) proc);
 	serv->total_proc++;
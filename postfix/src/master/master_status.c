@@ -136,6 +136,8 @@ static void master_status_event(int event, void *context)
 	master_avail_more(serv, proc);
 	break;
     case MASTER_STAT_TAKEN:
+	if (proc->start_time != 0)
+	    master_avail_latency(serv, proc);
 	master_avail_less(serv, proc);
 	break;
     default:
@@ -53,6 +53,8 @@
   */
 int     var_throttle_time;
 char   *var_master_disable;
+int     var_service_min_idle;
+bool    var_service_reuseport;
 
 /* master_vars_init - initialize from global Postfix configuration file */
 
@@ -63,6 +65,14 @@ void    master_vars_init(void)
 	VAR_MASTER_DISABLE, DEF_MASTER_DISABLE, &var_master_disable, 0, 0,
 	0,
     };
+    static const CONFIG_INT_TABLE int_table[] = {
+	VAR_SERVICE_MIN_IDLE, DEF_SERVICE_MIN_IDLE, &var_service_min_idle, 0, 0,
+	0,
+    };
+    static const CONFIG_BOOL_TABLE bool_table[] = {
+	VAR_SERVICE_REUSEPORT, DEF_SERVICE_REUSEPORT, &var_service_reuseport,
+	0,
+    };
     static const CONFIG_TIME_TABLE time_table[] = {
 	VAR_THROTTLE_TIME, DEF_THROTTLE_TIME, &var_throttle_time, 1, 0,
 	0,
@@ -86,6 +96,8 @@ void    master_vars_init(void)
     set_mail_conf_str(VAR_PROCNAME, var_procname);
     mail_conf_read();
     get_mail_conf_str_table(str_table);
+    get_mail_conf_int_table(int_table);
+    get_mail_conf_bool_table(bool_table);
     get_mail_conf_time_table(time_table);
     path = concatenate(var_config_dir, "/", MASTER_CONF_FILE, (void *) 0);
     fset_master_ent(path);
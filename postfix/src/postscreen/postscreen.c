@@ -41,6 +41,14 @@
 /*	more tests. \fBpostscreen\fR(8) logs rejected mail with the
 /*	client address, helo, sender and recipient information.
 /*
+/*	With a master.cf process limit greater than 1, multiple
+/*	\fBpostscreen\fR(8) processes share the load. They share the
+/*	temporary allowlist, including the DNS reputation verdicts,
+/*	through an lmdb:, memcache: or proxy: table; other table types
+/*	are a fatal error. Only one process at a time performs cache
+/*	cleanup.
+/*	Connection and queue limits apply per process.
+/*
 /*	\fBpostscreen\fR(8) is not an SMTP proxy; this is intentional.
 /*	The purpose is to keep spambots away from Postfix SMTP
 /*	server processes, while minimizing overhead for legitimate
@@ -314,6 +322,14 @@
 /*	The amount of time that \fBpostscreen\fR(8) remembers that a client
 /*	IP address passed a "pipelining" SMTP protocol test, before it is
 /*	required to pass that test again.
+/* .PP
+/*	Available in Postfix 3.11 and later:
+/* .IP "\fBpostscreen_cache_mmap_file (empty)\fR"
+/*	Optional memory-mapped file for \fBpostscreen\fR(8) server
+/*	decisions, used instead of $postscreen_cache_map.
+/* .IP "\fBpostscreen_cache_mmap_slots (100000)\fR"
+/*	The number of client IP addresses that fit in the
+/*	$postscreen_cache_mmap_file cache.
 /* RESOURCE CONTROLS
 /* .ad
 /* .fi
@@ -440,6 +456,9 @@
 #include <sys_defs.h>
 #include <sys/stat.h>
 #include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 /* Utility library. */
 
@@ -452,6 +471,9 @@
 #include <vstream.h>
 #include <name_code.h>
 #include <inet_proto.h>
+#include <myflock.h>
+#include <iostuff.h>
+#include <stringops.h>
 
 /* Global library. */
 
@@ -461,6 +483,9 @@
 #include <mail_proto.h>
 #include <data_redirect.h>
 #include <string_list.h>
+#include <dict_proxy.h>
+#include <dict_memcache.h>
+#include <dict_lmdb.h>
 
 /* Master server protocols. */
 
@@ -500,6 +525,8 @@ bool    var_psc_disable_vrfy;
 bool    var_psc_helo_required;
 
 char   *var_psc_cache_map;
+char   *var_psc_mmap_file;
+int     var_psc_mmap_slots;
 int     var_psc_cache_scan;
 int     var_psc_cache_ret;
 int     var_psc_post_queue_limit;
@@ -563,6 +590,7 @@ int     var_psc_uproxy_tmout;
 int     psc_check_queue_length;		/* connections being checked */
 int     psc_post_queue_length;		/* being sent to real SMTPD */
 DICT_CACHE *psc_cache_map;		/* cache table handle */
+PSC_MMAP *psc_mmap_cache;		/* memory-mapped cache */
 VSTRING *psc_temp;			/* scratchpad */
 char   *psc_smtpd_service_name;		/* path to real SMTPD */
 int     psc_pregr_action;		/* PSC_ACT_DROP/ENFORCE/etc */
@@ -588,10 +616,15 @@ HTABLE *psc_client_concurrency;		/* per-client concurrency */
 static ARGV *psc_acl;			/* permanent allow/denylist */
 static int psc_dnlist_action;		/* PSC_ACT_DROP/ENFORCE/etc */
 static ADDR_MATCH_LIST *psc_allist_if;	/* allowlist interfaces */
+static int psc_solitary;		/* process limit is 1 */
+static int psc_cache_lock_fd = -1;	/* cache cleanup lock */
+static int psc_cache_flags;		/* cache cleanup logging */
 
 static void psc_endpt_lookup_done(int, VSTREAM *,
 			             MAI_HOSTADDR_STR *, MAI_SERVPORT_STR *,
 			            MAI_HOSTADDR_STR *, MAI_SERVPORT_STR *);
+static void psc_mmap_clean_event(int, void *);
+static void psc_cache_clean_start(int, void *);
 
 /* psc_dump - dump some statistics before exit */
 
@@ -608,6 +641,10 @@ static void psc_dump(char *unused_service, char **unused_argv)
 	dict_cache_close(psc_cache_map);
 	psc_cache_map = 0;
     }
+    if (psc_mmap_cache) {
+	psc_mmap_close(psc_mmap_cache);
+	psc_mmap_cache = 0;
+    }
 }
 
 /* psc_drain - delayed exit after "postfix reload" */
@@ -635,12 +672,32 @@ static void psc_drain(char *unused_service, char **unused_argv)
      * 
      * XXX Don't assume that it is OK to share the same LMDB lockfile descriptor
      * between different processes.
+     * 
+     * The memory-mapped cache stays open: it serializes updates with a file
+     * lock, and a new postscreen process that changes the cache size
+     * replaces the file instead of resizing it. Its incremental cleanup
+     * stops below, together with the cleanup lock.
      */
     if (psc_cache_map != 0			/* XXX && psc_cache_map
 	    requires locking */ ) {
 	dict_cache_close(psc_cache_map);
 	psc_cache_map = 0;
     }
+
+    /*
+     * Release the cache cleanup lock before fork(), so that the draining
+     * process does not hold it while it no longer cleans the cache. The
+     * lock belongs to the open file, not to the process. Without the lock,
+     * the draining process must not clean the memory-mapped cache, nor try
+     * to acquire the lock again.
+     */
+    if (psc_cache_lock_fd >= 0) {
+	(void) close(psc_cache_lock_fd);
+	psc_cache_lock_fd = -1;
+    }
+    event_cancel_timer(psc_cache_clean_start, (void *) 0);
+    if (psc_mmap_cache != 0)
+	event_cancel_timer(psc_mmap_clean_event, (void *) 0);
     for (count = 0; /* see below */ ; count++) {
 	if (count >= 5) {
 	    msg_fatal("fork: %m");
@@ -706,7 +763,7 @@ static void psc_endpt_lookup_done(int endpt_status,
 {
     const char *myname = "psc_endpt_lookup_done";
     PSC_STATE *state;
-    const char *stamp_str;
+    const char *stamp_str = 0;
     int     saved_flags;
 
     /*
@@ -828,10 +885,17 @@ static void psc_endpt_lookup_done(int endpt_status,
      */
     if ((state->flags & PSC_STATE_MASK_ANY_FAIL) == 0
 	&& state->client_info->concurrency == 1
-	&& psc_cache_map != 0
-	&& (stamp_str = psc_cache_lookup(psc_cache_map, state->smtp_client_addr)) != 0) {
+	&& ((psc_mmap_cache != 0
+	     && psc_mmap_lookup(psc_mmap_cache, state->smtp_client_addr,
+				state->client_info->expire_time) != 0)
+	    || (psc_cache_map != 0
+		&& (stamp_str = psc_cache_lookup(psc_cache_map,
+					  state->smtp_client_addr)) != 0))) {
 	saved_flags = state->flags;
-	psc_parse_tests(state, stamp_str, event_time());
+	if (stamp_str != 0)
+	    psc_parse_tests(state, stamp_str, event_time());
+	else
+	    psc_todo_tests(state, event_time());
 	state->flags |= saved_flags;
 	if (msg_verbose)
 	    msg_info("%s: cached + recent flags: %s",
@@ -895,6 +959,44 @@ static void psc_endpt_lookup_done(int endpt_status,
 	psc_conclude(state);
 }
 
+/* psc_mmap_validator - validate one memory-mapped cache entry */
+
+static int psc_mmap_validator(const time_t *expire_time,
+			              void *unused_context)
+{
+    PSC_STATE dummy_state;
+    PSC_CLIENT_INFO dummy_client_info;
+
+    /*
+     * Same retention policy as with psc_cache_validator(), below.
+     */
+    dummy_state.client_info = &dummy_client_info;
+    memcpy((void *) dummy_client_info.expire_time, (void *) expire_time,
+	   sizeof(dummy_client_info.expire_time));
+    psc_todo_tests(&dummy_state, event_time() - var_psc_cache_ret);
+    return ((dummy_state.flags & PSC_STATE_MASK_ANY_TODO) == 0);
+}
+
+/* psc_mmap_clean_event - clean up a few memory-mapped cache entries */
+
+static void psc_mmap_clean_event(int unused_event, void *unused_context)
+{
+    int     count;
+
+    /*
+     * Spread each cleanup pass over $postscreen_cache_cleanup_interval in
+     * small steps, so that cleanup never stalls the event loop.
+     */
+#define PSC_MMAP_CLEAN_STEP	10		/* seconds */
+
+    count = (double) var_psc_mmap_slots * PSC_MMAP_CLEAN_STEP
+	/ var_psc_cache_scan + 1;
+    (void) psc_mmap_clean(psc_mmap_cache, count, psc_mmap_validator,
+			  (void *) 0);
+    event_request_timer(psc_mmap_clean_event, (void *) 0,
+			PSC_MMAP_CLEAN_STEP);
+}
+
 /* psc_cache_validator - validate one cache entry */
 
 static int psc_cache_validator(const char *client_addr,
@@ -917,11 +1019,76 @@ static int psc_cache_validator(const char *client_addr,
     return ((dummy_state.flags & PSC_STATE_MASK_ANY_TODO) == 0);
 }
 
+/* psc_cache_clean_start - start cache cleanup, or retry later */
+
+#define PSC_CACHE_LOCK_RETRY	60		/* seconds */
+
+static void psc_cache_clean_start(int unused_event, void *unused_context)
+{
+
+    /*
+     * With multiple postscreen(8) processes, only the process that holds
+     * the cleanup lock scans the shared cache. The others try again soon,
+     * because that process may terminate after max_idle or "postfix
+     * reload", long before the next cleanup interval.
+     */
+    if (psc_cache_map == 0 && psc_mmap_cache == 0)
+	return;
+    if (psc_cache_lock_fd >= 0
+	&& myflock(psc_cache_lock_fd, INTERNAL_LOCK,
+		   MYFLOCK_OP_EXCLUSIVE | MYFLOCK_OP_NOWAIT) < 0) {
+	if (msg_verbose)
+	    msg_info("%s cache cleanup is done by another process",
+		     psc_mmap_cache ? psc_mmap_name(psc_mmap_cache) :
+		     dict_cache_name(psc_cache_map));
+	event_request_timer(psc_cache_clean_start, (void *) 0,
+			    PSC_CACHE_LOCK_RETRY);
+	return;
+    }
+    if (psc_mmap_cache != 0) {
+	psc_mmap_clean_event(0, (void *) 0);
+	return;
+    }
+    dict_cache_control(psc_cache_map,
+		       CA_DICT_CACHE_CTL_FLAGS(psc_cache_flags),
+		       CA_DICT_CACHE_CTL_INTERVAL(var_psc_cache_scan),
+		       CA_DICT_CACHE_CTL_VALIDATOR(psc_cache_validator),
+		       CA_DICT_CACHE_CTL_CONTEXT((void *) 0),
+		       CA_DICT_CACHE_CTL_END);
+}
+
+/* psc_cache_check_shared - require a cache that multiple processes can share */
+
+static void psc_cache_check_shared(const char *map)
+{
+
+    /*
+     * lmdb: supports multiple writers, and memcache: and proxy: tables are
+     * accessed through a server. Other tables would be corrupted by
+     * concurrent writers. We can't wrap them in proxy: here, because the
+     * proxywrite service allows only tables that are listed with proxy: in
+     * proxy_write_maps.
+     */
+#define STREQ_TYPE(map, type) \
+	(strncmp((map), type ":", sizeof(type)) == 0)
+
+    if (STREQ_TYPE(map, DICT_TYPE_LMDB) || STREQ_TYPE(map, DICT_TYPE_MEMCACHE)
+	|| STREQ_TYPE(map, DICT_TYPE_PROXY))
+	return;
+    msg_fatal("with a process limit greater than 1, %s must be an %s:, %s:"
+	      " or %s: table; for example, specify \"%s = %s:%s\"",
+	      VAR_PSC_CACHE_MAP, DICT_TYPE_LMDB, DICT_TYPE_MEMCACHE,
+	      DICT_TYPE_PROXY, VAR_PSC_CACHE_MAP, DICT_TYPE_PROXY,
+	      var_psc_cache_map);
+}
+
 /* pre_jail_init - pre-jail initialization */
 
-static void pre_jail_init(char *unused_name, char **unused_argv)
+static void pre_jail_init(char *service_name, char **unused_argv)
 {
     VSTRING *redirect;
+    const char *cache_name;
+    char   *lock_path;
 
     /*
      * Open read-only maps before dropping privilege, for consistency with
@@ -966,10 +1133,31 @@ static void pre_jail_init(char *unused_name, char **unused_argv)
 #define PSC_DICT_OPEN_FLAGS (DICT_FLAG_DUP_REPLACE | DICT_FLAG_SYNC_UPDATE | \
 	    DICT_FLAG_OPEN_LOCK)
 
-    if (*var_psc_cache_map)
-	psc_cache_map =
-	    dict_cache_open(data_redirect_map(redirect, var_psc_cache_map),
-			    O_CREAT | O_RDWR, PSC_DICT_OPEN_FLAGS);
+    if (*var_psc_mmap_file) {
+	psc_mmap_cache =
+	    psc_mmap_open(data_redirect_file(redirect, var_psc_mmap_file),
+			  var_psc_mmap_slots);
+    } else if (*var_psc_cache_map) {
+	cache_name = data_redirect_map(redirect, var_psc_cache_map);
+	if (!psc_solitary)
+	    psc_cache_check_shared(cache_name);
+	psc_cache_map = dict_cache_open(cache_name, O_CREAT | O_RDWR,
+					PSC_DICT_OPEN_FLAGS);
+    }
+
+    /*
+     * With multiple postscreen(8) processes, a lock decides which process
+     * performs cache cleanup.
+     */
+    if ((psc_cache_map != 0 || psc_mmap_cache != 0)
+	&& !psc_solitary && var_psc_cache_scan > 0) {
+	lock_path = concatenate(var_data_dir, "/", var_procname, ".",
+				service_name, ".lock", (char *) 0);
+	if ((psc_cache_lock_fd = open(lock_path, O_RDWR | O_CREAT, 0600)) < 0)
+	    msg_fatal("open lock file %s: %m", lock_path);
+	close_on_exec(psc_cache_lock_fd, CLOSE_ON_EXEC);
+	myfree(lock_path);
+    }
 
     /*
      * Clean up and restore privilege.
@@ -1016,7 +1204,6 @@ static void post_jail_init(char *unused_name, char **unused_argv)
 	PSC_NAME_ACT_CONT, PSC_ACT_IGNORE,	/* compatibility */
 	0, -1,
     };
-    int     cache_flags;
     const char *tmp;
 
     /*
@@ -1087,16 +1274,11 @@ static void post_jail_init(char *unused_name, char **unused_argv)
      * verbose logging more informative (we get positive confirmation that
      * the cleanup thread runs).
      */
-    cache_flags = DICT_CACHE_FLAG_STATISTICS;
+    psc_cache_flags = DICT_CACHE_FLAG_STATISTICS;
     if (msg_verbose > 1)
-	cache_flags |= DICT_CACHE_FLAG_VERBOSE;
-    if (psc_cache_map != 0 && var_psc_cache_scan > 0)
-	dict_cache_control(psc_cache_map,
-			   CA_DICT_CACHE_CTL_FLAGS(cache_flags),
-			   CA_DICT_CACHE_CTL_INTERVAL(var_psc_cache_scan),
-			   CA_DICT_CACHE_CTL_VALIDATOR(psc_cache_validator),
-			   CA_DICT_CACHE_CTL_CONTEXT((void *) 0),
-			   CA_DICT_CACHE_CTL_END);
+	psc_cache_flags |= DICT_CACHE_FLAG_VERBOSE;
+    if ((psc_cache_map != 0 || psc_mmap_cache != 0) && var_psc_cache_scan > 0)
+	psc_cache_clean_start(0, (void *) 0);
 
     /*
      * Pre-compute the minimal and maximal TTL.
@@ -1161,6 +1343,7 @@ int     main(int argc, char **argv)
 	VAR_SMTPD_TLS_LEVEL, DEF_SMTPD_TLS_LEVEL, &var_smtpd_tls_level, 0, 0,
 	VAR_SMTPD_CMD_FILTER, DEF_SMTPD_CMD_FILTER, &var_smtpd_cmd_filter, 0, 0,
 	VAR_PSC_CACHE_MAP, DEF_PSC_CACHE_MAP, &var_psc_cache_map, 0, 0,
+	VAR_PSC_MMAP_FILE, DEF_PSC_MMAP_FILE, &var_psc_mmap_file, 0, 0,
 	VAR_PSC_PREGR_BANNER, DEF_PSC_PREGR_BANNER, &var_psc_pregr_banner, 0, 0,
 	VAR_PSC_PREGR_ACTION, DEF_PSC_PREGR_ACTION, &var_psc_pregr_action, 1, 0,
 	VAR_PSC_DNSBL_SITES, DEF_PSC_DNSBL_SITES, &var_psc_dnsbl_sites, 0, 0,
@@ -1187,6 +1370,7 @@ int     main(int argc, char **argv)
 	VAR_PSC_DNSBL_THRESH, DEF_PSC_DNSBL_THRESH, &var_psc_dnsbl_thresh, 1, 0,
 	VAR_PSC_CMD_COUNT, DEF_PSC_CMD_COUNT, &var_psc_cmd_count, 1, 0,
 	VAR_SMTPD_CCONN_LIMIT, DEF_SMTPD_CCONN_LIMIT, &var_smtpd_cconn_limit, 0, 0,
+	VAR_PSC_MMAP_SLOTS, DEF_PSC_MMAP_SLOTS, &var_psc_mmap_slots, 1000, 0,
 	0,
     };
     static const CONFIG_NINT_TABLE nint_table[] = {
@@ -1254,7 +1438,7 @@ int     main(int argc, char **argv)
 		      CA_MAIL_SERVER_PRE_INIT(pre_jail_init),
 		      CA_MAIL_SERVER_POST_INIT(post_jail_init),
 		      CA_MAIL_SERVER_PRE_ACCEPT(pre_accept),
-		      CA_MAIL_SERVER_SOLITARY,
+		      CA_MAIL_SERVER_SOLITARY_FLAG(&psc_solitary),
 		      CA_MAIL_SERVER_SLOW_EXIT(psc_drain),
 		      CA_MAIL_SERVER_EXIT(psc_dump),
 		      CA_MAIL_SERVER_WATCHDOG(&var_psc_watchdog),
@@ -357,12 +357,18 @@ typedef struct {
 #define PSC_ACT_ENFORCE		2
 #define PSC_ACT_IGNORE		3
 
+ /*
+  * Memory-mapped cache, see postscreen_mmap.c.
+  */
+typedef struct PSC_MMAP PSC_MMAP;
+
  /*
   * Global variables.
   */
 extern int psc_check_queue_length;	/* connections being checked */
 extern int psc_post_queue_length;	/* being sent to real SMTPD */
 extern DICT_CACHE *psc_cache_map;	/* cache table handle */
+extern PSC_MMAP *psc_mmap_cache;	/* memory-mapped cache */
 extern VSTRING *psc_temp;		/* scratchpad */
 extern char *psc_smtpd_service_name;	/* path to real SMTPD */
 extern int psc_pregr_action;		/* PSC_ACT_DROP etc. */
@@ -479,6 +485,17 @@ extern void psc_cache_update(DICT_CACHE *, const char *, const char *);
 const char *psc_dict_get(DICT *, const char *);
 const char *psc_maps_find(MAPS *, const char *, int);
 
+ /*
+  * postscreen_mmap.c
+  */
+extern PSC_MMAP *psc_mmap_open(const char *, int);
+extern int psc_mmap_lookup(PSC_MMAP *, const char *, time_t *);
+extern void psc_mmap_update(PSC_MMAP *, const char *, const time_t *);
+extern int psc_mmap_clean(PSC_MMAP *, int, int (*) (const time_t *, void *),
+			          void *);
+extern const char *psc_mmap_name(PSC_MMAP *);
+extern void psc_mmap_close(PSC_MMAP *);
+
  /*
   * postscreen_dnsbl.c
   */
@@ -507,6 +524,7 @@ extern int psc_dnsbl_request(const char *, void (*) (int, void *), void *);
 extern void psc_new_tests(PSC_STATE *);
 extern void psc_parse_tests(PSC_STATE *, const char *, time_t);
 extern void psc_todo_tests(PSC_STATE *, time_t);
+extern time_t *psc_save_tests(PSC_STATE *);
 extern char *psc_print_tests(VSTRING *, PSC_STATE *);
 extern char *psc_print_grey_key(VSTRING *, const char *, const char *,
 				        const char *, const char *);
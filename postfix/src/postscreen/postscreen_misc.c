@@ -122,10 +122,15 @@ void    psc_conclude(PSC_STATE *state)
      * result is renewed during overlapping SMTP sessions, and even if
      * 'postfix reload' happens in the middle of that.
      */
-    if ((state->flags & PSC_STATE_MASK_ANY_UPDATE) != 0
-	&& psc_cache_map != 0) {
-	psc_print_tests(psc_temp, state);
-	psc_cache_update(psc_cache_map, state->smtp_client_addr, STR(psc_temp));
+    if ((state->flags & PSC_STATE_MASK_ANY_UPDATE) != 0) {
+	if (psc_mmap_cache != 0) {
+	    psc_mmap_update(psc_mmap_cache, state->smtp_client_addr,
+			    psc_save_tests(state));
+	} else if (psc_cache_map != 0) {
+	    psc_print_tests(psc_temp, state);
+	    psc_cache_update(psc_cache_map, state->smtp_client_addr,
+			     STR(psc_temp));
+	}
     }
 
     /*
@@ -0,0 +1,694 @@
+/*++
+/* NAME
+/*	postscreen_mmap 3
+/* SUMMARY
+/*	postscreen memory-mapped cache
+/* SYNOPSIS
+/*	#include <postscreen.h>
+/*
+/*	PSC_MMAP *psc_mmap_open(path, slots)
+/*	const char *path;
+/*	int	slots;
+/*
+/*	int	psc_mmap_lookup(cache, addr, expire_time)
+/*	PSC_MMAP *cache;
+/*	const char *addr;
+/*	time_t	*expire_time;
+/*
+/*	void	psc_mmap_update(cache, addr, expire_time)
+/*	PSC_MMAP *cache;
+/*	const char *addr;
+/*	const time_t *expire_time;
+/*
+/*	int	psc_mmap_clean(cache, count, validator, context)
+/*	PSC_MMAP *cache;
+/*	int	count;
+/*	int	(*validator)(const time_t *expire_time, void *context);
+/*	void	*context;
+/*
+/*	const char *psc_mmap_name(cache)
+/*	PSC_MMAP *cache;
+/*
+/*	void	psc_mmap_close(cache)
+/*	PSC_MMAP *cache;
+/* DESCRIPTION
+/*	This module maintains the postscreen(8) temporary allowlist
+/*	in a fixed-size file that is mapped into memory, as an
+/*	alternative for a dict_cache(3) table. A cache entry is
+/*	keyed by the binary client IP address, and stores the
+/*	per-test expiration times as binary numbers. Lookups are
+/*	plain memory operations that require no system call, no
+/*	string conversion, and no lock.
+/*
+/*	The cache is an open-addressing hash table. A client address
+/*	hashes to a small window of adjacent slots; the hash is
+/*	seeded with a random value that is stored in the file, so
+/*	that remote clients cannot predict collisions. An update
+/*	replaces a matching entry, or uses a free slot in the
+/*	window, or replaces the entry in the window whose test
+/*	results expire first. The cache therefore never grows, and
+/*	never needs to be rehashed.
+/*
+/*	Each slot has a sequence number that is odd while the slot
+/*	is being updated, and a checksum of its content. A reader
+/*	that finds an odd or changed sequence number, or a bad
+/*	checksum, treats the slot as a cache miss. Updates are
+/*	serialized with an exclusive lock on the file, so that
+/*	multiple postscreen(8) processes can share one cache.
+/*	Because the file is mapped with MAP_SHARED, all updates
+/*	survive a process crash; a slot that was being updated
+/*	when a process died has an odd sequence number, and is
+/*	reclaimed by the next update or cleanup pass.
+/*
+/*	psc_mmap_open() opens or creates the named cache file with
+/*	the specified number of slots. A file with a different
+/*	size or format is replaced with an empty one; the new file
+/*	is created under a temporary name and renamed into place,
+/*	so that processes that still use the old file are not
+/*	affected. The file is opened with the privileges of the
+/*	caller.
+/*
+/*	psc_mmap_lookup() looks up the specified client address,
+/*	and copies PSC_TINDX_COUNT time stamps to the expire_time
+/*	array. The result is non-zero when the address was found;
+/*	otherwise the expire_time array is not modified.
+/*
+/*	psc_mmap_update() saves PSC_TINDX_COUNT time stamps for
+/*	the specified client address.
+/*
+/*	psc_mmap_clean() examines the next \fIcount\fR slots of a
+/*	cleanup pass that wraps around at the end of the cache, and
+/*	removes entries for which the validator returns zero. The
+/*	position of the cleanup pass is stored in the file, so that
+/*	a cleanup pass can be continued by another process. The
+/*	result is non-zero when a cleanup pass was completed; at
+/*	that point the function logs cleanup statistics and schedules
+/*	a write-back of modified pages.
+/*
+/*	psc_mmap_name() returns the cache file name.
+/*
+/*	psc_mmap_close() schedules a write-back of modified pages,
+/*	unmaps the cache file and releases storage.
+/* DIAGNOSTICS
+/*	Fatal errors: out of memory, file system errors.
+/* SEE ALSO
+/*	dict_cache(3) external cache manager
+/* LICENSE
+/* .ad
+/* .fi
+/*	The Secure Mailer license must be distributed with this software.
+/*--*/
+
+/* System library. */
+
+#include <sys_defs.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>			/* rename */
+#include <string.h>
+#include <limits.h>
+#include <stdint.h>
+
+#ifndef MAP_FAILED
+#define MAP_FAILED	((void *) -1)
+#endif
+
+/* Utility library. */
+
+#include <msg.h>
+#include <mymalloc.h>
+#include <myflock.h>
+#include <iostuff.h>
+#include <ldseed.h>
+#include <vstring.h>
+
+/* Application-specific. */
+
+#include <postscreen.h>
+
+ /*
+  * File format. All fields are in host byte order; the file is not meant to
+  * be shared between different machines. Slots are one cache line in size,
+  * and never straddle a page boundary.
+  */
+#define PSC_MMAP_MAGIC		"PSCMMAP"
+#define PSC_MMAP_VERSION	1
+#define PSC_MMAP_STAMPS		8	/* room for future tests */
+#define PSC_MMAP_WINDOW		16	/* slots per lookup */
+
+typedef struct {
+    char    magic[8];			/* PSC_MMAP_MAGIC */
+    uint32_t version;			/* PSC_MMAP_VERSION */
+    uint32_t slot_size;			/* sizeof(PSC_MMAP_SLOT) */
+    uint32_t slots;			/* number of slots */
+    uint32_t stamps;			/* PSC_MMAP_STAMPS */
+    uint64_t seed;			/* hash seed */
+    uint32_t clean_pos;			/* next slot to clean */
+    uint32_t spare[7];
+} PSC_MMAP_HEAD;
+
+typedef struct {
+    volatile uint32_t seq;		/* odd: update in progress */
+    uint32_t check;			/* content checksum */
+    uint32_t family;			/* 0 (free), 4 or 6 */
+    unsigned char addr[16];		/* binary address */
+    uint32_t expire[PSC_MMAP_STAMPS];	/* per-test expiration */
+    uint32_t spare;
+} PSC_MMAP_SLOT;
+
+struct PSC_MMAP {
+    char   *path;			/* cache file name */
+    int     fd;				/* open file, for locking */
+    size_t  size;			/* mapped size */
+    PSC_MMAP_HEAD *head;		/* mapped file header */
+    PSC_MMAP_SLOT *slots;		/* mapped slot array */
+    uint32_t nslots;			/* number of slots */
+    int     retained;			/* entries retained in cleanup */
+    int     dropped;			/* entries dropped in cleanup */
+};
+
+#define PSC_MMAP_FAMILY_FREE	0
+#define PSC_MMAP_FAMILY_INET	4
+#define PSC_MMAP_FAMILY_INET6	6
+
+#define PSC_MMAP_SIZE(n) \
+	(sizeof(PSC_MMAP_HEAD) + (size_t) (n) * sizeof(PSC_MMAP_SLOT))
+
+ /*
+  * Lock-free readers need the writer's stores to become visible in program
+  * order. Without compiler support, a reader may see a torn update; the
+  * checksum still turns that into a cache miss, which is harmless.
+  */
+#if defined(__GNUC__) && ((__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 1))
+#define PSC_MMAP_BARRIER()	__sync_synchronize()
+#else
+#define PSC_MMAP_BARRIER()	((void) 0)
+#endif
+
+#define PSC_MMAP_READ_TRIES	3
+
+ /*
+  * FNV-1a, 64-bit. We can't use hash_fnv(3), because that is seeded per
+  * process, and the slot positions must be the same in all processes.
+  */
+#define PSC_MMAP_FNV_BASIS	0xcbf29ce484222325ULL
+#define PSC_MMAP_FNV_PRIME	0x100000001b3ULL
+
+/* psc_mmap_fnv - hash a byte string */
+
+static uint64_t psc_mmap_fnv(uint64_t hash, const void *data, size_t len)
+{
+    const unsigned char *cp = (const unsigned char *) data;
+
+    while (len-- > 0) {
+	hash ^= *cp++;
+	hash *= PSC_MMAP_FNV_PRIME;
+    }
+    return (hash);
+}
+
+/* psc_mmap_check - compute slot checksum */
+
+static uint32_t psc_mmap_check(const PSC_MMAP_SLOT *slot)
+{
+    uint64_t hash;
+
+    hash = psc_mmap_fnv(PSC_MMAP_FNV_BASIS, &slot->family,
+			sizeof(slot->family));
+    hash = psc_mmap_fnv(hash, slot->addr, sizeof(slot->addr));
+    hash = psc_mmap_fnv(hash, slot->expire, sizeof(slot->expire));
+    return ((uint32_t) (hash ^ (hash >> 32)));
+}
+
+/* psc_mmap_key - convert address string to binary key */
+
+static int psc_mmap_key(const char *addr, uint32_t *family,
+			        unsigned char *bytes)
+{
+    memset(bytes, 0, sizeof(((PSC_MMAP_SLOT *) 0)->addr));
+    if (inet_pton(AF_INET, addr, bytes) == 1) {
+	*family = PSC_MMAP_FAMILY_INET;
+	return (1);
+    }
+#ifdef HAS_IPV6
+    if (inet_pton(AF_INET6, addr, bytes) == 1) {
+	*family = PSC_MMAP_FAMILY_INET6;
+	return (1);
+    }
+#endif
+    msg_warn("ignoring malformed client address: %s", addr);
+    return (0);
+}
+
+/* psc_mmap_slot - map binary key to first slot of lookup window */
+
+static uint32_t psc_mmap_slot(PSC_MMAP *cache, uint32_t family,
+			              const unsigned char *bytes)
+{
+    uint64_t hash;
+
+    hash = psc_mmap_fnv(PSC_MMAP_FNV_BASIS ^ cache->head->seed,
+			&family, sizeof(family));
+    hash = psc_mmap_fnv(hash, bytes, sizeof(((PSC_MMAP_SLOT *) 0)->addr));
+    return ((uint32_t) (hash % cache->nslots));
+}
+
+/* psc_mmap_read - lock-free read of one slot */
+
+static int psc_mmap_read(PSC_MMAP_SLOT *slot, PSC_MMAP_SLOT *copy)
+{
+    uint32_t seq;
+    int     tries;
+
+    for (tries = 0; tries < PSC_MMAP_READ_TRIES; tries++) {
+	if ((seq = slot->seq) & 1)
+	    continue;
+	PSC_MMAP_BARRIER();
+	memcpy((void *) copy, (void *) slot, sizeof(*copy));
+	PSC_MMAP_BARRIER();
+	if (slot->seq == seq && copy->check == psc_mmap_check(copy))
+	    return (copy->family != PSC_MMAP_FAMILY_FREE);
+    }
+    return (0);
+}
+
+/* psc_mmap_write - update one slot, with the file locked */
+
+static void psc_mmap_write(PSC_MMAP_SLOT *slot, uint32_t family,
+			           const unsigned char *bytes,
+			           const time_t *expire_time)
+{
+    uint32_t seq = slot->seq | 1;
+    int     n;
+
+    /*
+     * Keep the sequence number odd while the slot content is inconsistent.
+     * If we die here, the slot stays odd until it is reclaimed.
+     */
+    slot->seq = seq;
+    PSC_MMAP_BARRIER();
+    slot->family = family;
+    memcpy(slot->addr, bytes, sizeof(slot->addr));
+    for (n = 0; n < PSC_MMAP_STAMPS; n++)
+	slot->expire[n] = (expire_time == 0 ? PSC_TIME_STAMP_NEW :
+			   n >= PSC_TINDX_COUNT ? PSC_TIME_STAMP_DISABLED :
+			   expire_time[n] > (time_t) UINT32_MAX ? UINT32_MAX :
+			   (uint32_t) expire_time[n]);
+    slot->check = psc_mmap_check(slot);
+    PSC_MMAP_BARRIER();
+    slot->seq = seq + 1;
+}
+
+/* psc_mmap_free - release one slot, with the file locked */
+
+static void psc_mmap_free(PSC_MMAP_SLOT *slot)
+{
+    static const unsigned char none[sizeof(slot->addr)];
+
+    psc_mmap_write(slot, PSC_MMAP_FAMILY_FREE, none, (time_t *) 0);
+}
+
+/* psc_mmap_latest - latest expiration time in slot */
+
+static uint32_t psc_mmap_latest(PSC_MMAP_SLOT *slot)
+{
+    uint32_t latest = 0;
+    int     n;
+
+    for (n = 0; n < PSC_TINDX_COUNT; n++)
+	if (slot->expire[n] > latest)
+	    latest = slot->expire[n];
+    return (latest);
+}
+
+/* psc_mmap_lock - lock or unlock cache file */
+
+static void psc_mmap_lock(PSC_MMAP *cache, int op)
+{
+    if (myflock(cache->fd, INTERNAL_LOCK, op) < 0)
+	msg_fatal("%s: %slock cache file: %m", cache->path,
+		  op == MYFLOCK_OP_NONE ? "un" : "");
+}
+
+/* psc_mmap_create - create new cache file and rename it into place */
+
+static void psc_mmap_create(const char *path, int slots)
+{
+    PSC_MMAP_HEAD head;
+    VSTRING *tmp_buf = vstring_alloc(100);
+    const char *tmp_path;
+    int     fd;
+
+    tmp_path = STR(vstring_sprintf(tmp_buf, "%s.%ld", path, (long) getpid()));
+    memset((void *) &head, 0, sizeof(head));
+    memcpy(head.magic, PSC_MMAP_MAGIC, sizeof(PSC_MMAP_MAGIC));
+    head.version = PSC_MMAP_VERSION;
+    head.slot_size = sizeof(PSC_MMAP_SLOT);
+    head.slots = slots;
+    head.stamps = PSC_MMAP_STAMPS;
+    ldseed(&head.seed, sizeof(head.seed));
+
+    /*
+     * Make the new file durable before it replaces the old one, so that a
+     * system crash leaves either the old or the new file.
+     */
+    if ((fd = open(tmp_path, O_RDWR | O_CREAT | O_TRUNC, 0600)) < 0)
+	msg_fatal("open %s: %m", tmp_path);
+    if (ftruncate(fd, (off_t) PSC_MMAP_SIZE(slots)) < 0)
+	msg_fatal("truncate %s: %m", tmp_path);
+    if (write(fd, (void *) &head, sizeof(head)) != sizeof(head))
+	msg_fatal("write %s: %m", tmp_path);
+    if (fsync(fd) < 0)
+	msg_fatal("fsync %s: %m", tmp_path);
+    if (close(fd) < 0)
+	msg_fatal("close %s: %m", tmp_path);
+    if (rename(tmp_path, path) < 0)
+	msg_fatal("rename %s to %s: %m", tmp_path, path);
+    vstring_free(tmp_buf);
+}
+
+/* psc_mmap_open - open or create memory-mapped cache */
+
+PSC_MMAP *psc_mmap_open(const char *path, int slots)
+{
+    PSC_MMAP *cache;
+    PSC_MMAP_HEAD head;
+    struct stat fst;
+    struct stat st;
+    size_t  size = PSC_MMAP_SIZE(slots);
+    void   *ptr;
+    int     fd;
+
+    if (slots <= 0 || slots > INT_MAX / sizeof(PSC_MMAP_SLOT))
+	msg_fatal("%s: bad cache size: %d slots", path, slots);
+
+    /*
+     * Serialize with other processes that open, update or replace the file,
+     * and try again when the file was replaced while we waited for the lock.
+     */
+    for (;;) {
+	if ((fd = open(path, O_RDWR | O_CREAT, 0600)) < 0)
+	    msg_fatal("open %s: %m", path);
+	if (myflock(fd, INTERNAL_LOCK, MYFLOCK_OP_EXCLUSIVE) < 0)
+	    msg_fatal("lock %s: %m", path);
+	if (fstat(fd, &fst) < 0)
+	    msg_fatal("fstat %s: %m", path);
+	if (stat(path, &st) < 0 || st.st_dev != fst.st_dev
+	    || st.st_ino != fst.st_ino) {
+	    (void) close(fd);
+	    continue;
+	}
+	if (fst.st_size == size
+	    && read(fd, (void *) &head, sizeof(head)) == sizeof(head)
+	    && memcmp(head.magic, PSC_MMAP_MAGIC, sizeof(PSC_MMAP_MAGIC)) == 0
+	    && head.version == PSC_MMAP_VERSION
+	    && head.slot_size == sizeof(PSC_MMAP_SLOT)
+	    && head.slots == slots
+	    && head.stamps == PSC_MMAP_STAMPS)
+	    break;
+	if (fst.st_size != 0)
+	    msg_warn("%s: cache file size or format has changed "
+		     "-- creating new file with %d slots", path, slots);
+	psc_mmap_create(path, slots);
+	(void) close(fd);
+    }
+    if ((ptr = mmap((void *) 0, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+		    fd, (off_t) 0)) == MAP_FAILED)
+	msg_fatal("mmap %s: %m", path);
+    if (myflock(fd, INTERNAL_LOCK, MYFLOCK_OP_NONE) < 0)
+	msg_fatal("unlock %s: %m", path);
+    close_on_exec(fd, CLOSE_ON_EXEC);
+
+    cache = (PSC_MMAP *) mymalloc(sizeof(*cache));
+    cache->path = mystrdup(path);
+    cache->fd = fd;
+    cache->size = size;
+    cache->head = (PSC_MMAP_HEAD *) ptr;
+    cache->slots = (PSC_MMAP_SLOT *) (cache->head + 1);
+    cache->nslots = slots;
+    cache->retained = cache->dropped = 0;
+    return (cache);
+}
+
+/* psc_mmap_lookup - look up client address */
+
+int     psc_mmap_lookup(PSC_MMAP *cache, const char *addr, time_t *expire_time)
+{
+    unsigned char bytes[sizeof(((PSC_MMAP_SLOT *) 0)->addr)];
+    PSC_MMAP_SLOT copy;
+    uint32_t family;
+    uint32_t pos;
+    int     n;
+    int     i;
+
+    /*
+     * Examine the whole window. There are no tombstones; a free slot does
+     * not terminate the search.
+     */
+    if (psc_mmap_key(addr, &family, bytes) == 0)
+	return (0);
+    pos = psc_mmap_slot(cache, family, bytes);
+    for (n = 0; n < PSC_MMAP_WINDOW; n++, pos = (pos + 1) % cache->nslots) {
+	if (psc_mmap_read(cache->slots + pos, &copy)
+	    && copy.family == family
+	    && memcmp(copy.addr, bytes, sizeof(bytes)) == 0) {
+	    for (i = 0; i < PSC_TINDX_COUNT; i++)
+		expire_time[i] = copy.expire[i];
+	    if (msg_verbose)
+		msg_info("%s: %s: hit slot %lu", cache->path, addr,
+			 (unsigned long) pos);
+	    return (1);
+	}
+    }
+    return (0);
+}
+
+/* psc_mmap_update - save client test results */
+
+void    psc_mmap_update(PSC_MMAP *cache, const char *addr,
+			        const time_t *expire_time)
+{
+    unsigned char bytes[sizeof(((PSC_MMAP_SLOT *) 0)->addr)];
+    PSC_MMAP_SLOT *slot;
+    PSC_MMAP_SLOT *match = 0;
+    PSC_MMAP_SLOT *free_slot = 0;
+    PSC_MMAP_SLOT *oldest = 0;
+    uint32_t family;
+    uint32_t pos;
+    int     n;
+
+    if (psc_mmap_key(addr, &family, bytes) == 0)
+	return;
+    psc_mmap_lock(cache, MYFLOCK_OP_EXCLUSIVE);
+    pos = psc_mmap_slot(cache, family, bytes);
+    for (n = 0; n < PSC_MMAP_WINDOW; n++, pos = (pos + 1) % cache->nslots) {
+	slot = cache->slots + pos;
+	if ((slot->seq & 1) != 0 || slot->family == PSC_MMAP_FAMILY_FREE) {
+	    if (free_slot == 0)
+		free_slot = slot;
+	} else if (slot->family == family
+		   && memcmp(slot->addr, bytes, sizeof(bytes)) == 0) {
+	    match = slot;
+	    break;
+	} else if (oldest == 0
+		   || psc_mmap_latest(slot) < psc_mmap_latest(oldest)) {
+	    oldest = slot;
+	}
+    }
+    if ((slot = match) == 0 && (slot = free_slot) == 0) {
+	slot = oldest;
+	if (msg_verbose)
+	    msg_info("%s: %s: evicting slot %lu", cache->path, addr,
+		     (unsigned long) (slot - cache->slots));
+    }
+    psc_mmap_write(slot, family, bytes, expire_time);
+    psc_mmap_lock(cache, MYFLOCK_OP_NONE);
+}
+
+/* psc_mmap_clean - incremental cache cleanup */
+
+int     psc_mmap_clean(PSC_MMAP *cache, int count,
+		               int (*validator) (const time_t *, void *),
+		               void *context)
+{
+    PSC_MMAP_SLOT *slot;
+    time_t  expire_time[PSC_TINDX_COUNT];
+    uint32_t pos;
+    int     done = 0;
+    int     n;
+
+    psc_mmap_lock(cache, MYFLOCK_OP_EXCLUSIVE);
+    for (pos = cache->head->clean_pos % cache->nslots; count > 0; count--) {
+	slot = cache->slots + pos;
+	if ((slot->seq & 1) == 0 && slot->family == PSC_MMAP_FAMILY_FREE) {
+	     /* void */ ;
+	} else if ((slot->seq & 1) != 0 || psc_mmap_check(slot) != slot->check) {
+	    psc_mmap_free(slot);
+	    cache->dropped++;
+	} else {
+	    for (n = 0; n < PSC_TINDX_COUNT; n++)
+		expire_time[n] = slot->expire[n];
+	    if (validator(expire_time, context)) {
+		cache->retained++;
+	    } else {
+		psc_mmap_free(slot);
+		cache->dropped++;
+	    }
+	}
+	if (++pos >= cache->nslots) {
+	    pos = 0;
+	    done = 1;
+	    break;
+	}
+    }
+    cache->head->clean_pos = pos;
+    psc_mmap_lock(cache, MYFLOCK_OP_NONE);
+
+    /*
+     * Report statistics like dict_cache(3) does, and schedule a write-back
+     * so that a system crash loses no more than one cleanup interval.
+     */
+    if (done) {
+	msg_info("cache %s full cleanup: retained=%d dropped=%d entries",
+		 cache->path, cache->retained, cache->dropped);
+	cache->retained = cache->dropped = 0;
+	if (msync((void *) cache->head, cache->size, MS_ASYNC) < 0)
+	    msg_warn("msync %s: %m", cache->path);
+    }
+    return (done);
+}
+
+/* psc_mmap_name - return cache file name */
+
+const char *psc_mmap_name(PSC_MMAP *cache)
+{
+    return (cache->path);
+}
+
+/* psc_mmap_close - write back, unmap, and release storage */
+
+void    psc_mmap_close(PSC_MMAP *cache)
+{
+    if (msync((void *) cache->head, cache->size, MS_ASYNC) < 0)
+	msg_warn("msync %s: %m", cache->path);
+    if (munmap((void *) cache->head, cache->size) < 0)
+	msg_warn("munmap %s: %m", cache->path);
+    (void) close(cache->fd);
+    myfree(cache->path);
+    myfree((void *) cache);
+}
+
+#ifdef TEST
+
+ /*
+  * Test program. Commands are:
+  * 
+  * update address ttl
+  * 
+  * lookup address
+  * 
+  * clean count
+  * 
+  * resize slots
+  * 
+  * An update sets all test expiration times to the current time plus ttl. A
+  * lookup reports whether an entry exists, and whether it has expired. A
+  * cleanup pass drops expired entries, and reports the next cleanup
+  * position. A resize replaces the cache file with one that has a different
+  * size; the old handle stays usable for lookups. With no more than
+  * PSC_MMAP_WINDOW slots, every lookup window covers the entire cache, so
+  * that eviction results do not depend on the random hash seed.
+  */
+#include <stdlib.h>
+#include <msg_vstream.h>
+#include <vstring_vstream.h>
+#include <stringops.h>
+
+/* psc_mmap_test_validator - keep entries that have not expired */
+
+static int psc_mmap_test_validator(const time_t *expire_time, void *context)
+{
+    time_t  now = *(time_t *) context;
+    int     n;
+
+    for (n = 0; n < PSC_TINDX_COUNT; n++)
+	if (expire_time[n] > now)
+	    return (1);
+    return (0);
+}
+
+int     main(int argc, char **argv)
+{
+    PSC_MMAP *cache;
+    PSC_MMAP *old_cache = 0;
+    VSTRING *buf = vstring_alloc(100);
+    time_t  expire_time[PSC_TINDX_COUNT];
+    time_t  now;
+    char   *cp;
+    char   *cmd;
+    char   *arg;
+    char   *ttl;
+    int     done;
+    int     n;
+
+    msg_vstream_init(argv[0], VSTREAM_ERR);
+    if (argc != 3)
+	msg_fatal("usage: %s file slots", argv[0]);
+    cache = psc_mmap_open(argv[1], atoi(argv[2]));
+
+    while (vstring_get_nonl(buf, VSTREAM_IN) != VSTREAM_EOF) {
+	cp = STR(buf);
+	vstream_printf("> %s\n", cp);
+	vstream_fflush(VSTREAM_OUT);
+	if ((cmd = mystrtok(&cp, CHARS_SPACE)) == 0 || *cmd == '#')
+	    continue;
+	now = time((time_t *) 0);
+	if ((arg = mystrtok(&cp, CHARS_SPACE)) == 0) {
+	    msg_warn("missing argument");
+	} else if (strcmp(cmd, "update") == 0) {
+	    if ((ttl = mystrtok(&cp, CHARS_SPACE)) == 0) {
+		msg_warn("usage: update address ttl");
+	    } else {
+		for (n = 0; n < PSC_TINDX_COUNT; n++)
+		    expire_time[n] = now + atoi(ttl);
+		psc_mmap_update(cache, arg, expire_time);
+	    }
+	} else if (strcmp(cmd, "lookup") == 0) {
+	    if (psc_mmap_lookup(cache, arg, expire_time))
+		vstream_printf("%s: %s\n", arg,
+			       psc_mmap_test_validator(expire_time, &now) ?
+			       "found" : "found, expired");
+	    else
+		vstream_printf("%s: not found\n", arg);
+	    if (old_cache != 0)
+		vstream_printf("%s: %s in old file\n", arg,
+			       psc_mmap_lookup(old_cache, arg, expire_time) ?
+			       "found" : "not found");
+	} else if (strcmp(cmd, "clean") == 0) {
+	    done = psc_mmap_clean(cache, atoi(arg), psc_mmap_test_validator,
+				  (void *) &now);
+	    vstream_printf("done=%d clean_pos=%lu\n", done,
+			   (unsigned long) cache->head->clean_pos);
+	} else if (strcmp(cmd, "resize") == 0) {
+	    if (old_cache != 0)
+		psc_mmap_close(old_cache);
+	    old_cache = cache;
+	    cache = psc_mmap_open(argv[1], atoi(arg));
+	} else {
+	    msg_warn("unknown command: %s", cmd);
+	}
+	vstream_fflush(VSTREAM_OUT);
+    }
+    if (old_cache != 0)
+	psc_mmap_close(old_cache);
+    psc_mmap_close(cache);
+    vstring_free(buf);
+    return (0);
+}
+
+#endif
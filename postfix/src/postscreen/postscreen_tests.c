@@ -22,6 +22,9 @@
 /*	const char *stamp_text;
 /*	time_t time_value;
 /*
+/*	time_t	*psc_save_tests(state)
+/*	PSC_STATE *state;
+/*
 /*	char	*psc_print_tests(buffer, state)
 /*	VSTRING	*buffer;
 /*	PSC_STATE *state;
@@ -62,6 +65,10 @@
 /*	tests are flagged as "expired"; the object is flagged as
 /*	"new" if some enabled tests have "new" time stamps.
 /*
+/*	psc_save_tests() returns the per-test expiration time stamps
+/*	in the form that is stored in the postscreen(8) cache.
+/*	This may modify the time stamps for disabled tests.
+/*
 /*	psc_print_tests() creates a cache file record for the
 /*	specified flags and per-test expiration time stamps.
 /*	This may modify the time stamps for disabled tests.
@@ -272,11 +279,11 @@ void    psc_todo_tests(PSC_STATE *state, time_t time_value)
 #endif
 }
 
-/* psc_print_tests - print postscreen cache record */
+/* psc_save_tests - prepare test results for saving */
 
-char   *psc_print_tests(VSTRING *buf, PSC_STATE *state)
+time_t *psc_save_tests(PSC_STATE *state)
 {
-    const char *myname = "psc_print_tests";
+    const char *myname = "psc_save_tests";
     time_t *expire_time = state->client_info->expire_time;
 
     /*
@@ -300,6 +307,14 @@ char   *psc_print_tests(VSTRING *buf, PSC_STATE *state)
 	expire_time[PSC_TINDX_NSMTP] = PSC_TIME_STAMP_DISABLED;
     if (var_psc_barlf_enable == 0 && expire_time[PSC_TINDX_BARLF] == PSC_TIME_STAMP_NEW)
 	expire_time[PSC_TINDX_BARLF] = PSC_TIME_STAMP_DISABLED;
+    return (expire_time);
+}
+
+/* psc_print_tests - print postscreen cache record */
+
+char   *psc_print_tests(VSTRING *buf, PSC_STATE *state)
+{
+    time_t *expire_time = psc_save_tests(state);
 
     vstring_sprintf(buf, "%lu;%lu;%lu;%lu;%lu",
 		    (unsigned long) expire_time[PSC_TINDX_PREGR],
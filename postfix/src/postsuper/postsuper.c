@@ -223,8 +223,8 @@
 /*	Move queue files that are in the wrong place in the file system
 /*	hierarchy and remove subdirectories that are no longer needed.
 /*	File position rearrangements are necessary after a change in the
-/*	\fBhash_queue_names\fR and/or \fBhash_queue_depth\fR
-/*	configuration parameters.
+/*	\fBhash_queue_names\fR, \fBhash_queue_depth\fR and/or
+/*	\fBhash_queue_style\fR configuration parameters.
 /* .IP \(bu
 /*	Rename queue files created with "enable_long_queue_ids =
 /*	yes" to short names, for migration to Postfix <= 2.8.  The
@@ -302,6 +302,11 @@
 /*	Available in Postfix version 2.9 and later:
 /* .IP "\fBenable_long_queue_ids (no)\fR"
 /*	Enable long, non-repeating, queue IDs (queue file names).
+/* .PP
+/*	Available in Postfix version 3.11 and later:
+/* .IP "\fBhash_queue_style (classic)\fR"
+/*	How subdirectory names for queue directories listed with the
+/*	hash_queue_names parameter are derived from the queue ID.
 /* SEE ALSO
 /*	sendmail(1), Sendmail-compatible user interface
 /*	postqueue(1), unprivileged queue operations
@@ -585,6 +590,16 @@ static int postrmdir(const char *path)
     return (ret);
 }
 
+/* stale_subdir_style - subdirectory was created with other hash_queue_style */
+
+static int stale_subdir_style(const char *path)
+{
+    const char *name;
+
+    name = (name = strrchr(path, '/')) != 0 ? name + 1 : path;
+    return (mail_queue_subdir_style(name) != mail_queue_hash_style());
+}
+
 /* delete_one - delete one message instance and all its associated files */
 
 static void delete_one(const char **queue_names, const char *queue_id)
@@ -971,7 +986,9 @@ static void super(const char **queues, int action)
 	    if ((path = scan_dir_next(info)) == 0) {
 		if (actual_depth == 0)
 		    break;
-		if (actual_depth > wanted_depth)
+		if (actual_depth > wanted_depth
+		    || ((action & ACTION_STRUCT) != 0
+			&& stale_subdir_style(scan_dir_path(info))))
 		    postrmdir(scan_dir_path(info));
 		scan_dir_pop(info);
 		actual_depth--;
@@ -983,7 +1000,8 @@ static void super(const char **queues, int action)
 	     * considered safe to do so. Otherwise, try to remove the
 	     * subdirectory at a later stage.
 	     */
-	    if (strlen(path) == 1 && (qp->flags & RECURSE) != 0) {
+	    if (mail_queue_subdir_style(path) != 0
+		&& (qp->flags & RECURSE) != 0) {
 		actual_depth++;
 		scan_dir_push(info, path);
 		continue;
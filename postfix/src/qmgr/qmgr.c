@@ -142,6 +142,15 @@
 /*	A single queue manager process has to compete for disk access with
 /*	multiple front-end processes such as \fBcleanup\fR(8). A sudden burst of
 /*	inbound mail can negatively impact outbound delivery rates.
+/*
+/*	When the queue is split over multiple queue manager processes
+/*	with \fBqmgr_shard_services\fR, each process schedules its
+/*	own messages independently. The per-destination concurrency
+/*	limits and the active queue limits are divided evenly over
+/*	the processes, rounded up; a limit that is not a multiple
+/*	of the number of processes may be exceeded by up to that
+/*	number minus one. A destination concurrency limit of 1 or
+/*	a rate delay, for any transport, is a fatal error at startup.
 /* CONFIGURATION PARAMETERS
 /* .ad
 /* .fi
@@ -261,6 +270,17 @@
 /* .IP "\fBdestination_concurrency_feedback_debug (no)\fR"
 /*	Make the queue manager's feedback algorithm verbose for performance
 /*	analysis purposes.
+/* .PP
+/*	Available in Postfix 3.11 and later:
+/* .IP "\fBdefault_destination_concurrency_feedback_mode (success)\fR"
+/*	How the per-destination delivery concurrency is adjusted:
+/*	after delivery success and failure only ("success"), or also
+/*	after changes in delivery latency ("latency").
+/* .IP "\fBtransport_destination_concurrency_feedback_mode ($default_destination_concurrency_feedback_mode)\fR"
+/*	A transport-specific override for the
+/*	default_destination_concurrency_feedback_mode parameter value,
+/*	where \fItransport\fR is the master.cf name of the message delivery
+/*	transport.
 /* RECIPIENT SCHEDULING CONTROLS
 /* .ad
 /* .fi
@@ -400,6 +420,11 @@
 /* .IP "\fBinfo_log_address_format (external)\fR"
 /*	The email address form that will be used in non-debug logging
 /*	(info, warning, etc.).
+/* .PP
+/*	Available in Postfix 3.11 and later:
+/* .IP "\fBqmgr_shard_services (empty)\fR"
+/*	The master.cf service names of queue manager processes that
+/*	split the mail queue among themselves.
 /* FILES
 /*	/var/spool/postfix/incoming, incoming queue
 /*	/var/spool/postfix/active, active queue
@@ -509,6 +534,7 @@ bool    var_verp_bounce_off;
 int     var_qmgr_clog_warn_time;
 char   *var_conc_pos_feedback;
 char   *var_conc_neg_feedback;
+char   *var_conc_feedback_mode;
 int     var_conc_cohort_limit;
 int     var_conc_feedback_debug;
 int     var_xport_rate_delay;
@@ -518,6 +544,7 @@ int     var_qmgr_daemon_timeout;
 int     var_qmgr_ipc_timeout;
 int     var_dsn_delay_cleared;
 int     var_vrfy_pend_limit;
+char   *var_qmgr_shard_services;
 
 static QMGR_SCAN *qmgr_scans[2];
 
@@ -588,6 +615,12 @@ static void qmgr_trigger_event(char *buf, ssize_t len,
 	}
     }
 
+    /*
+     * When the queue is split over multiple queue managers, pass on the
+     * request to the other queue managers.
+     */
+    qmgr_shard_relay(buf, len);
+
     /*
      * Process each request type at most once. Modifiers take effect upon the
      * next queue run. If no queue run is in progress, and a queue scan is
@@ -709,6 +742,16 @@ static void qmgr_post_init(char *name, char **unused_argv)
 	msg_warn("support for the name old name (nqmgr) will be removed from Postfix");
     }
 
+    /*
+     * When the queue is split over multiple queue managers, each gets its
+     * share of the in-memory message and recipient limits.
+     */
+    qmgr_shard_init(var_qmgr_shard_services, name);
+    var_qmgr_active_limit = qmgr_shard_limit(var_qmgr_active_limit);
+    var_qmgr_rcpt_limit = qmgr_shard_limit(var_qmgr_rcpt_limit);
+    qmgr_shard_check(var_dest_con_limit, var_dest_rate_delay,
+		     var_xport_rate_delay);
+
     /*
      * Sanity check.
      */
@@ -757,7 +800,9 @@ int     main(int argc, char **argv)
 	VAR_DEFER_XPORTS, DEF_DEFER_XPORTS, &var_defer_xports, 0, 0,
 	VAR_CONC_POS_FDBACK, DEF_CONC_POS_FDBACK, &var_conc_pos_feedback, 1, 0,
 	VAR_CONC_NEG_FDBACK, DEF_CONC_NEG_FDBACK, &var_conc_neg_feedback, 1, 0,
+	VAR_CONC_FDBACK_MODE, DEF_CONC_FDBACK_MODE, &var_conc_feedback_mode, 1, 0,
 	VAR_DEF_FILTER_NEXTHOP, DEF_DEF_FILTER_NEXTHOP, &var_def_filter_nexthop, 0, 0,
+	VAR_QMGR_SHARD_SERVICES, DEF_QMGR_SHARD_SERVICES, &var_qmgr_shard_services, 0, 0,
 	0,
     };
     static const CONFIG_TIME_TABLE time_table[] = {
@@ -25,6 +25,7 @@
   */
 #include <recipient_list.h>
 #include <dsn.h>
+#include <resolve_clnt.h>
 
  /*
   * The queue manager is built around lots of mutually-referring structures.
@@ -139,6 +140,10 @@ struct QMGR_FEEDBACK {
 #endif
 
 extern void qmgr_feedback_init(QMGR_FEEDBACK *, const char *, const char *, const char *, const char *);
+extern int qmgr_feedback_mode(const char *);
+
+#define QMGR_FEEDBACK_MODE_SUCCESS	0	/* success/failure feedback */
+#define QMGR_FEEDBACK_MODE_LATENCY	1	/* latency feedback */
 
 #ifndef QMGR_FEEDBACK_IDX_SQRT_WIN
 #define QMGR_FEEDBACK_VAL(fb, win) \
@@ -204,6 +209,7 @@ struct QMGR_TRANSPORT {
     QMGR_FEEDBACK pos_feedback;		/* positive feedback control */
     QMGR_FEEDBACK neg_feedback;		/* negative feedback control */
     int     fail_cohort_limit;		/* flow shutdown control */
+    int     feedback_mode;		/* success or latency feedback */
     int     xport_rate_delay;		/* suspend per delivery */
     int     rate_delay;			/* suspend per delivery */
 };
@@ -244,6 +250,10 @@ struct QMGR_QUEUE {
     double  success;			/* accumulated positive feedback */
     double  failure;			/* accumulated negative feedback */
     double  fail_cohorts;		/* pseudo-cohort failure count */
+    double  latency_avg;		/* smoothed delivery latency */
+    double  latency_base;		/* lowest smoothed latency */
+    int     latency_count;		/* latency samples */
+    int     latency_cohort;		/* samples since window change */
     QMGR_TRANSPORT *transport;		/* transport linkage */
     QMGR_ENTRY_LIST todo;		/* todo queue entries */
     QMGR_ENTRY_LIST busy;		/* messages on the wire */
@@ -262,6 +272,7 @@ extern QMGR_QUEUE *qmgr_queue_create(QMGR_TRANSPORT *, const char *, const char
 extern void qmgr_queue_done(QMGR_QUEUE *);
 extern void qmgr_queue_throttle(QMGR_QUEUE *, DSN *);
 extern void qmgr_queue_unthrottle(QMGR_QUEUE *);
+extern void qmgr_queue_latency(QMGR_QUEUE *, double, int, long);
 extern QMGR_QUEUE *qmgr_queue_find(QMGR_TRANSPORT *, const char *);
 extern void qmgr_queue_suspend(QMGR_QUEUE *, int);
 
@@ -306,6 +317,7 @@ struct QMGR_ENTRY {
     QMGR_PEER *peer;			/* parent linkage */
     QMGR_ENTRY_LIST queue_peers;	/* per queue neighbor entries */
     QMGR_ENTRY_LIST peer_peers;		/* per peer neighbor entries */
+    struct timeval start_time;		/* delivery request sent */
 };
 
 extern QMGR_ENTRY *qmgr_entry_select(QMGR_PEER *);
@@ -446,6 +458,11 @@ extern void qmgr_job_blocker_update(QMGR_QUEUE *);
 extern QMGR_JOB *qmgr_job_obtain(QMGR_MESSAGE *, QMGR_TRANSPORT *);
 extern void qmgr_job_free(QMGR_JOB *);
 extern void qmgr_job_move_limits(QMGR_JOB *);
+extern void qmgr_job_candidate_update(QMGR_JOB *);
+
+extern long qmgr_job_candidate_lookups;
+extern long qmgr_job_candidate_walks;
+extern long qmgr_job_candidate_steps;
 
 extern QMGR_PEER *qmgr_peer_create(QMGR_JOB *, QMGR_QUEUE *);
 extern QMGR_PEER *qmgr_peer_find(QMGR_JOB *, QMGR_QUEUE *);
@@ -524,6 +541,22 @@ extern QMGR_TRANSPORT *qmgr_error_transport(const char *);
 extern QMGR_QUEUE *qmgr_error_queue(const char *, DSN *);
 extern char *qmgr_error_nexthop(DSN *);
 
+ /*
+  * qmgr_shard.c
+  */
+extern int qmgr_shard_count;
+extern int qmgr_shard_index;
+extern void qmgr_shard_init(const char *, const char *);
+extern int qmgr_shard_owns(const char *);
+extern int qmgr_shard_limit(int);
+extern void qmgr_shard_check(int, int, int);
+extern void qmgr_shard_relay(const char *, ssize_t);
+
+ /*
+  * qmgr_resolve.c
+  */
+extern void qmgr_resolve(QMGR_MESSAGE *, RECIPIENT *, RESOLVE_REPLY *);
+
 /* LICENSE
 /* .ad
 /* .fi
@@ -253,6 +253,7 @@ static void qmgr_deliver_update(int unused_event, void *context)
     QMGR_TRANSPORT *transport = queue->transport;
     QMGR_MESSAGE *message = entry->message;
     static DSN_BUF *dsb;
+    struct timeval now;
     int     status;
 
     /*
@@ -366,8 +367,13 @@ static void qmgr_deliver_update(int unused_event, void *context)
      */
     if (status != DELIVER_STAT_CRASH) {
 	qmgr_transport_unthrottle(transport);
-	if (VSTRING_LEN(dsb->reason) == 0)
+	if (VSTRING_LEN(dsb->reason) == 0) {
+	    GETTIMEOFDAY(&now);
+	    qmgr_queue_latency(queue, now.tv_sec - entry->start_time.tv_sec
+		      + (now.tv_usec - entry->start_time.tv_usec) / 1000000.0,
+			       entry->rcpt_list.len, message->data_size);
 	    qmgr_queue_unthrottle(queue);
+	}
     }
 
     /*
@@ -453,6 +459,7 @@ void    qmgr_deliver(QMGR_TRANSPORT *transport, VSTREAM *stream)
      */
     qmgr_deliver_concurrency++;
     entry->stream = stream;
+    GETTIMEOFDAY(&entry->start_time);
     event_enable_read(vstream_fileno(stream),
 		      qmgr_deliver_update, (void *) entry);
 
@@ -17,6 +17,9 @@
 /*	double	QMGR_FEEDBACK_VAL(fbck_ctl, concurrency)
 /*	QMGR_FEEDBACK *fbck_ctl;
 /*	const int concurrency;
+/*
+/*	int	qmgr_feedback_mode(name_prefix)
+/*	const char *name_prefix;
 /* DESCRIPTION
 /*	Upon completion of a delivery request, a delivery agent
 /*	provides a hint that the scheduler should dedicate fewer or
@@ -31,6 +34,12 @@
 /*	current concurrency window. This is an "unsafe" macro that
 /*	evaluates some arguments multiple times.
 /*
+/*	qmgr_feedback_mode() looks up the transport-dependent
+/*	feedback mode: QMGR_FEEDBACK_MODE_SUCCESS (concurrency
+/*	follows delivery success and failure) or QMGR_FEEDBACK_MODE_LATENCY
+/*	(concurrency also follows delivery latency, see
+/*	qmgr_queue_latency()).
+/*
 /*	Arguments:
 /* .IP fbck_ctl
 /*	Pointer to QMGR_FEEDBACK structure where the result will
@@ -50,7 +59,7 @@
 /*	Delivery concurrency for concurrency-dependent feedback calculation.
 /* DIAGNOSTICS
 /*	Warning: configuration error or unreasonable input. The program
-/*	uses name_tail feedback instead.
+/*	uses name_tail feedback, or success feedback mode, instead.
 /*	Panic: consistency check failure.
 /* LICENSE
 /* .ad
@@ -103,6 +112,12 @@ const NAME_CODE qmgr_feedback_map[] = {
     0, QMGR_FEEDBACK_IDX_NONE,
 };
 
+static const NAME_CODE qmgr_feedback_mode_map[] = {
+    CONC_FDBACK_MODE_SUCCESS, QMGR_FEEDBACK_MODE_SUCCESS,
+    CONC_FDBACK_MODE_LATENCY, QMGR_FEEDBACK_MODE_LATENCY,
+    0, -1,
+};
+
 /* qmgr_feedback_init - initialize feedback control */
 
 void    qmgr_feedback_init(QMGR_FEEDBACK *fb,
@@ -180,3 +195,27 @@ void    qmgr_feedback_init(QMGR_FEEDBACK *fb,
     myfree(fbck_name);
     myfree(fbck_val);
 }
+
+/* qmgr_feedback_mode - look up feedback mode */
+
+int     qmgr_feedback_mode(const char *name_prefix)
+{
+    char   *mode_name;
+    char   *mode_val;
+    int     mode;
+
+    mode_name = concatenate(name_prefix, _CONC_FDBACK_MODE, (char *) 0);
+    mode_val = get_mail_conf_str(mode_name, var_conc_feedback_mode, 1, 0);
+    if ((mode = name_code(qmgr_feedback_mode_map, NAME_CODE_FLAG_NONE,
+			  mode_val)) < 0) {
+	msg_warn("%s: ignoring unknown feedback mode: %s",
+		 strcmp(mode_val, var_conc_feedback_mode) ?
+		 mode_name : VAR_CONC_FDBACK_MODE, mode_val);
+	mode = QMGR_FEEDBACK_MODE_SUCCESS;
+    }
+    if (var_conc_feedback_debug)
+	msg_info("%s: feedback mode %s", name_prefix, mode_val);
+    myfree(mode_name);
+    myfree(mode_val);
+    return (mode);
+}
@@ -21,6 +21,9 @@
 /*
 /*	void	qmgr_job_blocker_update(queue)
 /*	QMGR_QUEUE *queue;
+/*
+/*	void	qmgr_job_candidate_update(job)
+/*	QMGR_JOB *job;
 /* DESCRIPTION
 /*	These routines add/delete/manipulate per-transport jobs.
 /*	Each job corresponds to a specific transport and message.
@@ -49,6 +52,18 @@
 /*	qmgr_job_move_limits() takes care of proper distribution of the
 /*	per-transport recipients limit among the per-transport jobs.
 /*	Should be called whenever a job's recipient slot becomes available.
+/*
+/*	qmgr_job_candidate_update() informs the preemption candidate
+/*	cache that the specified job has been assigned more entries,
+/*	or that its number of unread recipients has changed. This
+/*	updates the cached candidate where possible, instead of
+/*	throwing away the result of a full job list traversal.
+/*
+/*	The counters qmgr_job_candidate_lookups, qmgr_job_candidate_walks
+/*	and qmgr_job_candidate_steps record the number of candidate
+/*	lookups, the number of lookups that required a job list
+/*	traversal, and the number of jobs visited during those
+/*	traversals, respectively.
 /* DIAGNOSTICS
 /*	Panic: consistency check failure.
 /* LICENSE
@@ -95,6 +110,13 @@ static void qmgr_job_pop(QMGR_JOB *);
 
 #define IS_BLOCKER(job,transport) ((job)->blocker_tag == (transport)->blocker_tag)
 
+ /*
+  * Candidate selection cost accounting.
+  */
+long    qmgr_job_candidate_lookups;
+long    qmgr_job_candidate_walks;
+long    qmgr_job_candidate_steps;
+
 /* qmgr_job_create - create and initialize message job structure */
 
 static QMGR_JOB *qmgr_job_create(QMGR_MESSAGE *message, QMGR_TRANSPORT *transport)
@@ -258,18 +280,19 @@ QMGR_JOB *qmgr_job_obtain(QMGR_MESSAGE *message, QMGR_TRANSPORT *transport)
 	qmgr_job_link(job);
 
     /*
-     * Reset the candidate cache because of the new expected recipients. Make
-     * sure the job is not marked as a blocker for the same reason. Note that
-     * this can result in having a non-blocker followed by more blockers.
-     * Consequently, we can't just update the current job pointer, we have to
-     * reset it. Fortunately qmgr_job_entry_select() will easily deal with
-     * this and will lookup the real current job for us.
+     * Make sure the job is not marked as a blocker because of the new
+     * expected recipients. Note that this can result in having a non-blocker
+     * followed by more blockers. Consequently, we can't just update the
+     * current job pointer, we have to reset it. Fortunately
+     * qmgr_job_entry_select() will easily deal with this and will lookup the
+     * real current job for us. Then, update the candidate cache for the
+     * same reason.
      */
-    RESET_CANDIDATE_CACHE(transport);
     if (IS_BLOCKER(job, transport)) {
 	job->blocker_tag = 0;
 	transport->job_current = transport->job_list.next;
     }
+    qmgr_job_candidate_update(job);
     return (job);
 }
 
@@ -502,10 +525,12 @@ static QMGR_JOB *qmgr_job_candidate(QMGR_JOB *current)
      * one exists. However, this feature requires that we no longer relax the
      * cache resetting rules, depending on the automatic cache timeout.
      */
+    qmgr_job_candidate_lookups++;
     if (transport->candidate_cache_current == current
 	&& (transport->candidate_cache_time == now
 	    || transport->candidate_cache == 0))
 	return (transport->candidate_cache);
+    qmgr_job_candidate_walks++;
 
     /*
      * Estimate the minimum amount of delivery slots that can ever be
@@ -536,6 +561,7 @@ static QMGR_JOB *qmgr_job_candidate(QMGR_JOB *current)
      */
     if (max_slots > 0) {
 	for (job = current->transport_peers.next; job; job = job->transport_peers.next) {
+	    qmgr_job_candidate_steps++;
 	    if (job->stack_children.next != 0 || IS_BLOCKER(job, transport))
 		continue;
 	    max_total_entries = MAX_ENTRIES(job);
@@ -567,6 +593,68 @@ static QMGR_JOB *qmgr_job_candidate(QMGR_JOB *current)
     return (best_job);
 }
 
+/* qmgr_job_candidate_update - update candidate cache after job change */
+
+void    qmgr_job_candidate_update(QMGR_JOB *job)
+{
+    QMGR_TRANSPORT *transport = job->transport;
+    QMGR_JOB *current = transport->candidate_cache_current;
+    QMGR_JOB *best_job = transport->candidate_cache;
+    double  score, best_score;
+    int     max_slots, max_needed_entries, max_total_entries;
+    time_t  now = transport->candidate_cache_time;
+
+    /*
+     * Nothing to update if the cache is already invalid, or if the job is
+     * not on the job lists.
+     */
+    if (current == 0 || job->stack_level < 0)
+	return;
+
+    /*
+     * The change affects the current job's slot estimate, or the cached
+     * candidate's score, or the current job pointer has moved on. Any of
+     * these requires a fresh job list traversal.
+     */
+    if (job == current || job == best_job
+	|| current != transport->job_current) {
+	RESET_CANDIDATE_CACHE(transport);
+	return;
+    }
+
+    /*
+     * The cache was computed as the best choice among all jobs following the
+     * current job. Only the job at hand has changed, so it suffices to
+     * compare that job against the cached candidate, using the same time
+     * and the same criteria as qmgr_job_candidate().
+     * 
+     * All jobs in front of the current job are blockers; therefore, a job
+     * that is not a blocker and not the current job is a job following the
+     * current job. We play safe and do a full traversal when scores are
+     * equal, as list order would decide.
+     */
+    if (job->stack_children.next != 0 || IS_BLOCKER(job, transport))
+	return;
+    max_slots = (MIN_ENTRIES(current) - current->selected_entries
+		 + current->slots_available) / transport->slot_cost;
+    max_total_entries = MAX_ENTRIES(job);
+    max_needed_entries = max_total_entries - job->selected_entries;
+    if (max_needed_entries <= 0 || max_needed_entries > max_slots)
+	return;
+    score = (double) (now - job->message->queued_time + 1) / max_total_entries;
+    if (best_job != 0) {
+	best_score = (double) (now - best_job->message->queued_time + 1)
+	    / MAX_ENTRIES(best_job);
+	if (score == best_score) {
+	    RESET_CANDIDATE_CACHE(transport);
+	    return;
+	}
+	if (score < best_score)
+	    return;
+    }
+    transport->candidate_cache = job;
+}
+
 /* qmgr_job_preempt - preempt large message with smaller one */
 
 static QMGR_JOB *qmgr_job_preempt(QMGR_JOB *current)
@@ -1035,7 +1035,7 @@ static void qmgr_message_sort(QMGR_MESSAGE *message)
 /* qmgr_resolve_one - resolve or skip one recipient */
 
 static int qmgr_resolve_one(QMGR_MESSAGE *message, RECIPIENT *recipient,
-			            const char *addr, RESOLVE_REPLY *reply)
+			            RESOLVE_REPLY *reply)
 {
 #define QMGR_REDIRECT(rp, tp, np) do { \
 	(rp)->flags = 0; \
@@ -1043,10 +1043,7 @@ static int qmgr_resolve_one(QMGR_MESSAGE *message, RECIPIENT *recipient,
 	vstring_strcpy((rp)->nexthop, (np)); \
     } while (0)
 
-    if ((message->tflags & DEL_REQ_FLAG_MTA_VRFY) == 0)
-	resolve_clnt_query_from(message->sender, addr, reply);
-    else
-	resolve_clnt_verify_from(message->sender, addr, reply);
+    qmgr_resolve(message, recipient, reply);
     if (reply->flags & RESOLVE_FLAG_FAIL) {
 	QMGR_REDIRECT(reply, MAIL_SERVICE_RETRY,
 		      "4.3.0 address resolver failure");
@@ -1104,8 +1101,7 @@ static void qmgr_message_resolve(QMGR_MESSAGE *message)
 	    rewrite_clnt_internal(REWRITE_CANON, message->redirect_addr,
 				  reply.recipient);
 	    RECIPIENT_UPDATE(recipient->address, STR(reply.recipient));
-	    if (qmgr_resolve_one(message, recipient,
-				 recipient->address, &reply) < 0)
+	    if (qmgr_resolve_one(message, recipient, &reply) < 0)
 		continue;
 	    if (!STREQ(recipient->address, STR(reply.recipient)))
 		RECIPIENT_UPDATE(recipient->address, STR(reply.recipient));
@@ -1142,8 +1138,7 @@ static void qmgr_message_resolve(QMGR_MESSAGE *message)
 	 * result address may differ from the one specified by the sender.
 	 */
 	else {
-	    if (qmgr_resolve_one(message, recipient,
-				 recipient->address, &reply) < 0)
+	    if (qmgr_resolve_one(message, recipient, &reply) < 0)
 		continue;
 	    if (!STREQ(recipient->address, STR(reply.recipient)))
 		RECIPIENT_UPDATE(recipient->address, STR(reply.recipient));
@@ -1423,17 +1418,17 @@ static void qmgr_message_assign(QMGR_MESSAGE *message)
     recipient_list_init(&message->rcpt_list, RCPT_LIST_INIT_QUEUE);
 
     /*
-     * Note that even if qmgr_job_obtain() reset the job candidate cache of
+     * Note that even if qmgr_job_obtain() updated the job candidate cache of
      * all transports to which we assigned new recipients, this message may
      * have other jobs which we didn't touch at all this time. But the number
      * of unread recipients affecting the candidate selection might have
-     * changed considerably, so we must invalidate the caches if it might be
-     * of some use.
+     * changed considerably, so we must update the caches if it might be of
+     * some use.
      */
     for (job = message->job_list.next; job; job = job->message_peers.next)
 	if (job->selected_entries < job->read_entries
 	    && job->blocker_tag != job->transport->blocker_tag)
-	    job->transport->candidate_cache_current = 0;
+	    qmgr_job_candidate_update(job);
 }
 
 /* qmgr_message_move_limits - recycle unused recipient slots */
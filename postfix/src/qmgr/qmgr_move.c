@@ -15,7 +15,8 @@
 /*	with valid queue names and moves them to the \fIto\fR queue.
 /*	If \fItime_stamp\fR is non-zero, the queue file time stamps are
 /*	set to the specified value.
-/*	Entries with invalid names are left alone. No attempt is made to
+/*	Entries that belong to a different queue manager shard, and
+/*	entries with invalid names are left alone. No attempt is made to
 /*	look for other badness such as multiple links or weird file types.
 /*	These issues are dealt with when a queue file is actually opened.
 /* LICENSE
@@ -70,6 +71,8 @@ void    qmgr_move(const char *src_queue, const char *dst_queue,
 
     queue_dir = scan_dir_open(src_queue);
     while ((queue_id = mail_scan_dir_next(queue_dir)) != 0) {
+	if (!qmgr_shard_owns(queue_id))
+	    continue;
 	if (mail_queue_id_ok(queue_id)) {
 	    if (time_stamp > 0) {
 		tbuf.actime = tbuf.modtime = time_stamp;
@@ -27,6 +27,12 @@
 /*	void	qmgr_queue_unthrottle(queue)
 /*	QMGR_QUEUE *queue;
 /*
+/*	void	qmgr_queue_latency(queue, latency, rcpt_count, size)
+/*	QMGR_QUEUE *queue;
+/*	double	latency;
+/*	int	rcpt_count;
+/*	long	size;
+/*
 /*	void	qmgr_queue_suspend(queue, delay)
 /*	QMGR_QUEUE *queue;
 /*	int	delay;
@@ -64,6 +70,24 @@
 /*	provided that it does not exceed the destination concurrency
 /*	limit specified for the transport. This routine implements
 /*	"slow open" mode, and eliminates the "thundering herd" problem.
+/*	With latency feedback mode, the concurrency limit is not
+/*	incremented here, but in qmgr_queue_latency().
+/*
+/*	qmgr_queue_latency() handles the completion time in seconds
+/*	of a delivery request without connection or handshake
+/*	failure, and maintains the destination's smoothed and lowest
+/*	smoothed latency. The completion time is first divided by
+/*	the amount of work in the request, based on its recipient
+/*	count and message size, so that large requests are not
+/*	mistaken for congestion. With latency feedback mode, this routine
+/*	adjusts the concurrency limit once per pseudo-cohort, in the
+/*	style of TCP Vegas: when the smoothed latency is close to
+/*	the lowest latency, the destination is not yet saturated,
+/*	and the concurrency limit is incremented; when the latency
+/*	is well above the lowest latency, deliveries are waiting
+/*	at the remote side, and the concurrency limit is decremented.
+/*	In between, the concurrency limit is left alone, so that it
+/*	stays near the point where throughput stops increasing.
 /*
 /*	qmgr_queue_suspend() suspends delivery for this destination
 /*	briefly. This function invalidates any scheduling decisions
@@ -125,6 +149,32 @@ int     qmgr_queue_count;
 	if (var_conc_feedback_debug && !QMGR_ERROR_OR_RETRY_QUEUE(queue)) \
 	    msg_info("%s: feedback %g", myname, feedback);
 
+#define QMGR_LOG_LATENCY(queue) \
+	if (var_conc_feedback_debug && !QMGR_ERROR_OR_RETRY_QUEUE(queue)) \
+	    msg_info("%s: queue %s: window %d busy %d latency %.3f base %.3f", \
+		    myname, queue->name, queue->window, queue->busy_refcount, \
+		    queue->latency_avg, queue->latency_base);
+
+ /*
+  * Latency feedback: the smoothing factor for the average latency, the
+  * number of samples before the lowest latency is trusted, and the
+  * latency/lowest latency ratios below which the concurrency limit is
+  * incremented, and above which it is decremented.
+  */
+#define QMGR_LATENCY_GAIN	(1.0 / 8)
+#define QMGR_LATENCY_WARMUP	8
+#define QMGR_LATENCY_LOW	1.5
+#define QMGR_LATENCY_HIGH	2.0
+
+ /*
+  * Latency feedback: the amount of work in a delivery request, relative to
+  * a request with one recipient and no content. Recipients are pipelined,
+  * so that each additional recipient costs a fraction of a round trip; the
+  * content costs about one round trip per TCP window.
+  */
+#define QMGR_LATENCY_RCPT_COST	(1.0 / 4)
+#define QMGR_LATENCY_SIZE_UNIT	65536.0
+
 #define QMGR_LOG_WINDOW(queue) \
 	if (var_conc_feedback_debug && !QMGR_ERROR_OR_RETRY_QUEUE(queue)) \
 	    msg_info("%s: queue %s: limit %d window %d success %g failure %g fail_cohorts %g", \
@@ -255,6 +305,13 @@ void    qmgr_queue_unthrottle(QMGR_QUEUE *queue)
 	return;
     }
 
+    /*
+     * With latency-based feedback, the window is adjusted in
+     * qmgr_queue_latency() instead.
+     */
+    if (transport->feedback_mode == QMGR_FEEDBACK_MODE_LATENCY)
+	return;
+
     /*
      * Increase the destination's concurrency limit until we reach the
      * transport's concurrency limit. Allow for a margin the size of the
@@ -290,6 +347,66 @@ void    qmgr_queue_unthrottle(QMGR_QUEUE *queue)
     QMGR_LOG_WINDOW(queue);
 }
 
+/* qmgr_queue_latency - latency-based concurrency feedback */
+
+void    qmgr_queue_latency(QMGR_QUEUE *queue, double latency,
+			           int rcpt_count, long size)
+{
+    const char *myname = "qmgr_queue_latency";
+    QMGR_TRANSPORT *transport = queue->transport;
+    double  ratio;
+
+    /*
+     * Normalize the sample, so that a large message or a request with many
+     * recipients is not mistaken for a congested destination.
+     */
+    latency /= 1
+	+ (rcpt_count > 1 ? (rcpt_count - 1) * QMGR_LATENCY_RCPT_COST : 0)
+	+ (size > 0 ? size / QMGR_LATENCY_SIZE_UNIT : 0);
+
+    /*
+     * Keep a smoothed latency, so that one slow or fast delivery does not
+     * change the concurrency. The lowest smoothed latency approximates the
+     * latency of an idle destination. It is reset when the in-core queue is
+     * discarded.
+     */
+    if (latency < 0.001)
+	latency = 0.001;
+    if (queue->latency_count++ == 0)
+	queue->latency_avg = latency;
+    else
+	queue->latency_avg += (latency - queue->latency_avg) * QMGR_LATENCY_GAIN;
+    if (queue->latency_count >= QMGR_LATENCY_WARMUP
+	&& (queue->latency_base == 0 || queue->latency_avg < queue->latency_base))
+	queue->latency_base = queue->latency_avg;
+
+    /*
+     * Adjust the concurrency window once per pseudo-cohort, so that each
+     * adjustment is based on deliveries that saw the previous window. As
+     * with success feedback, don't open the window far beyond the actual
+     * concurrency, otherwise the next decrement is ineffective.
+     */
+    if (transport->feedback_mode != QMGR_FEEDBACK_MODE_LATENCY
+	|| !QMGR_QUEUE_READY(queue) || queue->latency_base == 0
+	|| ++queue->latency_cohort < queue->window)
+	return;
+    queue->latency_cohort = 0;
+    ratio = queue->latency_avg / queue->latency_base;
+    if (ratio < QMGR_LATENCY_LOW) {
+	if ((transport->dest_concurrency_limit == 0
+	     || transport->dest_concurrency_limit > queue->window)
+	    && queue->window < queue->busy_refcount
+	    + transport->init_dest_concurrency) {
+	    queue->window += 1;
+	    queue->failure = 0;
+	}
+    } else if (ratio > QMGR_LATENCY_HIGH) {
+	if (queue->window > 1)
+	    queue->window -= 1;
+    }
+    QMGR_LOG_LATENCY(queue);
+}
+
 /* qmgr_queue_throttle - handle destination delivery failure */
 
 void    qmgr_queue_throttle(QMGR_QUEUE *queue, DSN *dsn)
@@ -421,6 +538,8 @@ QMGR_QUEUE *qmgr_queue_create(QMGR_TRANSPORT *transport, const char *name,
     queue->transport = transport;
     queue->window = transport->init_dest_concurrency;
     queue->success = queue->failure = queue->fail_cohorts = 0;
+    queue->latency_avg = queue->latency_base = 0;
+    queue->latency_count = queue->latency_cohort = 0;
     QMGR_LIST_INIT(queue->todo);
     QMGR_LIST_INIT(queue->busy);
     queue->dsn = 0;
@@ -0,0 +1,593 @@
+/*++
+/* NAME
+/*	qmgr_resolve 3
+/* SUMMARY
+/*	batched recipient address resolution
+/* SYNOPSIS
+/*	#include "qmgr.h"
+/*
+/*	void	qmgr_resolve(message, recipient, reply)
+/*	QMGR_MESSAGE *message;
+/*	RECIPIENT *recipient;
+/*	RESOLVE_REPLY *reply;
+/* DESCRIPTION
+/*	This module resolves the recipients of an in-core message
+/*	without a resolver round trip per recipient.
+/*
+/*	qmgr_resolve() resolves the address of the specified recipient,
+/*	which must be a member of the message recipient list. When
+/*	the result is not already available, the recipient and up
+/*	to QMGR_RESOLVE_BATCH-1 recipients that follow it in the
+/*	(sorted) recipient list are resolved with one batch request
+/*	to the trivial-rewrite(8) server. The caller is expected to
+/*	walk the recipient list in order.
+/*
+/*	Results that the server flags as depending on the recipient
+/*	domain only are saved in a cache keyed by request class,
+/*	sender, and recipient domain. Other recipients in that domain
+/*	with a plain local-part are then resolved without asking the
+/*	server. Cache entries expire after QMGR_RESOLVE_TTL seconds,
+/*	the same as the resolver client's one-entry cache.
+/* DIAGNOSTICS
+/*	Panic: interface violation.
+/* SEE ALSO
+/*	resolve_clnt(3) address resolver client
+/* LICENSE
+/* .ad
+/* .fi
+/*	The Secure Mailer license must be distributed with this software.
+/*--*/
+
+/* System library. */
+
+#include <sys_defs.h>
+#include <string.h>
+#include <ctype.h>
+
+/* Utility library. */
+
+#include <msg.h>
+#include <mymalloc.h>
+#include <vstring.h>
+#include <htable.h>
+#include <events.h>
+
+/* Global library. */
+
+#include <mail_proto.h>
+#include <deliver_request.h>
+#include <resolve_clnt.h>
+
+/* Application-specific. */
+
+#include "qmgr.h"
+
+ /*
+  * Tunables. The batch size is a compromise between round-trip savings and
+  * wasted work when a message recipient list is cut short.
+  */
+#define QMGR_RESOLVE_BATCH	100	/* addresses per request */
+#define QMGR_RESOLVE_TTL	30	/* XXX make configurable */
+#define QMGR_RESOLVE_CACHE_SIZE	1000	/* max domain cache entries */
+
+static int qmgr_resolve_batch = QMGR_RESOLVE_BATCH;
+static int qmgr_resolve_cache_size = QMGR_RESOLVE_CACHE_SIZE;
+
+ /*
+  * Statistics, for the benchmark below.
+  */
+static long qmgr_resolve_requests;	/* batch requests sent */
+static long qmgr_resolve_queries;	/* addresses sent to server */
+static long qmgr_resolve_hits;		/* domain cache hits */
+
+ /*
+  * The domain cache.
+  */
+typedef struct {
+    char   *transport;			/* transport name */
+    char   *nexthop;			/* nexthop destination */
+    int     flags;			/* resolver flags */
+    time_t  expire;			/* time of expiration */
+} QMGR_RESOLVE_ENTRY;
+
+static HTABLE *qmgr_resolve_cache;
+static VSTRING *qmgr_resolve_key;
+
+ /*
+  * The batch window: results for consecutive recipients in one message
+  * recipient list, starting with qmgr_resolve_first. Each slot remembers
+  * its query address so that a stale window is never used.
+  */
+static const RECIPIENT *qmgr_resolve_list;
+static const char *qmgr_resolve_class;
+static VSTRING *qmgr_resolve_sender;
+static time_t qmgr_resolve_expire;
+static int qmgr_resolve_first;
+static int qmgr_resolve_count;
+static VSTRING *qmgr_resolve_query[QMGR_RESOLVE_BATCH];
+static RESOLVE_REPLY qmgr_resolve_window[QMGR_RESOLVE_BATCH];
+static RESOLVE_REPLY qmgr_resolve_reply[QMGR_RESOLVE_BATCH];
+
+#define STR	vstring_str
+
+/* qmgr_resolve_plain - can result be shared with other addresses */
+
+static const char *qmgr_resolve_plain(const char *addr)
+{
+    const char *cp;
+    const char *at;
+
+    /*
+     * Allow only a dot-atom local-part without routing operators or
+     * quoting, so that the resolver treats the local-part as an opaque
+     * string. Return the domain, or null.
+     */
+    if ((at = strrchr(addr, '@')) == 0 || at == addr || at[1] == 0
+	|| *addr == '-' || *addr == '.' || at[-1] == '.')
+	return (0);
+    for (cp = addr; cp < at; cp++) {
+	if (ISALNUM(*cp) || *cp == '+' || *cp == '-' || *cp == '=' || *cp == '_')
+	    continue;
+	if (*cp == '.' && cp[1] != '.')
+	    continue;
+	return (0);
+    }
+    return (at + 1);
+}
+
+/* qmgr_resolve_cache_key - generate domain cache lookup key */
+
+static const char *qmgr_resolve_cache_key(const char *class,
+					          const char *sender,
+					          const char *domain)
+{
+
+    /*
+     * The domain cannot contain '@', so the last '@' separates it from the
+     * sender; the class is a single-letter prefix.
+     */
+    vstring_sprintf(qmgr_resolve_key, "%c%s@%s", *class, sender, domain);
+    return (STR(qmgr_resolve_key));
+}
+
+/* qmgr_resolve_cache_free - destroy cache entry */
+
+static void qmgr_resolve_cache_free(void *ptr)
+{
+    QMGR_RESOLVE_ENTRY *entry = (QMGR_RESOLVE_ENTRY *) ptr;
+
+    myfree(entry->transport);
+    myfree(entry->nexthop);
+    myfree((void *) entry);
+}
+
+/* qmgr_resolve_cache_enter - save domain-wide result */
+
+static void qmgr_resolve_cache_enter(const char *key, RESOLVE_REPLY *reply)
+{
+    QMGR_RESOLVE_ENTRY *entry;
+
+    if (qmgr_resolve_cache_size <= 0)
+	return;
+
+    /*
+     * Keep the cache bounded. Domains are visited in sorted order, so there
+     * is no point in a more sophisticated replacement policy.
+     */
+    if (qmgr_resolve_cache->used >= qmgr_resolve_cache_size) {
+	htable_free(qmgr_resolve_cache, qmgr_resolve_cache_free);
+	qmgr_resolve_cache = htable_create(qmgr_resolve_cache_size);
+    }
+    if ((entry = (QMGR_RESOLVE_ENTRY *)
+	 htable_find(qmgr_resolve_cache, key)) == 0) {
+	entry = (QMGR_RESOLVE_ENTRY *) mymalloc(sizeof(*entry));
+	htable_enter(qmgr_resolve_cache, key, (void *) entry);
+    } else {
+	myfree(entry->transport);
+	myfree(entry->nexthop);
+    }
+    entry->transport = mystrdup(STR(reply->transport));
+    entry->nexthop = mystrdup(STR(reply->nexthop));
+    entry->flags = reply->flags & ~RESOLVE_FLAG_DOMAIN;
+    entry->expire = event_time() + QMGR_RESOLVE_TTL;
+}
+
+/* qmgr_resolve_cache_find - look up domain-wide result */
+
+static int qmgr_resolve_cache_find(const char *key, const char *addr,
+				           RESOLVE_REPLY *reply)
+{
+    QMGR_RESOLVE_ENTRY *entry;
+
+    if ((entry = (QMGR_RESOLVE_ENTRY *)
+	 htable_find(qmgr_resolve_cache, key)) == 0)
+	return (0);
+    if (entry->expire < event_time()) {
+	htable_delete(qmgr_resolve_cache, key, qmgr_resolve_cache_free);
+	return (0);
+    }
+    vstring_strcpy(reply->transport, entry->transport);
+    vstring_strcpy(reply->nexthop, entry->nexthop);
+    vstring_strcpy(reply->recipient, addr);
+    reply->flags = entry->flags;
+    qmgr_resolve_hits++;
+    return (1);
+}
+
+/* qmgr_resolve_copy - copy resolver result */
+
+static void qmgr_resolve_copy(RESOLVE_REPLY *to, RESOLVE_REPLY *from)
+{
+    vstring_strcpy(to->transport, STR(from->transport));
+    vstring_strcpy(to->nexthop, STR(from->nexthop));
+    vstring_strcpy(to->recipient, STR(from->recipient));
+    to->flags = from->flags & ~RESOLVE_FLAG_DOMAIN;
+}
+
+/* qmgr_resolve_fill - resolve window of recipients */
+
+static void qmgr_resolve_fill(QMGR_MESSAGE *message, RECIPIENT *recipient,
+			              const char *class)
+{
+    RECIPIENT_LIST *list = &message->rcpt_list;
+    const char *query[QMGR_RESOLVE_BATCH];
+    int     slot[QMGR_RESOLVE_BATCH];
+    const char *domain;
+    const char *key;
+    int     limit;
+    int     nquery;
+    int     n;
+
+    if (qmgr_resolve_cache == 0) {
+	qmgr_resolve_cache = htable_create(qmgr_resolve_cache_size);
+	qmgr_resolve_key = vstring_alloc(100);
+	qmgr_resolve_sender = vstring_alloc(100);
+	for (n = 0; n < QMGR_RESOLVE_BATCH; n++) {
+	    qmgr_resolve_query[n] = vstring_alloc(100);
+	    resolve_clnt_init(qmgr_resolve_window + n);
+	    resolve_clnt_init(qmgr_resolve_reply + n);
+	}
+    }
+
+    /*
+     * With a redirect, only the first recipient is resolved.
+     */
+    qmgr_resolve_list = list->info;
+    qmgr_resolve_class = class;
+    vstring_strcpy(qmgr_resolve_sender, message->sender);
+    qmgr_resolve_expire = event_time() + QMGR_RESOLVE_TTL;
+    qmgr_resolve_first = recipient - list->info;
+    limit = message->redirect_addr ? 1 : qmgr_resolve_batch;
+    if (limit > list->len - qmgr_resolve_first)
+	limit = list->len - qmgr_resolve_first;
+
+    /*
+     * Look up recipients in the domain cache, and collect the rest for a
+     * batch request.
+     */
+    for (nquery = n = 0; n < limit; n++, recipient++) {
+	vstring_strcpy(qmgr_resolve_query[n], recipient->address);
+	if ((domain = qmgr_resolve_plain(recipient->address)) == 0
+	    || qmgr_resolve_cache_find(qmgr_resolve_cache_key(class,
+						  message->sender, domain),
+				       recipient->address,
+				       qmgr_resolve_window + n) == 0) {
+	    query[nquery] = STR(qmgr_resolve_query[n]);
+	    slot[nquery++] = n;
+	}
+    }
+    qmgr_resolve_count = limit;
+    if (nquery == 0)
+	return;
+
+    /*
+     * One round trip for the remainder. Remember domain-wide results.
+     */
+    qmgr_resolve_requests++;
+    qmgr_resolve_queries += nquery;
+    resolve_clnt_batch(class, message->sender, nquery, query,
+		       qmgr_resolve_reply);
+    for (n = 0; n < nquery; n++) {
+	if ((qmgr_resolve_reply[n].flags & RESOLVE_FLAG_DOMAIN)
+	    && (domain = qmgr_resolve_plain(query[n])) != 0) {
+	    key = qmgr_resolve_cache_key(class, message->sender, domain);
+	    qmgr_resolve_cache_enter(key, qmgr_resolve_reply + n);
+	}
+	qmgr_resolve_copy(qmgr_resolve_window + slot[n], qmgr_resolve_reply + n);
+    }
+}
+
+/* qmgr_resolve - resolve one recipient of a message */
+
+void    qmgr_resolve(QMGR_MESSAGE *message, RECIPIENT *recipient,
+		             RESOLVE_REPLY *reply)
+{
+    const char *myname = "qmgr_resolve";
+    RECIPIENT_LIST *list = &message->rcpt_list;
+    const char *class;
+    int     n;
+
+    /*
+     * Sanity check.
+     */
+    if (recipient < list->info || recipient >= list->info + list->len)
+	msg_panic("%s: recipient not in message recipient list", myname);
+
+    /*
+     * Use the window if it has this recipient; a cut-short recipient list
+     * is refilled into the same memory, so compare the address, too.
+     */
+    class = (message->tflags & DEL_REQ_FLAG_MTA_VRFY) ?
+	RESOLVE_VERIFY : RESOLVE_REGULAR;
+    n = recipient - list->info - qmgr_resolve_first;
+    if (qmgr_resolve_list != list->info
+	|| n < 0 || n >= qmgr_resolve_count
+	|| qmgr_resolve_class != class
+	|| strcmp(STR(qmgr_resolve_sender), message->sender) != 0
+	|| strcmp(STR(qmgr_resolve_query[n]), recipient->address) != 0
+	|| qmgr_resolve_expire < event_time()) {
+	qmgr_resolve_fill(message, recipient, class);
+	n = 0;
+    }
+    qmgr_resolve_copy(reply, qmgr_resolve_window + n);
+    if (msg_verbose)
+	msg_info("%s: %s -> transp=%s host=%s rcpt=%s flags=0x%x",
+		 myname, recipient->address, STR(reply->transport),
+		 STR(reply->nexthop), STR(reply->recipient), reply->flags);
+}
+
+#ifdef TEST
+
+ /*
+  * Benchmark: resolve a large fan-out message against a stub resolver
+  * server that listens on private/rewrite in a scratch directory. The stub
+  * answers (smtp, domain, address) for every address, and flags batch
+  * results as domain-wide the way trivial-rewrite does when no transport
+  * or relocated table is configured. The output counts the resolver round
+  * trips, the addresses sent to the server, and domain cache hits; -t adds
+  * the elapsed time. With -f the stub hangs up on the first batch request,
+  * and reports when the client sends batch requests again.
+  */
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <signal.h>
+#include <msg_vstream.h>
+#include <argv.h>
+#include <listen.h>
+#include <iostuff.h>
+#include <vstream.h>
+#include <mail_params.h>
+
+static NORETURN usage(char *myname)
+{
+    msg_fatal("usage: %s [-b batch] [-c cache_size] [-d domains] [-n recipients] [-f] [-o] [-t] [-v]",
+	      myname);
+}
+
+/* stub_reply - send one stub result */
+
+static void stub_reply(VSTREAM *stream, int flags, const char *addr, int more)
+{
+    const char *domain = strrchr(addr, '@');
+
+    attr_print(stream, more ? ATTR_FLAG_MORE : ATTR_FLAG_NONE,
+	       SEND_ATTR_STR(MAIL_ATTR_TRANSPORT, "smtp"),
+	       SEND_ATTR_STR(MAIL_ATTR_NEXTHOP, domain ? domain + 1 : ""),
+	       SEND_ATTR_STR(MAIL_ATTR_RECIP, addr),
+	       SEND_ATTR_INT(MAIL_ATTR_FLAGS, flags | RESOLVE_CLASS_DEFAULT),
+	       ATTR_TYPE_END);
+}
+
+/* stub_server - answer resolver requests */
+
+#define STUB_BATCH_NONE		0	/* old server */
+#define STUB_BATCH_OK		1	/* answer batch requests */
+#define STUB_BATCH_FLAKY	2	/* fail the first batch request */
+
+static NORETURN stub_server(int listen_fd, int batch_ok)
+{
+    VSTRING *req = vstring_alloc(100);
+    VSTRING *sender = vstring_alloc(100);
+    VSTRING *addr = vstring_alloc(100);
+    ARGV   *batch = argv_alloc(10);
+    VSTREAM *stream;
+    int     count;
+    int     failed = 0;
+    int     fd;
+    int     n;
+
+    for (;;) {
+	if ((fd = accept(listen_fd, (struct sockaddr *) 0, (SOCKADDR_SIZE *) 0)) < 0)
+	    msg_fatal("accept: %m");
+	stream = vstream_fdopen(fd, O_RDWR);
+	attr_print(stream, ATTR_FLAG_NONE,
+		   SEND_ATTR_STR(MAIL_ATTR_PROTO, MAIL_ATTR_PROTO_TRIVIAL),
+		   ATTR_TYPE_END);
+	vstream_fflush(stream);
+	while (attr_scan(stream, ATTR_FLAG_STRICT | ATTR_FLAG_MORE,
+			 RECV_ATTR_STR(MAIL_ATTR_REQ, req),
+			 ATTR_TYPE_END) == 1) {
+	    if (strcmp(STR(req), RESOLVE_REGULAR) == 0) {
+		if (attr_scan(stream, ATTR_FLAG_STRICT,
+			      RECV_ATTR_STR(MAIL_ATTR_SENDER, sender),
+			      RECV_ATTR_STR(MAIL_ATTR_ADDR, addr),
+			      ATTR_TYPE_END) != 2)
+		    break;
+		attr_print(stream, ATTR_FLAG_MORE,
+			   SEND_ATTR_INT(MAIL_ATTR_FLAGS, 0),
+			   ATTR_TYPE_END);
+		stub_reply(stream, 0, STR(addr), 0);
+	    } else if (batch_ok && strcmp(STR(req), RESOLVE_REGULAR_BATCH) == 0) {
+		if (attr_scan(stream, ATTR_FLAG_STRICT | ATTR_FLAG_MORE,
+			      RECV_ATTR_STR(MAIL_ATTR_SENDER, sender),
+			      RECV_ATTR_INT(MAIL_ATTR_NREQ, &count),
+			      ATTR_TYPE_END) != 2
+		    || count < 1 || count > RESOLVE_BATCH_LIMIT)
+		    break;
+		argv_truncate(batch, 0);
+		for (n = 0; n < count; n++) {
+		    if (attr_scan(stream, n < count - 1 ?
+			      ATTR_FLAG_STRICT | ATTR_FLAG_MORE : ATTR_FLAG_STRICT,
+				  RECV_ATTR_STR(MAIL_ATTR_ADDR, addr),
+				  ATTR_TYPE_END) != 1)
+			break;
+		    argv_add(batch, STR(addr), (char *) 0);
+		}
+		if (n < count)
+		    break;
+		if (batch_ok == STUB_BATCH_FLAKY) {
+		    batch_ok = STUB_BATCH_OK;
+		    failed = 1;
+		    break;
+		}
+		if (failed) {
+		    vstream_fprintf(VSTREAM_ERR, "stub: batch requests resumed\n");
+		    vstream_fflush(VSTREAM_ERR);
+		    failed = 0;
+		}
+		attr_print(stream, ATTR_FLAG_MORE,
+			   SEND_ATTR_INT(MAIL_ATTR_FLAGS, 0),
+			   SEND_ATTR_INT(MAIL_ATTR_NREQ, count),
+			   ATTR_TYPE_END);
+		for (n = 0; n < count; n++)
+		    stub_reply(stream, RESOLVE_FLAG_DOMAIN, batch->argv[n],
+			       n < count - 1);
+	    } else {
+		break;
+	    }
+	    if (vstream_fflush(stream) != 0)
+		break;
+	}
+	(void) vstream_fclose(stream);
+    }
+}
+
+int     main(int argc, char **argv)
+{
+    QMGR_MESSAGE message;
+    RESOLVE_REPLY reply;
+    VSTRING *addr = vstring_alloc(100);
+    VSTRING *dir = vstring_alloc(100);
+    struct timeval start;
+    struct timeval done;
+    RECIPIENT *rcpt;
+    int     recipients = 50000;
+    int     domains = 100;
+    int     batch_ok = STUB_BATCH_OK;
+    int     show_time = 0;
+    int     listen_fd;
+    int     errors = 0;
+    pid_t   pid;
+    int     ch;
+    int     n;
+
+    msg_vstream_init(argv[0], VSTREAM_ERR);
+    while ((ch = GETOPT(argc, argv, "b:c:d:fn:otv")) > 0) {
+	switch (ch) {
+	case 'b':
+	    if ((qmgr_resolve_batch = atoi(optarg)) < 1
+		|| qmgr_resolve_batch > QMGR_RESOLVE_BATCH)
+		msg_fatal("batch size must be 1..%d", QMGR_RESOLVE_BATCH);
+	    break;
+	case 'c':
+	    if ((qmgr_resolve_cache_size = atoi(optarg)) < 0)
+		usage(argv[0]);
+	    break;
+	case 'd':
+	    if ((domains = atoi(optarg)) < 1)
+		usage(argv[0]);
+	    break;
+	case 'f':
+	    batch_ok = STUB_BATCH_FLAKY;
+	    break;
+	case 'n':
+	    if ((recipients = atoi(optarg)) < 1)
+		usage(argv[0]);
+	    break;
+	case 'o':
+	    batch_ok = STUB_BATCH_NONE;
+	    break;
+	case 't':
+	    show_time = 1;
+	    break;
+	case 'v':
+	    msg_verbose++;
+	    break;
+	default:
+	    usage(argv[0]);
+	}
+    }
+    var_rewrite_service = DEF_REWRITE_SERVICE;
+    var_ipc_timeout = 3600;
+    var_ipc_idle_limit = 3600;
+    var_ipc_ttl_limit = 3600;
+
+    /*
+     * Start the stub server in a private scratch directory.
+     */
+    vstring_sprintf(dir, "qmgr_resolve.%ld", (long) getpid());
+    if (mkdir(STR(dir), 0700) < 0 || chdir(STR(dir)) < 0
+	|| mkdir(MAIL_CLASS_PRIVATE, 0700) < 0)
+	msg_fatal("create directory %s/%s: %m", STR(dir), MAIL_CLASS_PRIVATE);
+    listen_fd = unix_listen(MAIL_CLASS_PRIVATE "/" DEF_REWRITE_SERVICE,
+			    10, BLOCKING);
+    if ((pid = fork()) < 0)
+	msg_fatal("fork: %m");
+    if (pid == 0)
+	stub_server(listen_fd, batch_ok);
+    (void) close(listen_fd);
+
+    /*
+     * A message with recipients spread evenly over the domains, in the
+     * order that qmgr_message_sort() would produce. A cache size of zero
+     * disables the domain cache.
+     */
+    memset((void *) &message, 0, sizeof(message));
+    message.sender = "";
+    recipient_list_init(&message.rcpt_list, RCPT_LIST_INIT_QUEUE);
+    for (n = 0; n < recipients; n++) {
+	vstring_sprintf(addr, "user%d@domain%ld.example",
+			n, (long) n * domains / recipients);
+	recipient_list_add(&message.rcpt_list, n, "", 0, "", STR(addr));
+    }
+
+    resolve_clnt_init(&reply);
+    GETTIMEOFDAY(&start);
+    for (rcpt = message.rcpt_list.info;
+	 rcpt < message.rcpt_list.info + message.rcpt_list.len; rcpt++) {
+	qmgr_resolve(&message, rcpt, &reply);
+	if (strcmp(STR(reply.transport), "smtp") != 0
+	    || strcmp(STR(reply.nexthop), strrchr(rcpt->address, '@') + 1) != 0
+	    || strcmp(STR(reply.recipient), rcpt->address) != 0
+	    || reply.flags != RESOLVE_CLASS_DEFAULT)
+	    errors++;
+    }
+    GETTIMEOFDAY(&done);
+
+    vstream_printf("recipients %d domains %d batch %d requests %ld"
+		   " queries %ld hits %ld errors %d\n",
+		   recipients, domains, qmgr_resolve_batch,
+		   qmgr_resolve_requests, qmgr_resolve_queries,
+		   qmgr_resolve_hits, errors);
+    if (show_time)
+	vstream_printf("elapsed %.3f s\n", done.tv_sec - start.tv_sec
+		       + (done.tv_usec - start.tv_usec) / 1000000.0);
+    vstream_fflush(VSTREAM_OUT);
+
+    /*
+     * Clean up.
+     */
+    (void) kill(pid, SIGTERM);
+    (void) waitpid(pid, (WAIT_STATUS_T *) 0, 0);
+    (void) unlink(MAIL_CLASS_PRIVATE "/" DEF_REWRITE_SERVICE);
+    (void) rmdir(MAIL_CLASS_PRIVATE);
+    (void) chdir("..");
+    (void) rmdir(STR(dir));
+    exit(errors != 0);
+}
+
+#endif
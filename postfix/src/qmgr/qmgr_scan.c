@@ -24,7 +24,8 @@
 /*	but does not start a queue scan.
 /*
 /*	qmgr_scan_next() returns the base name of the next queue file.
-/*	A null pointer means that no file was found. qmgr_scan_next()
+/*	Queue files that belong to a different queue manager shard
+/*	are skipped. A null pointer means that no file was found. qmgr_scan_next()
 /*	automagically restarts a queue scan when a scan request had
 /*	arrived while the scan was in progress.
 /*
@@ -149,6 +150,18 @@ void    qmgr_scan_request(QMGR_SCAN *scan_info, int flags)
     }
 }
 
+/* qmgr_scan_dir_next - next queue file that belongs to this queue manager */
+
+static char *qmgr_scan_dir_next(QMGR_SCAN *scan_info)
+{
+    char   *path;
+
+    while ((path = mail_scan_dir_next(scan_info->handle)) != 0
+	   && !qmgr_shard_owns(path))
+	 /* void */ ;
+    return (path);
+}
+
 /* qmgr_scan_next - look for next queue file */
 
 char   *qmgr_scan_next(QMGR_SCAN *scan_info)
@@ -159,14 +172,14 @@ char   *qmgr_scan_next(QMGR_SCAN *scan_info)
      * Restart the scan if we reach the end and a queue scan request has
      * arrived in the mean time.
      */
-    if (scan_info->handle && (path = mail_scan_dir_next(scan_info->handle)) == 0) {
+    if (scan_info->handle && (path = qmgr_scan_dir_next(scan_info)) == 0) {
 	scan_info->handle = scan_dir_close(scan_info->handle);
 	if (msg_verbose && (scan_info->nflags & QMGR_SCAN_START) == 0)
 	    msg_info("done %s queue scan", scan_info->queue);
     }
     if (!scan_info->handle && (scan_info->nflags & QMGR_SCAN_START)) {
 	qmgr_scan_start(scan_info);
-	path = mail_scan_dir_next(scan_info->handle);
+	path = qmgr_scan_dir_next(scan_info);
     }
     return (path);
 }
@@ -0,0 +1,352 @@
+/*++
+/* NAME
+/*	qmgr_shard 3
+/* SUMMARY
+/*	split the mail queue over multiple queue manager processes
+/* SYNOPSIS
+/*	#include "qmgr.h"
+/*
+/*	int	qmgr_shard_count;
+/*	int	qmgr_shard_index;
+/*
+/*	void	qmgr_shard_init(service_list, service_name)
+/*	const char *service_list;
+/*	const char *service_name;
+/*
+/*	int	qmgr_shard_owns(queue_id)
+/*	const char *queue_id;
+/*
+/*	int	qmgr_shard_limit(limit)
+/*	int	limit;
+/*
+/*	void	qmgr_shard_check(dest_con_limit, dest_rate_delay,
+/*				xport_rate_delay)
+/*	int	dest_con_limit;
+/*	int	dest_rate_delay;
+/*	int	xport_rate_delay;
+/*
+/*	void	qmgr_shard_relay(request, len)
+/*	const char *request;
+/*	ssize_t	len;
+/* DESCRIPTION
+/*	This module allows a number of queue manager processes to
+/*	share one Postfix queue, so that scheduling work is not
+/*	limited by the speed of one CPU. Each queue manager instance
+/*	runs as its own master.cf service, and owns the queue files
+/*	whose queue ID hashes to its shard index. A queue manager
+/*	instance never opens, moves or removes a queue file that
+/*	belongs to another shard.
+/*
+/*	Queue files, not recipient destinations, are the unit of
+/*	ownership: a queue file can be delivered, deferred or removed
+/*	only as a whole, so splitting it by destination would require
+/*	coordination between queue manager processes for every
+/*	message. Destinations with mail in multiple shards are
+/*	scheduled independently by each shard.
+/*
+/*	Global resource limits are enforced as follows. Delivery
+/*	agent process limits (master.cf) are naturally shared by
+/*	all shards. The active queue message and recipient limits,
+/*	and the per-destination concurrency limits, are divided
+/*	evenly over the shards with qmgr_shard_limit(). Because
+/*	each share is rounded up, the shards together may exceed a
+/*	limit that is not a multiple of the shard count, by up to
+/*	the shard count minus one. For example, a destination
+/*	concurrency limit of 5 with 4 shards allows up to 8 parallel
+/*	deliveries to one destination.
+/*
+/*	Rate delays and a destination concurrency limit of 1 cannot
+/*	be divided: each shard would deliver at the full rate, or
+/*	with its own serial connection. Because a destination's
+/*	mail is spread over all shards, these are refused at startup
+/*	with qmgr_shard_check().
+/*
+/*	qmgr_shard_init() determines the shard count and the shard
+/*	index of this process. The shard count is the number of
+/*	services in service_list; the shard index is the position
+/*	of service_name in that list. An empty service_list means
+/*	there is only one queue manager.
+/*
+/*	qmgr_shard_owns() returns non-zero if the named queue file
+/*	belongs to this queue manager instance. The mapping depends
+/*	only on the queue ID and the shard count, so that all
+/*	instances agree on it.
+/*
+/*	qmgr_shard_limit() returns this instance's share of a global
+/*	limit, rounded up. A zero (unlimited) limit is returned
+/*	unchanged. The result is never less than one.
+/*
+/*	qmgr_shard_check() terminates the program with a fatal error
+/*	when there is more than one shard, and the default settings
+/*	(specified with the arguments), or the settings of any transport that has its own destination
+/*	concurrency limit or rate delay parameter, specify a
+/*	destination concurrency limit of 1, or a non-zero destination
+/*	or transport rate delay. This must be called after the
+/*	configuration is read, and before any transport is used, so
+/*	that the program never terminates in the middle of a delivery.
+/*
+/*	qmgr_shard_relay() forwards a trigger request to all other
+/*	queue manager instances. Other Postfix programs notify only
+/*	the first service in the shard list ($queue_service_name),
+/*	and that instance passes on the request.
+/* DIAGNOSTICS
+/*	Fatal: this service name is not listed in the shard service
+/*	list; a destination concurrency limit of 1 or a rate delay
+/*	with more than one shard. Warning: unable to relay a trigger
+/*	request.
+/* SEE ALSO
+/*	mail_trigger(3), trigger a mail service
+/* LICENSE
+/* .ad
+/* .fi
+/*	The Secure Mailer license must be distributed with this software.
+/*--*/
+
+/* System library. */
+
+#include <sys_defs.h>
+#include <string.h>
+
+/* Utility library. */
+
+#include <msg.h>
+#include <argv.h>
+#include <dict.h>
+#include <stringops.h>
+
+/* Global library. */
+
+#include <mail_proto.h>
+#include <mail_params.h>
+#include <mail_conf.h>
+
+/* Application-specific. */
+
+#include "qmgr.h"
+
+int     qmgr_shard_count = 1;
+int     qmgr_shard_index = 0;
+
+static ARGV *qmgr_shard_services;
+
+/* qmgr_shard_hash - hash queue ID, identical in all processes */
+
+static unsigned qmgr_shard_hash(const char *queue_id)
+{
+    unsigned long h = 2166136261UL;
+
+    /*
+     * FNV-1a. We cannot use hash_fnv(3), because that is seeded differently
+     * in each process. Queue IDs have long runs of characters in common,
+     * so we must use all input bytes.
+     */
+    while (*queue_id)
+	h = ((h ^ (unsigned char) *queue_id++) * 16777619UL) & 0xffffffffUL;
+    return (h);
+}
+
+/* qmgr_shard_init - determine shard count and index */
+
+void    qmgr_shard_init(const char *service_list, const char *service_name)
+{
+    int     n;
+
+    qmgr_shard_services = argv_split(service_list, CHARS_COMMA_SP);
+    if (qmgr_shard_services->argc <= 1) {
+	qmgr_shard_count = 1;
+	qmgr_shard_index = 0;
+	return;
+    }
+    for (n = 0; n < qmgr_shard_services->argc; n++)
+	if (strcmp(qmgr_shard_services->argv[n], service_name) == 0)
+	    break;
+    if (n >= qmgr_shard_services->argc)
+	msg_fatal("service \"%s\" is not listed in %s = %s",
+		  service_name, VAR_QMGR_SHARD_SERVICES, service_list);
+    qmgr_shard_count = qmgr_shard_services->argc;
+    qmgr_shard_index = n;
+    msg_info("queue manager shard %d of %d", qmgr_shard_index + 1,
+	     qmgr_shard_count);
+}
+
+/* qmgr_shard_owns - does this queue file belong to us */
+
+int     qmgr_shard_owns(const char *queue_id)
+{
+    if (qmgr_shard_count <= 1)
+	return (1);
+    return (qmgr_shard_hash(queue_id) % qmgr_shard_count == qmgr_shard_index);
+}
+
+/* qmgr_shard_limit - our share of a global limit */
+
+int     qmgr_shard_limit(int limit)
+{
+    if (qmgr_shard_count <= 1 || limit <= 0)
+	return (limit);
+    return ((limit + qmgr_shard_count - 1) / qmgr_shard_count);
+}
+
+/* qmgr_shard_check_one - refuse limits that cannot be divided */
+
+static void qmgr_shard_check_one(const char *name, int dest_con_limit,
+			              int dest_rate_delay, int xport_rate_delay)
+{
+    if (get_mail_conf_int2(name, _DEST_CON_LIMIT, dest_con_limit, 0, 0) == 1)
+	msg_fatal("%s%s = 1 requires a single queue manager, but %s lists "
+		  "%d services", name, _DEST_CON_LIMIT,
+		  VAR_QMGR_SHARD_SERVICES, qmgr_shard_count);
+    if (get_mail_conf_time2(name, _DEST_RATE_DELAY, dest_rate_delay,
+			    's', 0, 0) > 0)
+	msg_fatal("a non-zero %s%s requires a single queue manager, but %s "
+		  "lists %d services", name, _DEST_RATE_DELAY,
+		  VAR_QMGR_SHARD_SERVICES, qmgr_shard_count);
+    if (get_mail_conf_time2(name, _XPORT_RATE_DELAY, xport_rate_delay,
+			    's', 0, 0) > 0)
+	msg_fatal("a non-zero %s%s requires a single queue manager, but %s "
+		  "lists %d services", name, _XPORT_RATE_DELAY,
+		  VAR_QMGR_SHARD_SERVICES, qmgr_shard_count);
+}
+
+/* qmgr_shard_check - refuse limits that cannot be divided */
+
+void    qmgr_shard_check(int dest_con_limit, int dest_rate_delay,
+			         int xport_rate_delay)
+{
+    static const char *suffixes[] = {
+	_DEST_CON_LIMIT, _DEST_RATE_DELAY, _XPORT_RATE_DELAY, 0,
+    };
+    const char **cpp;
+    ARGV   *names;
+    DICT   *dict;
+    const char *param_name;
+    const char *param_value;
+    ssize_t len;
+    ssize_t suffix_len;
+    int     how;
+    int     n;
+
+    if (qmgr_shard_count <= 1)
+	return;
+
+    /*
+     * Transports are created when mail for them first arrives. Find all
+     * transports that have their own settings now, instead of terminating
+     * in the middle of a delivery. Don't look up parameters while iterating
+     * over the configuration dictionary; a lookup may update it.
+     */
+    if ((dict = dict_handle(CONFIG_DICT)) == 0)
+	msg_panic("qmgr_shard_check: parameter dictionary %s not found",
+		  CONFIG_DICT);
+    names = argv_alloc(10);
+    argv_add(names, "default", (char *) 0);
+    for (how = DICT_SEQ_FUN_FIRST;
+	 dict->sequence(dict, how, &param_name, &param_value) == 0;
+	 how = DICT_SEQ_FUN_NEXT) {
+	len = strlen(param_name);
+	for (cpp = suffixes; *cpp; cpp++) {
+	    suffix_len = strlen(*cpp);
+	    if (len > suffix_len
+		&& strcmp(param_name + len - suffix_len, *cpp) == 0) {
+		argv_addn(names, param_name, len - suffix_len, (char *) 0);
+		break;
+	    }
+	}
+    }
+    argv_qsort(names, (ARGV_COMPAR_FN) 0);
+    argv_uniq(names, (ARGV_COMPAR_FN) 0);
+    for (n = 0; n < names->argc; n++)
+	qmgr_shard_check_one(names->argv[n], dest_con_limit,
+			     dest_rate_delay, xport_rate_delay);
+    argv_free(names);
+}
+
+/* qmgr_shard_relay - pass on trigger request to other shards */
+
+void    qmgr_shard_relay(const char *request, ssize_t len)
+{
+    int     n;
+
+    if (qmgr_shard_count <= 1 || qmgr_shard_index != 0)
+	return;
+    for (n = 1; n < qmgr_shard_count; n++)
+	if (mail_trigger(MAIL_CLASS_PUBLIC, qmgr_shard_services->argv[n],
+			 request, len) < 0)
+	    msg_warn("unable to relay trigger to %s service %s",
+		     MAIL_CLASS_PUBLIC, qmgr_shard_services->argv[n]);
+}
+
+#ifdef TEST
+
+ /*
+  * Proof-of-concept test program: distribute synthetic queue IDs over the
+  * shards, and report how evenly the work is spread. Usage: qmgr_shard
+  * shard-count [queue-id-count].
+  */
+#include <stdlib.h>
+#include <vstream.h>
+#include <vstring.h>
+#include <mymalloc.h>
+#include <msg_vstream.h>
+
+int     main(int argc, char **argv)
+{
+    VSTRING *service_list = vstring_alloc(100);
+    VSTRING *queue_id = vstring_alloc(100);
+    unsigned long usec;
+    unsigned long inum;
+    long    count = 1000000;
+    long   *owned;
+    long    min;
+    long    max;
+    long    n;
+    int     shards;
+    int     i;
+
+    msg_vstream_init(argv[0], VSTREAM_ERR);
+    if (argc < 2 || (shards = atoi(argv[1])) < 1)
+	msg_fatal("usage: %s shard-count [queue-id-count]", argv[0]);
+    if (argc > 2 && (count = atol(argv[2])) < 1)
+	msg_fatal("bad queue-id-count: %s", argv[2]);
+    owned = (long *) mymalloc(sizeof(*owned) * shards);
+    for (i = 0; i < shards; i++)
+	vstring_sprintf_append(service_list, "%sqmgr%d", i ? ", " : "", i);
+
+    /*
+     * Emulate one queue manager instance per shard. The queue IDs have the
+     * short format: five hex digits of microseconds followed by the hex
+     * inode number. Inode numbers are recycled by the file system, and the
+     * time stamp advances a few microseconds per message.
+     */
+    for (i = 0; i < shards; i++) {
+	vstring_sprintf(queue_id, "qmgr%d", i);
+	qmgr_shard_init(vstring_str(service_list), vstring_str(queue_id));
+	for (usec = 0, owned[i] = n = 0; n < count; n++) {
+	    usec = (usec + 7) % 1000000;
+	    inum = 131072 + n % 4096;
+	    vstring_sprintf(queue_id, "%05lX%lX", usec, inum);
+	    owned[i] += qmgr_shard_owns(vstring_str(queue_id));
+	}
+	argv_free(qmgr_shard_services);
+    }
+    for (min = max = owned[0], n = i = 0; i < shards; i++) {
+	vstream_printf("shard %d: %ld\n", i, owned[i]);
+	if (owned[i] < min)
+	    min = owned[i];
+	if (owned[i] > max)
+	    max = owned[i];
+	n += owned[i];
+    }
+    vstream_printf("total %ld, imbalance %.2f%%\n", n,
+		   n ? 100.0 * (max - min) * shards / n : 0.0);
+    vstream_fflush(VSTREAM_OUT);
+    if (n != count)
+	msg_fatal("queue file ownership is not a partition: %ld != %ld",
+		  n, count);
+    myfree((void *) owned);
+    vstring_free(service_list);
+    vstring_free(queue_id);
+    return (0);
+}
+
+#endif
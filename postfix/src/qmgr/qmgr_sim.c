@@ -0,0 +1,1351 @@
+/*++
+/* NAME
+/*	qmgr_sim 1
+/* SUMMARY
+/*	deterministic queue manager scheduler simulation
+/* SYNOPSIS
+/* .fi
+/*	\fBqmgr_sim\fR [\fB-v\fR] <\fIworkload\fR
+/* DESCRIPTION
+/*	The \fBqmgr_sim\fR command runs the queue manager's in-core
+/*	scheduler (transports, destination queues, jobs, peers and
+/*	queue entries) against a synthetic mail queue and simulated
+/*	delivery agents, using a simulated clock. No queue files,
+/*	delivery agents or network connections are involved, so that
+/*	a run takes seconds even when it simulates hours of delivery,
+/*	and the results are reproducible for a given workload.
+/*
+/*	The program links with the same scheduler modules as the
+/*	\fBqmgr\fR(8) daemon, and replaces only the queue file I/O,
+/*	address resolution, delivery agent communication and the
+/*	event loop. The simulation mirrors qmgr_active_feed(),
+/*	qmgr_active_drain(), qmgr_deliver() and the completion
+/*	handling in qmgr_deliver_update(), including concurrency
+/*	feedback, destination throttling and the reading of large
+/*	recipient lists in chunks.
+/*
+/*	The workload is read from standard input. Empty lines and
+/*	text after "#" are ignored. Each line is one of:
+/* .IP "\fIname\fR = \fIvalue\fR"
+/*	Set a main.cf parameter. This is how one configures the
+/*	scheduler, for example \fBdefault_destination_concurrency_limit\fR
+/*	or \fIsmtp\fB_delivery_slot_cost\fR.
+/* .IP "\fBseed \fInumber\fR"
+/*	Seed the pseudo-random number generator (default: 1).
+/* .IP "\fBstop \fIseconds\fR"
+/*	Stop the simulation at the specified simulated time (default:
+/*	one week). Mail that is not delivered by then is reported as
+/*	unfinished.
+/* .IP "\fBtransport \fIname\fR \fBagents \fIcount\fR"
+/*	The delivery agent process limit for the named transport
+/*	(default: 100), as with the master.cf maxproc field.
+/* .IP "\fBsite \fIname\fR [\fIattribute value\fR ...]"
+/*	Define the behavior of a destination. The attributes are:
+/* .RS
+/* .IP "\fBlatency \fIseconds\fR"
+/*	The average delivery transaction time (default: 1).
+/* .IP "\fBspread \fIfraction\fR"
+/*	Delivery times are uniformly distributed within this fraction
+/*	of the average (default: 0.5).
+/* .IP "\fBper_rcpt \fIseconds\fR"
+/*	Additional time per recipient in a delivery request (default: 0).
+/* .IP "\fBcapacity \fIcount\fR"
+/*	When more than this many deliveries are in progress, each
+/*	delivery slows down proportionally (default: 0, no limit).
+/* .IP "\fBlimit \fIcount\fR"
+/*	When more than this many deliveries are in progress, the
+/*	site refuses service, and all recipients in the request are
+/*	deferred with a reason (default: 0, no limit).
+/* .IP "\fBdefer \fIpercent\fR"
+/*	Recipients are deferred without a reason with this
+/*	probability (default: 0).
+/* .IP "\fBdown \fIpercent\fR"
+/*	Delivery requests fail with a reason with this probability
+/*	(default: 0).
+/* .IP "\fBstall \fIpercent seconds\fR"
+/*	Delivery requests take the specified time with this
+/*	probability, as with a non-responding server (default: 0).
+/* .RE
+/* .IP "\fBmail \fIclass\fR [\fIattribute value\fR ...]"
+/*	Inject mail. The attributes are:
+/* .RS
+/* .IP "\fBcount \fInumber\fR"
+/*	The number of messages (default: 1).
+/* .IP "\fBrcpt \fInumber\fR"
+/*	The number of recipients per message (default: 1).
+/* .IP "\fBat \fIseconds\fR"
+/*	The arrival time of the first message (default: 0).
+/* .IP "\fBevery \fIseconds\fR"
+/*	The interval between message arrivals (default: 0).
+/* .IP "\fBtransport \fIname\fR"
+/*	The message delivery transport (default: smtp).
+/* .IP "\fBsite \fIname\fR[,\fIname\fR...]"
+/*	The recipient destinations. Recipients are divided evenly
+/*	over the destinations, and each message starts with the next
+/*	destination in the list. This attribute is required.
+/* .RE
+/* .PP
+/*	When all mail is delivered, the program reports the simulated
+/*	time, the throughput in delivered recipients per second,
+/*	delivery agent utilization, and per mail class the number of
+/*	recipients and their delivery delays (arrival to delivery)
+/*	at the 50th, 90th and 99th percentile. The fairness line
+/*	shows Jain's fairness index over the mean delivery delay of
+/*	each mail class: 1 means all classes see the same delay.
+/*	Per destination, the program reports the number of delivery
+/*	requests, the average and peak concurrency, and the average
+/*	and peak concurrency window. Finally, the program reports
+/*	the scheduler's candidate cache statistics.
+/*
+/*	Options:
+/* .IP \fB-v\fR
+/*	Enable verbose logging for debugging purposes. Multiple
+/*	\fB-v\fR options make the software increasingly verbose.
+/* DIAGNOSTICS
+/*	Problems are reported to the standard error stream.
+/* BUGS
+/*	Deferred mail is retried after the same backoff time as
+/*	with \fBqmgr\fR(8), but the deferred queue is not scanned
+/*	periodically, and \fBqueue_run_delay\fR is ignored.
+/*
+/*	Rate-delayed destinations and transports are scheduled, but
+/*	the retry(8) and error(8) pseudo transports are not simulated.
+/* SEE ALSO
+/*	qmgr(8), queue manager
+/* LICENSE
+/* .ad
+/* .fi
+/*	The Secure Mailer license must be distributed with this software.
+/*--*/
+
+/* System library. */
+
+#include <sys_defs.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+/* Utility library. */
+
+#include <msg.h>
+#include <msg_vstream.h>
+#include <mymalloc.h>
+#include <argv.h>
+#include <vstream.h>
+#include <vstring.h>
+#include <vstring_vstream.h>
+#include <stringops.h>
+#include <htable.h>
+#include <events.h>
+#include <sane_time.h>
+
+/* Global library. */
+
+#include <mail_conf.h>
+#include <mail_params.h>
+#include <mail_queue.h>
+#include <recipient_list.h>
+#include <dsn.h>
+#include <mail_version.h>
+
+/* Application-specific. */
+
+#include "qmgr.h"
+
+ /*
+  * The scheduler configuration, as in qmgr.c.
+  */
+int     var_queue_run_delay;
+int     var_min_backoff_time;
+int     var_max_backoff_time;
+int     var_transport_retry_time;
+int     var_qmgr_clog_warn_time;
+int     var_xport_refill_delay;
+int     var_xport_rate_delay;
+int     var_dest_rate_delay;
+int     var_qmgr_active_limit;
+int     var_qmgr_rcpt_limit;
+int     var_qmgr_msg_rcpt_limit;
+int     var_xport_rcpt_limit;
+int     var_stack_rcpt_limit;
+int     var_xport_refill_limit;
+int     var_delivery_slot_cost;
+int     var_delivery_slot_loan;
+int     var_delivery_slot_discount;
+int     var_min_delivery_slots;
+int     var_init_dest_concurrency;
+int     var_dest_con_limit;
+int     var_dest_rcpt_limit;
+int     var_conc_cohort_limit;
+bool    var_conc_feedback_debug;
+char   *var_conc_pos_feedback;
+char   *var_conc_neg_feedback;
+char   *var_conc_feedback_mode;
+
+ /*
+  * Normally defined in qmgr_message.c.
+  */
+int     qmgr_message_count;
+int     qmgr_recipient_count;
+
+ /*
+  * Simulated destination.
+  */
+typedef struct {
+    char   *name;
+    double  latency;			/* average transaction time */
+    double  spread;			/* uniform spread */
+    double  per_rcpt;			/* extra time per recipient */
+    int     capacity;			/* concurrency before slowdown */
+    int     limit;			/* concurrency before refusal */
+    double  defer;			/* recipient deferral probability */
+    double  down;			/* request failure probability */
+    double  stall;			/* stall probability */
+    double  stall_time;			/* stall duration */
+    int     busy;			/* deliveries in progress */
+    int     busy_peak;			/* peak deliveries in progress */
+    double  busy_time;			/* integral of busy over time */
+    double  busy_since;			/* last change of busy */
+    long    requests;			/* delivery requests */
+    long    refused;			/* site busy or down */
+    long    window_sum;			/* sum of window at request start */
+    int     window_peak;		/* peak window at request start */
+} SIM_SITE;
+
+ /*
+  * Simulated delivery agent pool, one per transport.
+  */
+typedef struct SIM_ALLOC SIM_ALLOC;
+
+typedef struct {
+    char   *name;
+    int     agents;			/* process limit */
+    int     busy;			/* processes in use */
+    double  busy_time;			/* integral of busy over time */
+    double  busy_since;			/* last change of busy */
+    SIM_ALLOC *wait_head;		/* connection requests */
+    SIM_ALLOC *wait_tail;
+} SIM_POOL;
+
+struct SIM_ALLOC {
+    QMGR_TRANSPORT *transport;
+    SIM_POOL *pool;
+    SIM_ALLOC *next;
+};
+
+ /*
+  * Simulated delivery transaction.
+  */
+typedef struct {
+    QMGR_ENTRY *entry;
+    SIM_POOL *pool;
+    SIM_SITE *site;
+    int     refused;			/* refused at start */
+    double  duration;			/* transaction time */
+} SIM_DELIVERY;
+
+ /*
+  * Mail class, for delay statistics.
+  */
+typedef struct {
+    char   *name;
+    long    messages;			/* injected messages */
+    long    recipients;			/* injected recipients */
+    double *delays;			/* per delivered recipient */
+    long    delays_len;
+    long    delays_avail;
+} SIM_CLASS;
+
+ /*
+  * Simulated queue file.
+  */
+typedef struct SIM_MAIL {
+    char   *queue_id;
+    SIM_CLASS *class;
+    const char *transport;
+    double  arrival;			/* time of arrival */
+    double  ready;			/* time to enter active queue */
+    int     rcpt_count;			/* total recipients */
+    int     rcpt_todo;			/* undelivered recipients */
+    SIM_SITE **rcpt_site;		/* per-recipient destination */
+    char   *rcpt_done;			/* per-recipient status */
+    struct SIM_MAIL *next;		/* incoming or deferred queue */
+} SIM_MAIL;
+
+ /*
+  * Simulated timer.
+  */
+typedef struct SIM_TIMER {
+    double  when;
+    long    seqno;
+    EVENT_NOTIFY_TIME_FN callback;
+    void   *context;
+    struct SIM_TIMER *next;
+} SIM_TIMER;
+
+static double sim_now;			/* simulated clock */
+static double sim_stop = 7 * 86400;	/* end of simulation */
+static long sim_timer_seqno;
+static SIM_TIMER *sim_timer_list;
+static SIM_MAIL *sim_queue;		/* incoming and deferred */
+static HTABLE *sim_sites;
+static HTABLE *sim_pools;
+static HTABLE *sim_classes;
+static HTABLE *sim_mail_byid;
+static ARGV *sim_class_order;
+static ARGV *sim_site_order;
+static unsigned sim_seed = 1;
+static long sim_mail_seqno;
+static long sim_delivered;
+static long sim_deferred;
+static long sim_unfinished;
+
+#define SIM_STAT_DEFER	1		/* as in qmgr_deliver.c */
+#define SIM_REFUSE_TIME	0.1		/* time to refuse service */
+#define SIM_DEF_AGENTS	100		/* default_process_limit */
+#define SIM_DEF_XPORT	"smtp"
+
+#define STR(x)	vstring_str(x)
+
+/* sim_random - deterministic pseudo-random number in [0, 1) */
+
+static double sim_random(void)
+{
+
+    /*
+     * Xorshift. We want the same results on every system, so we cannot use
+     * the system library.
+     */
+    sim_seed ^= (sim_seed << 13) & 0xffffffff;
+    sim_seed ^= sim_seed >> 17;
+    sim_seed ^= (sim_seed << 5) & 0xffffffff;
+    return ((sim_seed & 0xffffff) / 16777216.0);
+}
+
+/* sim_timer - schedule or reschedule simulated timer */
+
+static void sim_timer(EVENT_NOTIFY_TIME_FN callback, void *context,
+		              double when)
+{
+    SIM_TIMER *timer;
+    SIM_TIMER **tpp;
+
+    (void) event_cancel_timer(callback, context);
+    timer = (SIM_TIMER *) mymalloc(sizeof(*timer));
+    timer->when = when;
+    timer->seqno = sim_timer_seqno++;
+    timer->callback = callback;
+    timer->context = context;
+    for (tpp = &sim_timer_list; *tpp; tpp = &(*tpp)->next)
+	if ((*tpp)->when > when)
+	    break;
+    timer->next = *tpp;
+    *tpp = timer;
+}
+
+ /*
+  * Replacements for the event loop, with a simulated clock. The scheduler
+  * modules use only timers.
+  */
+
+/* event_time - simulated time of day */
+
+time_t  event_time(void)
+{
+    return ((time_t) sim_now);
+}
+
+/* sane_time - simulated time of day */
+
+time_t  sane_time(void)
+{
+    return ((time_t) sim_now);
+}
+
+/* event_request_timer - schedule simulated timer */
+
+time_t  event_request_timer(EVENT_NOTIFY_TIME_FN callback, void *context,
+				    int delay)
+{
+    if (delay < 0)
+	msg_panic("event_request_timer: invalid delay: %d", delay);
+    sim_timer(callback, context, (time_t) sim_now + delay);
+    return ((time_t) sim_now + delay);
+}
+
+/* event_cancel_timer - cancel simulated timer */
+
+int     event_cancel_timer(EVENT_NOTIFY_TIME_FN callback, void *context)
+{
+    SIM_TIMER **tpp;
+    SIM_TIMER *timer;
+
+    for (tpp = &sim_timer_list; (timer = *tpp) != 0; tpp = &timer->next) {
+	if (timer->callback == callback && timer->context == context) {
+	    *tpp = timer->next;
+	    myfree((void *) timer);
+	    return (0);
+	}
+    }
+    return (-1);
+}
+
+/* event_enable_read - not simulated */
+
+void    event_enable_read(int fd, EVENT_NOTIFY_RDWR_FN unused_callback,
+			          void *unused_context)
+{
+    msg_panic("event_enable_read: fd %d: not simulated", fd);
+}
+
+/* event_disable_readwrite - not simulated */
+
+void    event_disable_readwrite(int fd)
+{
+    msg_panic("event_disable_readwrite: fd %d: not simulated", fd);
+}
+
+/* sim_site_busy - update destination concurrency statistics */
+
+static void sim_site_busy(SIM_SITE *site, int delta)
+{
+    site->busy_time += site->busy * (sim_now - site->busy_since);
+    site->busy_since = sim_now;
+    site->busy += delta;
+    if (site->busy > site->busy_peak)
+	site->busy_peak = site->busy;
+}
+
+/* sim_pool_busy - update delivery agent statistics */
+
+static void sim_pool_busy(SIM_POOL *pool, int delta)
+{
+    pool->busy_time += pool->busy * (sim_now - pool->busy_since);
+    pool->busy_since = sim_now;
+    pool->busy += delta;
+}
+
+/* sim_pool_find - look up or instantiate delivery agent pool */
+
+static SIM_POOL *sim_pool_find(const char *name)
+{
+    SIM_POOL *pool;
+
+    if ((pool = (SIM_POOL *) htable_find(sim_pools, name)) == 0) {
+	pool = (SIM_POOL *) mymalloc(sizeof(*pool));
+	pool->name = mystrdup(name);
+	pool->agents = SIM_DEF_AGENTS;
+	pool->busy = 0;
+	pool->busy_time = pool->busy_since = 0;
+	pool->wait_head = pool->wait_tail = 0;
+	htable_enter(sim_pools, name, (void *) pool);
+    }
+    return (pool);
+}
+
+/* sim_mail_done - record delivered recipient */
+
+static void sim_mail_done(SIM_MAIL *mail, long offset)
+{
+    SIM_CLASS *class = mail->class;
+
+    if (offset < 0 || offset >= mail->rcpt_count || mail->rcpt_done[offset])
+	msg_panic("sim_mail_done: %s: bad recipient offset %ld",
+		  mail->queue_id, offset);
+    mail->rcpt_done[offset] = 1;
+    mail->rcpt_todo -= 1;
+    if (class->delays_len >= class->delays_avail) {
+	class->delays_avail = 2 * class->delays_avail + 100;
+	if (class->delays == 0)
+	    class->delays = (double *)
+		mymalloc(sizeof(*class->delays) * class->delays_avail);
+	else
+	    class->delays = (double *) myrealloc((void *) class->delays,
+			      sizeof(*class->delays) * class->delays_avail);
+    }
+    class->delays[class->delays_len++] = sim_now - mail->arrival;
+    sim_delivered++;
+}
+
+/* sim_mail_enqueue - add mail to incoming or deferred queue */
+
+static void sim_mail_enqueue(SIM_MAIL *mail)
+{
+    SIM_MAIL **mpp;
+
+    for (mpp = &sim_queue; *mpp; mpp = &(*mpp)->next)
+	if ((*mpp)->ready > mail->ready)
+	    break;
+    mail->next = *mpp;
+    *mpp = mail;
+}
+
+/* sim_message_read - read a chunk of recipients, as qmgr_message_read() */
+
+static void sim_message_read(QMGR_MESSAGE *message, SIM_MAIL *mail)
+{
+    static VSTRING *buf;
+    int     recipient_limit;
+    int     first;
+    int     n;
+
+    if (buf == 0)
+	buf = vstring_alloc(100);
+
+    /*
+     * The same recipient limit computation as in qmgr_message_read().
+     */
+    if (message->rcpt_offset) {
+	if (message->rcpt_list.len)
+	    msg_panic("%s: recipient list not empty on recipient reload",
+		      message->queue_id);
+	first = message->rcpt_offset - 1;
+	message->rcpt_offset = 0;
+	recipient_limit = message->rcpt_limit - message->rcpt_count;
+    } else {
+	first = 0;
+	recipient_limit = var_qmgr_rcpt_limit - qmgr_recipient_count;
+	if (recipient_limit < message->rcpt_limit)
+	    recipient_limit = message->rcpt_limit;
+    }
+    if (recipient_limit > 5000)
+	recipient_limit = 5000;
+    if (recipient_limit <= 0)
+	msg_panic("%s: no recipient slots available", message->queue_id);
+
+    /*
+     * Recipients that were delivered in an earlier attempt are skipped, as
+     * if they were marked done in the queue file.
+     */
+    message->rcpt_unread = 0;
+    for (n = first; n < mail->rcpt_count; n++) {
+	if (mail->rcpt_done[n])
+	    continue;
+	if (message->rcpt_offset != 0) {
+	    message->rcpt_unread++;
+	} else if (message->rcpt_list.len >= recipient_limit) {
+	    message->rcpt_offset = n + 1;
+	    message->rcpt_unread++;
+	} else {
+	    vstring_sprintf(buf, "rcpt%d@%s", n, mail->rcpt_site[n]->name);
+	    recipient_list_add(&message->rcpt_list, (long) n, "", 0, "",
+			       STR(buf));
+	}
+    }
+    message->refill_time = sane_time();
+}
+
+/* sim_message_resolve - find queues, as qmgr_message_resolve() */
+
+static void sim_message_resolve(QMGR_MESSAGE *message, SIM_MAIL *mail)
+{
+    RECIPIENT_LIST list = message->rcpt_list;
+    RECIPIENT *recipient;
+    QMGR_TRANSPORT *transport;
+    QMGR_QUEUE *queue;
+    const char *site;
+
+    if ((transport = qmgr_transport_find(mail->transport)) == 0)
+	transport = qmgr_transport_create(mail->transport);
+    for (recipient = list.info; recipient < list.info + list.len; recipient++) {
+	recipient->u.queue = 0;
+	if (QMGR_TRANSPORT_THROTTLED(transport)) {
+	    message->flags |= SIM_STAT_DEFER;
+	    sim_deferred++;
+	    continue;
+	}
+	site = mail->rcpt_site[recipient->offset]->name;
+	if ((queue = qmgr_queue_find(transport, site)) == 0)
+	    queue = qmgr_queue_create(transport, site, site);
+	if (QMGR_QUEUE_THROTTLED(queue)) {
+	    message->flags |= SIM_STAT_DEFER;
+	    sim_deferred++;
+	    continue;
+	}
+	recipient->u.queue = queue;
+    }
+}
+
+/* sim_message_assign - create queue entries, as qmgr_message_assign() */
+
+static void sim_message_assign(QMGR_MESSAGE *message)
+{
+    RECIPIENT_LIST list = message->rcpt_list;
+    RECIPIENT *recipient;
+    QMGR_ENTRY *entry = 0;
+    QMGR_QUEUE *queue;
+    QMGR_JOB *job = 0;
+    QMGR_PEER *peer = 0;
+
+#define LIMIT_OK(limit, count) ((limit) == 0 || ((count) < (limit)))
+
+    for (recipient = list.info; recipient < list.info + list.len; recipient++) {
+	if ((queue = recipient->u.queue) == 0)
+	    continue;
+	if (job == 0 || queue->transport != job->transport) {
+	    job = qmgr_job_obtain(message, queue->transport);
+	    peer = 0;
+	}
+	if (peer == 0 || queue != peer->queue)
+	    peer = qmgr_peer_obtain(job, queue);
+	entry = peer->entry_list.prev;
+	if (entry == 0
+	    || !LIMIT_OK(queue->transport->recipient_limit, entry->rcpt_list.len))
+	    entry = qmgr_entry_create(peer, message);
+	recipient_list_add(&entry->rcpt_list, recipient->offset,
+			   recipient->dsn_orcpt, recipient->dsn_notify,
+			   recipient->orig_addr, recipient->address);
+	job->rcpt_count++;
+	message->rcpt_count++;
+	qmgr_recipient_count++;
+    }
+    recipient_list_free(&message->rcpt_list);
+    recipient_list_init(&message->rcpt_list, RCPT_LIST_INIT_QUEUE);
+    for (job = message->job_list.next; job; job = job->message_peers.next)
+	if (job->selected_entries < job->read_entries
+	    && job->blocker_tag != job->transport->blocker_tag)
+	    qmgr_job_candidate_update(job);
+}
+
+/* sim_message_load - read, resolve and assign recipients */
+
+static void sim_message_load(QMGR_MESSAGE *message)
+{
+    SIM_MAIL *mail;
+    QMGR_JOB *job;
+
+    if ((mail = (SIM_MAIL *) htable_find(sim_mail_byid,
+					 message->queue_id)) == 0)
+	msg_panic("sim_message_load: unknown queue ID %s", message->queue_id);
+    sim_message_read(message, mail);
+    sim_message_resolve(message, mail);
+    sim_message_assign(message);
+    if (message->rcpt_offset == 0)
+	for (job = message->job_list.next; job; job = job->message_peers.next)
+	    qmgr_job_move_limits(job);
+}
+
+/* qmgr_message_realloc - refill in-core recipients */
+
+QMGR_MESSAGE *qmgr_message_realloc(QMGR_MESSAGE *message)
+{
+    if (message->rcpt_offset <= 0)
+	msg_panic("qmgr_message_realloc: invalid offset: %ld",
+		  message->rcpt_offset);
+    sim_message_load(message);
+    return (message);
+}
+
+/* sim_message_alloc - move mail into the active queue */
+
+static QMGR_MESSAGE *sim_message_alloc(SIM_MAIL *mail)
+{
+    QMGR_MESSAGE *message;
+
+    message = (QMGR_MESSAGE *) mymalloc(sizeof(QMGR_MESSAGE));
+    memset((void *) message, 0, sizeof(*message));
+    qmgr_message_count++;
+    message->queued_time = sane_time();
+    message->create_time = (time_t) mail->arrival;
+    message->queue_id = mystrdup(mail->queue_id);
+    message->queue_name = mystrdup(MAIL_QUEUE_ACTIVE);
+    recipient_list_init(&message->rcpt_list, RCPT_LIST_INIT_QUEUE);
+    message->rcpt_limit = var_qmgr_msg_rcpt_limit;
+    QMGR_LIST_INIT(message->job_list);
+    sim_message_load(message);
+    return (message);
+}
+
+/* qmgr_active_done - dispose of message after recipients have been tried */
+
+void    qmgr_active_done(QMGR_MESSAGE *message)
+{
+    SIM_MAIL *mail;
+    QMGR_JOB *job;
+    int     delay;
+
+    if ((mail = (SIM_MAIL *) htable_find(sim_mail_byid,
+					 message->queue_id)) == 0)
+	msg_panic("qmgr_active_done: unknown queue ID %s", message->queue_id);
+
+    /*
+     * Read more recipients, as in qmgr_active_done_2_generic().
+     */
+    if (message->rcpt_offset > 0) {
+	qmgr_message_realloc(message);
+	if (message->refcount == 0)
+	    qmgr_active_done(message);
+	return;
+    }
+
+    /*
+     * Move deferred mail to the deferred queue, with the same backoff time
+     * as qmgr_active_done_3_generic(). Otherwise, we're done.
+     */
+    if (message->flags) {
+	if (mail->rcpt_todo <= 0)
+	    msg_panic("qmgr_active_done: %s: deferred without recipients",
+		      mail->queue_id);
+	delay = sim_now - mail->arrival;
+	if (delay > var_max_backoff_time)
+	    delay = var_max_backoff_time;
+	if (delay < var_min_backoff_time)
+	    delay = var_min_backoff_time;
+	mail->ready = sim_now + delay;
+	sim_mail_enqueue(mail);
+    } else {
+	if (mail->rcpt_todo != 0)
+	    msg_panic("qmgr_active_done: %s: %d recipients lost",
+		      mail->queue_id, mail->rcpt_todo);
+	htable_delete(sim_mail_byid, mail->queue_id, (void (*) (void *)) 0);
+	myfree(mail->queue_id);
+	myfree((void *) mail->rcpt_site);
+	myfree(mail->rcpt_done);
+	myfree((void *) mail);
+    }
+
+    /*
+     * Same as qmgr_message_free().
+     */
+    while ((job = message->job_list.next) != 0)
+	qmgr_job_free(job);
+    myfree(message->queue_id);
+    myfree(message->queue_name);
+    recipient_list_free(&message->rcpt_list);
+    qmgr_message_count--;
+    myfree((void *) message);
+}
+
+/* sim_defer_todo - defer all todo queue entries, as qmgr_defer_todo() */
+
+static void sim_defer_todo(QMGR_QUEUE *queue)
+{
+    QMGR_ENTRY *entry;
+    QMGR_ENTRY *next;
+
+    for (entry = queue->todo.next; entry != 0; entry = next) {
+	next = entry->queue_peers.next;
+	entry->message->flags |= SIM_STAT_DEFER;
+	sim_deferred += entry->rcpt_list.len;
+	qmgr_entry_done(entry, QMGR_QUEUE_TODO);
+    }
+}
+
+/* sim_agent_release - release delivery agent */
+
+static void sim_connect(int, void *);
+
+static void sim_agent_release(SIM_POOL *pool)
+{
+    SIM_ALLOC *alloc;
+
+    sim_pool_busy(pool, -1);
+    if ((alloc = pool->wait_head) != 0) {
+	if ((pool->wait_head = alloc->next) == 0)
+	    pool->wait_tail = 0;
+	sim_pool_busy(pool, 1);
+	sim_timer(sim_connect, (void *) alloc, sim_now);
+    }
+}
+
+/* sim_deliver_done - delivery agent reports, as qmgr_deliver_update() */
+
+static void sim_deliver_done(int unused_event, void *context)
+{
+    SIM_DELIVERY *delivery = (SIM_DELIVERY *) context;
+    QMGR_ENTRY *entry = delivery->entry;
+    QMGR_QUEUE *queue = entry->queue;
+    QMGR_TRANSPORT *transport = queue->transport;
+    QMGR_MESSAGE *message = entry->message;
+    SIM_SITE *site = delivery->site;
+    SIM_MAIL *mail;
+    RECIPIENT *recipient;
+    DSN     dsn;
+    int     reason = 0;
+
+    if ((mail = (SIM_MAIL *) htable_find(sim_mail_byid,
+					 message->queue_id)) == 0)
+	msg_panic("sim_deliver_done: unknown queue ID %s", message->queue_id);
+
+    /*
+     * Determine the delivery status. When the site is in trouble, all
+     * recipients are deferred with a reason, and the destination receives
+     * negative feedback. Deferred recipients without reason do not affect
+     * the destination concurrency.
+     */
+    if (delivery->refused || (site->down > 0 && sim_random() < site->down)) {
+	site->refused++;
+	message->flags |= SIM_STAT_DEFER;
+	sim_deferred += entry->rcpt_list.len;
+	reason = 1;
+    } else {
+	for (recipient = entry->rcpt_list.info;
+	     recipient < entry->rcpt_list.info + entry->rcpt_list.len;
+	     recipient++) {
+	    if (site->defer > 0 && sim_random() < site->defer) {
+		message->flags |= SIM_STAT_DEFER;
+		sim_deferred++;
+	    } else {
+		sim_mail_done(mail, recipient->offset);
+	    }
+	}
+    }
+    if (reason && QMGR_QUEUE_READY(queue)) {
+	qmgr_queue_throttle(queue, DSN_SIMPLE(&dsn, "4.4.2",
+				      "delivery temporarily suspended: "
+					      "simulated site failure"));
+	if (QMGR_QUEUE_THROTTLED(queue))
+	    sim_defer_todo(queue);
+    }
+    qmgr_transport_unthrottle(transport);
+    if (reason == 0) {
+	qmgr_queue_latency(queue, delivery->duration, 1, 0);
+	qmgr_queue_unthrottle(queue);
+    }
+
+    /*
+     * Release the delivery agent and dispose of the queue entry.
+     */
+    sim_site_busy(site, -1);
+    sim_agent_release(delivery->pool);
+    myfree((void *) delivery);
+    qmgr_entry_done(entry, QMGR_QUEUE_BUSY);
+}
+
+/* sim_connect - delivery agent is available, as qmgr_deliver() */
+
+static void sim_connect(int unused_event, void *context)
+{
+    SIM_ALLOC *alloc = (SIM_ALLOC *) context;
+    QMGR_TRANSPORT *transport = alloc->transport;
+    SIM_POOL *pool = alloc->pool;
+    SIM_DELIVERY *delivery;
+    QMGR_ENTRY *entry;
+    SIM_SITE *site;
+    double  duration;
+
+    myfree((void *) alloc);
+    transport->pending -= 1;
+
+    /*
+     * As in qmgr_deliver(), there may be no work for this delivery agent
+     * by the time it becomes available.
+     */
+    if ((entry = qmgr_job_entry_select(transport)) == 0) {
+	sim_agent_release(pool);
+	return;
+    }
+    if ((site = (SIM_SITE *) htable_find(sim_sites, entry->queue->name)) == 0)
+	msg_panic("sim_connect: unknown site %s", entry->queue->name);
+    sim_site_busy(site, 1);
+    site->requests++;
+    site->window_sum += entry->queue->window;
+    if (entry->queue->window > site->window_peak)
+	site->window_peak = entry->queue->window;
+
+    /*
+     * Compute the transaction time.
+     */
+    delivery = (SIM_DELIVERY *) mymalloc(sizeof(*delivery));
+    delivery->entry = entry;
+    delivery->pool = pool;
+    delivery->site = site;
+    delivery->refused = (site->limit > 0 && site->busy > site->limit);
+    if (delivery->refused) {
+	duration = SIM_REFUSE_TIME;
+    } else if (site->stall > 0 && sim_random() < site->stall) {
+	duration = site->stall_time;
+    } else {
+	duration = site->latency * (1 + site->spread * (2 * sim_random() - 1))
+	    + site->per_rcpt * entry->rcpt_list.len;
+	if (site->capacity > 0 && site->busy > site->capacity)
+	    duration *= site->busy / (double) site->capacity;
+    }
+    delivery->duration = duration;
+    sim_timer(sim_deliver_done, (void *) delivery, sim_now + duration);
+}
+
+/* sim_transport_alloc - request delivery agent, as qmgr_transport_alloc() */
+
+static void sim_transport_alloc(QMGR_TRANSPORT *transport)
+{
+    SIM_ALLOC *alloc;
+
+    alloc = (SIM_ALLOC *) mymalloc(sizeof(*alloc));
+    alloc->transport = transport;
+    alloc->pool = sim_pool_find(transport->name);
+    alloc->next = 0;
+    transport->pending += 1;
+
+    /*
+     * When all delivery agents are busy, the connection request waits, as
+     * with the master(8) process limit.
+     */
+    if (alloc->pool->busy < alloc->pool->agents) {
+	sim_pool_busy(alloc->pool, 1);
+	sim_timer(sim_connect, (void *) alloc, sim_now);
+    } else {
+	if (alloc->pool->wait_tail)
+	    alloc->pool->wait_tail->next = alloc;
+	else
+	    alloc->pool->wait_head = alloc;
+	alloc->pool->wait_tail = alloc;
+    }
+}
+
+/* sim_active_feed - move mail into the active queue */
+
+static void sim_active_feed(void)
+{
+    QMGR_MESSAGE *message;
+    SIM_MAIL *mail;
+
+    while ((mail = sim_queue) != 0 && mail->ready <= sim_now
+	   && qmgr_message_count < var_qmgr_active_limit) {
+	sim_queue = mail->next;
+	message = sim_message_alloc(mail);
+	if (message->refcount == 0)
+	    qmgr_active_done(message);
+    }
+}
+
+/* sim_run - run the simulation */
+
+static void sim_run(void)
+{
+    QMGR_TRANSPORT *transport;
+    SIM_TIMER *timer;
+
+    for (;;) {
+
+	/*
+	 * The qmgr_loop() equivalent: feed the active queue, and start as
+	 * many deliveries as we can.
+	 */
+	sim_active_feed();
+	while ((transport = qmgr_transport_select()) != 0)
+	    sim_transport_alloc(transport);
+
+	/*
+	 * Advance the clock to the next event.
+	 */
+	timer = sim_timer_list;
+	if (sim_queue != 0 && qmgr_message_count < var_qmgr_active_limit
+	    && (timer == 0 || sim_queue->ready < timer->when)) {
+	    if (sim_queue->ready > sim_stop)
+		break;
+	    sim_now = sim_queue->ready;
+	    continue;
+	}
+	if (timer == 0 || timer->when > sim_stop)
+	    break;
+	sim_timer_list = timer->next;
+	if (timer->when > sim_now)
+	    sim_now = timer->when;
+	timer->callback(EVENT_TIME, timer->context);
+	myfree((void *) timer);
+    }
+}
+
+/* sim_number - convert number */
+
+static double sim_number(const char *what, const char *value, int lineno)
+{
+    char   *end;
+    double  result;
+
+    if (value == 0)
+	msg_fatal("line %d: missing %s value", lineno, what);
+    result = strtod(value, &end);
+    if (*end != 0 || result < 0)
+	msg_fatal("line %d: bad %s value: %s", lineno, what, value);
+    return (result);
+}
+
+/* sim_site - define destination */
+
+static void sim_site(char *args, int lineno)
+{
+    SIM_SITE *site;
+    char   *name;
+    char   *attr;
+
+    if ((name = mystrtok(&args, CHARS_SPACE)) == 0)
+	msg_fatal("line %d: missing site name", lineno);
+    if (htable_find(sim_sites, name) != 0)
+	msg_fatal("line %d: duplicate site %s", lineno, name);
+    site = (SIM_SITE *) mymalloc(sizeof(*site));
+    memset((void *) site, 0, sizeof(*site));
+    site->name = mystrdup(name);
+    site->latency = 1;
+    site->spread = 0.5;
+    while ((attr = mystrtok(&args, CHARS_SPACE)) != 0) {
+	if (strcmp(attr, "latency") == 0) {
+	    site->latency = sim_number(attr, mystrtok(&args, CHARS_SPACE), lineno);
+	} else if (strcmp(attr, "spread") == 0) {
+	    site->spread = sim_number(attr, mystrtok(&args, CHARS_SPACE), lineno);
+	    if (site->spread > 1)
+		msg_fatal("line %d: spread must be at most 1", lineno);
+	} else if (strcmp(attr, "per_rcpt") == 0) {
+	    site->per_rcpt = sim_number(attr, mystrtok(&args, CHARS_SPACE), lineno);
+	} else if (strcmp(attr, "capacity") == 0) {
+	    site->capacity = sim_number(attr, mystrtok(&args, CHARS_SPACE), lineno);
+	} else if (strcmp(attr, "limit") == 0) {
+	    site->limit = sim_number(attr, mystrtok(&args, CHARS_SPACE), lineno);
+	} else if (strcmp(attr, "defer") == 0) {
+	    site->defer = sim_number(attr, mystrtok(&args, CHARS_SPACE), lineno) / 100;
+	} else if (strcmp(attr, "down") == 0) {
+	    site->down = sim_number(attr, mystrtok(&args, CHARS_SPACE), lineno) / 100;
+	} else if (strcmp(attr, "stall") == 0) {
+	    site->stall = sim_number(attr, mystrtok(&args, CHARS_SPACE), lineno) / 100;
+	    site->stall_time = sim_number(attr, mystrtok(&args, CHARS_SPACE), lineno);
+	} else {
+	    msg_fatal("line %d: unknown site attribute: %s", lineno, attr);
+	}
+    }
+    if (site->defer >= 1)
+	msg_fatal("line %d: site %s would never accept mail", lineno, name);
+    htable_enter(sim_sites, name, (void *) site);
+    argv_add(sim_site_order, name, (char *) 0);
+}
+
+/* sim_mail - inject mail */
+
+static void sim_mail(char *args, int lineno)
+{
+    SIM_CLASS *class;
+    SIM_MAIL *mail;
+    SIM_SITE **sites;
+    static VSTRING *queue_id;
+    ARGV   *site_list = 0;
+    const char *transport = SIM_DEF_XPORT;
+    char   *name;
+    char   *attr;
+    long    count = 1;
+    int     rcpt = 1;
+    double  at = 0;
+    double  every = 0;
+    long    n;
+    int     i;
+
+    if ((name = mystrtok(&args, CHARS_SPACE)) == 0)
+	msg_fatal("line %d: missing mail class name", lineno);
+    while ((attr = mystrtok(&args, CHARS_SPACE)) != 0) {
+	if (strcmp(attr, "count") == 0) {
+	    count = sim_number(attr, mystrtok(&args, CHARS_SPACE), lineno);
+	} else if (strcmp(attr, "rcpt") == 0) {
+	    rcpt = sim_number(attr, mystrtok(&args, CHARS_SPACE), lineno);
+	} else if (strcmp(attr, "at") == 0) {
+	    at = sim_number(attr, mystrtok(&args, CHARS_SPACE), lineno);
+	} else if (strcmp(attr, "every") == 0) {
+	    every = sim_number(attr, mystrtok(&args, CHARS_SPACE), lineno);
+	} else if (strcmp(attr, "transport") == 0) {
+	    if ((transport = mystrtok(&args, CHARS_SPACE)) == 0)
+		msg_fatal("line %d: missing transport name", lineno);
+	} else if (strcmp(attr, "site") == 0) {
+	    if ((attr = mystrtok(&args, CHARS_SPACE)) == 0)
+		msg_fatal("line %d: missing site name", lineno);
+	    site_list = argv_split(attr, CHARS_COMMA_SP);
+	} else {
+	    msg_fatal("line %d: unknown mail attribute: %s", lineno, attr);
+	}
+    }
+    if (site_list == 0)
+	msg_fatal("line %d: mail without site", lineno);
+    if (queue_id == 0)
+	queue_id = vstring_alloc(10);
+    if (count < 1 || rcpt < 1)
+	msg_fatal("line %d: bad message or recipient count", lineno);
+    sites = (SIM_SITE **) mymalloc(sizeof(*sites) * site_list->argc);
+    for (i = 0; i < site_list->argc; i++)
+	if ((sites[i] = (SIM_SITE *) htable_find(sim_sites,
+						 site_list->argv[i])) == 0)
+	    msg_fatal("line %d: unknown site: %s", lineno, site_list->argv[i]);
+    if ((class = (SIM_CLASS *) htable_find(sim_classes, name)) == 0) {
+	class = (SIM_CLASS *) mymalloc(sizeof(*class));
+	memset((void *) class, 0, sizeof(*class));
+	class->name = mystrdup(name);
+	htable_enter(sim_classes, name, (void *) class);
+	argv_add(sim_class_order, name, (char *) 0);
+    }
+
+    /*
+     * Recipients are sorted by destination, as after qmgr_message_sort().
+     * Each message starts with the next destination in the list.
+     */
+    for (n = 0; n < count; n++) {
+	mail = (SIM_MAIL *) mymalloc(sizeof(*mail));
+	vstring_sprintf(queue_id, "%08lX", sim_mail_seqno++);
+	mail->queue_id = mystrdup(STR(queue_id));
+	mail->class = class;
+	mail->transport = mystrdup(transport);
+	mail->arrival = mail->ready = at + n * every;
+	mail->rcpt_count = mail->rcpt_todo = rcpt;
+	mail->rcpt_site = (SIM_SITE **) mymalloc(sizeof(SIM_SITE *) * rcpt);
+	mail->rcpt_done = mymalloc(rcpt);
+	for (i = 0; i < rcpt; i++) {
+	    mail->rcpt_site[i] =
+		sites[((long) i * site_list->argc / rcpt + n) % site_list->argc];
+	    mail->rcpt_done[i] = 0;
+	}
+	htable_enter(sim_mail_byid, mail->queue_id, (void *) mail);
+	sim_mail_enqueue(mail);
+	class->messages++;
+	class->recipients += rcpt;
+    }
+    myfree((void *) sites);
+    argv_free(site_list);
+}
+
+/* sim_workload - read workload description */
+
+static void sim_workload(VSTREAM *fp)
+{
+    VSTRING *buf = vstring_alloc(100);
+    SIM_POOL *pool;
+    char   *cp;
+    char   *cmd;
+    char   *name;
+    char   *value;
+    const char *err;
+    int     lineno = 0;
+
+    while (vstring_get_nonl(buf, fp) != VSTREAM_EOF) {
+	lineno++;
+	if ((cp = strchr(STR(buf), '#')) != 0)
+	    *cp = 0;
+	cp = STR(buf);
+	if (strchr(cp, '=') != 0) {
+	    if ((err = split_nameval(cp, &name, &value)) != 0)
+		msg_fatal("line %d: %s", lineno, err);
+	    mail_conf_update(name, value);
+	    continue;
+	}
+	if ((cmd = mystrtok(&cp, CHARS_SPACE)) == 0)
+	    continue;
+	if (strcmp(cmd, "seed") == 0) {
+	    sim_seed = sim_number(cmd, mystrtok(&cp, CHARS_SPACE), lineno);
+	    if (sim_seed == 0)
+		msg_fatal("line %d: seed must be non-zero", lineno);
+	} else if (strcmp(cmd, "stop") == 0) {
+	    sim_stop = sim_number(cmd, mystrtok(&cp, CHARS_SPACE), lineno);
+	} else if (strcmp(cmd, "transport") == 0) {
+	    if ((name = mystrtok(&cp, CHARS_SPACE)) == 0)
+		msg_fatal("line %d: missing transport name", lineno);
+	    if ((value = mystrtok(&cp, CHARS_SPACE)) == 0
+		|| strcmp(value, "agents") != 0)
+		msg_fatal("line %d: expected \"agents\"", lineno);
+	    pool = sim_pool_find(name);
+	    if ((pool->agents = sim_number(value, mystrtok(&cp, CHARS_SPACE),
+					   lineno)) < 1)
+		msg_fatal("line %d: need at least one agent", lineno);
+	} else if (strcmp(cmd, "site") == 0) {
+	    sim_site(cp, lineno);
+	} else if (strcmp(cmd, "mail") == 0) {
+	    sim_mail(cp, lineno);
+	} else {
+	    msg_fatal("line %d: unknown command: %s", lineno, cmd);
+	}
+    }
+    vstring_free(buf);
+}
+
+/* sim_delay_compare - qsort callback */
+
+static int sim_delay_compare(const void *a, const void *b)
+{
+    double  da = *(const double *) a;
+    double  db = *(const double *) b;
+
+    return (da < db ? -1 : da > db ? 1 : 0);
+}
+
+/* sim_percentile - look up percentile in sorted array */
+
+static double sim_percentile(SIM_CLASS *class, int pct)
+{
+    long    n;
+
+    if (class->delays_len == 0)
+	return (0);
+    n = (class->delays_len * pct + 99) / 100 - 1;
+    if (n < 0)
+	n = 0;
+    return (class->delays[n]);
+}
+
+/* sim_report - report results */
+
+static void sim_report(void)
+{
+    HTABLE_INFO **ht_info;
+    HTABLE_INFO **ht;
+    SIM_CLASS *class;
+    SIM_SITE *site;
+    SIM_POOL *pool;
+    SIM_MAIL *mail;
+    double  mean;
+    double  sum;
+    double  sum2;
+    long    n;
+    int     i;
+
+    /*
+     * Undelivered mail.
+     */
+    ht_info = htable_list(sim_mail_byid);
+    for (ht = ht_info; *ht; ht++) {
+	mail = (SIM_MAIL *) ht[0]->value;
+	sim_unfinished += mail->rcpt_todo;
+    }
+    myfree((void *) ht_info);
+
+    vstream_printf("time %.1f s, delivered %ld, deferrals %ld, unfinished %ld\n",
+		   sim_now, sim_delivered, sim_deferred, sim_unfinished);
+    vstream_printf("throughput %.2f recipients/s\n",
+		   sim_now > 0 ? sim_delivered / sim_now : 0.0);
+
+    ht_info = htable_list(sim_pools);
+    for (ht = ht_info; *ht; ht++) {
+	pool = (SIM_POOL *) ht[0]->value;
+	sim_pool_busy(pool, 0);
+	vstream_printf("transport %s: agents %d, utilization %.1f%%\n",
+		       pool->name, pool->agents, sim_now > 0 ?
+		       100 * pool->busy_time / (pool->agents * sim_now) : 0);
+    }
+    myfree((void *) ht_info);
+
+    /*
+     * Per mail class delays, and fairness between mail classes.
+     */
+    for (sum = sum2 = 0, n = i = 0; i < sim_class_order->argc; i++) {
+	class = (SIM_CLASS *) htable_find(sim_classes, sim_class_order->argv[i]);
+	qsort((void *) class->delays, class->delays_len,
+	      sizeof(*class->delays), sim_delay_compare);
+	for (mean = 0, n = 0; n < class->delays_len; n++)
+	    mean += class->delays[n];
+	if (class->delays_len > 0)
+	    mean /= class->delays_len;
+	sum += mean;
+	sum2 += mean * mean;
+	vstream_printf("class %s: messages %ld, recipients %ld, delivered %ld, "
+		       "delay mean %.1f p50 %.1f p90 %.1f p99 %.1f max %.1f\n",
+		       class->name, class->messages, class->recipients,
+		       class->delays_len, mean, sim_percentile(class, 50),
+		       sim_percentile(class, 90), sim_percentile(class, 99),
+		       sim_percentile(class, 100));
+    }
+    if (sim_class_order->argc > 1)
+	vstream_printf("fairness %.3f\n", sum2 > 0 ?
+		       sum * sum / (sim_class_order->argc * sum2) : 1.0);
+
+    /*
+     * Per destination concurrency.
+     */
+    for (i = 0; i < sim_site_order->argc; i++) {
+	site = (SIM_SITE *) htable_find(sim_sites, sim_site_order->argv[i]);
+	sim_site_busy(site, 0);
+	vstream_printf("site %s: requests %ld, refused %ld, "
+		       "concurrency avg %.1f peak %d, window avg %.1f peak %d\n",
+		       site->name, site->requests, site->refused,
+		       sim_now > 0 ? site->busy_time / sim_now : 0,
+		       site->busy_peak, site->requests ?
+		       site->window_sum / (double) site->requests : 0,
+		       site->window_peak);
+    }
+
+    /*
+     * Scheduler statistics.
+     */
+    vstream_printf("scheduler: candidate lookups %ld, walks %ld, steps %ld\n",
+		   qmgr_job_candidate_lookups, qmgr_job_candidate_walks,
+		   qmgr_job_candidate_steps);
+    vstream_fflush(VSTREAM_OUT);
+}
+
+MAIL_VERSION_STAMP_DECLARE;
+
+/* main - simulate the queue manager */
+
+int     main(int argc, char **argv)
+{
+    static const CONFIG_STR_TABLE str_table[] = {
+	VAR_CONC_POS_FDBACK, DEF_CONC_POS_FDBACK, &var_conc_pos_feedback, 1, 0,
+	VAR_CONC_NEG_FDBACK, DEF_CONC_NEG_FDBACK, &var_conc_neg_feedback, 1, 0,
+	VAR_CONC_FDBACK_MODE, DEF_CONC_FDBACK_MODE, &var_conc_feedback_mode, 1, 0,
+	0,
+    };
+    static const CONFIG_TIME_TABLE time_table[] = {
+	VAR_QUEUE_RUN_DELAY, DEF_QUEUE_RUN_DELAY, &var_queue_run_delay, 1, 0,
+	VAR_MIN_BACKOFF_TIME, DEF_MIN_BACKOFF_TIME, &var_min_backoff_time, 1, 0,
+	VAR_MAX_BACKOFF_TIME, DEF_MAX_BACKOFF_TIME, &var_max_backoff_time, 1, 0,
+	VAR_XPORT_RETRY_TIME, DEF_XPORT_RETRY_TIME, &var_transport_retry_time, 1, 0,
+	VAR_QMGR_CLOG_WARN_TIME, DEF_QMGR_CLOG_WARN_TIME, &var_qmgr_clog_warn_time, 0, 0,
+	VAR_XPORT_REFILL_DELAY, DEF_XPORT_REFILL_DELAY, &var_xport_refill_delay, 1, 0,
+	VAR_XPORT_RATE_DELAY, DEF_XPORT_RATE_DELAY, &var_xport_rate_delay, 0, 0,
+	VAR_DEST_RATE_DELAY, DEF_DEST_RATE_DELAY, &var_dest_rate_delay, 0, 0,
+	0,
+    };
+    static const CONFIG_INT_TABLE int_table[] = {
+	VAR_QMGR_ACT_LIMIT, DEF_QMGR_ACT_LIMIT, &var_qmgr_active_limit, 1, 0,
+	VAR_QMGR_RCPT_LIMIT, DEF_QMGR_RCPT_LIMIT, &var_qmgr_rcpt_limit, 1, 0,
+	VAR_QMGR_MSG_RCPT_LIMIT, DEF_QMGR_MSG_RCPT_LIMIT, &var_qmgr_msg_rcpt_limit, 1, 0,
+	VAR_XPORT_RCPT_LIMIT, DEF_XPORT_RCPT_LIMIT, &var_xport_rcpt_limit, 0, 0,
+	VAR_STACK_RCPT_LIMIT, DEF_STACK_RCPT_LIMIT, &var_stack_rcpt_limit, 0, 0,
+	VAR_XPORT_REFILL_LIMIT, DEF_XPORT_REFILL_LIMIT, &var_xport_refill_limit, 1, 0,
+	VAR_DELIVERY_SLOT_COST, DEF_DELIVERY_SLOT_COST, &var_delivery_slot_cost, 0, 0,
+	VAR_DELIVERY_SLOT_LOAN, DEF_DELIVERY_SLOT_LOAN, &var_delivery_slot_loan, 0, 0,
+	VAR_DELIVERY_SLOT_DISCOUNT, DEF_DELIVERY_SLOT_DISCOUNT, &var_delivery_slot_discount, 0, 100,
+	VAR_MIN_DELIVERY_SLOTS, DEF_MIN_DELIVERY_SLOTS, &var_min_delivery_slots, 0, 0,
+	VAR_INIT_DEST_CON, DEF_INIT_DEST_CON, &var_init_dest_concurrency, 1, 0,
+	VAR_DEST_CON_LIMIT, DEF_DEST_CON_LIMIT, &var_dest_con_limit, 0, 0,
+	VAR_DEST_RCPT_LIMIT, DEF_DEST_RCPT_LIMIT, &var_dest_rcpt_limit, 0, 0,
+	VAR_CONC_COHORT_LIM, DEF_CONC_COHORT_LIM, &var_conc_cohort_limit, 0, 0,
+	0,
+    };
+    static const CONFIG_BOOL_TABLE bool_table[] = {
+	VAR_CONC_FDBACK_DEBUG, DEF_CONC_FDBACK_DEBUG, &var_conc_feedback_debug,
+	0,
+    };
+    int     ch;
+
+    /*
+     * Fingerprint executables and core dumps.
+     */
+    MAIL_VERSION_STAMP_ALLOCATE;
+
+    msg_vstream_init(argv[0], VSTREAM_ERR);
+    while ((ch = GETOPT(argc, argv, "v")) > 0) {
+	switch (ch) {
+	case 'v':
+	    msg_verbose++;
+	    break;
+	default:
+	    msg_fatal("usage: %s [-v] <workload", argv[0]);
+	}
+    }
+    if (argc != optind)
+	msg_fatal("usage: %s [-v] <workload", argv[0]);
+
+    sim_sites = htable_create(0);
+    sim_pools = htable_create(0);
+    sim_classes = htable_create(0);
+    sim_mail_byid = htable_create(0);
+    sim_class_order = argv_alloc(1);
+    sim_site_order = argv_alloc(1);
+
+    /*
+     * The workload may override main.cf parameters, so read it before the
+     * parameter tables.
+     */
+    sim_workload(VSTREAM_IN);
+    get_mail_conf_str_table(str_table);
+    get_mail_conf_time_table(time_table);
+    get_mail_conf_int_table(int_table);
+    get_mail_conf_bool_table(bool_table);
+
+    sim_run();
+    sim_report();
+    return (0);
+}
@@ -444,6 +444,10 @@ QMGR_TRANSPORT *qmgr_transport_create(const char *name)
 
     if (transport->rate_delay > 0)
 	transport->dest_concurrency_limit = 1;
+    transport->dest_concurrency_limit =
+	qmgr_shard_limit(transport->dest_concurrency_limit);
+    transport->init_dest_concurrency =
+	qmgr_shard_limit(transport->init_dest_concurrency);
     if (transport->dest_concurrency_limit != 0
     && transport->dest_concurrency_limit < transport->init_dest_concurrency)
 	transport->init_dest_concurrency = transport->dest_concurrency_limit;
@@ -485,6 +489,7 @@ QMGR_TRANSPORT *qmgr_transport_create(const char *name)
     transport->fail_cohort_limit =
 	get_mail_conf_int2(name, _CONC_COHORT_LIM,
 			   var_conc_cohort_limit, 0, 0);
+    transport->feedback_mode = qmgr_feedback_mode(name);
     if (qmgr_transport_byname == 0)
 	qmgr_transport_byname = htable_create(10);
     htable_enter(qmgr_transport_byname, name, (void *) transport);
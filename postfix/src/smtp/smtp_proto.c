@@ -1559,6 +1559,8 @@ static int smtp_loop(SMTP_STATE *state, NOCLOBBER int send_state,
     NOCLOBBER int recv_done;
     int     except;
     int     rec_type;
+    const char *rec_data;
+    ssize_t rec_len;
     NOCLOBBER int prev_type = 0;
     NOCLOBBER int mail_from_rejected;
     NOCLOBBER int downgrading;
@@ -2399,13 +2401,31 @@ static int smtp_loop(SMTP_STATE *state, NOCLOBBER int send_state,
 		    && smtp_out_add_headers(state) < 0)
 		    RETURN(0);
 
-		while ((rec_type = rec_get(state->src, session->scratch, 0)) > 0) {
-		    if (rec_type != REC_TYPE_NORM && rec_type != REC_TYPE_CONT)
-			break;
-		    if (smtp_out_raw_or_mime(state, rec_type,
-					     session->scratch) < 0)
-			RETURN(0);
-		    prev_type = rec_type;
+		/*
+		 * Without MIME processing, send records straight from the
+		 * queue file read buffer where possible. The header/body
+		 * callbacks expect null-terminated text.
+		 */
+		if (session->mime_state == 0) {
+		    while ((rec_type = rec_get_view(state->src, session->scratch,
+						    0, REC_FLAG_DEFAULT,
+						    &rec_data, &rec_len)) > 0) {
+			if (rec_type != REC_TYPE_NORM
+			    && rec_type != REC_TYPE_CONT)
+			    break;
+			smtp_text_out((void *) state, rec_type, rec_data,
+				      rec_len, (off_t) 0);
+			prev_type = rec_type;
+		    }
+		} else {
+		    while ((rec_type = rec_get(state->src, session->scratch, 0)) > 0) {
+			if (rec_type != REC_TYPE_NORM && rec_type != REC_TYPE_CONT)
+			    break;
+			if (smtp_out_raw_or_mime(state, rec_type,
+						 session->scratch) < 0)
+			    RETURN(0);
+			prev_type = rec_type;
+		    }
 		}
 
 		if (session->mime_state) {
@@ -839,6 +839,12 @@
 /* .IP "\fBsmtpd_forbid_bare_newline_reject_code (550)\fR"
 /*	The numerical Postfix SMTP server response code when rejecting a
 /*	request with "smtpd_forbid_bare_newline = reject".
+/* .PP
+/*	Available in Postfix 3.11 and later:
+/* .IP "\fBsmtpd_idle_release_time (0s)\fR"
+/*	The time that an SMTP client may be idle between commands
+/*	before the Postfix SMTP server closes its connections to
+/*	policy services.
 /* TARPIT CONTROLS
 /* .ad
 /* .fi
@@ -904,6 +910,16 @@
 /*	the "policy_context" attribute of a policy service request (originally,
 /*	to share the same service endpoint among multiple check_policy_service
 /*	clients).
+/* .PP
+/*	Available in Postfix 3.11 and later:
+/* .IP "\fBsmtpd_policy_service_cache_attributes (empty)\fR"
+/*	Optional list of policy request attribute names that identify
+/*	equivalent requests; the Postfix SMTP server reuses a policy
+/*	service reply for an equivalent request in the same protocol
+/*	state.
+/* .IP "\fBsmtpd_policy_service_cache_ttl (60s)\fR"
+/*	The time that the Postfix SMTP server reuses a policy service
+/*	reply with "smtpd_policy_service_cache_attributes".
 /* ACCESS CONTROLS
 /* .ad
 /* .fi
@@ -977,6 +993,14 @@
 /*	Access restrictions for mail relay control that the Postfix
 /*	SMTP server applies in the context of the RCPT TO command, before
 /*	smtpd_recipient_restrictions.
+/* .PP
+/*	Available in Postfix 3.11 and later:
+/* .IP "\fBsmtpd_dns_prefetch (no)\fR"
+/*	Send the DNS queries for all DNS-based access restrictions at
+/*	the start of an SMTP protocol stage, instead of one at a time.
+/* .IP "\fBsmtpd_dns_prefetch_timeout (2s)\fR"
+/*	The time limit for receiving replies to DNS queries that are
+/*	sent with "smtpd_dns_prefetch = yes".
 /* SENDER AND RECIPIENT ADDRESS VERIFICATION CONTROLS
 /* .ad
 /* .fi
@@ -1029,6 +1053,11 @@
 /* .IP "\fBaddress_verify_sender_ttl (0s)\fR"
 /*	The time between changes in the time-dependent portion of address
 /*	verification probe sender addresses.
+/* .PP
+/*	Available in Postfix 3.11 and later:
+/* .IP "\fBaddress_verify_shared_cache_file (empty)\fR"
+/*	Optional memory-mapped file that shares address verification
+/*	results with Postfix SMTP server processes.
 /* ACCESS CONTROL RESPONSES
 /* .ad
 /* .fi
@@ -1439,6 +1468,7 @@ char   *var_verp_clients;
 int     var_show_unk_rcpt_table;
 int     var_verify_poll_count;
 int     var_verify_poll_delay;
+char   *var_verify_mmap_file;
 char   *var_smtpd_proxy_filt;
 int     var_smtpd_proxy_tmout;
 char   *var_smtpd_proxy_ehlo;
@@ -1450,6 +1480,8 @@ int     var_smtpd_policy_try_limit;
 int     var_smtpd_policy_try_delay;
 char   *var_smtpd_policy_def_action;
 char   *var_smtpd_policy_context;
+char   *var_smtpd_policy_cache_attrs;
+int     var_smtpd_policy_cache_ttl;
 int     var_smtpd_policy_idle;
 int     var_smtpd_policy_ttl;
 char   *var_xclient_hosts;
@@ -1480,6 +1512,9 @@ char   *var_smtpd_rej_footer;
 char   *var_smtpd_rej_ftr_maps;
 char   *var_smtpd_acl_perm_log;
 char   *var_smtpd_dns_re_filter;
+bool    var_smtpd_dns_prefetch;
+int     var_smtpd_dns_prefetch_tmout;
+int     var_smtpd_idle_release;
 
 #ifdef USE_TLS
 char   *var_smtpd_relay_ccerts;
@@ -1657,6 +1692,11 @@ static int ask_client_cert;
   */
 static DICT *smtpd_cmd_filter;
 
+ /*
+  * Number of times that shared resources were released for an idle client.
+  */
+static int smtpd_idle_releases;
+
  /*
   * Parsed header_from_format setting.
   */
@@ -3659,12 +3699,13 @@ static void receive_data_message(SMTPD_STATE *state,
 				         int out_error)
 {
     SMTPD_PROXY *proxy = state->proxy;
-    char   *start;
-    int     len;
+    const char *start;
+    ssize_t len;
     int     curr_rec_type;
     int     prev_rec_type;
     int     first = 1;
     int     prev_got_bare_lf = 0;
+    ssize_t client_bufsize;
 
     /*
      * If deadlines are enabled, increase the time budget as message content
@@ -3673,6 +3714,23 @@ static void receive_data_message(SMTPD_STATE *state,
     smtp_stream_setup(state->client, var_smtpd_tmout, var_smtpd_req_deadline,
 		      var_smtpd_min_data_rate);
 
+    /*
+     * Read and write message content in larger chunks. This reduces the
+     * number of system calls per message, and makes it more likely that a
+     * complete line is already in the input buffer. The client stream gets
+     * its original buffer size back after the message, so that an idle
+     * session does not hold on to the larger buffer.
+     */
+#define SMTPD_DATA_BUFSIZE	(4 * VSTREAM_BUFSIZE)
+
+    client_bufsize = vstream_req_bufsize(state->client);
+    vstream_control(state->client,
+		    CA_VSTREAM_CTL_BUFSIZE(SMTPD_DATA_BUFSIZE),
+		    CA_VSTREAM_CTL_END);
+    vstream_control(out_stream,
+		    CA_VSTREAM_CTL_BUFSIZE(SMTPD_DATA_BUFSIZE),
+		    CA_VSTREAM_CTL_END);
+
     /*
      * Copy the message content. If the cleanup process has a problem, keep
      * reading until the remote stops sending, then complain. Produce typed
@@ -3684,20 +3742,29 @@ static void receive_data_message(SMTPD_STATE *state,
      * 
      * XXX Deal with UNIX-style From_ lines at the start of message content
      * because sendmail permits it.
+     * 
+     * After the first line, process complete lines in place in the input
+     * buffer, and copy only lines that span buffers or that exceed the
+     * line length limit.
      */
     for (prev_rec_type = 0; /* void */ ; prev_rec_type = curr_rec_type,
 	 prev_got_bare_lf = smtp_got_bare_lf) {
-	if (smtp_get(state->buffer, state->client, var_line_limit,
-		     SMTP_GET_FLAG_NONE) == '\n')
+	if (first == 0 && smtp_get_view(state->client, var_line_limit,
+					&start, &len) == '\n') {
 	    curr_rec_type = REC_TYPE_NORM;
-	else
-	    curr_rec_type = REC_TYPE_CONT;
+	} else {
+	    if (smtp_get(state->buffer, state->client, var_line_limit,
+			 SMTP_GET_FLAG_NONE) == '\n')
+		curr_rec_type = REC_TYPE_NORM;
+	    else
+		curr_rec_type = REC_TYPE_CONT;
+	    start = vstring_str(state->buffer);
+	    len = VSTRING_LEN(state->buffer);
+	}
 	if (IS_BARE_LF_REPLY_REJECT(smtp_got_bare_lf))
 	    state->err |= CLEANUP_STAT_BARE_LF;
 	else if (IS_BARE_LF_NOTE_LOG(smtp_got_bare_lf))
 	    state->notes |= SMTPD_NOTE_BARE_LF;
-	start = vstring_str(state->buffer);
-	len = VSTRING_LEN(state->buffer);
 	if (first) {
 	    if (strncmp(start + strspn(start, ">"), "From ", 5) == 0) {
 		out_fprintf(out_stream, curr_rec_type,
@@ -3729,6 +3796,9 @@ static void receive_data_message(SMTPD_STATE *state,
 	    }
 	}
     }
+    vstream_control(state->client,
+		    CA_VSTREAM_CTL_BUFSIZE(client_bufsize),
+		    CA_VSTREAM_CTL_END);
     state->where = SMTPD_AFTER_EOM;
 }
 
@@ -5692,6 +5762,44 @@ static int smtpd_flag_ill_pipelining(SMTPD_STATE *state)
     return (0);
 }
 
+/* smtpd_idle_release - release shared resources while the client is idle */
+
+static int smtpd_idle_release(SMTPD_STATE *state)
+{
+
+    /*
+     * Don't wait when the client has already sent the next command. Flush
+     * pending output first, otherwise we would wait for a client that
+     * still waits for our reply.
+     */
+    if (vstream_peek(state->client) > 0)
+	return (0);
+#ifdef USE_TLS
+    if (state->tls_context && state->tls_context->con
+	&& SSL_pending(state->tls_context->con) > 0)
+	return (0);
+#endif
+    smtp_flush(state->client);
+    if (read_wait(vstream_fileno(state->client), var_smtpd_idle_release) == 0)
+	return (0);
+
+    /*
+     * The client is idle. Close connections that would otherwise tie up a
+     * server process for the remainder of this session. The next request
+     * will reconnect. Connections with per-session state (anvil, Milters)
+     * are left alone.
+     */
+    smtpd_check_policy_release();
+    smtpd_idle_releases += 1;
+
+    /*
+     * Preserve the total time limit for reading the next command.
+     */
+    smtp_stream_setup(state->client, var_smtpd_tmout - var_smtpd_idle_release,
+		      var_smtpd_req_deadline, 0);
+    return (1);
+}
+
 /* smtpd_proto - talk the SMTP protocol */
 
 static void smtpd_proto(SMTPD_STATE *state)
@@ -5896,6 +6004,13 @@ static void smtpd_proto(SMTPD_STATE *state)
 	    ehlo_words = var_smtpd_ehlo_dis_words;
 	state->ehlo_discard_mask = ehlo_mask(ehlo_words);
 
+	/*
+	 * Start the DNS queries for client-based restrictions, so that
+	 * they overlap with the greeting and EHLO round trip.
+	 */
+	if (SMTPD_STAND_ALONE(state) == 0)
+	    smtpd_check_dns_prefetch(state);
+
 	/* XXX We use the real client for connect access control. */
 	if (SMTPD_STAND_ALONE(state) == 0
 	    && var_smtpd_delay_reject == 0
@@ -5984,7 +6099,16 @@ static void smtpd_proto(SMTPD_STATE *state)
 		break;
 	    }
 	    watchdog_pat();
-	    smtpd_chat_query(state);
+	    if (var_smtpd_idle_release > 0
+		&& var_smtpd_idle_release < var_smtpd_tmout
+		&& SMTPD_STAND_ALONE(state) == 0
+		&& smtpd_idle_release(state) != 0) {
+		smtpd_chat_query(state);
+		smtp_stream_setup(state->client, var_smtpd_tmout,
+				  var_smtpd_req_deadline, 0);
+	    } else {
+		smtpd_chat_query(state);
+	    }
 	    if (IS_BARE_LF_REPLY_REJECT(smtp_got_bare_lf)) {
 		log_whatsup(state, "reject", "bare <LF> received");
 		state->error_mask |= MAIL_ERROR_PROTOCOL;
@@ -6641,6 +6765,17 @@ static void pre_jail_init(char *unused_name, char **unused_argv)
 	smtpd_chat_pre_jail_init();
 }
 
+/* pre_exit - log statistics before normal process termination */
+
+static void pre_exit(char *unused_name, char **unused_argv)
+{
+    smtpd_check_policy_stats();
+    smtpd_check_verify_stats();
+    if (smtpd_idle_releases > 0)
+	msg_info("statistics: idle client connection releases=%d",
+		 smtpd_idle_releases);
+}
+
 /* post_jail_init - post-jail initialization */
 
 static void post_jail_init(char *unused_name, char **unused_argv)
@@ -6757,6 +6892,9 @@ int     main(int argc, char **argv)
 	VAR_SMTPD_POLICY_TMOUT, DEF_SMTPD_POLICY_TMOUT, &var_smtpd_policy_tmout, 1, 0,
 	VAR_SMTPD_POLICY_IDLE, DEF_SMTPD_POLICY_IDLE, &var_smtpd_policy_idle, 1, 0,
 	VAR_SMTPD_POLICY_TTL, DEF_SMTPD_POLICY_TTL, &var_smtpd_policy_ttl, 1, 0,
+	VAR_SMTPD_POLICY_CACHE_TTL, DEF_SMTPD_POLICY_CACHE_TTL, &var_smtpd_policy_cache_ttl, 1, 0,
+	VAR_SMTPD_DNS_PREFETCH_TMOUT, DEF_SMTPD_DNS_PREFETCH_TMOUT, &var_smtpd_dns_prefetch_tmout, 1, 0,
+	VAR_SMTPD_IDLE_RELEASE, DEF_SMTPD_IDLE_RELEASE, &var_smtpd_idle_release, 0, 0,
 #ifdef USE_TLS
 	VAR_SMTPD_STARTTLS_TMOUT, DEF_SMTPD_STARTTLS_TMOUT, &var_smtpd_starttls_tmout, 1, 0,
 #endif
@@ -6795,6 +6933,7 @@ int     main(int argc, char **argv)
 	VAR_SMTPD_DELAY_OPEN, DEF_SMTPD_DELAY_OPEN, &var_smtpd_delay_open,
 	VAR_SMTPD_CLIENT_PORT_LOG, DEF_SMTPD_CLIENT_PORT_LOG, &var_smtpd_client_port_log,
 	VAR_SMTPD_FORBID_UNAUTH_PIPE, DEF_SMTPD_FORBID_UNAUTH_PIPE, &var_smtpd_forbid_unauth_pipe,
+	VAR_SMTPD_DNS_PREFETCH, DEF_SMTPD_DNS_PREFETCH, &var_smtpd_dns_prefetch,
 	0,
     };
     static const CONFIG_NBOOL_TABLE nbool_table[] = {
@@ -6909,6 +7048,8 @@ int     main(int argc, char **argv)
 	VAR_SMTPD_UPROXY_PROTO, DEF_SMTPD_UPROXY_PROTO, &var_smtpd_uproxy_proto, 0, 0,
 	VAR_SMTPD_POLICY_DEF_ACTION, DEF_SMTPD_POLICY_DEF_ACTION, &var_smtpd_policy_def_action, 1, 0,
 	VAR_SMTPD_POLICY_CONTEXT, DEF_SMTPD_POLICY_CONTEXT, &var_smtpd_policy_context, 0, 0,
+	VAR_SMTPD_POLICY_CACHE_ATTRS, DEF_SMTPD_POLICY_CACHE_ATTRS, &var_smtpd_policy_cache_attrs, 0, 0,
+	VAR_VERIFY_MMAP_FILE, DEF_VERIFY_MMAP_FILE, &var_verify_mmap_file, 0, 0,
 	VAR_SMTPD_DNS_RE_FILTER, DEF_SMTPD_DNS_RE_FILTER, &var_smtpd_dns_re_filter, 0, 0,
 	VAR_SMTPD_REJ_FTR_MAPS, DEF_SMTPD_REJ_FTR_MAPS, &var_smtpd_rej_ftr_maps, 0, 0,
 	VAR_HFROM_FORMAT, DEF_HFROM_FORMAT, &var_hfrom_format, 1, 0,
@@ -6943,5 +7084,6 @@ int     main(int argc, char **argv)
 		       CA_MAIL_SERVER_PRE_INIT(pre_jail_init),
 		       CA_MAIL_SERVER_PRE_ACCEPT(pre_accept),
 		       CA_MAIL_SERVER_POST_INIT(post_jail_init),
+		       CA_MAIL_SERVER_EXIT(pre_exit),
 		       0);
 }
@@ -17,6 +17,9 @@
 /*	char	*smtpd_check_rewrite(state)
 /*	SMTPD_STATE *state;
 /*
+/*	void	smtpd_check_dns_prefetch(state)
+/*	SMTPD_STATE *state;
+/*
 /*	char	*smtpd_check_client(state)
 /*	SMTPD_STATE *state;
 /*
@@ -48,6 +51,12 @@
 /*
 /*	char	*smtpd_check_queue(state)
 /*	SMTPD_STATE *state;
+/*
+/*	void	smtpd_check_policy_stats()
+/*
+/*	void	smtpd_check_verify_stats()
+/*
+/*	void	smtpd_check_policy_release()
 /* AUXILIARY FUNCTIONS
 /*	void	log_whatsup(state, action, text)
 /*	SMTPD_STATE *state;
@@ -71,6 +80,20 @@
 /*	file or proxy connection, in order to establish the proper
 /*	header address rewriting context.
 /*
+/*	smtpd_check_dns_prefetch() should be called when a client
+/*	connects. With "smtpd_dns_prefetch = yes", it sends all DNS
+/*	queries that the restriction lists can make with only the
+/*	client name and address, without waiting for replies. The
+/*	smtpd_check_client(), smtpd_check_helo(), smtpd_check_mail()
+/*	and smtpd_check_rcpt() routines do the same with the
+/*	information that becomes available at that stage, and wait
+/*	up to $smtpd_dns_prefetch_timeout for the replies, before
+/*	they evaluate restrictions in the order as specified. They
+/*	don't wait when the restriction lists for that stage start
+/*	with a permit that needs no DNS lookup and that would permit
+/*	the request. The queries only warm up the local resolver
+/*	cache; restrictions still make their own DNS lookups.
+/*
 /*	Each of the following routines scrutinizes the argument passed to
 /*	an SMTP command such as HELO, MAIL FROM, RCPT TO, or scrutinizes
 /*	the initial client connection request.  The administrator can
@@ -138,6 +161,21 @@
 /*	smtpd_check_eod() enforces generic restrictions after the
 /*	client has sent the END-OF-DATA command.
 /*
+/*	smtpd_check_policy_stats() logs, for each policy service,
+/*	the number of requests, the number of requests that were
+/*	answered from the optional reply cache, and a histogram of
+/*	request latencies. The counters are reset after logging.
+/*
+/*	smtpd_check_verify_stats() logs the number of address
+/*	verification requests that were answered from, or missed,
+/*	the optional shared cache of the verify(8) server. The
+/*	counters are reset after logging.
+/*
+/*	smtpd_check_policy_release() closes the connections to all
+/*	policy services, so that an idle SMTP session does not tie
+/*	up a policy server process. The next policy request will
+/*	open a new connection.
+/*
 /*	Arguments:
 /* .IP name
 /*	The client hostname, or \fIunknown\fR.
@@ -200,6 +238,8 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <errno.h>
+#include <time.h>
+#include <sys/time.h>
 
 #ifdef STRCASECMP_IN_STRINGS_H
 #include <strings.h>
@@ -253,6 +293,8 @@
 #include <mail_proto.h>
 #include <mail_addr.h>
 #include <verify_clnt.h>
+#include <verify_mmap.h>
+#include <data_redirect.h>
 #include <input_transp.h>
 #include <is_header.h>
 #include <valid_mailhost_addr.h>
@@ -294,6 +336,20 @@ static VSTRING *error_text;
 static CTABLE *smtpd_rbl_cache;
 static CTABLE *smtpd_rbl_byte_cache;
 
+ /*
+  * Optional DNS prefetch context, to load the answers for all DNS-based
+  * restrictions into the resolver cache at the start of a protocol stage.
+  */
+static DNS_PREFETCH *smtpd_dns_prefetch;
+
+ /*
+  * Optional shared address verification cache, with fresh results that are
+  * published by the verify(8) server.
+  */
+static VERIFY_MMAP *smtpd_verify_mmap;
+static int smtpd_verify_hits;
+static int smtpd_verify_misses;
+
  /*
   * Pre-opened SMTP recipient maps so we can reject mail for unknown users.
   * XXX This does not belong here and will eventually become part of the
@@ -343,28 +399,205 @@ static MAPS *relay_ccerts;
 static int access_parent_style;
 
  /*
-  * Pre-parsed restriction lists.
+  * Pre-parsed restriction lists. Each restriction name is looked up once,
+  * when a list is parsed, and is replaced with an operation code, so that
+  * generic_checks() does not have to compare it against every known
+  * restriction name each time that the list is evaluated. Restriction
+  * arguments (table names, DNS domains, policy servers) stay in argv[],
+  * and are consumed by the operation that needs them.
   */
-static ARGV *client_restrctions;
-static ARGV *helo_restrctions;
-static ARGV *mail_restrctions;
-static ARGV *relay_restrctions;
-static ARGV *fake_relay_restrctions;
-static ARGV *rcpt_restrctions;
-static ARGV *etrn_restrctions;
-static ARGV *data_restrctions;
-static ARGV *eod_restrictions;
+typedef struct {
+    ARGV   *argv;			/* restriction names and arguments */
+    int    *ops;			/* SMTPD_OP_XXX per argv[] element */
+} SMTPD_REST_PROG;
+
+static SMTPD_REST_PROG *client_restrctions;
+static SMTPD_REST_PROG *helo_restrctions;
+static SMTPD_REST_PROG *mail_restrctions;
+static SMTPD_REST_PROG *relay_restrctions;
+static SMTPD_REST_PROG *fake_relay_restrctions;
+static SMTPD_REST_PROG *rcpt_restrctions;
+static SMTPD_REST_PROG *etrn_restrctions;
+static SMTPD_REST_PROG *data_restrctions;
+static SMTPD_REST_PROG *eod_restrictions;
 
 static HTABLE *smtpd_rest_classes;
 static HTABLE *policy_clnt_table;
 static HTABLE *map_command_table;
 
-static ARGV *local_rewrite_clients;
+static SMTPD_REST_PROG *local_rewrite_clients;
+
+ /*
+  * Restriction operation codes. SMTPD_OP_CLASS is used for names that are
+  * not built-in; those are looked up as restriction class when the list is
+  * evaluated. SMTPD_OP_IMPLICIT_MAP is used for "type:table" without
+  * check_mumble_access command.
+  */
+#define SMTPD_OP_CLASS			0
+#define SMTPD_OP_WARN_IF_REJECT		1
+#define SMTPD_OP_PERMIT_ALL		2
+#define SMTPD_OP_DEFER_ALL		3
+#define SMTPD_OP_REJECT_ALL		4
+#define SMTPD_OP_REJECT_UNAUTH_PIPE	5
+#define SMTPD_OP_CHECK_POLICY_SERVICE	6
+#define SMTPD_OP_DEFER_IF_PERMIT	7
+#define SMTPD_OP_DEFER_IF_REJECT	8
+#define SMTPD_OP_SLEEP			9
+#define SMTPD_OP_REJECT_PLAINTEXT_SESSION	10
+#define SMTPD_OP_REJECT_UNKNOWN_CLIENT_HOSTNAME	11
+#define SMTPD_OP_REJECT_UNKNOWN_CLIENT	12
+#define SMTPD_OP_REJECT_UNKNOWN_REVERSE_HOSTNAME	13
+#define SMTPD_OP_PERMIT_INET_INTERFACES	14
+#define SMTPD_OP_PERMIT_MYNETWORKS	15
+#define SMTPD_OP_CHECK_CLIENT_ACL	16
+#define SMTPD_OP_CHECK_REVERSE_CLIENT_ACL	17
+#define SMTPD_OP_REJECT_MAPS_RBL	18
+#define SMTPD_OP_REJECT_RBL_CLIENT	19
+#define SMTPD_OP_REJECT_RBL		20
+#define SMTPD_OP_PERMIT_DNSWL_CLIENT	21
+#define SMTPD_OP_REJECT_RHSBL_CLIENT	22
+#define SMTPD_OP_PERMIT_RHSWL_CLIENT	23
+#define SMTPD_OP_REJECT_RHSBL_REVERSE_CLIENT	24
+#define SMTPD_OP_CHECK_CCERT_ACL	25
+#define SMTPD_OP_CHECK_SASL_ACL		26
+#define SMTPD_OP_CHECK_CLIENT_NS_ACL	27
+#define SMTPD_OP_CHECK_CLIENT_MX_ACL	28
+#define SMTPD_OP_CHECK_CLIENT_A_ACL	29
+#define SMTPD_OP_CHECK_REVERSE_CLIENT_NS_ACL	30
+#define SMTPD_OP_CHECK_REVERSE_CLIENT_MX_ACL	31
+#define SMTPD_OP_CHECK_REVERSE_CLIENT_A_ACL	32
+#define SMTPD_OP_CHECK_HELO_ACL		33
+#define SMTPD_OP_REJECT_INVALID_HELO_HOSTNAME	34
+#define SMTPD_OP_REJECT_INVALID_HOSTNAME	35
+#define SMTPD_OP_REJECT_UNKNOWN_HELO_HOSTNAME	36
+#define SMTPD_OP_REJECT_UNKNOWN_HOSTNAME	37
+#define SMTPD_OP_PERMIT_NAKED_IP_ADDR	38
+#define SMTPD_OP_CHECK_HELO_NS_ACL	39
+#define SMTPD_OP_CHECK_HELO_MX_ACL	40
+#define SMTPD_OP_CHECK_HELO_A_ACL	41
+#define SMTPD_OP_REJECT_NON_FQDN_HELO_HOSTNAME	42
+#define SMTPD_OP_REJECT_NON_FQDN_HOSTNAME	43
+#define SMTPD_OP_REJECT_RHSBL_HELO	44
+#define SMTPD_OP_CHECK_SENDER_ACL	45
+#define SMTPD_OP_REJECT_UNKNOWN_ADDRESS	46
+#define SMTPD_OP_REJECT_UNKNOWN_SENDDOM	47
+#define SMTPD_OP_REJECT_UNVERIFIED_SENDER	48
+#define SMTPD_OP_REJECT_NON_FQDN_SENDER	49
+#define SMTPD_OP_REJECT_AUTH_SENDER_LOGIN_MISMATCH	50
+#define SMTPD_OP_REJECT_KNOWN_SENDER_LOGIN_MISMATCH	51
+#define SMTPD_OP_REJECT_UNAUTH_SENDER_LOGIN_MISMATCH	52
+#define SMTPD_OP_CHECK_SENDER_NS_ACL	53
+#define SMTPD_OP_CHECK_SENDER_MX_ACL	54
+#define SMTPD_OP_CHECK_SENDER_A_ACL	55
+#define SMTPD_OP_REJECT_RHSBL_SENDER	56
+#define SMTPD_OP_REJECT_UNLISTED_SENDER	57
+#define SMTPD_OP_CHECK_RECIP_ACL	58
+#define SMTPD_OP_PERMIT_MX_BACKUP	59
+#define SMTPD_OP_PERMIT_AUTH_DEST	60
+#define SMTPD_OP_REJECT_UNAUTH_DEST	61
+#define SMTPD_OP_DEFER_UNAUTH_DEST	62
+#define SMTPD_OP_CHECK_RELAY_DOMAINS	63
+#define SMTPD_OP_PERMIT_SASL_AUTH	64
+#define SMTPD_OP_PERMIT_TLS_ALL_CLIENTCERTS	65
+#define SMTPD_OP_PERMIT_TLS_CLIENTCERTS	66
+#define SMTPD_OP_REJECT_UNKNOWN_RCPTDOM	67
+#define SMTPD_OP_REJECT_NON_FQDN_RCPT	68
+#define SMTPD_OP_CHECK_RECIP_NS_ACL	69
+#define SMTPD_OP_CHECK_RECIP_MX_ACL	70
+#define SMTPD_OP_CHECK_RECIP_A_ACL	71
+#define SMTPD_OP_REJECT_RHSBL_RECIPIENT	72
+#define SMTPD_OP_CHECK_RCPT_MAPS	73
+#define SMTPD_OP_REJECT_UNLISTED_RCPT	74
+#define SMTPD_OP_REJECT_MUL_RCPT_BOUNCE	75
+#define SMTPD_OP_REJECT_UNVERIFIED_RECIP	76
+#define SMTPD_OP_CHECK_ETRN_ACL		77
+#define SMTPD_OP_IMPLICIT_MAP		78
+
+static const NAME_CODE smtpd_check_ops[] = {
+    WARN_IF_REJECT, SMTPD_OP_WARN_IF_REJECT,
+    PERMIT_ALL, SMTPD_OP_PERMIT_ALL,
+    DEFER_ALL, SMTPD_OP_DEFER_ALL,
+    REJECT_ALL, SMTPD_OP_REJECT_ALL,
+    REJECT_UNAUTH_PIPE, SMTPD_OP_REJECT_UNAUTH_PIPE,
+    CHECK_POLICY_SERVICE, SMTPD_OP_CHECK_POLICY_SERVICE,
+    DEFER_IF_PERMIT, SMTPD_OP_DEFER_IF_PERMIT,
+    DEFER_IF_REJECT, SMTPD_OP_DEFER_IF_REJECT,
+    SLEEP, SMTPD_OP_SLEEP,
+    REJECT_PLAINTEXT_SESSION, SMTPD_OP_REJECT_PLAINTEXT_SESSION,
+    REJECT_UNKNOWN_CLIENT_HOSTNAME, SMTPD_OP_REJECT_UNKNOWN_CLIENT_HOSTNAME,
+    REJECT_UNKNOWN_CLIENT, SMTPD_OP_REJECT_UNKNOWN_CLIENT,
+    REJECT_UNKNOWN_REVERSE_HOSTNAME, SMTPD_OP_REJECT_UNKNOWN_REVERSE_HOSTNAME,
+    PERMIT_INET_INTERFACES, SMTPD_OP_PERMIT_INET_INTERFACES,
+    PERMIT_MYNETWORKS, SMTPD_OP_PERMIT_MYNETWORKS,
+    CHECK_CLIENT_ACL, SMTPD_OP_CHECK_CLIENT_ACL,
+    CHECK_REVERSE_CLIENT_ACL, SMTPD_OP_CHECK_REVERSE_CLIENT_ACL,
+    REJECT_MAPS_RBL, SMTPD_OP_REJECT_MAPS_RBL,
+    REJECT_RBL_CLIENT, SMTPD_OP_REJECT_RBL_CLIENT,
+    REJECT_RBL, SMTPD_OP_REJECT_RBL,
+    PERMIT_DNSWL_CLIENT, SMTPD_OP_PERMIT_DNSWL_CLIENT,
+    REJECT_RHSBL_CLIENT, SMTPD_OP_REJECT_RHSBL_CLIENT,
+    PERMIT_RHSWL_CLIENT, SMTPD_OP_PERMIT_RHSWL_CLIENT,
+    REJECT_RHSBL_REVERSE_CLIENT, SMTPD_OP_REJECT_RHSBL_REVERSE_CLIENT,
+    CHECK_CCERT_ACL, SMTPD_OP_CHECK_CCERT_ACL,
+    CHECK_SASL_ACL, SMTPD_OP_CHECK_SASL_ACL,
+    CHECK_CLIENT_NS_ACL, SMTPD_OP_CHECK_CLIENT_NS_ACL,
+    CHECK_CLIENT_MX_ACL, SMTPD_OP_CHECK_CLIENT_MX_ACL,
+    CHECK_CLIENT_A_ACL, SMTPD_OP_CHECK_CLIENT_A_ACL,
+    CHECK_REVERSE_CLIENT_NS_ACL, SMTPD_OP_CHECK_REVERSE_CLIENT_NS_ACL,
+    CHECK_REVERSE_CLIENT_MX_ACL, SMTPD_OP_CHECK_REVERSE_CLIENT_MX_ACL,
+    CHECK_REVERSE_CLIENT_A_ACL, SMTPD_OP_CHECK_REVERSE_CLIENT_A_ACL,
+    CHECK_HELO_ACL, SMTPD_OP_CHECK_HELO_ACL,
+    REJECT_INVALID_HELO_HOSTNAME, SMTPD_OP_REJECT_INVALID_HELO_HOSTNAME,
+    REJECT_INVALID_HOSTNAME, SMTPD_OP_REJECT_INVALID_HOSTNAME,
+    REJECT_UNKNOWN_HELO_HOSTNAME, SMTPD_OP_REJECT_UNKNOWN_HELO_HOSTNAME,
+    REJECT_UNKNOWN_HOSTNAME, SMTPD_OP_REJECT_UNKNOWN_HOSTNAME,
+    PERMIT_NAKED_IP_ADDR, SMTPD_OP_PERMIT_NAKED_IP_ADDR,
+    CHECK_HELO_NS_ACL, SMTPD_OP_CHECK_HELO_NS_ACL,
+    CHECK_HELO_MX_ACL, SMTPD_OP_CHECK_HELO_MX_ACL,
+    CHECK_HELO_A_ACL, SMTPD_OP_CHECK_HELO_A_ACL,
+    REJECT_NON_FQDN_HELO_HOSTNAME, SMTPD_OP_REJECT_NON_FQDN_HELO_HOSTNAME,
+    REJECT_NON_FQDN_HOSTNAME, SMTPD_OP_REJECT_NON_FQDN_HOSTNAME,
+    REJECT_RHSBL_HELO, SMTPD_OP_REJECT_RHSBL_HELO,
+    CHECK_SENDER_ACL, SMTPD_OP_CHECK_SENDER_ACL,
+    REJECT_UNKNOWN_ADDRESS, SMTPD_OP_REJECT_UNKNOWN_ADDRESS,
+    REJECT_UNKNOWN_SENDDOM, SMTPD_OP_REJECT_UNKNOWN_SENDDOM,
+    REJECT_UNVERIFIED_SENDER, SMTPD_OP_REJECT_UNVERIFIED_SENDER,
+    REJECT_NON_FQDN_SENDER, SMTPD_OP_REJECT_NON_FQDN_SENDER,
+    REJECT_AUTH_SENDER_LOGIN_MISMATCH, SMTPD_OP_REJECT_AUTH_SENDER_LOGIN_MISMATCH,
+    REJECT_KNOWN_SENDER_LOGIN_MISMATCH, SMTPD_OP_REJECT_KNOWN_SENDER_LOGIN_MISMATCH,
+    REJECT_UNAUTH_SENDER_LOGIN_MISMATCH, SMTPD_OP_REJECT_UNAUTH_SENDER_LOGIN_MISMATCH,
+    CHECK_SENDER_NS_ACL, SMTPD_OP_CHECK_SENDER_NS_ACL,
+    CHECK_SENDER_MX_ACL, SMTPD_OP_CHECK_SENDER_MX_ACL,
+    CHECK_SENDER_A_ACL, SMTPD_OP_CHECK_SENDER_A_ACL,
+    REJECT_RHSBL_SENDER, SMTPD_OP_REJECT_RHSBL_SENDER,
+    REJECT_UNLISTED_SENDER, SMTPD_OP_REJECT_UNLISTED_SENDER,
+    CHECK_RECIP_ACL, SMTPD_OP_CHECK_RECIP_ACL,
+    PERMIT_MX_BACKUP, SMTPD_OP_PERMIT_MX_BACKUP,
+    PERMIT_AUTH_DEST, SMTPD_OP_PERMIT_AUTH_DEST,
+    REJECT_UNAUTH_DEST, SMTPD_OP_REJECT_UNAUTH_DEST,
+    DEFER_UNAUTH_DEST, SMTPD_OP_DEFER_UNAUTH_DEST,
+    CHECK_RELAY_DOMAINS, SMTPD_OP_CHECK_RELAY_DOMAINS,
+    PERMIT_SASL_AUTH, SMTPD_OP_PERMIT_SASL_AUTH,
+    PERMIT_TLS_ALL_CLIENTCERTS, SMTPD_OP_PERMIT_TLS_ALL_CLIENTCERTS,
+    PERMIT_TLS_CLIENTCERTS, SMTPD_OP_PERMIT_TLS_CLIENTCERTS,
+    REJECT_UNKNOWN_RCPTDOM, SMTPD_OP_REJECT_UNKNOWN_RCPTDOM,
+    REJECT_NON_FQDN_RCPT, SMTPD_OP_REJECT_NON_FQDN_RCPT,
+    CHECK_RECIP_NS_ACL, SMTPD_OP_CHECK_RECIP_NS_ACL,
+    CHECK_RECIP_MX_ACL, SMTPD_OP_CHECK_RECIP_MX_ACL,
+    CHECK_RECIP_A_ACL, SMTPD_OP_CHECK_RECIP_A_ACL,
+    REJECT_RHSBL_RECIPIENT, SMTPD_OP_REJECT_RHSBL_RECIPIENT,
+    CHECK_RCPT_MAPS, SMTPD_OP_CHECK_RCPT_MAPS,
+    REJECT_UNLISTED_RCPT, SMTPD_OP_REJECT_UNLISTED_RCPT,
+    REJECT_MUL_RCPT_BOUNCE, SMTPD_OP_REJECT_MUL_RCPT_BOUNCE,
+    REJECT_UNVERIFIED_RECIP, SMTPD_OP_REJECT_UNVERIFIED_RECIP,
+    CHECK_ETRN_ACL, SMTPD_OP_CHECK_ETRN_ACL,
+    0, SMTPD_OP_CLASS,
+};
 
  /*
   * The routine that recursively applies restrictions.
   */
-static int generic_checks(SMTPD_STATE *, ARGV *, const char *, const char *, const char *);
+static int generic_checks(SMTPD_STATE *, SMTPD_REST_PROG *, const char *, const char *, const char *);
 
  /*
   * Recipient table check.
@@ -485,12 +718,78 @@ double  smtpd_space_multf = 1.5;
  /*
   * SMTPD policy client. Most attributes are ATTR_CLNT attributes.
   */
+#define SMTPD_POLICY_LAT_BUCKETS	13	/* see smtpd_policy_lat_limits */
+
 typedef struct {
     ATTR_CLNT *client;			/* client handle */
+    char   *name;			/* policy service name */
     char   *def_action;			/* default action */
     char   *policy_context;		/* context of policy request */
+    int    *cache_attrs;		/* reply cache key attributes */
+    int     cache_attr_count;		/* number of key attributes */
+    int     cache_ttl;			/* reply cache time to live */
+    HTABLE *cache;			/* cached replies, or null */
+    int     requests;			/* requests sent to server */
+    int     cache_hits;			/* requests answered from cache */
+    int     latency[SMTPD_POLICY_LAT_BUCKETS];	/* request latency */
 } SMTPD_POLICY_CLNT;
 
+ /*
+  * Cached policy server reply.
+  */
+typedef struct {
+    char   *action;			/* policy server reply */
+    time_t  expires;			/* time of expiration */
+} SMTPD_POLICY_CACHE_ENTRY;
+
+#define SMTPD_POLICY_CACHE_LIMIT	1000	/* max entries per service */
+
+ /*
+  * Upper bounds in milliseconds of the policy latency histogram buckets;
+  * the last bucket counts everything else.
+  */
+static const int smtpd_policy_lat_limits[SMTPD_POLICY_LAT_BUCKETS - 1] = {
+    1, 2, 5, 10, 20, 50, 100, 200, 500, 1000, 2000, 5000,
+};
+
+ /*
+  * Policy request attributes that may be used as reply cache key.
+  */
+#define SMTPD_POLICY_KEY_CLIENT_ADDR	1
+#define SMTPD_POLICY_KEY_CLIENT_NAME	2
+#define SMTPD_POLICY_KEY_REV_CLIENT_NAME	3
+#define SMTPD_POLICY_KEY_SERVER_ADDR	4
+#define SMTPD_POLICY_KEY_SERVER_PORT	5
+#define SMTPD_POLICY_KEY_PROTO_NAME	6
+#define SMTPD_POLICY_KEY_HELO_NAME	7
+#define SMTPD_POLICY_KEY_SENDER		8
+#define SMTPD_POLICY_KEY_RECIP		9
+#define SMTPD_POLICY_KEY_ETRN_DOMAIN	10
+#define SMTPD_POLICY_KEY_SASL_METHOD	11
+#define SMTPD_POLICY_KEY_SASL_USERNAME	12
+#define SMTPD_POLICY_KEY_SASL_SENDER	13
+#define SMTPD_POLICY_KEY_CERT_FPRINT	14
+#define SMTPD_POLICY_KEY_PKEY_FPRINT	15
+
+static const NAME_CODE smtpd_policy_key_attrs[] = {
+    MAIL_ATTR_ACT_CLIENT_ADDR, SMTPD_POLICY_KEY_CLIENT_ADDR,
+    MAIL_ATTR_ACT_CLIENT_NAME, SMTPD_POLICY_KEY_CLIENT_NAME,
+    MAIL_ATTR_ACT_REVERSE_CLIENT_NAME, SMTPD_POLICY_KEY_REV_CLIENT_NAME,
+    MAIL_ATTR_ACT_SERVER_ADDR, SMTPD_POLICY_KEY_SERVER_ADDR,
+    MAIL_ATTR_ACT_SERVER_PORT, SMTPD_POLICY_KEY_SERVER_PORT,
+    MAIL_ATTR_ACT_PROTO_NAME, SMTPD_POLICY_KEY_PROTO_NAME,
+    MAIL_ATTR_ACT_HELO_NAME, SMTPD_POLICY_KEY_HELO_NAME,
+    MAIL_ATTR_SENDER, SMTPD_POLICY_KEY_SENDER,
+    MAIL_ATTR_RECIP, SMTPD_POLICY_KEY_RECIP,
+    MAIL_ATTR_ETRN_DOMAIN, SMTPD_POLICY_KEY_ETRN_DOMAIN,
+    MAIL_ATTR_SASL_METHOD, SMTPD_POLICY_KEY_SASL_METHOD,
+    MAIL_ATTR_SASL_USERNAME, SMTPD_POLICY_KEY_SASL_USERNAME,
+    MAIL_ATTR_SASL_SENDER, SMTPD_POLICY_KEY_SASL_SENDER,
+    MAIL_ATTR_CCERT_CERT_FPRINT, SMTPD_POLICY_KEY_CERT_FPRINT,
+    MAIL_ATTR_CCERT_PKEY_FPRINT, SMTPD_POLICY_KEY_PKEY_FPRINT,
+    0, 0,
+};
+
  /*
   * Table-driven parsing of main.cf parameter overrides for specific policy
   * clients. We derive the override names from the corresponding main.cf
@@ -501,6 +800,7 @@ static ATTR_OVER_TIME time_table[] = {
     21 + (const char *) VAR_SMTPD_POLICY_IDLE, DEF_SMTPD_POLICY_IDLE, 0, 1, 0,
     21 + (const char *) VAR_SMTPD_POLICY_TTL, DEF_SMTPD_POLICY_TTL, 0, 1, 0,
     21 + (const char *) VAR_SMTPD_POLICY_TRY_DELAY, DEF_SMTPD_POLICY_TRY_DELAY, 0, 1, 0,
+    21 + (const char *) VAR_SMTPD_POLICY_CACHE_TTL, DEF_SMTPD_POLICY_CACHE_TTL, 0, 1, 0,
     0,
 };
 static ATTR_OVER_INT int_table[] = {
@@ -511,6 +811,7 @@ static ATTR_OVER_INT int_table[] = {
 static ATTR_OVER_STR str_table[] = {
     21 + (const char *) VAR_SMTPD_POLICY_DEF_ACTION, 0, 1, 0,
     21 + (const char *) VAR_SMTPD_POLICY_CONTEXT, 0, 1, 0,
+    21 + (const char *) VAR_SMTPD_POLICY_CACHE_ATTRS, 0, 0, 0,
     0,
 };
 
@@ -521,12 +822,14 @@ static ATTR_OVER_STR str_table[] = {
 #define smtpd_policy_idle_offset	1
 #define smtpd_policy_ttl_offset		2
 #define smtpd_policy_try_delay_offset	3
+#define smtpd_policy_cache_ttl_offset	4
 
 #define smtpd_policy_req_limit_offset	0
 #define smtpd_policy_try_limit_offset	1
 
 #define smtpd_policy_def_action_offset	0
 #define smtpd_policy_context_offset	1
+#define smtpd_policy_cache_attrs_offset	2
 
  /*
   * Search order names must be distinct, non-empty, and non-null.
@@ -586,6 +889,10 @@ static void policy_client_register(const char *name)
 	int     smtpd_policy_try_limit = var_smtpd_policy_try_limit;
 	const char *smtpd_policy_def_action = var_smtpd_policy_def_action;
 	const char *smtpd_policy_context = var_smtpd_policy_context;
+	int     smtpd_policy_cache_ttl = var_smtpd_policy_cache_ttl;
+	const char *smtpd_policy_cache_attrs = var_smtpd_policy_cache_attrs;
+	ARGV   *cache_attrs;
+	int     n;
 
 	link_override_table_to_variable(time_table, smtpd_policy_tmout);
 	link_override_table_to_variable(time_table, smtpd_policy_idle);
@@ -595,6 +902,8 @@ static void policy_client_register(const char *name)
 	link_override_table_to_variable(int_table, smtpd_policy_try_limit);
 	link_override_table_to_variable(str_table, smtpd_policy_def_action);
 	link_override_table_to_variable(str_table, smtpd_policy_context);
+	link_override_table_to_variable(time_table, smtpd_policy_cache_ttl);
+	link_override_table_to_variable(str_table, smtpd_policy_cache_attrs);
 
 	if (*name == parens[0]) {
 	    cp = saved_name = mystrdup(name);
@@ -613,12 +922,14 @@ static void policy_client_register(const char *name)
 	if (msg_verbose)
 	    msg_info("%s: name=\"%s\" default_action=\"%s\" max_idle=%d "
 		     "max_ttl=%d request_limit=%d retry_delay=%d "
-		     "timeout=%d try_limit=%d policy_context=\"%s\"",
+		     "timeout=%d try_limit=%d policy_context=\"%s\" "
+		     "cache_attributes=\"%s\" cache_ttl=%d",
 		     myname, policy_name, smtpd_policy_def_action,
 		     smtpd_policy_idle, smtpd_policy_ttl,
 		     smtpd_policy_req_limit, smtpd_policy_try_delay,
 		     smtpd_policy_tmout, smtpd_policy_try_limit,
-		     smtpd_policy_context);
+		     smtpd_policy_context, smtpd_policy_cache_attrs,
+		     smtpd_policy_cache_ttl);
 
 	/*
 	 * Create the client.
@@ -634,8 +945,32 @@ static void policy_client_register(const char *name)
 			  ATTR_CLNT_CTL_TRY_LIMIT, smtpd_policy_try_limit,
 			  ATTR_CLNT_CTL_TRY_DELAY, smtpd_policy_try_delay,
 			  ATTR_CLNT_CTL_END);
+	policy_client->name = mystrdup(policy_name);
 	policy_client->def_action = mystrdup(smtpd_policy_def_action);
 	policy_client->policy_context = mystrdup(smtpd_policy_context);
+
+	/*
+	 * Optional reply cache, keyed by the specified request attributes.
+	 */
+	cache_attrs = argv_split(smtpd_policy_cache_attrs, sep);
+	policy_client->cache_attr_count = cache_attrs->argc;
+	policy_client->cache_attrs = (int *)
+	    mymalloc(sizeof(int) * (cache_attrs->argc + 1));
+	for (n = 0; n < cache_attrs->argc; n++)
+	    if ((policy_client->cache_attrs[n] =
+		 name_code(smtpd_policy_key_attrs, NAME_CODE_FLAG_NONE,
+			   cache_attrs->argv[n])) == 0)
+		msg_fatal("policy service %s: unsupported %s attribute: \"%s\"",
+			  policy_name, VAR_SMTPD_POLICY_CACHE_ATTRS,
+			  cache_attrs->argv[n]);
+	argv_free(cache_attrs);
+	policy_client->cache_ttl = smtpd_policy_cache_ttl;
+	policy_client->cache = policy_client->cache_attr_count > 0 ?
+	    htable_create(1) : 0;
+	policy_client->requests = 0;
+	policy_client->cache_hits = 0;
+	memset((void *) policy_client->latency, 0,
+	       sizeof(policy_client->latency));
 	htable_enter(policy_clnt_table, name, (void *) policy_client);
 	if (saved_name)
 	    myfree(saved_name);
@@ -659,9 +994,41 @@ static void command_map_register(const char *name)
     }
 }
 
+/* smtpd_check_op - look up restriction operation code */
+
+static int smtpd_check_op(const char *name)
+{
+    if (strchr(name, ':') != 0)
+	return (SMTPD_OP_IMPLICIT_MAP);
+    return (name_code(smtpd_check_ops, NAME_CODE_FLAG_NONE, name));
+}
+
+/* smtpd_check_compile - look up operation codes for restriction list */
+
+static SMTPD_REST_PROG *smtpd_check_compile(ARGV *argv)
+{
+    SMTPD_REST_PROG *prog = (SMTPD_REST_PROG *) mymalloc(sizeof(*prog));
+    ssize_t n;
+
+    prog->argv = argv;
+    prog->ops = (int *) mymalloc(sizeof(*prog->ops) * (argv->argc + 1));
+    for (n = 0; n < argv->argc; n++)
+	prog->ops[n] = smtpd_check_op(argv->argv[n]);
+    return (prog);
+}
+
+/* smtpd_check_prog_free - destroy restriction list */
+
+static void smtpd_check_prog_free(SMTPD_REST_PROG *prog)
+{
+    argv_free(prog->argv);
+    myfree((void *) prog->ops);
+    myfree((void *) prog);
+}
+
 /* smtpd_check_parse - pre-parse restrictions */
 
-static ARGV *smtpd_check_parse(int flags, const char *checks)
+static SMTPD_REST_PROG *smtpd_check_parse(int flags, const char *checks)
 {
     char   *saved_checks = mystrdup(checks);
     ARGV   *argv = argv_alloc(1);
@@ -697,23 +1064,23 @@ static ARGV *smtpd_check_parse(int flags, const char *checks)
      * Cleanup.
      */
     myfree(saved_checks);
-    return (argv);
+    return (smtpd_check_compile(argv));
 }
 
 #ifndef TEST
 
 /* has_required - make sure required restriction is present */
 
-static int has_required(ARGV *restrictions, const char **required)
+static int has_required(SMTPD_REST_PROG *restrictions, const char **required)
 {
     char  **rest;
     const char **reqd;
-    ARGV   *expansion;
+    SMTPD_REST_PROG *expansion;
 
     /*
      * Recursively check list membership.
      */
-    for (rest = restrictions->argv; *rest; rest++) {
+    for (rest = restrictions->argv->argv; *rest; rest++) {
 	if (strcasecmp(*rest, WARN_IF_REJECT) == 0 && rest[1] != 0) {
 	    rest += 1;
 	    continue;
@@ -728,7 +1095,8 @@ static int has_required(ARGV *restrictions, const char **required)
 	    if (strcasecmp(*rest, *reqd) == 0)
 		return (1);
 	/* XXX This lookup operation should not be case-sensitive. */
-	if ((expansion = (ARGV *) htable_find(smtpd_rest_classes, *rest)) != 0)
+	if ((expansion = (SMTPD_REST_PROG *) htable_find(smtpd_rest_classes,
+							 *rest)) != 0)
 	    if (has_required(expansion, required))
 		return (1);
     }
@@ -880,6 +1248,25 @@ void    smtpd_check_init(void)
     smtpd_rbl_byte_cache = ctable_create(1000, rbl_byte_pagein,
 					 rbl_byte_pageout, (void *) 0);
 
+    /*
+     * Initialize the DNS prefetch context before going to jail.
+     */
+    if (var_smtpd_dns_prefetch)
+	smtpd_dns_prefetch = dns_prefetch_create();
+
+    /*
+     * Map the shared address verification cache before going to jail. The
+     * verify(8) server creates the file; until then, we always ask.
+     */
+    if (*var_verify_mmap_file) {
+	VSTRING *redirect = vstring_alloc(100);
+
+	smtpd_verify_mmap =
+	    verify_mmap_open(data_redirect_file(redirect, var_verify_mmap_file),
+			     0, O_RDONLY);
+	vstring_free(redirect);
+    }
+
     /*
      * Initialize access map search list support before parsing restriction
      * lists.
@@ -2245,16 +2632,30 @@ static int reject_unverified_address(SMTPD_STATE *state, const char *addr,
     if (msg_verbose)
 	msg_info("%s: %s", myname, addr);
 
+    /*
+     * Use a fresh result from the shared cache, if available.
+     */
+    if (smtpd_verify_mmap != 0
+	&& verify_mmap_lookup(smtpd_verify_mmap, addr, &rcpt_status, why)) {
+	verify_status = VRFY_STAT_OK;
+	smtpd_verify_hits += 1;
+    }
+
     /*
      * Verify the address. Don't waste too much of their or our time.
      */
-    for (count = 0; /* see below */ ; /* see below */ ) {
-	verify_status = verify_clnt_query(addr, &rcpt_status, why);
-	if (verify_status != VRFY_STAT_OK || rcpt_status != DEL_RCPT_STAT_TODO)
-	    break;
-	if (++count >= var_verify_poll_count)
-	    break;
-	sleep(var_verify_poll_delay);
+    else {
+	if (smtpd_verify_mmap != 0)
+	    smtpd_verify_misses += 1;
+	for (count = 0; /* see below */ ; /* see below */ ) {
+	    verify_status = verify_clnt_query(addr, &rcpt_status, why);
+	    if (verify_status != VRFY_STAT_OK
+		|| rcpt_status != DEL_RCPT_STAT_TODO)
+		break;
+	    if (++count >= var_verify_poll_count)
+		break;
+	    sleep(var_verify_poll_delay);
+	}
     }
     if (verify_status != VRFY_STAT_OK) {
 	msg_warn("%s service failure", var_verify_service);
@@ -2381,7 +2782,7 @@ static int check_table_result(SMTPD_STATE *state, const char *table,
 {
     const char *myname = "check_table_result";
     int     code;
-    ARGV   *restrictions;
+    SMTPD_REST_PROG *restrictions;
     jmp_buf savebuf;
     int     status;
     const char *cmd_text;
@@ -2758,16 +3159,17 @@ static int check_table_result(SMTPD_STATE *state, const char *table,
      */
 #define ADDROF(x) ((char *) &(x))
 
-    restrictions = argv_splitq(value, CHARS_COMMA_SP, CHARS_BRACE);
+    restrictions = smtpd_check_compile(argv_splitq(value, CHARS_COMMA_SP,
+						   CHARS_BRACE));
     memcpy(ADDROF(savebuf), ADDROF(smtpd_check_buf), sizeof(savebuf));
     status = setjmp(smtpd_check_buf);
     if (status != 0) {
-	argv_free(restrictions);
+	smtpd_check_prog_free(restrictions);
 	memcpy(ADDROF(smtpd_check_buf), ADDROF(savebuf),
 	       sizeof(smtpd_check_buf));
 	longjmp(smtpd_check_buf, status);
     }
-    if (restrictions->argc == 0) {
+    if (restrictions->argv->argc == 0) {
 	msg_warn("access table %s entry %s has empty value",
 		 table, value);
 	status = SMTPD_CHECK_OK;
@@ -2775,7 +3177,7 @@ static int check_table_result(SMTPD_STATE *state, const char *table,
 	status = generic_checks(state, restrictions, reply_name,
 				reply_class, def_acl);
     }
-    argv_free(restrictions);
+    smtpd_check_prog_free(restrictions);
     memcpy(ADDROF(smtpd_check_buf), ADDROF(savebuf), sizeof(smtpd_check_buf));
     return (status);
 }
@@ -3665,23 +4067,18 @@ static int rbl_match_addr(SMTPD_RBL_STATE *rbl, const char *byte_codes)
     return (0);
 }
 
-/* find_dnsxl_addr - look up address in DNSXL */
+/* dnsxl_addr_query - format DNSXL query name for address */
 
-static const SMTPD_RBL_STATE *find_dnsxl_addr(SMTPD_STATE *state,
-					              const char *rbl_domain,
-					              const char *addr)
+static void dnsxl_addr_query(VSTRING *query, const char *rbl_domain,
+			             const char *addr)
 {
-    const char *myname = "find_dnsxl_addr";
+    const char *myname = "dnsxl_addr_query";
     ARGV   *octets;
-    VSTRING *query;
     int     i;
-    SMTPD_RBL_STATE *rbl;
-    const char *reply_addr;
-    const char *byte_codes;
     struct addrinfo *res;
     unsigned char *ipv6_addr;
 
-    query = vstring_alloc(100);
+    VSTRING_RESET(query);
 
     /*
      * Reverse the client IPV6 address, represented as 32 hexadecimal
@@ -3716,9 +4113,27 @@ static const SMTPD_RBL_STATE *find_dnsxl_addr(SMTPD_STATE *state,
     }
 
     /*
-     * Tack on the RBL domain name and query the DNS for an A record.
+     * Tack on the RBL domain name.
      */
     vstring_strcat(query, rbl_domain);
+}
+
+/* find_dnsxl_addr - look up address in DNSXL */
+
+static const SMTPD_RBL_STATE *find_dnsxl_addr(SMTPD_STATE *state,
+					              const char *rbl_domain,
+					              const char *addr)
+{
+    VSTRING *query;
+    SMTPD_RBL_STATE *rbl;
+    const char *reply_addr;
+    const char *byte_codes;
+
+    /*
+     * Query the DNS for an A record.
+     */
+    query = vstring_alloc(100);
+    dnsxl_addr_query(query, rbl_domain, addr);
     reply_addr = split_at(STR(query), '=');
     rbl = (SMTPD_RBL_STATE *) ctable_locate(smtpd_rbl_cache, STR(query));
     if (reply_addr != 0)
@@ -3788,27 +4203,21 @@ static int permit_dnswl_addr(SMTPD_STATE *state, const char *dnswl_domain,
     }
 }
 
-/* find_dnsxl_domain - reject if domain in DNS deny list */
+/* dnsxl_domain_name - extract domain for DNSXL query, or null */
 
-static const SMTPD_RBL_STATE *find_dnsxl_domain(SMTPD_STATE *state,
-			           const char *rbl_domain, const char *what)
+static const char *dnsxl_domain_name(const char *what)
 {
-    VSTRING *query;
-    SMTPD_RBL_STATE *rbl;
     const char *domain;
-    const char *reply_addr;
-    const char *byte_codes;
     const char *suffix;
     const char *adomain;
 
     /*
-     * Extract the domain, tack on the RBL domain name and query the DNS for
-     * an A record.
+     * Extract the domain.
      */
     if ((domain = strrchr(what, '@')) != 0) {
 	domain += 1;
 	if (domain[0] == '[')
-	    return (SMTPD_CHECK_DUNNO);
+	    return (0);
     } else
 	domain = what;
 
@@ -3818,10 +4227,10 @@ static const SMTPD_RBL_STATE *find_dnsxl_domain(SMTPD_STATE *state,
      * RHSBL and RHSWL queries for names ending in a numerical suffix.
      */
     if (domain[0] == 0)
-	return (SMTPD_CHECK_DUNNO);
+	return (0);
     suffix = strrchr(domain, '.');
     if (alldig(suffix == 0 ? domain : suffix + 1))
-	return (SMTPD_CHECK_DUNNO);
+	return (0);
 
     /*
      * Fix 20140706: convert domain to ASCII.
@@ -3834,6 +4243,26 @@ static const SMTPD_RBL_STATE *find_dnsxl_domain(SMTPD_STATE *state,
     }
 #endif
     if (domain[0] == 0 || valid_hostname(domain, DONT_GRIPE) == 0)
+	return (0);
+    return (domain);
+}
+
+/* find_dnsxl_domain - reject if domain in DNS deny list */
+
+static const SMTPD_RBL_STATE *find_dnsxl_domain(SMTPD_STATE *state,
+			           const char *rbl_domain, const char *what)
+{
+    VSTRING *query;
+    SMTPD_RBL_STATE *rbl;
+    const char *domain;
+    const char *reply_addr;
+    const char *byte_codes;
+
+    /*
+     * Extract the domain, tack on the RBL domain name and query the DNS for
+     * an A record.
+     */
+    if ((domain = dnsxl_domain_name(what)) == 0)
 	return (SMTPD_CHECK_DUNNO);
 
     query = vstring_alloc(100);
@@ -4005,6 +4434,219 @@ static int valid_utf8_action(const char *server, const char *action)
     return (retval);
 }
 
+/* policy_cache_attr - look up request attribute for reply cache key */
+
+static const char *policy_cache_attr(SMTPD_STATE *state, int code)
+{
+#define STR_OR_EMPTY(s) ((s) ? (s) : "")
+
+    switch (code) {
+    case SMTPD_POLICY_KEY_CLIENT_ADDR:
+	return (state->addr);
+    case SMTPD_POLICY_KEY_CLIENT_NAME:
+	return (state->name);
+    case SMTPD_POLICY_KEY_REV_CLIENT_NAME:
+	return (state->reverse_name);
+    case SMTPD_POLICY_KEY_SERVER_ADDR:
+	return (state->dest_addr);
+    case SMTPD_POLICY_KEY_SERVER_PORT:
+	return (state->dest_port);
+    case SMTPD_POLICY_KEY_PROTO_NAME:
+	return (state->protocol);
+    case SMTPD_POLICY_KEY_HELO_NAME:
+	return (STR_OR_EMPTY(state->helo_name));
+    case SMTPD_POLICY_KEY_SENDER:
+	return (STR_OR_EMPTY(state->sender));
+    case SMTPD_POLICY_KEY_RECIP:
+	return (STR_OR_EMPTY(state->recipient));
+    case SMTPD_POLICY_KEY_ETRN_DOMAIN:
+	return (STR_OR_EMPTY(state->etrn_name));
+#ifdef USE_SASL_AUTH
+    case SMTPD_POLICY_KEY_SASL_METHOD:
+	return (STR_OR_EMPTY(state->sasl_method));
+    case SMTPD_POLICY_KEY_SASL_USERNAME:
+	return (STR_OR_EMPTY(state->sasl_username));
+    case SMTPD_POLICY_KEY_SASL_SENDER:
+	return (STR_OR_EMPTY(state->sasl_sender));
+#endif
+#ifdef USE_TLS
+    case SMTPD_POLICY_KEY_CERT_FPRINT:
+	return (state->tls_context ?
+		STR_OR_EMPTY(state->tls_context->peer_cert_fprint) : "");
+    case SMTPD_POLICY_KEY_PKEY_FPRINT:
+	return (state->tls_context ?
+		STR_OR_EMPTY(state->tls_context->peer_pkey_fprint) : "");
+#endif
+    default:
+	return ("");
+    }
+}
+
+/* policy_cache_key - compute reply cache key for this request */
+
+static void policy_cache_key(SMTPD_POLICY_CLNT *policy_clnt,
+			             SMTPD_STATE *state, VSTRING *key)
+{
+    const char *value;
+    int     n;
+
+    /*
+     * The protocol state is always part of the key. Prefix each value with
+     * its length, so that different requests cannot produce the same key.
+     */
+    vstring_sprintf(key, "%s", state->where);
+    for (n = 0; n < policy_clnt->cache_attr_count; n++) {
+	value = policy_cache_attr(state, policy_clnt->cache_attrs[n]);
+	vstring_sprintf_append(key, "|%ld:%s", (long) strlen(value), value);
+    }
+}
+
+/* policy_cache_free - destroy cached policy reply */
+
+static void policy_cache_free(void *ptr)
+{
+    SMTPD_POLICY_CACHE_ENTRY *entry = (SMTPD_POLICY_CACHE_ENTRY *) ptr;
+
+    myfree(entry->action);
+    myfree((void *) entry);
+}
+
+/* policy_cache_find - look up cached policy reply */
+
+static const char *policy_cache_find(SMTPD_POLICY_CLNT *policy_clnt,
+				             const char *key)
+{
+    SMTPD_POLICY_CACHE_ENTRY *entry;
+
+    if ((entry = (SMTPD_POLICY_CACHE_ENTRY *)
+	 htable_find(policy_clnt->cache, key)) == 0)
+	return (0);
+    if (entry->expires <= time((time_t *) 0)) {
+	htable_delete(policy_clnt->cache, key, policy_cache_free);
+	return (0);
+    }
+    return (entry->action);
+}
+
+/* policy_cache_enter - save policy reply */
+
+static void policy_cache_enter(SMTPD_POLICY_CLNT *policy_clnt,
+			               const char *key, const char *action)
+{
+    SMTPD_POLICY_CACHE_ENTRY *entry;
+    HTABLE_INFO **ht_info;
+    HTABLE_INFO **ht;
+    time_t  now = time((time_t *) 0);
+
+    /*
+     * When the cache is full, purge expired entries. If that does not make
+     * room, don't cache this reply; the oldest entries will expire soon.
+     */
+    if (policy_clnt->cache->used >= SMTPD_POLICY_CACHE_LIMIT) {
+	ht_info = htable_list(policy_clnt->cache);
+	for (ht = ht_info; *ht; ht++)
+	    if (((SMTPD_POLICY_CACHE_ENTRY *) ht[0]->value)->expires <= now)
+		htable_delete(policy_clnt->cache, ht[0]->key,
+			      policy_cache_free);
+	myfree((void *) ht_info);
+	if (policy_clnt->cache->used >= SMTPD_POLICY_CACHE_LIMIT)
+	    return;
+    }
+    entry = (SMTPD_POLICY_CACHE_ENTRY *) mymalloc(sizeof(*entry));
+    entry->action = mystrdup(action);
+    entry->expires = now + policy_clnt->cache_ttl;
+    htable_enter(policy_clnt->cache, key, (void *) entry);
+}
+
+/* policy_latency_update - update latency histogram */
+
+static void policy_latency_update(SMTPD_POLICY_CLNT *policy_clnt,
+				          struct timeval * start)
+{
+    struct timeval now;
+    long    msec;
+    int     n;
+
+    GETTIMEOFDAY(&now);
+    msec = (now.tv_sec - start->tv_sec) * 1000
+	+ (now.tv_usec - start->tv_usec) / 1000;
+    for (n = 0; n < SMTPD_POLICY_LAT_BUCKETS - 1; n++)
+	if (msec < smtpd_policy_lat_limits[n])
+	    break;
+    policy_clnt->latency[n] += 1;
+    policy_clnt->requests += 1;
+}
+
+/* smtpd_check_verify_stats - log shared verify cache statistics */
+
+void    smtpd_check_verify_stats(void)
+{
+    if (smtpd_verify_hits == 0 && smtpd_verify_misses == 0)
+	return;
+    msg_info("statistics: address verification shared cache hits=%d misses=%d",
+	     smtpd_verify_hits, smtpd_verify_misses);
+    smtpd_verify_hits = smtpd_verify_misses = 0;
+}
+
+/* smtpd_check_policy_stats - log policy service statistics */
+
+void    smtpd_check_policy_stats(void)
+{
+    HTABLE_INFO **ht_info;
+    HTABLE_INFO **ht;
+    SMTPD_POLICY_CLNT *policy_clnt;
+    VSTRING *buf;
+    int     n;
+
+    if (policy_clnt_table == 0)
+	return;
+    buf = vstring_alloc(100);
+    ht_info = htable_list(policy_clnt_table);
+    for (ht = ht_info; *ht; ht++) {
+	policy_clnt = (SMTPD_POLICY_CLNT *) ht[0]->value;
+	if (policy_clnt->requests == 0 && policy_clnt->cache_hits == 0)
+	    continue;
+	VSTRING_RESET(buf);
+	for (n = 0; n < SMTPD_POLICY_LAT_BUCKETS; n++) {
+	    if (policy_clnt->latency[n] == 0)
+		continue;
+	    if (n < SMTPD_POLICY_LAT_BUCKETS - 1)
+		vstring_sprintf_append(buf, " <%dms=%d",
+				       smtpd_policy_lat_limits[n],
+				       policy_clnt->latency[n]);
+	    else
+		vstring_sprintf_append(buf, " >=%dms=%d",
+				       smtpd_policy_lat_limits[n - 1],
+				       policy_clnt->latency[n]);
+	}
+	VSTRING_TERMINATE(buf);
+	msg_info("statistics: policy service %s requests=%d cache_hits=%d"
+		 " latency:%s", policy_clnt->name, policy_clnt->requests,
+		 policy_clnt->cache_hits,
+		 VSTRING_LEN(buf) ? STR(buf) : " none");
+	policy_clnt->requests = policy_clnt->cache_hits = 0;
+	memset((void *) policy_clnt->latency, 0,
+	       sizeof(policy_clnt->latency));
+    }
+    myfree((void *) ht_info);
+    vstring_free(buf);
+}
+
+/* smtpd_check_policy_release - close idle policy service connections */
+
+void    smtpd_check_policy_release(void)
+{
+    HTABLE_INFO **ht_info;
+    HTABLE_INFO **ht;
+
+    if (policy_clnt_table == 0)
+	return;
+    ht_info = htable_list(policy_clnt_table);
+    for (ht = ht_info; *ht; ht++)
+	attr_clnt_disconnect(((SMTPD_POLICY_CLNT *) ht[0]->value)->client);
+    myfree((void *) ht_info);
+}
+
 /* check_policy_service - check delegated policy service */
 
 static int check_policy_service(SMTPD_STATE *state, const char *server,
@@ -4013,7 +4655,11 @@ static int check_policy_service(SMTPD_STATE *state, const char *server,
 {
     static int warned = 0;
     static VSTRING *action = 0;
+    static VSTRING *cache_key = 0;
     SMTPD_POLICY_CLNT *policy_clnt;
+    const char *cached_action = 0;
+    struct timeval start;
+    int     policy_ok;
 
 #ifdef USE_TLS
     VSTRING *subject_buf;
@@ -4036,8 +4682,28 @@ static int check_policy_service(SMTPD_STATE *state, const char *server,
     /*
      * Initialize.
      */
-    if (action == 0)
+    if (action == 0) {
 	action = vstring_alloc(10);
+	cache_key = vstring_alloc(100);
+    }
+
+    /*
+     * Optionally, reuse an earlier reply for a request with the same
+     * protocol state and cache key attributes.
+     */
+    if (policy_clnt->cache != 0) {
+	policy_cache_key(policy_clnt, state, cache_key);
+	if ((cached_action = policy_cache_find(policy_clnt,
+					       STR(cache_key))) != 0) {
+	    policy_clnt->cache_hits += 1;
+	    if (msg_verbose)
+		msg_info("check_policy_service: %s: cached action=%s",
+			 server, cached_action);
+	    return (check_table_result(state, server, cached_action,
+				       "policy query", reply_name,
+				       reply_class, def_acl));
+	}
+    }
 
 #ifdef USE_TLS
 #define ENCODE_CN(coded_CN, coded_CN_buf, CN) do { \
@@ -4074,7 +4740,8 @@ static int check_policy_service(SMTPD_STATE *state, const char *server,
     }
 #endif
 
-    if (attr_clnt_request(policy_clnt->client,
+    GETTIMEOFDAY(&start);
+    policy_ok = (attr_clnt_request(policy_clnt->client,
 			  ATTR_FLAG_NONE,	/* Query attributes. */
 			SEND_ATTR_STR(MAIL_ATTR_REQ, "smtpd_access_policy"),
 			  SEND_ATTR_STR(MAIL_ATTR_PROTO_STATE,
@@ -4148,8 +4815,13 @@ static int check_policy_service(SMTPD_STATE *state, const char *server,
 			  ATTR_TYPE_END,
 			  ATTR_FLAG_MISSING,	/* Reply attributes. */
 			  RECV_ATTR_STR(MAIL_ATTR_ACTION, action),
-			  ATTR_TYPE_END) != 1
-	|| (var_smtputf8_enable && valid_utf8_action(server, STR(action)) == 0)) {
+			  ATTR_TYPE_END) == 1
+	      && (var_smtputf8_enable == 0
+		  || valid_utf8_action(server, STR(action)) != 0));
+    policy_latency_update(policy_clnt, &start);
+    if (policy_ok && policy_clnt->cache != 0)
+	policy_cache_enter(policy_clnt, STR(cache_key), STR(action));
+    if (!policy_ok) {
 	NOCLOBBER static int nesting_level = 0;
 	jmp_buf savebuf;
 	int     status;
@@ -4193,6 +4865,23 @@ static int check_policy_service(SMTPD_STATE *state, const char *server,
     return (ret);
 }
 
+/* map_command_arg - skip to check_xxx_access type:name argument */
+
+static void map_command_arg(SMTPD_STATE *state, const char *command,
+			            char ***argp)
+{
+
+    /*
+     * The well-formed case returns normally. The malformed case uses a long
+     * jump.
+     */
+    if (*(*argp + 1) == 0 || strchr(*(*argp += 1), ':') == 0) {
+	msg_warn("restriction %s: bad argument \"%s\": need maptype:mapname",
+		 command, **argp);
+	reject_server_error(state);
+    }
+}
+
 /* is_map_command - restriction has form: check_xxx_access type:name */
 
 static int is_map_command(SMTPD_STATE *state, const char *name,
@@ -4208,11 +4897,8 @@ static int is_map_command(SMTPD_STATE *state, const char *name,
      */
     if (strcasecmp(name, command) != 0) {
 	return (0);
-    } else if (*(*argp + 1) == 0 || strchr(*(*argp += 1), ':') == 0) {
-	msg_warn("restriction %s: bad argument \"%s\": need maptype:mapname",
-		 command, **argp);
-	reject_server_error(state);
     } else {
+	map_command_arg(state, command, argp);
 	return (1);
     }
 }
@@ -4232,7 +4918,7 @@ static void forbid_allowlist(SMTPD_STATE *state, const char *name,
 
 /* generic_checks - generic restrictions */
 
-static int generic_checks(SMTPD_STATE *state, ARGV *restrictions,
+static int generic_checks(SMTPD_STATE *state, SMTPD_REST_PROG *prog,
 			          const char *reply_name,
 			          const char *reply_class,
 			          const char *def_acl)
@@ -4240,15 +4926,16 @@ static int generic_checks(SMTPD_STATE *state, ARGV *restrictions,
     const char *myname = "generic_checks";
     char  **cpp;
     const char *name;
+    int     op;
     int     status = 0;
-    ARGV   *list;
+    SMTPD_REST_PROG *list;
     int     found;
     int     saved_recursion = state->recursion++;
 
     if (msg_verbose)
 	msg_info(">>> START %s RESTRICTIONS <<<", reply_class);
 
-    for (cpp = restrictions->argv; (name = *cpp) != 0; cpp++) {
+    for (cpp = prog->argv->argv; (name = *cpp) != 0; cpp++) {
 
 	if (state->discard != 0)
 	    break;
@@ -4256,22 +4943,28 @@ static int generic_checks(SMTPD_STATE *state, ARGV *restrictions,
 	if (msg_verbose)
 	    msg_info("%s: name=%s", myname, name);
 
+	/*
+	 * Dispatch on the operation code that was looked up when the
+	 * restriction list was parsed.
+	 */
+	op = prog->ops[cpp - prog->argv->argv];
+
 	/*
 	 * Pseudo restrictions.
 	 */
-	if (strcasecmp(name, WARN_IF_REJECT) == 0) {
+	if (op == SMTPD_OP_WARN_IF_REJECT) {
 	    if (state->warn_if_reject == 0)
 		state->warn_if_reject = state->recursion;
 	    continue;
 	}
 
 	/*
-	 * Spoof the is_map_command() routine, so that we do not have to make
+	 * Spoof the map_command_arg() routine, so that we do not have to make
 	 * special cases for the implicit short-hand access map notation.
 	 */
 #define NO_DEF_ACL	0
 
-	if (strchr(name, ':') != 0) {
+	if (op == SMTPD_OP_IMPLICIT_MAP) {
 	    if (def_acl == NO_DEF_ACL) {
 		msg_warn("specify one of (%s, %s, %s, %s, %s, %s) before %s restriction \"%s\"",
 			 CHECK_CLIENT_ACL, CHECK_REVERSE_CLIENT_ACL, CHECK_HELO_ACL, CHECK_SENDER_ACL,
@@ -4279,19 +4972,22 @@ static int generic_checks(SMTPD_STATE *state, ARGV *restrictions,
 		reject_server_error(state);
 	    }
 	    name = def_acl;
+	    op = smtpd_check_op(name);
 	    cpp -= 1;
 	}
+	switch (op) {
 
-	/*
-	 * Generic restrictions.
-	 */
-	if (strcasecmp(name, PERMIT_ALL) == 0) {
+	    /*
+	     * Generic restrictions.
+	     */
+	case SMTPD_OP_PERMIT_ALL:
 	    status = smtpd_acl_permit(state, name, reply_class,
 				      reply_name, NO_PRINT_ARGS);
 	    if (status == SMTPD_CHECK_OK && cpp[1] != 0)
 		msg_warn("restriction `%s' after `%s' is ignored",
 			 cpp[1], PERMIT_ALL);
-	} else if (strcasecmp(name, DEFER_ALL) == 0) {
+	    break;
+	case SMTPD_OP_DEFER_ALL:
 	    status = smtpd_check_reject(state, MAIL_ERROR_POLICY,
 					var_defer_code, "4.3.2",
 					"<%s>: %s rejected: Try again later",
@@ -4299,7 +4995,8 @@ static int generic_checks(SMTPD_STATE *state, ARGV *restrictions,
 	    if (cpp[1] != 0 && state->warn_if_reject == 0)
 		msg_warn("restriction `%s' after `%s' is ignored",
 			 cpp[1], DEFER_ALL);
-	} else if (strcasecmp(name, REJECT_ALL) == 0) {
+	    break;
+	case SMTPD_OP_REJECT_ALL:
 	    status = smtpd_check_reject(state, MAIL_ERROR_POLICY,
 					var_reject_code, "5.7.1",
 					"<%s>: %s rejected: Access denied",
@@ -4307,9 +5004,11 @@ static int generic_checks(SMTPD_STATE *state, ARGV *restrictions,
 	    if (cpp[1] != 0 && state->warn_if_reject == 0)
 		msg_warn("restriction `%s' after `%s' is ignored",
 			 cpp[1], REJECT_ALL);
-	} else if (strcasecmp(name, REJECT_UNAUTH_PIPE) == 0) {
+	    break;
+	case SMTPD_OP_REJECT_UNAUTH_PIPE:
 	    status = reject_unauth_pipelining(state, reply_name, reply_class);
-	} else if (strcasecmp(name, CHECK_POLICY_SERVICE) == 0) {
+	    break;
+	case SMTPD_OP_CHECK_POLICY_SERVICE:
 	    if (cpp[1] == 0 || strchr(cpp[1], ':') == 0) {
 		msg_warn("restriction %s must be followed by transport:server",
 			 CHECK_POLICY_SERVICE);
@@ -4317,64 +5016,78 @@ static int generic_checks(SMTPD_STATE *state, ARGV *restrictions,
 	    } else
 		status = check_policy_service(state, *++cpp, reply_name,
 					      reply_class, def_acl);
-	} else if (strcasecmp(name, DEFER_IF_PERMIT) == 0) {
+	    break;
+	case SMTPD_OP_DEFER_IF_PERMIT:
 	    status = DEFER_IF_PERMIT2(DEFER_IF_PERMIT_ACT,
 				      state, MAIL_ERROR_POLICY,
 				      450, "4.7.0",
 			     "<%s>: %s rejected: defer_if_permit requested",
 				      reply_name, reply_class);
-	} else if (strcasecmp(name, DEFER_IF_REJECT) == 0) {
+	    break;
+	case SMTPD_OP_DEFER_IF_REJECT:
 	    DEFER_IF_REJECT2(state, MAIL_ERROR_POLICY,
 			     450, "4.7.0",
 			     "<%s>: %s rejected: defer_if_reject requested",
 			     reply_name, reply_class);
-	} else if (strcasecmp(name, SLEEP) == 0) {
+	    break;
+	case SMTPD_OP_SLEEP:
 	    if (cpp[1] == 0 || alldig(cpp[1]) == 0) {
 		msg_warn("restriction %s must be followed by number", SLEEP);
 		reject_server_error(state);
 	    } else
 		sleep(atoi(*++cpp));
-	} else if (strcasecmp(name, REJECT_PLAINTEXT_SESSION) == 0) {
+	    break;
+	case SMTPD_OP_REJECT_PLAINTEXT_SESSION:
 	    status = reject_plaintext_session(state);
-	}
+	    break;
 
-	/*
-	 * Client name/address restrictions.
-	 */
-	else if (strcasecmp(name, REJECT_UNKNOWN_CLIENT_HOSTNAME) == 0
-		 || strcasecmp(name, REJECT_UNKNOWN_CLIENT) == 0) {
+	    /*
+	     * Client name/address restrictions.
+	     */
+	case SMTPD_OP_REJECT_UNKNOWN_CLIENT_HOSTNAME:
+	case SMTPD_OP_REJECT_UNKNOWN_CLIENT:
 	    status = reject_unknown_client(state);
-	} else if (strcasecmp(name, REJECT_UNKNOWN_REVERSE_HOSTNAME) == 0) {
+	    break;
+	case SMTPD_OP_REJECT_UNKNOWN_REVERSE_HOSTNAME:
 	    status = reject_unknown_reverse_name(state);
-	} else if (strcasecmp(name, PERMIT_INET_INTERFACES) == 0) {
+	    break;
+	case SMTPD_OP_PERMIT_INET_INTERFACES:
 	    status = permit_inet_interfaces(state);
 	    if (status == SMTPD_CHECK_OK)
 		status = smtpd_acl_permit(state, name, SMTPD_NAME_CLIENT,
 					  state->namaddr, NO_PRINT_ARGS);
-	} else if (strcasecmp(name, PERMIT_MYNETWORKS) == 0) {
+	    break;
+	case SMTPD_OP_PERMIT_MYNETWORKS:
 	    status = permit_mynetworks(state);
 	    if (status == SMTPD_CHECK_OK)
 		status = smtpd_acl_permit(state, name, SMTPD_NAME_CLIENT,
 					  state->namaddr, NO_PRINT_ARGS);
-	} else if (is_map_command(state, name, CHECK_CLIENT_ACL, &cpp)) {
+	    break;
+	case SMTPD_OP_CHECK_CLIENT_ACL:
+	    map_command_arg(state, CHECK_CLIENT_ACL, &cpp);
 	    status = check_namadr_access(state, *cpp, state->name, state->addr,
 					 FULL, &found, state->namaddr,
 					 SMTPD_NAME_CLIENT, def_acl);
-	} else if (is_map_command(state, name, CHECK_REVERSE_CLIENT_ACL, &cpp)) {
+	    break;
+	case SMTPD_OP_CHECK_REVERSE_CLIENT_ACL:
+	    map_command_arg(state, CHECK_REVERSE_CLIENT_ACL, &cpp);
 	    status = check_namadr_access(state, *cpp, state->reverse_name, state->addr,
 					 FULL, &found, state->reverse_name,
 					 SMTPD_NAME_REV_CLIENT, def_acl);
 	    forbid_allowlist(state, name, status, state->reverse_name);
-	} else if (strcasecmp(name, REJECT_MAPS_RBL) == 0) {
+	    break;
+	case SMTPD_OP_REJECT_MAPS_RBL:
 	    status = reject_maps_rbl(state);
-	} else if (strcasecmp(name, REJECT_RBL_CLIENT) == 0
-		   || strcasecmp(name, REJECT_RBL) == 0) {
+	    break;
+	case SMTPD_OP_REJECT_RBL_CLIENT:
+	case SMTPD_OP_REJECT_RBL:
 	    if (cpp[1] == 0)
 		msg_warn("restriction %s requires domain name argument", name);
 	    else
 		status = reject_rbl_addr(state, *(cpp += 1), state->addr,
 					 SMTPD_NAME_CLIENT);
-	} else if (strcasecmp(name, PERMIT_DNSWL_CLIENT) == 0) {
+	    break;
+	case SMTPD_OP_PERMIT_DNSWL_CLIENT:
 	    if (cpp[1] == 0)
 		msg_warn("restriction %s requires domain name argument", name);
 	    else {
@@ -4384,7 +5097,8 @@ static int generic_checks(SMTPD_STATE *state, ARGV *restrictions,
 		    status = smtpd_acl_permit(state, name, SMTPD_NAME_CLIENT,
 					      state->namaddr, NO_PRINT_ARGS);
 	    }
-	} else if (strcasecmp(name, REJECT_RHSBL_CLIENT) == 0) {
+	    break;
+	case SMTPD_OP_REJECT_RHSBL_CLIENT:
 	    if (cpp[1] == 0)
 		msg_warn("restriction %s requires domain name argument",
 			 name);
@@ -4394,7 +5108,8 @@ static int generic_checks(SMTPD_STATE *state, ARGV *restrictions,
 		    status = reject_rbl_domain(state, *cpp, state->name,
 					       SMTPD_NAME_CLIENT);
 	    }
-	} else if (strcasecmp(name, PERMIT_RHSWL_CLIENT) == 0) {
+	    break;
+	case SMTPD_OP_PERMIT_RHSWL_CLIENT:
 	    if (cpp[1] == 0)
 		msg_warn("restriction %s requires domain name argument",
 			 name);
@@ -4408,7 +5123,8 @@ static int generic_checks(SMTPD_STATE *state, ARGV *restrictions,
 			  SMTPD_NAME_CLIENT, state->namaddr, NO_PRINT_ARGS);
 		}
 	    }
-	} else if (strcasecmp(name, REJECT_RHSBL_REVERSE_CLIENT) == 0) {
+	    break;
+	case SMTPD_OP_REJECT_RHSBL_REVERSE_CLIENT:
 	    if (cpp[1] == 0)
 		msg_warn("restriction %s requires domain name argument",
 			 name);
@@ -4418,9 +5134,13 @@ static int generic_checks(SMTPD_STATE *state, ARGV *restrictions,
 		    status = reject_rbl_domain(state, *cpp, state->reverse_name,
 					       SMTPD_NAME_REV_CLIENT);
 	    }
-	} else if (is_map_command(state, name, CHECK_CCERT_ACL, &cpp)) {
+	    break;
+	case SMTPD_OP_CHECK_CCERT_ACL:
+	    map_command_arg(state, CHECK_CCERT_ACL, &cpp);
 	    status = check_ccert_access(state, *cpp, def_acl);
-	} else if (is_map_command(state, name, CHECK_SASL_ACL, &cpp)) {
+	    break;
+	case SMTPD_OP_CHECK_SASL_ACL:
+	    map_command_arg(state, CHECK_SASL_ACL, &cpp);
 #ifdef USE_SASL_AUTH
 	    if (var_smtpd_sasl_enable) {
 		if (state->sasl_username && state->sasl_username[0])
@@ -4428,60 +5148,74 @@ static int generic_checks(SMTPD_STATE *state, ARGV *restrictions,
 	    } else
 #endif
 		msg_warn("restriction `%s' ignored: no SASL support", name);
-	} else if (is_map_command(state, name, CHECK_CLIENT_NS_ACL, &cpp)) {
+	    break;
+	case SMTPD_OP_CHECK_CLIENT_NS_ACL:
+	    map_command_arg(state, CHECK_CLIENT_NS_ACL, &cpp);
 	    if (strcasecmp(state->name, "unknown") != 0) {
 		status = check_server_access(state, *cpp, state->name,
 					     T_NS, state->namaddr,
 					     SMTPD_NAME_CLIENT, def_acl);
 		forbid_allowlist(state, name, status, state->name);
 	    }
-	} else if (is_map_command(state, name, CHECK_CLIENT_MX_ACL, &cpp)) {
+	    break;
+	case SMTPD_OP_CHECK_CLIENT_MX_ACL:
+	    map_command_arg(state, CHECK_CLIENT_MX_ACL, &cpp);
 	    if (strcasecmp(state->name, "unknown") != 0) {
 		status = check_server_access(state, *cpp, state->name,
 					     T_MX, state->namaddr,
 					     SMTPD_NAME_CLIENT, def_acl);
 		forbid_allowlist(state, name, status, state->name);
 	    }
-	} else if (is_map_command(state, name, CHECK_CLIENT_A_ACL, &cpp)) {
+	    break;
+	case SMTPD_OP_CHECK_CLIENT_A_ACL:
+	    map_command_arg(state, CHECK_CLIENT_A_ACL, &cpp);
 	    if (strcasecmp(state->name, "unknown") != 0) {
 		status = check_server_access(state, *cpp, state->name,
 					     T_A, state->namaddr,
 					     SMTPD_NAME_CLIENT, def_acl);
 		forbid_allowlist(state, name, status, state->name);
 	    }
-	} else if (is_map_command(state, name, CHECK_REVERSE_CLIENT_NS_ACL, &cpp)) {
+	    break;
+	case SMTPD_OP_CHECK_REVERSE_CLIENT_NS_ACL:
+	    map_command_arg(state, CHECK_REVERSE_CLIENT_NS_ACL, &cpp);
 	    if (strcasecmp(state->reverse_name, "unknown") != 0) {
 		status = check_server_access(state, *cpp, state->reverse_name,
 					     T_NS, state->reverse_name,
 					     SMTPD_NAME_REV_CLIENT, def_acl);
 		forbid_allowlist(state, name, status, state->reverse_name);
 	    }
-	} else if (is_map_command(state, name, CHECK_REVERSE_CLIENT_MX_ACL, &cpp)) {
+	    break;
+	case SMTPD_OP_CHECK_REVERSE_CLIENT_MX_ACL:
+	    map_command_arg(state, CHECK_REVERSE_CLIENT_MX_ACL, &cpp);
 	    if (strcasecmp(state->reverse_name, "unknown") != 0) {
 		status = check_server_access(state, *cpp, state->reverse_name,
 					     T_MX, state->reverse_name,
 					     SMTPD_NAME_REV_CLIENT, def_acl);
 		forbid_allowlist(state, name, status, state->reverse_name);
 	    }
-	} else if (is_map_command(state, name, CHECK_REVERSE_CLIENT_A_ACL, &cpp)) {
+	    break;
+	case SMTPD_OP_CHECK_REVERSE_CLIENT_A_ACL:
+	    map_command_arg(state, CHECK_REVERSE_CLIENT_A_ACL, &cpp);
 	    if (strcasecmp(state->reverse_name, "unknown") != 0) {
 		status = check_server_access(state, *cpp, state->reverse_name,
 					     T_A, state->reverse_name,
 					     SMTPD_NAME_REV_CLIENT, def_acl);
 		forbid_allowlist(state, name, status, state->reverse_name);
 	    }
-	}
+	    break;
 
-	/*
-	 * HELO/EHLO parameter restrictions.
-	 */
-	else if (is_map_command(state, name, CHECK_HELO_ACL, &cpp)) {
+	    /*
+	     * HELO/EHLO parameter restrictions.
+	     */
+	case SMTPD_OP_CHECK_HELO_ACL:
+	    map_command_arg(state, CHECK_HELO_ACL, &cpp);
 	    if (state->helo_name)
 		status = check_domain_access(state, *cpp, state->helo_name,
 					     FULL, &found, state->helo_name,
 					     SMTPD_NAME_HELO, def_acl);
-	} else if (strcasecmp(name, REJECT_INVALID_HELO_HOSTNAME) == 0
-		   || strcasecmp(name, REJECT_INVALID_HOSTNAME) == 0) {
+	    break;
+	case SMTPD_OP_REJECT_INVALID_HELO_HOSTNAME:
+	case SMTPD_OP_REJECT_INVALID_HOSTNAME:
 	    if (state->helo_name) {
 		if (*state->helo_name != '[')
 		    status = reject_invalid_hostname(state, state->helo_name,
@@ -4490,8 +5224,9 @@ static int generic_checks(SMTPD_STATE *state, ARGV *restrictions,
 		    status = reject_invalid_hostaddr(state, state->helo_name,
 					 state->helo_name, SMTPD_NAME_HELO);
 	    }
-	} else if (strcasecmp(name, REJECT_UNKNOWN_HELO_HOSTNAME) == 0
-		   || strcasecmp(name, REJECT_UNKNOWN_HOSTNAME) == 0) {
+	    break;
+	case SMTPD_OP_REJECT_UNKNOWN_HELO_HOSTNAME:
+	case SMTPD_OP_REJECT_UNKNOWN_HOSTNAME:
 	    if (state->helo_name) {
 		if (*state->helo_name != '[')
 		    status = reject_unknown_hostname(state, state->helo_name,
@@ -4500,36 +5235,44 @@ static int generic_checks(SMTPD_STATE *state, ARGV *restrictions,
 		    status = reject_invalid_hostaddr(state, state->helo_name,
 					 state->helo_name, SMTPD_NAME_HELO);
 	    }
-	} else if (strcasecmp(name, PERMIT_NAKED_IP_ADDR) == 0) {
+	    break;
+	case SMTPD_OP_PERMIT_NAKED_IP_ADDR:
 	    /* permit_naked_ip_addr is deprecated as of Postfix 2.0. */
 	    msg_warn("support for restriction \"%s\" has been removed in %s"
 		     " 3.9; instead, specify \"%s\" or \"%s\"",
 		     PERMIT_NAKED_IP_ADDR, var_mail_name,
 		     PERMIT_MYNETWORKS, PERMIT_SASL_AUTH);
 	    reject_server_error(state);
-	} else if (is_map_command(state, name, CHECK_HELO_NS_ACL, &cpp)) {
+	    break;
+	case SMTPD_OP_CHECK_HELO_NS_ACL:
+	    map_command_arg(state, CHECK_HELO_NS_ACL, &cpp);
 	    if (state->helo_name) {
 		status = check_server_access(state, *cpp, state->helo_name,
 					     T_NS, state->helo_name,
 					     SMTPD_NAME_HELO, def_acl);
 		forbid_allowlist(state, name, status, state->helo_name);
 	    }
-	} else if (is_map_command(state, name, CHECK_HELO_MX_ACL, &cpp)) {
+	    break;
+	case SMTPD_OP_CHECK_HELO_MX_ACL:
+	    map_command_arg(state, CHECK_HELO_MX_ACL, &cpp);
 	    if (state->helo_name) {
 		status = check_server_access(state, *cpp, state->helo_name,
 					     T_MX, state->helo_name,
 					     SMTPD_NAME_HELO, def_acl);
 		forbid_allowlist(state, name, status, state->helo_name);
 	    }
-	} else if (is_map_command(state, name, CHECK_HELO_A_ACL, &cpp)) {
+	    break;
+	case SMTPD_OP_CHECK_HELO_A_ACL:
+	    map_command_arg(state, CHECK_HELO_A_ACL, &cpp);
 	    if (state->helo_name) {
 		status = check_server_access(state, *cpp, state->helo_name,
 					     T_A, state->helo_name,
 					     SMTPD_NAME_HELO, def_acl);
 		forbid_allowlist(state, name, status, state->helo_name);
 	    }
-	} else if (strcasecmp(name, REJECT_NON_FQDN_HELO_HOSTNAME) == 0
-		   || strcasecmp(name, REJECT_NON_FQDN_HOSTNAME) == 0) {
+	    break;
+	case SMTPD_OP_REJECT_NON_FQDN_HELO_HOSTNAME:
+	case SMTPD_OP_REJECT_NON_FQDN_HOSTNAME:
 	    if (state->helo_name) {
 		if (*state->helo_name != '[')
 		    status = reject_non_fqdn_hostname(state, state->helo_name,
@@ -4538,7 +5281,8 @@ static int generic_checks(SMTPD_STATE *state, ARGV *restrictions,
 		    status = reject_invalid_hostaddr(state, state->helo_name,
 					 state->helo_name, SMTPD_NAME_HELO);
 	    }
-	} else if (strcasecmp(name, REJECT_RHSBL_HELO) == 0) {
+	    break;
+	case SMTPD_OP_REJECT_RHSBL_HELO:
 	    if (cpp[1] == 0)
 		msg_warn("restriction %s requires domain name argument",
 			 name);
@@ -4548,12 +5292,13 @@ static int generic_checks(SMTPD_STATE *state, ARGV *restrictions,
 		    status = reject_rbl_domain(state, *cpp, state->helo_name,
 					       SMTPD_NAME_HELO);
 	    }
-	}
+	    break;
 
-	/*
-	 * Sender mail address restrictions.
-	 */
-	else if (is_map_command(state, name, CHECK_SENDER_ACL, &cpp)) {
+	    /*
+	     * Sender mail address restrictions.
+	     */
+	case SMTPD_OP_CHECK_SENDER_ACL:
+	    map_command_arg(state, CHECK_SENDER_ACL, &cpp);
 	    if (state->sender && *state->sender)
 		status = check_mail_access(state, *cpp, state->sender,
 					   &found, state->sender,
@@ -4562,26 +5307,31 @@ static int generic_checks(SMTPD_STATE *state, ARGV *restrictions,
 		status = check_access(state, *cpp, var_smtpd_null_key, FULL,
 				      &found, state->sender,
 				      SMTPD_NAME_SENDER, def_acl);
-	} else if (strcasecmp(name, REJECT_UNKNOWN_ADDRESS) == 0) {
+	    break;
+	case SMTPD_OP_REJECT_UNKNOWN_ADDRESS:
 	    if (state->sender && *state->sender)
 		status = reject_unknown_address(state, state->sender,
 					  state->sender, SMTPD_NAME_SENDER);
-	} else if (strcasecmp(name, REJECT_UNKNOWN_SENDDOM) == 0) {
+	    break;
+	case SMTPD_OP_REJECT_UNKNOWN_SENDDOM:
 	    if (state->sender && *state->sender)
 		status = reject_unknown_address(state, state->sender,
 					  state->sender, SMTPD_NAME_SENDER);
-	} else if (strcasecmp(name, REJECT_UNVERIFIED_SENDER) == 0) {
+	    break;
+	case SMTPD_OP_REJECT_UNVERIFIED_SENDER:
 	    if (state->sender && *state->sender)
 		status = reject_unverified_address(state, state->sender,
 					   state->sender, SMTPD_NAME_SENDER,
 				     var_unv_from_dcode, var_unv_from_rcode,
 						   unv_from_tf_act,
 						   var_unv_from_why);
-	} else if (strcasecmp(name, REJECT_NON_FQDN_SENDER) == 0) {
+	    break;
+	case SMTPD_OP_REJECT_NON_FQDN_SENDER:
 	    if (state->sender && *state->sender)
 		status = reject_non_fqdn_address(state, state->sender,
 					  state->sender, SMTPD_NAME_SENDER);
-	} else if (strcasecmp(name, REJECT_AUTH_SENDER_LOGIN_MISMATCH) == 0) {
+	    break;
+	case SMTPD_OP_REJECT_AUTH_SENDER_LOGIN_MISMATCH:
 #ifdef USE_SASL_AUTH
 	    if (var_smtpd_sasl_enable) {
 		if (state->sender && *state->sender)
@@ -4590,7 +5340,8 @@ static int generic_checks(SMTPD_STATE *state, ARGV *restrictions,
 	    } else
 #endif
 		msg_warn("restriction `%s' ignored: no SASL support", name);
-	} else if (strcasecmp(name, REJECT_KNOWN_SENDER_LOGIN_MISMATCH) == 0) {
+	    break;
+	case SMTPD_OP_REJECT_KNOWN_SENDER_LOGIN_MISMATCH:
 #ifdef USE_SASL_AUTH
 	    if (var_smtpd_sasl_enable) {
 		if (state->sender && *state->sender) {
@@ -4603,7 +5354,8 @@ static int generic_checks(SMTPD_STATE *state, ARGV *restrictions,
 	    } else
 #endif
 		msg_warn("restriction `%s' ignored: no SASL support", name);
-	} else if (strcasecmp(name, REJECT_UNAUTH_SENDER_LOGIN_MISMATCH) == 0) {
+	    break;
+	case SMTPD_OP_REJECT_UNAUTH_SENDER_LOGIN_MISMATCH:
 #ifdef USE_SASL_AUTH
 	    if (var_smtpd_sasl_enable) {
 		if (state->sender && *state->sender)
@@ -4611,28 +5363,35 @@ static int generic_checks(SMTPD_STATE *state, ARGV *restrictions,
 	    } else
 #endif
 		msg_warn("restriction `%s' ignored: no SASL support", name);
-	} else if (is_map_command(state, name, CHECK_SENDER_NS_ACL, &cpp)) {
+	    break;
+	case SMTPD_OP_CHECK_SENDER_NS_ACL:
+	    map_command_arg(state, CHECK_SENDER_NS_ACL, &cpp);
 	    if (state->sender && *state->sender) {
 		status = check_server_access(state, *cpp, state->sender,
 					     T_NS, state->sender,
 					     SMTPD_NAME_SENDER, def_acl);
 		forbid_allowlist(state, name, status, state->sender);
 	    }
-	} else if (is_map_command(state, name, CHECK_SENDER_MX_ACL, &cpp)) {
+	    break;
+	case SMTPD_OP_CHECK_SENDER_MX_ACL:
+	    map_command_arg(state, CHECK_SENDER_MX_ACL, &cpp);
 	    if (state->sender && *state->sender) {
 		status = check_server_access(state, *cpp, state->sender,
 					     T_MX, state->sender,
 					     SMTPD_NAME_SENDER, def_acl);
 		forbid_allowlist(state, name, status, state->sender);
 	    }
-	} else if (is_map_command(state, name, CHECK_SENDER_A_ACL, &cpp)) {
+	    break;
+	case SMTPD_OP_CHECK_SENDER_A_ACL:
+	    map_command_arg(state, CHECK_SENDER_A_ACL, &cpp);
 	    if (state->sender && *state->sender) {
 		status = check_server_access(state, *cpp, state->sender,
 					     T_A, state->sender,
 					     SMTPD_NAME_SENDER, def_acl);
 		forbid_allowlist(state, name, status, state->sender);
 	    }
-	} else if (strcasecmp(name, REJECT_RHSBL_SENDER) == 0) {
+	    break;
+	case SMTPD_OP_REJECT_RHSBL_SENDER:
 	    if (cpp[1] == 0)
 		msg_warn("restriction %s requires domain name argument", name);
 	    else {
@@ -4641,20 +5400,23 @@ static int generic_checks(SMTPD_STATE *state, ARGV *restrictions,
 		    status = reject_rbl_domain(state, *cpp, state->sender,
 					       SMTPD_NAME_SENDER);
 	    }
-	} else if (strcasecmp(name, REJECT_UNLISTED_SENDER) == 0) {
+	    break;
+	case SMTPD_OP_REJECT_UNLISTED_SENDER:
 	    if (state->sender && *state->sender)
 		status = check_sender_rcpt_maps(state, state->sender);
-	}
+	    break;
 
-	/*
-	 * Recipient mail address restrictions.
-	 */
-	else if (is_map_command(state, name, CHECK_RECIP_ACL, &cpp)) {
+	    /*
+	     * Recipient mail address restrictions.
+	     */
+	case SMTPD_OP_CHECK_RECIP_ACL:
+	    map_command_arg(state, CHECK_RECIP_ACL, &cpp);
 	    if (state->recipient)
 		status = check_mail_access(state, *cpp, state->recipient,
 					   &found, state->recipient,
 					   SMTPD_NAME_RECIPIENT, def_acl);
-	} else if (strcasecmp(name, PERMIT_MX_BACKUP) == 0) {
+	    break;
+	case SMTPD_OP_PERMIT_MX_BACKUP:
 	    if (state->recipient) {
 		status = permit_mx_backup(state, state->recipient,
 				    state->recipient, SMTPD_NAME_RECIPIENT);
@@ -4662,22 +5424,26 @@ static int generic_checks(SMTPD_STATE *state, ARGV *restrictions,
 		    status = smtpd_acl_permit(state, name, SMTPD_NAME_RECIPIENT,
 					   state->recipient, NO_PRINT_ARGS);
 	    }
-	} else if (strcasecmp(name, PERMIT_AUTH_DEST) == 0) {
+	    break;
+	case SMTPD_OP_PERMIT_AUTH_DEST:
 	    if (state->recipient) {
 		status = permit_auth_destination(state, state->recipient);
 		if (status == SMTPD_CHECK_OK)
 		    status = smtpd_acl_permit(state, name, SMTPD_NAME_RECIPIENT,
 					   state->recipient, NO_PRINT_ARGS);
 	    }
-	} else if (strcasecmp(name, REJECT_UNAUTH_DEST) == 0) {
+	    break;
+	case SMTPD_OP_REJECT_UNAUTH_DEST:
 	    if (state->recipient)
 		status = reject_unauth_destination(state, state->recipient,
 						   var_relay_code, "5.7.1");
-	} else if (strcasecmp(name, DEFER_UNAUTH_DEST) == 0) {
+	    break;
+	case SMTPD_OP_DEFER_UNAUTH_DEST:
 	    if (state->recipient)
 		status = reject_unauth_destination(state, state->recipient,
 					     var_relay_code - 100, "4.7.1");
-	} else if (strcasecmp(name, CHECK_RELAY_DOMAINS) == 0) {
+	    break;
+	case SMTPD_OP_CHECK_RELAY_DOMAINS:
 	    if (state->recipient)
 		status = check_relay_domains(state, state->recipient,
 				    state->recipient, SMTPD_NAME_RECIPIENT);
@@ -4687,7 +5453,8 @@ static int generic_checks(SMTPD_STATE *state, ARGV *restrictions,
 	    if (cpp[1] != 0 && state->warn_if_reject == 0)
 		msg_warn("restriction `%s' after `%s' is ignored",
 			 cpp[1], CHECK_RELAY_DOMAINS);
-	} else if (strcasecmp(name, PERMIT_SASL_AUTH) == 0) {
+	    break;
+	case SMTPD_OP_PERMIT_SASL_AUTH:
 #ifdef USE_SASL_AUTH
 	    status = permit_sasl_auth(state,
 				      SMTPD_CHECK_OK, SMTPD_CHECK_DUNNO);
@@ -4695,46 +5462,57 @@ static int generic_checks(SMTPD_STATE *state, ARGV *restrictions,
 		status = smtpd_acl_permit(state, name, SMTPD_NAME_CLIENT,
 					  state->namaddr, NO_PRINT_ARGS);
 #endif
-	} else if (strcasecmp(name, PERMIT_TLS_ALL_CLIENTCERTS) == 0) {
+	    break;
+	case SMTPD_OP_PERMIT_TLS_ALL_CLIENTCERTS:
 	    status = permit_tls_clientcerts(state, 1);
 	    if (status == SMTPD_CHECK_OK)
 		status = smtpd_acl_permit(state, name, SMTPD_NAME_CLIENT,
 					  state->namaddr, NO_PRINT_ARGS);
-	} else if (strcasecmp(name, PERMIT_TLS_CLIENTCERTS) == 0) {
+	    break;
+	case SMTPD_OP_PERMIT_TLS_CLIENTCERTS:
 	    status = permit_tls_clientcerts(state, 0);
 	    if (status == SMTPD_CHECK_OK)
 		status = smtpd_acl_permit(state, name, SMTPD_NAME_CLIENT,
 					  state->namaddr, NO_PRINT_ARGS);
-	} else if (strcasecmp(name, REJECT_UNKNOWN_RCPTDOM) == 0) {
+	    break;
+	case SMTPD_OP_REJECT_UNKNOWN_RCPTDOM:
 	    if (state->recipient)
 		status = reject_unknown_address(state, state->recipient,
 				    state->recipient, SMTPD_NAME_RECIPIENT);
-	} else if (strcasecmp(name, REJECT_NON_FQDN_RCPT) == 0) {
+	    break;
+	case SMTPD_OP_REJECT_NON_FQDN_RCPT:
 	    if (state->recipient)
 		status = reject_non_fqdn_address(state, state->recipient,
 				    state->recipient, SMTPD_NAME_RECIPIENT);
-	} else if (is_map_command(state, name, CHECK_RECIP_NS_ACL, &cpp)) {
+	    break;
+	case SMTPD_OP_CHECK_RECIP_NS_ACL:
+	    map_command_arg(state, CHECK_RECIP_NS_ACL, &cpp);
 	    if (state->recipient && *state->recipient) {
 		status = check_server_access(state, *cpp, state->recipient,
 					     T_NS, state->recipient,
 					     SMTPD_NAME_RECIPIENT, def_acl);
 		forbid_allowlist(state, name, status, state->recipient);
 	    }
-	} else if (is_map_command(state, name, CHECK_RECIP_MX_ACL, &cpp)) {
+	    break;
+	case SMTPD_OP_CHECK_RECIP_MX_ACL:
+	    map_command_arg(state, CHECK_RECIP_MX_ACL, &cpp);
 	    if (state->recipient && *state->recipient) {
 		status = check_server_access(state, *cpp, state->recipient,
 					     T_MX, state->recipient,
 					     SMTPD_NAME_RECIPIENT, def_acl);
 		forbid_allowlist(state, name, status, state->recipient);
 	    }
-	} else if (is_map_command(state, name, CHECK_RECIP_A_ACL, &cpp)) {
+	    break;
+	case SMTPD_OP_CHECK_RECIP_A_ACL:
+	    map_command_arg(state, CHECK_RECIP_A_ACL, &cpp);
 	    if (state->recipient && *state->recipient) {
 		status = check_server_access(state, *cpp, state->recipient,
 					     T_A, state->recipient,
 					     SMTPD_NAME_RECIPIENT, def_acl);
 		forbid_allowlist(state, name, status, state->recipient);
 	    }
-	} else if (strcasecmp(name, REJECT_RHSBL_RECIPIENT) == 0) {
+	    break;
+	case SMTPD_OP_REJECT_RHSBL_RECIPIENT:
 	    if (cpp[1] == 0)
 		msg_warn("restriction %s requires domain name argument", name);
 	    else {
@@ -4743,50 +5521,55 @@ static int generic_checks(SMTPD_STATE *state, ARGV *restrictions,
 		    status = reject_rbl_domain(state, *cpp, state->recipient,
 					       SMTPD_NAME_RECIPIENT);
 	    }
-	} else if (strcasecmp(name, CHECK_RCPT_MAPS) == 0
-		   || strcasecmp(name, REJECT_UNLISTED_RCPT) == 0) {
+	    break;
+	case SMTPD_OP_CHECK_RCPT_MAPS:
+	case SMTPD_OP_REJECT_UNLISTED_RCPT:
 	    if (state->recipient && *state->recipient)
 		status = check_recipient_rcpt_maps(state, state->recipient);
-	} else if (strcasecmp(name, REJECT_MUL_RCPT_BOUNCE) == 0) {
+	    break;
+	case SMTPD_OP_REJECT_MUL_RCPT_BOUNCE:
 	    if (state->sender && *state->sender == 0 && state->rcpt_count
 		> (strcmp(state->where, SMTPD_CMD_RCPT) != 0))
 		status = smtpd_check_reject(state, MAIL_ERROR_POLICY,
 					    var_mul_rcpt_code, "5.5.3",
 				"<%s>: %s rejected: Multi-recipient bounce",
 					    reply_name, reply_class);
-	} else if (strcasecmp(name, REJECT_UNVERIFIED_RECIP) == 0) {
+	    break;
+	case SMTPD_OP_REJECT_UNVERIFIED_RECIP:
 	    if (state->recipient && *state->recipient)
 		status = reject_unverified_address(state, state->recipient,
 				     state->recipient, SMTPD_NAME_RECIPIENT,
 				     var_unv_rcpt_dcode, var_unv_rcpt_rcode,
 						   unv_rcpt_tf_act,
 						   var_unv_rcpt_why);
-	}
+	    break;
 
-	/*
-	 * ETRN domain name restrictions.
-	 */
-	else if (is_map_command(state, name, CHECK_ETRN_ACL, &cpp)) {
+	    /*
+	     * ETRN domain name restrictions.
+	     */
+	case SMTPD_OP_CHECK_ETRN_ACL:
+	    map_command_arg(state, CHECK_ETRN_ACL, &cpp);
 	    if (state->etrn_name)
 		status = check_domain_access(state, *cpp, state->etrn_name,
 					     FULL, &found, state->etrn_name,
 					     SMTPD_NAME_ETRN, def_acl);
-	}
-
-	/*
-	 * User-defined restriction class.
-	 */
-	else if ((list = (ARGV *) htable_find(smtpd_rest_classes, name)) != 0) {
-	    status = generic_checks(state, list, reply_name,
-				    reply_class, def_acl);
-	}
+	    break;
 
-	/*
-	 * Error: undefined restriction name.
-	 */
-	else {
-	    msg_warn("unknown smtpd restriction: \"%s\"", name);
-	    reject_server_error(state);
+	    /*
+	     * User-defined restriction class, or error: undefined restriction
+	     * name. Classes are looked up here, because a class may be
+	     * (re)defined after a list that uses it was parsed.
+	     */
+	default:
+	    if ((list = (SMTPD_REST_PROG *)
+		 htable_find(smtpd_rest_classes, name)) != 0) {
+		status = generic_checks(state, list, reply_name,
+					reply_class, def_acl);
+	    } else {
+		msg_warn("unknown smtpd restriction: \"%s\"", name);
+		reject_server_error(state);
+	    }
+	    break;
 	}
 	if (msg_verbose)
 	    msg_info("%s: name=%s status=%d", myname, name, status);
@@ -4868,7 +5651,7 @@ char   *smtpd_check_rewrite(SMTPD_STATE *state)
      * We don't use generic_checks() because it produces results that aren't
      * applicable such as DEFER or REJECT.
      */
-    for (cpp = local_rewrite_clients->argv; *cpp != 0; cpp++) {
+    for (cpp = local_rewrite_clients->argv->argv; *cpp != 0; cpp++) {
 	if (msg_verbose)
 	    msg_info("%s: trying: %s", myname, *cpp);
 	status = SMTPD_CHECK_DUNNO;
@@ -4926,6 +5709,361 @@ char   *smtpd_check_rewrite(SMTPD_STATE *state)
     return (0);
 }
 
+/* smtpd_prefetch_dnsxl - send DNSXL query for domain */
+
+static void smtpd_prefetch_dnsxl(const char *rbl_domain, const char *what)
+{
+    static VSTRING *query;
+    const char *domain;
+
+    if ((domain = dnsxl_domain_name(what)) == 0)
+	return;
+    if (query == 0)
+	query = vstring_alloc(100);
+    vstring_sprintf(query, "%s.%s", domain, rbl_domain);
+    (void) split_at(STR(query), '=');
+    dns_prefetch_add(smtpd_dns_prefetch, STR(query), T_A);
+}
+
+/* smtpd_prefetch_server - send query for check_mumble_{ns,mx,a}_access */
+
+static void smtpd_prefetch_server(const char *name, unsigned type)
+{
+    const char *domain;
+    const char *adomain;
+
+    if ((domain = strrchr(name, '@')) != 0)
+	domain += 1;
+    else
+	domain = name;
+    if (*domain == 0 || *domain == '[')
+	return;
+#ifndef NO_EAI
+    if (!allascii(domain) && (adomain = midna_domain_to_ascii(domain)) != 0)
+	domain = adomain;
+#endif
+    dns_prefetch_add(smtpd_dns_prefetch, domain, type);
+}
+
+/* smtpd_prefetch_mailhost - send queries for reject_unknown_mumble_domain */
+
+static void smtpd_prefetch_mailhost(const char *sender, const char *addr)
+{
+    const RESOLVE_REPLY *reply;
+    const char *domain;
+
+    /*
+     * Skip the same destinations as reject_unknown_address().
+     */
+    reply = smtpd_resolve_addr(sender, addr);
+    if (reply->flags & (RESOLVE_FLAG_FAIL | RESOLVE_CLASS_FINAL))
+	return;
+    if ((domain = strrchr(CONST_STR(reply->recipient), '@')) == 0)
+	return;
+    smtpd_prefetch_server(domain + 1, T_MX);
+    smtpd_prefetch_server(domain + 1, T_A);
+}
+
+/* smtpd_prefetch_list - send DNS queries for one restriction list */
+
+static void smtpd_prefetch_list(SMTPD_STATE *state, SMTPD_REST_PROG *prog,
+				        int depth)
+{
+    static VSTRING *query;
+    SMTPD_REST_PROG *list;
+    char  **cpp;
+    const char *arg;
+    int     op;
+    int     have_name;
+    int     have_rev_name;
+    int     have_sender;
+
+#define SMTPD_PREFETCH_MAX_DEPTH	10
+
+    have_name = (state->name && strcasecmp(state->name, "unknown") != 0);
+    have_rev_name = (state->reverse_name
+		     && strcasecmp(state->reverse_name, "unknown") != 0);
+    have_sender = (state->sender && *state->sender);
+
+    /*
+     * Mirror the generic_checks() dispatch, but only for restrictions that
+     * make DNS queries, and only when the data for the query is available.
+     * Skip over restriction arguments, so that those are not mistaken for
+     * restriction class names.
+     */
+    for (cpp = prog->argv->argv; *cpp != 0; cpp++) {
+	arg = cpp[1];
+	op = prog->ops[cpp - prog->argv->argv];
+	switch (op) {
+
+	    /*
+	     * DNS allow/deny lists.
+	     */
+	case SMTPD_OP_REJECT_RBL_CLIENT:
+	case SMTPD_OP_REJECT_RBL:
+	case SMTPD_OP_PERMIT_DNSWL_CLIENT:
+	    if (arg == 0)
+		break;
+	    cpp += 1;
+	    if (state->addr == 0)
+		break;
+	    if (query == 0)
+		query = vstring_alloc(100);
+	    dnsxl_addr_query(query, arg, state->addr);
+	    (void) split_at(STR(query), '=');
+	    dns_prefetch_add(smtpd_dns_prefetch, STR(query), T_A);
+	    break;
+	case SMTPD_OP_REJECT_RHSBL_CLIENT:
+	case SMTPD_OP_PERMIT_RHSWL_CLIENT:
+	    if (arg == 0)
+		break;
+	    cpp += 1;
+	    if (have_name)
+		smtpd_prefetch_dnsxl(arg, state->name);
+	    break;
+	case SMTPD_OP_REJECT_RHSBL_REVERSE_CLIENT:
+	    if (arg == 0)
+		break;
+	    cpp += 1;
+	    if (have_rev_name)
+		smtpd_prefetch_dnsxl(arg, state->reverse_name);
+	    break;
+	case SMTPD_OP_REJECT_RHSBL_HELO:
+	    if (arg == 0)
+		break;
+	    cpp += 1;
+	    if (state->helo_name)
+		smtpd_prefetch_dnsxl(arg, state->helo_name);
+	    break;
+	case SMTPD_OP_REJECT_RHSBL_SENDER:
+	    if (arg == 0)
+		break;
+	    cpp += 1;
+	    if (have_sender)
+		smtpd_prefetch_dnsxl(arg, state->sender);
+	    break;
+	case SMTPD_OP_REJECT_RHSBL_RECIPIENT:
+	    if (arg == 0)
+		break;
+	    cpp += 1;
+	    if (state->recipient)
+		smtpd_prefetch_dnsxl(arg, state->recipient);
+	    break;
+
+	    /*
+	     * DNS server access tables.
+	     */
+	case SMTPD_OP_CHECK_CLIENT_NS_ACL:
+	case SMTPD_OP_CHECK_CLIENT_MX_ACL:
+	case SMTPD_OP_CHECK_CLIENT_A_ACL:
+	case SMTPD_OP_CHECK_REVERSE_CLIENT_NS_ACL:
+	case SMTPD_OP_CHECK_REVERSE_CLIENT_MX_ACL:
+	case SMTPD_OP_CHECK_REVERSE_CLIENT_A_ACL:
+	case SMTPD_OP_CHECK_HELO_NS_ACL:
+	case SMTPD_OP_CHECK_HELO_MX_ACL:
+	case SMTPD_OP_CHECK_HELO_A_ACL:
+	case SMTPD_OP_CHECK_SENDER_NS_ACL:
+	case SMTPD_OP_CHECK_SENDER_MX_ACL:
+	case SMTPD_OP_CHECK_SENDER_A_ACL:
+	case SMTPD_OP_CHECK_RECIP_NS_ACL:
+	case SMTPD_OP_CHECK_RECIP_MX_ACL:
+	case SMTPD_OP_CHECK_RECIP_A_ACL:
+	    if (arg != 0)
+		cpp += 1;
+	    switch (op) {
+	    case SMTPD_OP_CHECK_CLIENT_NS_ACL:
+		if (have_name)
+		    smtpd_prefetch_server(state->name, T_NS);
+		break;
+	    case SMTPD_OP_CHECK_CLIENT_MX_ACL:
+		if (have_name)
+		    smtpd_prefetch_server(state->name, T_MX);
+		break;
+	    case SMTPD_OP_CHECK_CLIENT_A_ACL:
+		if (have_name)
+		    smtpd_prefetch_server(state->name, T_A);
+		break;
+	    case SMTPD_OP_CHECK_REVERSE_CLIENT_NS_ACL:
+		if (have_rev_name)
+		    smtpd_prefetch_server(state->reverse_name, T_NS);
+		break;
+	    case SMTPD_OP_CHECK_REVERSE_CLIENT_MX_ACL:
+		if (have_rev_name)
+		    smtpd_prefetch_server(state->reverse_name, T_MX);
+		break;
+	    case SMTPD_OP_CHECK_REVERSE_CLIENT_A_ACL:
+		if (have_rev_name)
+		    smtpd_prefetch_server(state->reverse_name, T_A);
+		break;
+	    case SMTPD_OP_CHECK_HELO_NS_ACL:
+		if (state->helo_name)
+		    smtpd_prefetch_server(state->helo_name, T_NS);
+		break;
+	    case SMTPD_OP_CHECK_HELO_MX_ACL:
+		if (state->helo_name)
+		    smtpd_prefetch_server(state->helo_name, T_MX);
+		break;
+	    case SMTPD_OP_CHECK_HELO_A_ACL:
+		if (state->helo_name)
+		    smtpd_prefetch_server(state->helo_name, T_A);
+		break;
+	    case SMTPD_OP_CHECK_SENDER_NS_ACL:
+		if (have_sender)
+		    smtpd_prefetch_server(state->sender, T_NS);
+		break;
+	    case SMTPD_OP_CHECK_SENDER_MX_ACL:
+		if (have_sender)
+		    smtpd_prefetch_server(state->sender, T_MX);
+		break;
+	    case SMTPD_OP_CHECK_SENDER_A_ACL:
+		if (have_sender)
+		    smtpd_prefetch_server(state->sender, T_A);
+		break;
+	    case SMTPD_OP_CHECK_RECIP_NS_ACL:
+		if (state->recipient && *state->recipient)
+		    smtpd_prefetch_server(state->recipient, T_NS);
+		break;
+	    case SMTPD_OP_CHECK_RECIP_MX_ACL:
+		if (state->recipient && *state->recipient)
+		    smtpd_prefetch_server(state->recipient, T_MX);
+		break;
+	    case SMTPD_OP_CHECK_RECIP_A_ACL:
+		if (state->recipient && *state->recipient)
+		    smtpd_prefetch_server(state->recipient, T_A);
+		break;
+	    }
+	    break;
+
+	    /*
+	     * Host and domain existence checks.
+	     */
+	case SMTPD_OP_REJECT_UNKNOWN_HELO_HOSTNAME:
+	case SMTPD_OP_REJECT_UNKNOWN_HOSTNAME:
+	    if (state->helo_name && *state->helo_name != '[') {
+		smtpd_prefetch_server(state->helo_name, T_A);
+		smtpd_prefetch_server(state->helo_name, T_MX);
+	    }
+	    break;
+	case SMTPD_OP_REJECT_UNKNOWN_ADDRESS:
+	case SMTPD_OP_REJECT_UNKNOWN_SENDDOM:
+	    if (have_sender)
+		smtpd_prefetch_mailhost(state->recipient, state->sender);
+	    break;
+	case SMTPD_OP_REJECT_UNKNOWN_RCPTDOM:
+	    if (state->recipient)
+		smtpd_prefetch_mailhost(state->sender, state->recipient);
+	    break;
+
+	    /*
+	     * Restrictions with a non-DNS argument.
+	     */
+	case SMTPD_OP_CHECK_POLICY_SERVICE:
+	case SMTPD_OP_SLEEP:
+	case SMTPD_OP_CHECK_CLIENT_ACL:
+	case SMTPD_OP_CHECK_REVERSE_CLIENT_ACL:
+	case SMTPD_OP_CHECK_CCERT_ACL:
+	case SMTPD_OP_CHECK_SASL_ACL:
+	case SMTPD_OP_CHECK_HELO_ACL:
+	case SMTPD_OP_CHECK_SENDER_ACL:
+	case SMTPD_OP_CHECK_RECIP_ACL:
+	case SMTPD_OP_CHECK_ETRN_ACL:
+	    if (arg != 0)
+		cpp += 1;
+	    break;
+
+	    /*
+	     * Restriction classes.
+	     */
+	case SMTPD_OP_CLASS:
+	    if (depth < SMTPD_PREFETCH_MAX_DEPTH && smtpd_rest_classes != 0
+		&& (list = (SMTPD_REST_PROG *)
+		    htable_find(smtpd_rest_classes, *cpp)) != 0)
+		smtpd_prefetch_list(state, list, depth + 1);
+	    break;
+	}
+    }
+}
+
+/* smtpd_prefetch_permit - restriction list starts with a matching permit */
+
+static int smtpd_prefetch_permit(SMTPD_STATE *state, SMTPD_REST_PROG *prog)
+{
+    char  **cpp;
+
+    /*
+     * Look only at the leading permit_mynetworks, permit_sasl_authenticated
+     * or permit restrictions, which need no DNS lookup. Don't call
+     * permit_mynetworks(), because that may log a compatibility warning.
+     */
+    if (prog->argv->argc == 0)
+	return (1);
+    for (cpp = prog->argv->argv; *cpp != 0; cpp++) {
+	switch (prog->ops[cpp - prog->argv->argv]) {
+	case SMTPD_OP_PERMIT_ALL:
+	    return (1);
+	case SMTPD_OP_PERMIT_MYNETWORKS:
+	    if (namadr_list_match(mynetworks_curr, state->name, state->addr))
+		return (1);
+	    break;
+	case SMTPD_OP_PERMIT_SASL_AUTH:
+#ifdef USE_SASL_AUTH
+	    if (permit_sasl_auth(state, 1, 0))
+		return (1);
+#endif
+	    break;
+	default:
+	    return (0);
+	}
+    }
+    return (0);
+}
+
+/* smtpd_check_prefetch - send DNS queries for all restriction lists */
+
+#define SMTPD_PREFETCH_NOWAIT	0
+#define SMTPD_PREFETCH_WAIT	1
+
+ /*
+  * Don't wait for DNS replies when the restrictions for this stage would
+  * permit the request without DNS lookups, for example for a client in
+  * $mynetworks.
+  */
+#define SMTPD_PREFETCH_WAIT_FOR(state, prog) \
+	(smtpd_prefetch_permit((state), (prog)) ? \
+	 SMTPD_PREFETCH_NOWAIT : SMTPD_PREFETCH_WAIT)
+
+static void smtpd_check_prefetch(SMTPD_STATE *state, int wait)
+{
+    if (smtpd_dns_prefetch == 0)
+	return;
+
+    /*
+     * Walk all restriction lists that may be evaluated in this session, not
+     * only the list for the current stage, because smtpd_delay_reject and
+     * smtpd_recipient_restrictions commonly defer client, helo and sender
+     * checks until RCPT TO time. Queries that were already sent during this
+     * session are not sent again.
+     */
+    smtpd_prefetch_list(state, client_restrctions, 0);
+    smtpd_prefetch_list(state, helo_restrctions, 0);
+    smtpd_prefetch_list(state, mail_restrctions, 0);
+    smtpd_prefetch_list(state, relay_restrctions, 0);
+    smtpd_prefetch_list(state, rcpt_restrctions, 0);
+    if (wait)
+	(void) dns_prefetch_wait(smtpd_dns_prefetch,
+				 var_smtpd_dns_prefetch_tmout);
+}
+
+/* smtpd_check_dns_prefetch - start DNS queries at connection time */
+
+void    smtpd_check_dns_prefetch(SMTPD_STATE *state)
+{
+    if (smtpd_dns_prefetch == 0)
+	return;
+    dns_prefetch_reset(smtpd_dns_prefetch);
+    smtpd_check_prefetch(state, SMTPD_PREFETCH_NOWAIT);
+}
+
 /* smtpd_check_client - validate client name or address */
 
 char   *smtpd_check_client(SMTPD_STATE *state)
@@ -4937,6 +6075,8 @@ char   *smtpd_check_client(SMTPD_STATE *state)
      */
     if (state->name == 0 || state->addr == 0)
 	return (0);
+    smtpd_check_prefetch(state,
+			 SMTPD_PREFETCH_WAIT_FOR(state, client_restrctions));
 
 #define SMTPD_CHECK_RESET() { \
 	state->recursion = 0; \
@@ -4954,7 +6094,7 @@ char   *smtpd_check_client(SMTPD_STATE *state)
      */
     SMTPD_CHECK_RESET();
     status = setjmp(smtpd_check_buf);
-    if (status == 0 && client_restrctions->argc)
+    if (status == 0 && client_restrctions->argv->argc)
 	status = generic_checks(state, client_restrctions, state->namaddr,
 				SMTPD_NAME_CLIENT, CHECK_CLIENT_ACL);
     state->defer_if_permit_client = state->defer_if_permit.active;
@@ -4990,6 +6130,8 @@ char   *smtpd_check_helo(SMTPD_STATE *state, char *helohost)
     }
 
     SMTPD_CHECK_PUSH(saved_helo, state->helo_name, helohost);
+    smtpd_check_prefetch(state,
+			 SMTPD_PREFETCH_WAIT_FOR(state, helo_restrctions));
 
 #define SMTPD_CHECK_HELO_RETURN(x) { \
 	SMTPD_CHECK_POP(state->helo_name, saved_helo); \
@@ -5008,7 +6150,7 @@ char   *smtpd_check_helo(SMTPD_STATE *state, char *helohost)
      */
     SMTPD_CHECK_RESET();
     status = setjmp(smtpd_check_buf);
-    if (status == 0 && helo_restrctions->argc)
+    if (status == 0 && helo_restrctions->argv->argc)
 	status = generic_checks(state, helo_restrctions, state->helo_name,
 				SMTPD_NAME_HELO, CHECK_HELO_ACL);
     state->defer_if_permit_helo = state->defer_if_permit.active;
@@ -5034,6 +6176,8 @@ char   *smtpd_check_mail(SMTPD_STATE *state, char *sender)
      * that we can syslog the recipient with the reject messages.
      */
     SMTPD_CHECK_PUSH(saved_sender, state->sender, sender);
+    smtpd_check_prefetch(state,
+			 SMTPD_PREFETCH_WAIT_FOR(state, mail_restrctions));
 
 #define SMTPD_CHECK_MAIL_RETURN(x) { \
 	SMTPD_CHECK_POP(state->sender, saved_sender); \
@@ -5054,7 +6198,7 @@ char   *smtpd_check_mail(SMTPD_STATE *state, char *sender)
      */
     SMTPD_CHECK_RESET();
     status = setjmp(smtpd_check_buf);
-    if (status == 0 && mail_restrctions->argc)
+    if (status == 0 && mail_restrctions->argv->argc)
 	status = generic_checks(state, mail_restrctions, sender,
 				SMTPD_NAME_SENDER, CHECK_SENDER_ACL);
     state->defer_if_permit_sender = state->defer_if_permit.active;
@@ -5078,7 +6222,7 @@ char   *smtpd_check_rcpt(SMTPD_STATE *state, char *recipient)
     int     status;
     char   *saved_recipient;
     char   *err;
-    ARGV   *restrctions[2];
+    SMTPD_REST_PROG *restrctions[2];
     int     n;
     int     rcpt_index;
     int     relay_index;
@@ -5101,6 +6245,9 @@ char   *smtpd_check_rcpt(SMTPD_STATE *state, char *recipient)
      * that we can syslog the recipient with the reject messages.
      */
     SMTPD_CHECK_PUSH(saved_recipient, state->recipient, recipient);
+    smtpd_check_prefetch(state,
+			 SMTPD_PREFETCH_WAIT_FOR(state, relay_restrctions)
+			 | SMTPD_PREFETCH_WAIT_FOR(state, rcpt_restrctions));
 
 #define SMTPD_CHECK_RCPT_RETURN(x) { \
 	SMTPD_CHECK_POP(state->recipient, saved_recipient); \
@@ -5159,7 +6306,7 @@ char   *smtpd_check_rcpt(SMTPD_STATE *state, char *recipient)
 	fake_relay_restrctions : relay_restrctions;
     for (n = 0; n < 2; n++) {
 	status = setjmp(smtpd_check_buf);
-	if (status == 0 && restrctions[n]->argc)
+	if (status == 0 && restrctions[n]->argv->argc)
 	    status = generic_checks(state, restrctions[n],
 			  recipient, SMTPD_NAME_RECIPIENT, CHECK_RECIP_ACL);
 	if (n == relay_index && warn_compat_break_relay_restrictions
@@ -5248,7 +6395,7 @@ char   *smtpd_check_etrn(SMTPD_STATE *state, char *domain)
      */
     SMTPD_CHECK_RESET();
     status = setjmp(smtpd_check_buf);
-    if (status == 0 && etrn_restrctions->argc)
+    if (status == 0 && etrn_restrctions->argv->argc)
 	status = generic_checks(state, etrn_restrctions, domain,
 				SMTPD_NAME_ETRN, CHECK_ETRN_ACL);
 
@@ -5565,7 +6712,7 @@ char   *smtpd_check_data(SMTPD_STATE *state)
      */
     SMTPD_CHECK_RESET();
     status = setjmp(smtpd_check_buf);
-    if (status == 0 && data_restrctions->argc)
+    if (status == 0 && data_restrctions->argv->argc)
 	status = generic_checks(state, data_restrctions,
 				SMTPD_CMD_DATA, SMTPD_NAME_DATA, NO_DEF_ACL);
 
@@ -5616,7 +6763,7 @@ char   *smtpd_check_eod(SMTPD_STATE *state)
      */
     SMTPD_CHECK_RESET();
     status = setjmp(smtpd_check_buf);
-    if (status == 0 && eod_restrictions->argc)
+    if (status == 0 && eod_restrictions->argv->argc)
 	status = generic_checks(state, eod_restrictions,
 				SMTPD_CMD_EOD, SMTPD_NAME_EOD, NO_DEF_ACL);
 
@@ -5678,6 +6825,8 @@ char   *var_relay_ccerts = "";
 char   *var_notify_classes = "";
 char   *var_smtpd_policy_def_action = "";
 char   *var_smtpd_policy_context = "";
+char   *var_smtpd_policy_cache_attrs = "";
+int     var_smtpd_policy_cache_ttl = 60;
 
  /*
   * String-valued configuration parameters.
@@ -5847,6 +6996,9 @@ int     var_plaintext_code;
 bool    var_smtpd_peername_lookup;
 bool    var_smtpd_client_port_log;
 char   *var_smtpd_dns_re_filter;
+bool    var_smtpd_dns_prefetch;
+char   *var_verify_mmap_file = "";
+int     var_smtpd_dns_prefetch_tmout;
 bool    var_smtpd_tls_ask_ccert;
 int     var_smtpd_cipv4_prefix;
 int     var_smtpd_cipv6_prefix;
@@ -5929,7 +7081,7 @@ bool    var_relay_before_rcpt_checks;
   */
 typedef struct {
     char   *name;
-    ARGV  **target;
+    SMTPD_REST_PROG **target;
 } REST_TABLE;
 
 static const REST_TABLE rest_table[] = {
@@ -5950,7 +7102,7 @@ static int rest_update(char **argv)
 
     for (rp = rest_table; rp->name; rp++) {
 	if (strcasecmp(rp->name, argv[0]) == 0) {
-	    argv_free(rp->target[0]);
+	    smtpd_check_prog_free(rp->target[0]);
 	    rp->target[0] = smtpd_check_parse(SMTPD_CHECK_PARSE_ALL, argv[1]);
 	    return (1);
 	}
@@ -5972,7 +7124,7 @@ static void rest_class(char *class)
     if ((name = mystrtok(&cp, CHARS_COMMA_SP)) == 0)
 	msg_panic("rest_class: null class name");
     if ((entry = htable_locate(smtpd_rest_classes, name)) != 0)
-	argv_free((ARGV *) entry->value);
+	smtpd_check_prog_free((SMTPD_REST_PROG *) entry->value);
     else
 	entry = htable_enter(smtpd_rest_classes, name, (void *) 0);
     entry->value = (void *) smtpd_check_parse(SMTPD_CHECK_PARSE_ALL, cp);
@@ -6380,7 +7532,7 @@ int     main(int argc, char **argv)
 	    }
 	    if (strcasecmp(args->argv[0], VAR_LOC_RWR_CLIENTS) == 0) {
 		UPDATE_STRING(var_local_rwr_clients, args->argv[1]);
-		argv_free(local_rewrite_clients);
+		smtpd_check_prog_free(local_rewrite_clients);
 		local_rewrite_clients = smtpd_check_parse(SMTPD_CHECK_PARSE_MAPS,
 						     var_local_rwr_clients);
 	    }
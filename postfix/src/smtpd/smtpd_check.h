@@ -15,6 +15,7 @@
 extern void smtpd_check_init(void);
 extern int smtpd_check_addr(const char *, const char *, int);
 extern char *smtpd_check_rewrite(SMTPD_STATE *);
+extern void smtpd_check_dns_prefetch(SMTPD_STATE *);
 extern char *smtpd_check_client(SMTPD_STATE *);
 extern char *smtpd_check_helo(SMTPD_STATE *, char *);
 extern char *smtpd_check_mail(SMTPD_STATE *, char *);
@@ -25,6 +26,9 @@ extern char *smtpd_check_etrn(SMTPD_STATE *, char *);
 extern char *smtpd_check_data(SMTPD_STATE *);
 extern char *smtpd_check_eod(SMTPD_STATE *);
 extern char *smtpd_check_policy(SMTPD_STATE *, char *);
+extern void smtpd_check_policy_stats(void);
+extern void smtpd_check_verify_stats(void);
+extern void smtpd_check_policy_release(void);
 extern void log_whatsup(SMTPD_STATE *, const char *, const char *);
 
 /* LICENSE
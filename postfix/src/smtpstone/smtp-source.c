@@ -30,6 +30,14 @@
 /* .IP "\fB-A\fR"
 /*	Don't abort when the server sends something other than the
 /*	expected positive reply code.
+/* .IP \fB-B\fR
+/*	Upon completion, report the number of server greeting banners
+/*	received per second, and the time from connect() to the
+/*	receipt of the server greeting banner (count, minimum,
+/*	average, median, 99th percentile, and maximum). This is
+/*	useful to measure how quickly a server accepts a burst of
+/*	new connections, for example with and without a pool of
+/*	idle server processes.
 /* .IP \fB-c\fR
 /*	Display a running counter that is incremented each time
 /*	an SMTP DATA command completes.
@@ -135,6 +143,7 @@
 
 #include <sys_defs.h>
 #include <sys/socket.h>
+#include <sys/time.h>
 #include <sys/wait.h>
 #include <netinet/in.h>
 #include <sys/un.h>
@@ -193,11 +202,22 @@ typedef struct SESSION {
     int     rcpt_sample;		/* Sample recipient # for To: header */
     VSTREAM *stream;			/* open connection */
     int     connect_count;		/* # of connect()s to retry */
+    double  connect_time;		/* start of TCP handshake */
     struct SESSION *next;		/* connect() queue linkage */
 } SESSION;
 
 static SESSION *last_session;		/* connect() queue tail */
 
+ /*
+  * Time-to-banner samples, reported upon completion.
+  */
+static int banner_stats;		/* report time to banner */
+static double *banner_delay;		/* one sample per connection */
+static int banner_count;		/* # of samples */
+static int banner_size;			/* # of sample slots */
+static double banner_first;		/* first connect() */
+static double banner_last;		/* last banner */
+
  /*
   * Structure with broken-up SMTP server response.
   */
@@ -485,6 +505,53 @@ static void fail_connect(SESSION *session)
     start_connect(session);
 }
 
+/* time_now - wall-clock time with sub-second resolution */
+
+static double time_now(void)
+{
+    struct timeval tv;
+
+    GETTIMEOFDAY(&tv);
+    return (tv.tv_sec + tv.tv_usec / 1000000.0);
+}
+
+/* banner_delay_cmp - qsort callback */
+
+static int banner_delay_cmp(const void *a, const void *b)
+{
+    double  da = *(const double *) a;
+    double  db = *(const double *) b;
+
+    return (da < db ? -1 : da > db ? 1 : 0);
+}
+
+/* banner_report - report time-to-banner statistics */
+
+static void banner_report(void)
+{
+    double  sum = 0;
+    int     n;
+
+#define BANNER_PCT(p) banner_delay[(banner_count - 1) * (p) / 100]
+
+    if (banner_count == 0) {
+	msg_info("time to banner: no samples");
+	return;
+    }
+    qsort((void *) banner_delay, banner_count, sizeof(*banner_delay),
+	  banner_delay_cmp);
+    for (n = 0; n < banner_count; n++)
+	sum += banner_delay[n];
+    msg_info("%d connections in %.3fs (%.0f/s)", banner_count,
+	     banner_last - banner_first, banner_last > banner_first ?
+	     banner_count / (banner_last - banner_first) : 0.0);
+    msg_info("time to banner: %d connections, min %.2fms avg %.2fms "
+	     "p50 %.2fms p99 %.2fms max %.2fms", banner_count,
+	     1000 * banner_delay[0], 1000 * sum / banner_count,
+	     1000 * BANNER_PCT(50), 1000 * BANNER_PCT(99),
+	     1000 * banner_delay[banner_count - 1]);
+}
+
 /* start_connect - start TCP handshake */
 
 static void start_connect(SESSION *session)
@@ -511,6 +578,9 @@ static void start_connect(SESSION *session)
     smtp_timeout_setup(session->stream, var_timeout);
     if (inet_windowsize > 0)
 	set_inet_windowsize(fd, inet_windowsize);
+    session->connect_time = time_now();
+    if (banner_first == 0)
+	banner_first = session->connect_time;
     if (sane_connect(fd, sa, sa_length) < 0 && errno != EINPROGRESS)
 	fail_connect(session);
 }
@@ -561,7 +631,21 @@ static void read_banner(int unused_event, void *context)
     /*
      * Read and parse the server's SMTP greeting banner.
      */
-    if (((resp = response(session->stream, buffer))->code / 100) == 2) {
+    resp = response(session->stream, buffer);
+    if (banner_stats) {
+	if (banner_size == 0) {
+	    banner_size = 100;
+	    banner_delay = (double *) mymalloc(banner_size
+					       * sizeof(*banner_delay));
+	} else if (banner_count >= banner_size) {
+	    banner_size *= 2;
+	    banner_delay = (double *) myrealloc((void *) banner_delay,
+					  banner_size * sizeof(*banner_delay));
+	}
+	banner_last = time_now();
+	banner_delay[banner_count++] = banner_last - session->connect_time;
+    }
+    if ((resp->code / 100) == 2) {
 	 /* void */ ;
     } else if (allow_reject) {
 	msg_warn("rejected at server banner: %d %s", resp->code, resp->str);
@@ -978,7 +1062,7 @@ static void close_session(SESSION *session)
 
 static void usage(char *myname)
 {
-    msg_fatal("usage: %s -cdLNov -s sess -l msglen -m msgs -C count -M myhostname -f from -t to -r rcptcount -R delay -w delay host[:port]", myname);
+    msg_fatal("usage: %s -BcdLNov -s sess -l msglen -m msgs -C count -M myhostname -f from -t to -r rcptcount -R delay -w delay host[:port]", myname);
 }
 
 MAIL_VERSION_STAMP_DECLARE;
@@ -1013,7 +1097,7 @@ int     main(int argc, char **argv)
     /*
      * Parse JCL.
      */
-    while ((ch = GETOPT(argc, argv, "46AcC:df:F:l:Lm:M:Nor:R:s:S:t:T:vw:")) > 0) {
+    while ((ch = GETOPT(argc, argv, "46ABcC:df:F:l:Lm:M:Nor:R:s:S:t:T:vw:")) > 0) {
 	switch (ch) {
 	case '4':
 	    protocols = INET_PROTO_NAME_IPV4;
@@ -1024,6 +1108,9 @@ int     main(int argc, char **argv)
 	case 'A':
 	    allow_reject = 1;
 	    break;
+	case 'B':
+	    banner_stats = 1;
+	    break;
 	case 'c':
 	    count++;
 	    break;
@@ -1228,6 +1315,8 @@ int     main(int argc, char **argv)
 		VSTREAM_PUTC('\n', VSTREAM_OUT);
 		vstream_fflush(VSTREAM_OUT);
 	    }
+	    if (banner_stats)
+		banner_report();
 	    exit(0);
 	}
     }
@@ -14,6 +14,10 @@
 /*	void	resolve_proto(context, stream)
 /*	RES_CONTEXT *context;
 /*	VSTREAM	*stream;
+/*
+/*	void	resolve_batch_proto(context, stream)
+/*	RES_CONTEXT *context;
+/*	VSTREAM	*stream;
 /* DESCRIPTION
 /*	This module implements the trivial address resolving engine.
 /*	It distinguishes between local and remote mail, and optionally
@@ -30,6 +34,12 @@
 /*	resolve_proto() implements the client-server protocol:
 /*	read one address in FQDN form, reply with a (transport,
 /*	nexthop, internalized recipient) triple.
+/*
+/*	resolve_batch_proto() implements the batch version: read
+/*	a sender and a vector of addresses, and reply with one
+/*	triple per address. A result is flagged with RESOLVE_FLAG_DOMAIN
+/*	when no local-part based table lookups are configured, and
+/*	the address was not changed or flagged as routed.
 /* STANDARDS
 /* DIAGNOSTICS
 /*	Problems and transactions are logged to \fBsyslogd\fR(8)
@@ -72,6 +82,7 @@
 #include <valid_utf8_hostname.h>
 #include <stringops.h>
 #include <mymalloc.h>
+#include <argv.h>
 
 /* Global library. */
 
@@ -805,6 +816,81 @@ int     resolve_proto(RES_CONTEXT *context, VSTREAM *stream)
     return (0);
 }
 
+/* resolve_batch_proto - read batch request and send reply */
+
+int     resolve_batch_proto(RES_CONTEXT *context, VSTREAM *stream)
+{
+    static ARGV *batch;
+    int     count;
+    int     flags;
+    int     n;
+
+    if (batch == 0)
+	batch = argv_alloc(10);
+    else
+	argv_truncate(batch, 0);
+
+    /*
+     * Read the entire request before replying; the client does not read
+     * until it has sent all addresses.
+     */
+    if (attr_scan(stream, ATTR_FLAG_STRICT | ATTR_FLAG_MORE,
+		  RECV_ATTR_STR(MAIL_ATTR_SENDER, sender),
+		  RECV_ATTR_INT(MAIL_ATTR_NREQ, &count),
+		  ATTR_TYPE_END) != 2)
+	return (-1);
+    if (count < 1 || count > RESOLVE_BATCH_LIMIT) {
+	msg_warn("bad batch request address count: %d", count);
+	return (-1);
+    }
+    for (n = 0; n < count; n++) {
+	if (attr_scan(stream, n < count - 1 ?
+		      ATTR_FLAG_STRICT | ATTR_FLAG_MORE : ATTR_FLAG_STRICT,
+		      RECV_ATTR_STR(MAIL_ATTR_ADDR, query),
+		      ATTR_TYPE_END) != 1)
+	    return (-1);
+	argv_add(batch, STR(query), (char *) 0);
+    }
+
+    /*
+     * Results that do not depend on the recipient local-part may be cached
+     * by domain. The transport and relocated tables may have entries for
+     * individual addresses, and routing operators or address rewriting
+     * make the result specific to one address.
+     */
+    attr_print(stream, ATTR_FLAG_MORE,
+	       SEND_ATTR_INT(MAIL_ATTR_FLAGS, server_flags),
+	       SEND_ATTR_INT(MAIL_ATTR_NREQ, count),
+	       ATTR_TYPE_END);
+    for (n = 0; n < count; n++) {
+	resolve_addr(context, STR(sender), batch->argv[n],
+		     channel, nexthop, nextrcpt, &flags);
+	if (context->transport_info == 0 && relocated_maps == 0
+	    && (flags & (RESOLVE_FLAG_ROUTED | RESOLVE_FLAG_ERROR
+			 | RESOLVE_FLAG_FAIL)) == 0
+	    && strcmp(STR(nextrcpt), batch->argv[n]) == 0)
+	    flags |= RESOLVE_FLAG_DOMAIN;
+
+	if (msg_verbose)
+	    msg_info("`%s' -> `%s' -> (`%s' `%s' `%s' `%d')",
+		     STR(sender), batch->argv[n], STR(channel),
+		     STR(nexthop), STR(nextrcpt), flags);
+
+	attr_print(stream, n < count - 1 ? ATTR_FLAG_MORE : ATTR_FLAG_NONE,
+		   SEND_ATTR_STR(MAIL_ATTR_TRANSPORT, STR(channel)),
+		   SEND_ATTR_STR(MAIL_ATTR_NEXTHOP, STR(nexthop)),
+		   SEND_ATTR_STR(MAIL_ATTR_RECIP, STR(nextrcpt)),
+		   SEND_ATTR_INT(MAIL_ATTR_FLAGS, flags),
+		   ATTR_TYPE_END);
+    }
+
+    if (vstream_fflush(stream) != 0) {
+	msg_warn("write resolver reply: %m");
+	return (-1);
+    }
+    return (0);
+}
+
 /* resolve_init - module initializations */
 
 void    resolve_init(void)
@@ -501,6 +501,10 @@ static void rewrite_service(VSTREAM *stream, char *unused_service, char **argv)
 	    status = resolve_proto(&resolve_regular, stream);
 	} else if (strcmp(vstring_str(command), RESOLVE_VERIFY) == 0) {
 	    status = resolve_proto(&resolve_verify, stream);
+	} else if (strcmp(vstring_str(command), RESOLVE_REGULAR_BATCH) == 0) {
+	    status = resolve_batch_proto(&resolve_regular, stream);
+	} else if (strcmp(vstring_str(command), RESOLVE_VERIFY_BATCH) == 0) {
+	    status = resolve_batch_proto(&resolve_verify, stream);
 	} else {
 	    msg_warn("bad command %.30s", printable(vstring_str(command), '?'));
 	}
@@ -30,6 +30,9 @@
 /*	void	attr_clnt_free(client)
 /*	ATTR_CLNT *client;
 /*
+/*	void	attr_clnt_disconnect(client)
+/*	ATTR_CLNT *client;
+/*
 /*	void	attr_clnt_control(client, name, value, ... ATTR_CLNT_CTL_END)
 /*	ATTR_CLNT *client;
 /*	int	name;
@@ -47,6 +50,10 @@
 /*
 /*	attr_clnt_free() destroys a client handle and closes its connection.
 /*
+/*	attr_clnt_disconnect() closes the connection to the server,
+/*	if one is open, without destroying the client handle. The
+/*	next request will open a new connection.
+/*
 /*	attr_clnt_control() allows the user to fine tune the behavior of
 /*	the specified client. The arguments are a list of (name, value)
 /*	terminated with ATTR_CLNT_CTL_END.
@@ -134,6 +141,13 @@ void    attr_clnt_free(ATTR_CLNT *client)
     myfree((void *) client);
 }
 
+/* attr_clnt_disconnect - close connection, keep client */
+
+void    attr_clnt_disconnect(ATTR_CLNT *client)
+{
+    auto_clnt_recover(client->auto_clnt);
+}
+
 /* attr_clnt_create - create attribute client */
 
 ATTR_CLNT *attr_clnt_create(const char *service, int timeout,
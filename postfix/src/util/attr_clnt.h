@@ -32,6 +32,7 @@ typedef int (*ATTR_CLNT_HANDSHAKE_FN) (VSTREAM *);
 extern ATTR_CLNT *attr_clnt_create(const char *, int, int, int);
 extern int attr_clnt_request(ATTR_CLNT *, int,...);
 extern void attr_clnt_free(ATTR_CLNT *);
+extern void attr_clnt_disconnect(ATTR_CLNT *);
 extern void attr_clnt_control(ATTR_CLNT *, int,...);
 
 #define ATTR_CLNT_CTL_END	0
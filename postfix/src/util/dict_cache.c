@@ -121,8 +121,19 @@
 /*	interval to stop cache cleanup.
 /* .IP "CA_DICT_CACHE_CTL_CONTEXT(void *context)"
 /*	Application context that is passed to the validator function.
+/* .IP "CA_DICT_CACHE_CTL_BATCH(int count)"
+/*	The maximal number of cache entries that a cleanup run
+/*	examines before it yields to other events (default: 1000).
+/* .IP "CA_DICT_CACHE_CTL_SLICE(int msec)"
+/*	The maximal time in milliseconds that a cleanup run spends
+/*	before it yields to other events (default: 10). A cleanup
+/*	run examines at least one entry each time.
 /* .RE
 /* .PP
+/*	A cleanup run resumes where it left off, and with
+/*	CA_DICT_CACHE_CTL_FLAG_EXP_SUMMARY, logs progress once a
+/*	minute until the run completes.
+/* .PP
 /*	dict_cache_name() returns the name of the specified cache.
 /*
 /*	dict_cache_error() returns the error status for the underlying
@@ -232,8 +243,11 @@ struct DICT_CACHE {
     int     exp_interval;		/* time between cleanup runs */
     DICT_CACHE_VALIDATOR_FN exp_validator;	/* expiration call-back */
     void   *exp_context;		/* call-back context */
+    int     exp_batch;			/* max entries per cleanup step */
+    int     exp_slice;			/* max msec per cleanup step */
     int     retained;			/* entries retained in cleanup run */
     int     dropped;			/* entries removed in cleanup run */
+    time_t  progress_stamp;		/* last cleanup progress report */
 
     /* Rate-limited logging support. */
     int     log_delay;
@@ -250,6 +264,18 @@ struct DICT_CACHE {
   */
 #define DC_DEF_LOG_DELAY	1
 
+ /*
+  * Cleanup runs are time-sliced. Each step examines a bounded number of
+  * entries within a bounded amount of time, then yields to other events.
+  */
+#define DC_DEF_EXP_BATCH	1000
+#define DC_DEF_EXP_SLICE	10		/* msec */
+#define DC_PROGRESS_INTERVAL	60		/* sec */
+
+#define DC_ELAPSED_MS(new, old) \
+    (((new).tv_sec - (old).tv_sec) * 1000 \
+	+ ((new).tv_usec - (old).tv_usec) / 1000)
+
  /*
   * Macros to make obscure code more readable.
   */
@@ -465,7 +491,7 @@ static void dict_cache_clean_stat_log_reset(DICT_CACHE *cp,
     cp->retained = cp->dropped = 0;
 }
 
-/* dict_cache_clean_event - examine one cache entry */
+/* dict_cache_clean_event - examine a batch of cache entries */
 
 static void dict_cache_clean_event(int unused_event, void *cache_context)
 {
@@ -476,6 +502,10 @@ static void dict_cache_clean_event(int unused_event, void *cache_context)
     int     next_interval;
     VSTRING *stamp_buf;
     int     first_next;
+    struct timeval start;
+    struct timeval now;
+    int     seq_res = 0;
+    int     count;
 
     /*
      * We interleave cache cleanup with other processing, so that the
@@ -488,6 +518,7 @@ static void dict_cache_clean_event(int unused_event, void *cache_context)
      */
     if (cp->saved_curr_key == 0) {
 	cp->retained = cp->dropped = 0;
+	cp->progress_stamp = event_time();
 	first_next = DICT_SEQ_FUN_FIRST;
 	if (cp->user_flags & DICT_CACHE_FLAG_VERBOSE)
 	    msg_info("%s: start %s cache cleanup", myname, cp->name);
@@ -501,9 +532,21 @@ static void dict_cache_clean_event(int unused_event, void *cache_context)
     }
 
     /*
-     * Examine one cache entry.
+     * Examine cache entries until the batch or the time slice is used up.
+     * The sequence position and any pending delete-behind are saved in the
+     * cache object, so that the next step resumes where this one stopped.
      */
-    if (dict_cache_sequence(cp, first_next, &cache_key, &cache_val) == 0) {
+    GETTIMEOFDAY(&start);
+    for (count = 0; count < cp->exp_batch; count++) {
+	if (count > 0) {
+	    GETTIMEOFDAY(&now);
+	    if (DC_ELAPSED_MS(now, start) >= cp->exp_slice)
+		break;
+	}
+	if ((seq_res = dict_cache_sequence(cp, first_next,
+					   &cache_key, &cache_val)) != 0)
+	    break;
+	first_next = DICT_SEQ_FUN_NEXT;
 	if (cp->exp_validator(cache_key, cache_val, cp->exp_context) == 0) {
 	    DC_SCHEDULE_FOR_DELETE_BEHIND(cp);
 	    cp->dropped++;
@@ -516,6 +559,18 @@ static void dict_cache_clean_event(int unused_event, void *cache_context)
 		msg_info("%s: keep %s cache entry for %s",
 			 myname, cp->name, cache_key);
 	}
+    }
+
+    /*
+     * Cache cleanup in progress. Report progress now and then.
+     */
+    if (seq_res == 0) {
+	if ((cp->user_flags & DICT_CACHE_FLAG_STATISTICS)
+	    && event_time() >= cp->progress_stamp + DC_PROGRESS_INTERVAL) {
+	    msg_info("cache %s cleanup in progress: retained=%d dropped=%d "
+		     "entries", cp->name, cp->retained, cp->dropped);
+	    cp->progress_stamp = event_time();
+	}
 	next_interval = 0;
     }
 
@@ -576,6 +631,16 @@ void    dict_cache_control(DICT_CACHE *cp,...)
 	case DICT_CACHE_CTL_CONTEXT:
 	    cp->exp_context = va_arg(ap, void *);
 	    break;
+	case DICT_CACHE_CTL_BATCH:
+	    if ((cp->exp_batch = va_arg(ap, int)) <= 0)
+		msg_panic("%s: bad %s cache cleanup batch size %d",
+			  myname, cp->name, cp->exp_batch);
+	    break;
+	case DICT_CACHE_CTL_SLICE:
+	    if ((cp->exp_slice = va_arg(ap, int)) <= 0)
+		msg_panic("%s: bad %s cache cleanup time slice %d",
+			  myname, cp->name, cp->exp_slice);
+	    break;
 	default:
 	    msg_panic("%s: bad command: %d", myname, name);
 	}
@@ -649,8 +714,11 @@ DICT_CACHE *dict_cache_open(const char *dbname, int open_flags, int dict_flags)
     cp->exp_interval = 0;
     cp->exp_validator = 0;
     cp->exp_context = 0;
+    cp->exp_batch = DC_DEF_EXP_BATCH;
+    cp->exp_slice = DC_DEF_EXP_SLICE;
     cp->retained = 0;
     cp->dropped = 0;
+    cp->progress_stamp = 0;
     cp->log_delay = DC_DEF_LOG_DELAY;
     cp->upd_log_stamp = cp->get_log_stamp =
 	cp->del_log_stamp = cp->seq_log_stamp = 0;
@@ -720,6 +788,9 @@ int     dict_cache_error(DICT_CACHE *cp)
 		"\n\tlmdb_map_size <limit> (initial LMDB size limit)" \
 		"\n\tcache <type>:<name> (switch to named database)" \
 		"\n\tstatus (show map size, cache, pending requests)" \
+		"\n\tbatch <count> (max entries per cleanup step)" \
+		"\n\tslice <msec> (max time per cleanup step)" \
+		"\n\tclean <key-suffix> (cleanup run that drops entries)" \
 		"\n\n\tTo manage pending requests:" \
 		"\n\treset (discard pending requests)" \
 		"\n\trun (execute pending requests in interleaved order)" \
@@ -770,6 +841,8 @@ typedef struct DICT_CACHE_TEST {
 #define STR(x)	vstring_str(x)
 
 int     show_elapsed = 1;		/* show elapsed time */
+int     clean_batch = DC_DEF_EXP_BATCH;	/* max entries per cleanup step */
+int     clean_slice = DC_DEF_EXP_SLICE;	/* max msec per cleanup step */
 
 #ifdef HAS_LMDB
 extern size_t dict_lmdb_map_size;	/* LMDB-specific */
@@ -994,6 +1067,67 @@ static void iter_action(DICT_CACHE_SREQ *cp, DICT_CACHE *dp, VSTRING *bp)
     }
 }
 
+/* clean_validator - drop entries with the specified key suffix */
+
+static int clean_validator(const char *cache_key, const char *unused_val,
+			           void *context)
+{
+    const char *suffix = cache_key + strspn(cache_key, "0123456789");
+
+    return (suffix[0] != '-' || strcmp(suffix + 1, (char *) context) != 0);
+}
+
+/* clean_cache - run one time-sliced cleanup to completion */
+
+static void clean_cache(DICT_CACHE *dp, char *suffix)
+{
+    struct timeval start;
+    struct timeval before;
+    struct timeval after;
+    struct timeval elapsed;
+    double  step;
+    double  max_step = 0;
+    int     steps = 0;
+
+    if (dp == 0) {
+	msg_warn("no cache");
+	return;
+    }
+
+    /*
+     * Start the cleanup thread now, not after the cleanup interval, and
+     * stop it after one run. Each event loop iteration runs one step.
+     */
+    (void) dict_del(dp->db, DC_LAST_CACHE_CLEANUP_COMPLETED);
+    dict_cache_control(dp,
+		       CA_DICT_CACHE_CTL_FLAGS(DICT_CACHE_FLAG_STATISTICS
+			     | (msg_verbose ? DICT_CACHE_FLAG_VERBOSE : 0)),
+		       CA_DICT_CACHE_CTL_BATCH(clean_batch),
+		       CA_DICT_CACHE_CTL_SLICE(clean_slice),
+		       CA_DICT_CACHE_CTL_INTERVAL(3600),
+		       CA_DICT_CACHE_CTL_VALIDATOR(clean_validator),
+		       CA_DICT_CACHE_CTL_CONTEXT((void *) suffix),
+		       CA_DICT_CACHE_CTL_END);
+    GETTIMEOFDAY(&start);
+    do {
+	GETTIMEOFDAY(&before);
+	event_loop(0);
+	GETTIMEOFDAY(&after);
+	timersub(&after, &before, &elapsed);
+	step = elapsed.tv_sec + elapsed.tv_usec / 1000000.0;
+	if (step > max_step)
+	    max_step = step;
+	steps++;
+    } while (dp->saved_curr_key != 0);
+    dict_cache_control(dp, CA_DICT_CACHE_CTL_INTERVAL(0),
+		       CA_DICT_CACHE_CTL_END);
+    timersub(&after, &start, &elapsed);
+    if (show_elapsed)
+	vstream_printf("Elapsed: %g Steps: %d Longest step: %g\n",
+		       elapsed.tv_sec + elapsed.tv_usec / 1000000.0,
+		       steps, max_step);
+}
+
  /*
   * Table-driven support.
   */
@@ -1108,6 +1242,12 @@ int     main(int argc, char **argv)
 	    msg_verbose = atoi(args->argv[1]);
 	} else if (strcmp(args->argv[0], "elapsed") == 0 && args->argc == 2) {
 	    show_elapsed = atoi(args->argv[1]);
+	} else if (strcmp(args->argv[0], "batch") == 0 && args->argc == 2) {
+	    if ((clean_batch = atoi(args->argv[1])) <= 0)
+		clean_batch = 1;
+	} else if (strcmp(args->argv[0], "slice") == 0 && args->argc == 2) {
+	    if ((clean_slice = atoi(args->argv[1])) <= 0)
+		clean_slice = 1;
 #ifdef HAS_LMDB
 	} else if (strcmp(args->argv[0], "lmdb_map_size") == 0 && args->argc == 2) {
 	    dict_lmdb_map_size = atol(args->argv[1]);
@@ -1123,6 +1263,8 @@ int     main(int argc, char **argv)
 	    run_requests(test_job, cache, inbuf);
 	} else if (strcmp(args->argv[0], "status") == 0 && args->argc == 1) {
 	    show_status(test_job, cache);
+	} else if (strcmp(args->argv[0], "clean") == 0 && args->argc == 2) {
+	    clean_cache(cache, args->argv[1]);
 	} else {
 	    add_request(test_job, args);
 	}
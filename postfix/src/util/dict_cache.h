@@ -42,6 +42,8 @@ extern int dict_cache_error(DICT_CACHE *);
 #define DICT_CACHE_CTL_INTERVAL		2	/* cleanup interval */
 #define DICT_CACHE_CTL_VALIDATOR	3	/* call-back validator */
 #define DICT_CACHE_CTL_CONTEXT		4	/* call-back context */
+#define DICT_CACHE_CTL_BATCH		5	/* entries per cleanup step */
+#define DICT_CACHE_CTL_SLICE		6	/* time per cleanup step */
 
 /* Safer API: type-checked arguments, external use. */
 #define CA_DICT_CACHE_CTL_END		DICT_CACHE_CTL_END
@@ -49,6 +51,8 @@ extern int dict_cache_error(DICT_CACHE *);
 #define CA_DICT_CACHE_CTL_INTERVAL(v)	DICT_CACHE_CTL_INTERVAL, CHECK_VAL(DICT_CACHE, int, (v))
 #define CA_DICT_CACHE_CTL_VALIDATOR(v)	DICT_CACHE_CTL_VALIDATOR, CHECK_VAL(DICT_CACHE, DICT_CACHE_VALIDATOR_FN, (v))
 #define CA_DICT_CACHE_CTL_CONTEXT(v)	DICT_CACHE_CTL_CONTEXT, CHECK_PTR(DICT_CACHE, void, (v))
+#define CA_DICT_CACHE_CTL_BATCH(v)	DICT_CACHE_CTL_BATCH, CHECK_VAL(DICT_CACHE, int, (v))
+#define CA_DICT_CACHE_CTL_SLICE(v)	DICT_CACHE_CTL_SLICE, CHECK_VAL(DICT_CACHE, int, (v))
 
 CHECK_VAL_HELPER_DCL(DICT_CACHE, int);
 CHECK_VAL_HELPER_DCL(DICT_CACHE, DICT_CACHE_VALIDATOR_FN);
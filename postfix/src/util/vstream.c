@@ -138,6 +138,10 @@
 /*	const char *vstream_peek_data(stream)
 /*	VSTREAM	*stream;
 /*
+/*	void	vstream_peek_skip(stream, len)
+/*	VSTREAM	*stream;
+/*	ssize_t	len;
+/*
 /*	int	vstream_setjmp(stream)
 /*	VSTREAM	*stream;
 /*
@@ -372,14 +376,18 @@
 /*	used.
 /* .IP "CA_VSTREAM_CTL_BUFSIZE(ssize_t)"
 /*	Specify a non-default buffer size for the next read(2) or
-/*	write(2) operation, or zero to implement a no-op. Requests
-/*	to reduce the buffer size are silently ignored (i.e. any
-/*	positive value <= vstream_req_bufsize()). To get a buffer
-/*	size smaller than VSTREAM_BUFSIZE, make the VSTREAM_CTL_BUFSIZE
-/*	request before the first stream read or write operation
-/*	(i.e., vstream_req_bufsize() returns zero).  Requests to
-/*	change a fixed-size buffer (i.e., VSTREAM_ERR) are not
-/*	allowed.
+/*	write(2) operation, or zero to implement a no-op. A request
+/*	to reduce the buffer size to a value >= VSTREAM_BUFSIZE
+/*	takes effect for the read buffer when it is next refilled;
+/*	a write buffer that was already enlarged keeps its size, and
+/*	so does a buffer that was enlarged by formatted output without
+/*	such a request.
+/*	Other requests to reduce the buffer size are silently
+/*	ignored. To get a buffer size smaller than VSTREAM_BUFSIZE,
+/*	make the VSTREAM_CTL_BUFSIZE request before the first stream
+/*	read or write operation (i.e., vstream_req_bufsize() returns
+/*	zero).  Requests to change a fixed-size buffer (i.e.,
+/*	VSTREAM_ERR) are not allowed.
 /*
 /*	NOTE: the vstream_*printf() routines may silently expand a
 /*	buffer, so that the result of some %letter specifiers can
@@ -460,6 +468,14 @@
 /*	that exist according to vstream_peek(), or null if no unread
 /*	bytes are available.
 /*
+/*	vstream_peek_skip() consumes \fIlen\fR bytes of the unread
+/*	data that exist according to vstream_peek(), as if they were
+/*	read with vstream_fread(), but without copying them. This
+/*	allows an application to process data in place with
+/*	vstream_peek_data(); the data remain valid until the next
+/*	operation on the stream. It is an error to skip more bytes
+/*	than vstream_peek() reports.
+/*
 /*	vstream_setjmp() saves processing context and makes that context
 /*	available for use with vstream_longjmp().  Normally, vstream_setjmp()
 /*	returns zero.  A non-zero result means that vstream_setjmp() returned
@@ -941,6 +957,22 @@ static int vstream_buf_get_ready(VBUF *bp)
     if (bp->len < stream->req_bufsize)
 	vstream_buf_alloc(bp, stream->req_bufsize);
 
+    /*
+     * If the preferred buffer size was reduced, release the excess memory
+     * now that the buffer holds no unread data. Don't shrink a buffer that
+     * was expanded by vstream_buf_space() or formatted output, otherwise
+     * every change of I/O direction would reallocate it.
+     */
+    else if ((bp->flags & VSTREAM_FLAG_SHRINK)
+	     && bp->len > stream->req_bufsize
+	     && (bp->flags & VSTREAM_FLAG_FIXED) == 0) {
+	bp->data = (unsigned char *) myrealloc((void *) bp->data,
+					       stream->req_bufsize);
+	bp->len = stream->req_bufsize;
+	VSTREAM_BUF_AT_END(bp);
+    }
+    bp->flags &= ~VSTREAM_FLAG_SHRINK;
+
     /*
      * If the stream is double-buffered and the write buffer is not empty,
      * this is the time to flush the write buffer. Delayed flushes reduce
@@ -1725,12 +1757,16 @@ void    vstream_control(VSTREAM *stream, int name,...)
 		msg_panic("unreasonable VSTREAM_CTL_BUFSIZE request: %ld",
 			  (long) req_bufsize);
 	    if ((stream->buf.flags & VSTREAM_FLAG_FIXED) == 0
-		&& req_bufsize > stream->req_bufsize) {
+		&& (req_bufsize > stream->req_bufsize
+		    || (req_bufsize >= VSTREAM_BUFSIZE
+			&& req_bufsize < stream->req_bufsize))) {
 		if (msg_verbose)
 		    msg_info("fd=%d: stream buffer size old=%ld new=%ld",
 			     vstream_fileno(stream),
 			     (long) stream->req_bufsize,
 			     (long) req_bufsize);
+		if (req_bufsize < stream->req_bufsize)
+		    stream->buf.flags |= VSTREAM_FLAG_SHRINK;
 		stream->req_bufsize = req_bufsize;
 	    }
 	    break;
@@ -1853,6 +1889,27 @@ const char *vstream_peek_data(VSTREAM *vp)
     }
 }
 
+/* vstream_peek_skip - consume unread data */
+
+void    vstream_peek_skip(VSTREAM *vp, ssize_t len)
+{
+    VBUF   *bp;
+
+    if (vp->buf.flags & VSTREAM_FLAG_READ) {
+	bp = &vp->buf;
+    } else if (vp->buf.flags & VSTREAM_FLAG_DOUBLE) {
+	bp = &vp->read_buf;
+    } else {
+	bp = 0;
+    }
+    if (len < 0 || len > (bp ? -bp->cnt : 0))
+	msg_panic("vstream_peek_skip: bad length %ld", (long) len);
+    if (len > 0) {
+	bp->ptr += len;
+	bp->cnt += len;
+    }
+}
+
 /* vstream_memopen - open a VSTRING */
 
 VSTREAM *vstream_memreopen(VSTREAM *stream, VSTRING *string, int flags)
@@ -1917,6 +1974,45 @@ static void copy_line(ssize_t bufsize)
     vstream_fflush(VSTREAM_ERR);
 }
 
+static void resize_buffer(void)
+{
+    const char *path = "vstream_test.file";
+    VSTREAM *fp;
+    int     count;
+    int     n;
+
+    /*
+     * Demonstrates that a buffer that was expanded by formatted output keeps
+     * its size when the stream changes from writing to reading, and that an
+     * explicit request to shrink the buffer takes effect when the read
+     * buffer is next refilled, without losing data.
+     */
+    vstream_printf("buffer size test: grow, shrink and refill\n");
+    if ((fp = vstream_fopen(path, O_RDWR | O_CREAT | O_TRUNC, 0600)) == 0)
+	msg_fatal("open %s: %m", path);
+    (void) unlink(path);
+    vstream_fprintf(fp, "%*s\n", 3 * VSTREAM_BUFSIZE, "x");
+    for (n = 0; n < 4 * VSTREAM_BUFSIZE; n++)
+	VSTREAM_PUTC('y', fp);
+    vstream_printf("after formatted write: %ld\n", (long) fp->buf.len);
+    if (vstream_fseek(fp, (off_t) 0, SEEK_SET) < 0)
+	msg_fatal("seek %s: %m", path);
+    (void) VSTREAM_GETC(fp);
+    vstream_printf("after read: %ld\n", (long) fp->buf.len);
+    vstream_control(fp, CA_VSTREAM_CTL_BUFSIZE(2 * VSTREAM_BUFSIZE),
+		    VSTREAM_CTL_END);
+    vstream_printf("after grow request: %ld\n", (long) fp->buf.len);
+    vstream_control(fp, CA_VSTREAM_CTL_BUFSIZE(VSTREAM_BUFSIZE),
+		    VSTREAM_CTL_END);
+    vstream_printf("after shrink request: %ld\n", (long) fp->buf.len);
+    for (count = 1; (n = VSTREAM_GETC(fp)) != VSTREAM_EOF; count++)
+	 /* void */ ;
+    vstream_printf("after refill: %ld, bytes read: %d\n\n",
+		   (long) fp->buf.len, count);
+    vstream_fflush(VSTREAM_OUT);
+    (void) vstream_fclose(fp);
+}
+
 static void printf_number(void)
 {
 
@@ -2069,6 +2165,7 @@ int     main(int argc, char **argv)
     copy_line(1);				/* one-byte read/write */
     copy_line(2);				/* two-byte read/write */
     copy_line(1);				/* two-byte read/write */
+    resize_buffer();
     printf_number();				/* multi-byte write */
     do_memory_stream();
 
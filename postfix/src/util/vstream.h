@@ -89,6 +89,7 @@ extern VSTREAM vstream_fstd[];		/* pre-defined streams */
 #define VSTREAM_FLAG_DEADLINE	(1<<13)	/* deadline active */
 #define VSTREAM_FLAG_MEMORY	(1<<14)	/* internal stream */
 #define VSTREAM_FLAG_OWN_VSTRING (1<<15)/* owns VSTRING resource */
+#define VSTREAM_FLAG_SHRINK	(1<<16)	/* buffer size was reduced */
 
 #define VSTREAM_PURGE_READ	(1<<0)	/* flush unread data */
 #define VSTREAM_PURGE_WRITE	(1<<1)	/* flush unwritten data */
@@ -242,6 +243,7 @@ extern ssize_t vstream_bufstat(VSTREAM *, int);
 #define vstream_peek(vp) vstream_bufstat((vp), VSTREAM_BST_IN_PEND)
 
 extern const char *vstream_peek_data(VSTREAM *);
+extern void vstream_peek_skip(VSTREAM *, ssize_t);
 
  /*
   * Exception handling. We use pointer to jmp_buf to avoid a lot of unused
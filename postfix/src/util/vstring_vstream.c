@@ -88,6 +88,11 @@
 /*	The functions without _flags in their name accept the same
 /*	arguments except flags. These functions use the default
 /*	flags value.
+/*
+/*	All functions search the stream's input buffer for the
+/*	terminator with memchr(), and copy everything up to the
+/*	terminator at once, instead of reading one character at a
+/*	time.
 /* DIAGNOSTICS
 /*	Fatal errors: memory allocation failure.
 /*	Panic: improper string bound.
@@ -126,55 +131,80 @@
 #define VSTRING_GET_RESULT(vp, base_len) \
     (VSTRING_LEN(vp) > (base_len) ? vstring_end(vp)[-1] : VSTREAM_EOF)
 
-/* vstring_get_flags - read line from file, keep newline */
+/* vstring_get_scan - read until terminator, copy buffered data in bulk */
 
-int     vstring_get_flags(VSTRING *vp, VSTREAM *fp, int flags)
+static int vstring_get_scan(VSTRING *vp, VSTREAM *fp, int flags,
+			            int term, int keep, ssize_t bound)
 {
-    int     c;
+    const char *data;
+    const char *cp;
     ssize_t base_len;
+    ssize_t avail;
+    int     c;
 
     if ((flags & VSTRING_GET_FLAG_APPEND) == 0)
 	VSTRING_RESET(vp);
     base_len = VSTRING_LEN(vp);
-    while ((c = VSTREAM_GETC(fp)) != VSTREAM_EOF) {
+
+    /*
+     * Look for the terminator in the unread part of the stream buffer with
+     * memchr(), which is typically vectorized, and append everything up to
+     * the terminator at once. Only when the buffer is empty, read one
+     * character with VSTREAM_GETC() so that the stream refills the buffer,
+     * with the usual timeout and error handling. A negative bound means no
+     * limit.
+     */
+    for (;;) {
+	if ((avail = vstream_peek(fp)) > 0) {
+	    if (bound >= 0 && avail > bound)
+		avail = bound;
+	    data = vstream_peek_data(fp);
+	    if ((cp = memchr(data, term, avail)) != 0) {
+		vstring_memcat(vp, data, cp - data + (keep ? 1 : 0));
+		vstream_peek_skip(fp, cp - data + 1);
+		VSTRING_TERMINATE(vp);
+		return (term);
+	    }
+	    vstring_memcat(vp, data, avail);
+	    vstream_peek_skip(fp, avail);
+	    if (bound >= 0 && (bound -= avail) == 0)
+		break;
+	}
+	if ((c = VSTREAM_GETC(fp)) == VSTREAM_EOF)
+	    break;
+	if (c == term) {
+	    if (keep)
+		VSTRING_ADDCH(vp, c);
+	    VSTRING_TERMINATE(vp);
+	    return (term);
+	}
 	VSTRING_ADDCH(vp, c);
-	if (c == '\n')
+	if (bound >= 0 && --bound == 0)
 	    break;
     }
     VSTRING_TERMINATE(vp);
     return (VSTRING_GET_RESULT(vp, base_len));
 }
 
+/* vstring_get_flags - read line from file, keep newline */
+
+int     vstring_get_flags(VSTRING *vp, VSTREAM *fp, int flags)
+{
+    return (vstring_get_scan(vp, fp, flags, '\n', 1, -1));
+}
+
 /* vstring_get_flags_nonl - read line from file, strip newline */
 
 int     vstring_get_flags_nonl(VSTRING *vp, VSTREAM *fp, int flags)
 {
-    int     c;
-    ssize_t base_len;
-
-    if ((flags & VSTRING_GET_FLAG_APPEND) == 0)
-	VSTRING_RESET(vp);
-    base_len = VSTRING_LEN(vp);
-    while ((c = VSTREAM_GETC(fp)) != VSTREAM_EOF && c != '\n')
-	VSTRING_ADDCH(vp, c);
-    VSTRING_TERMINATE(vp);
-    return (c == '\n' ? c : VSTRING_GET_RESULT(vp, base_len));
+    return (vstring_get_scan(vp, fp, flags, '\n', 0, -1));
 }
 
 /* vstring_get_flags_null - read null-terminated string from file */
 
 int     vstring_get_flags_null(VSTRING *vp, VSTREAM *fp, int flags)
 {
-    int     c;
-    ssize_t base_len;
-
-    if ((flags & VSTRING_GET_FLAG_APPEND) == 0)
-	VSTRING_RESET(vp);
-    base_len = VSTRING_LEN(vp);
-    while ((c = VSTREAM_GETC(fp)) != VSTREAM_EOF && c != 0)
-	VSTRING_ADDCH(vp, c);
-    VSTRING_TERMINATE(vp);
-    return (c == 0 ? c : VSTRING_GET_RESULT(vp, base_len));
+    return (vstring_get_scan(vp, fp, flags, 0, 0, -1));
 }
 
 /* vstring_get_flags_bound - read line from file, keep newline, up to bound */
@@ -182,22 +212,10 @@ int     vstring_get_flags_null(VSTRING *vp, VSTREAM *fp, int flags)
 int     vstring_get_flags_bound(VSTRING *vp, VSTREAM *fp, int flags,
 				        ssize_t bound)
 {
-    int     c;
-    ssize_t base_len;
-
     if (bound <= 0)
 	msg_panic("vstring_get_bound: invalid bound %ld", (long) bound);
 
-    if ((flags & VSTRING_GET_FLAG_APPEND) == 0)
-	VSTRING_RESET(vp);
-    base_len = VSTRING_LEN(vp);
-    while (bound-- > 0 && (c = VSTREAM_GETC(fp)) != VSTREAM_EOF) {
-	VSTRING_ADDCH(vp, c);
-	if (c == '\n')
-	    break;
-    }
-    VSTRING_TERMINATE(vp);
-    return (VSTRING_GET_RESULT(vp, base_len));
+    return (vstring_get_scan(vp, fp, flags, '\n', 1, bound));
 }
 
 /* vstring_get_flags_nonl_bound - read line from file, strip newline, up to bound */
@@ -205,19 +223,10 @@ int     vstring_get_flags_bound(VSTRING *vp, VSTREAM *fp, int flags,
 int     vstring_get_flags_nonl_bound(VSTRING *vp, VSTREAM *fp, int flags,
 				             ssize_t bound)
 {
-    int     c;
-    ssize_t base_len;
-
     if (bound <= 0)
 	msg_panic("vstring_get_nonl_bound: invalid bound %ld", (long) bound);
 
-    if ((flags & VSTRING_GET_FLAG_APPEND) == 0)
-	VSTRING_RESET(vp);
-    base_len = VSTRING_LEN(vp);
-    while (bound-- > 0 && (c = VSTREAM_GETC(fp)) != VSTREAM_EOF && c != '\n')
-	VSTRING_ADDCH(vp, c);
-    VSTRING_TERMINATE(vp);
-    return (c == '\n' ? c : VSTRING_GET_RESULT(vp, base_len));
+    return (vstring_get_scan(vp, fp, flags, '\n', 0, bound));
 }
 
 /* vstring_get_flags_null_bound - read null-terminated string from file */
@@ -225,42 +234,193 @@ int     vstring_get_flags_nonl_bound(VSTRING *vp, VSTREAM *fp, int flags,
 int     vstring_get_flags_null_bound(VSTRING *vp, VSTREAM *fp, int flags,
 				             ssize_t bound)
 {
-    int     c;
-    ssize_t base_len;
-
     if (bound <= 0)
 	msg_panic("vstring_get_null_bound: invalid bound %ld", (long) bound);
 
-    if ((flags & VSTRING_GET_FLAG_APPEND) == 0)
-	VSTRING_RESET(vp);
-    base_len = VSTRING_LEN(vp);
-    while (bound-- > 0 && (c = VSTREAM_GETC(fp)) != VSTREAM_EOF && c != 0)
-	VSTRING_ADDCH(vp, c);
-    VSTRING_TERMINATE(vp);
-    return (c == 0 ? c : VSTRING_GET_RESULT(vp, base_len));
+    return (vstring_get_scan(vp, fp, flags, 0, 0, bound));
 }
 
 #ifdef TEST
 
  /*
-  * Proof-of-concept test program: copy the source to this module to stdout.
+  * Test program. Without file arguments, compare each function against a
+  * reference implementation that reads one character at a time, using
+  * input with long lines, empty lines and null bytes that is read through
+  * a small buffer, with a range of bounds. With file arguments, time
+  * vstring_get() and the reference implementation over each file, repeated
+  * as specified with the -n option.
   */
+#include <stdlib.h>
 #include <fcntl.h>
+#include <sys/time.h>
+#include <msg_vstream.h>
+
+#define TEST_FILE	"vstring_vstream.data"
+#define TEST_BUFSIZE	32
+
+static int ref_get(VSTRING *vp, VSTREAM *fp, int term, int keep,
+		           ssize_t bound)
+{
+    int     c = VSTREAM_EOF;
+    ssize_t base_len = VSTRING_LEN(vp);
+
+    while (bound-- != 0 && (c = VSTREAM_GETC(fp)) != VSTREAM_EOF) {
+	if (c == term && !keep)
+	    break;
+	VSTRING_ADDCH(vp, c);
+	if (c == term)
+	    break;
+    }
+    VSTRING_TERMINATE(vp);
+    return (c == term ? c : VSTRING_GET_RESULT(vp, base_len));
+}
 
-#define TEXT_VSTREAM    "vstring_vstream.c"
+static int new_get(VSTRING *vp, VSTREAM *fp, int term, int keep,
+		           ssize_t bound)
+{
+    int     flags = VSTRING_GET_FLAG_APPEND;
+
+    if (bound < 0)
+	return (term == 0 ? vstring_get_flags_null(vp, fp, flags) :
+		keep ? vstring_get_flags(vp, fp, flags) :
+		vstring_get_flags_nonl(vp, fp, flags));
+    else
+	return (term == 0 ? vstring_get_flags_null_bound(vp, fp, flags, bound) :
+		keep ? vstring_get_flags_bound(vp, fp, flags, bound) :
+		vstring_get_flags_nonl_bound(vp, fp, flags, bound));
+}
 
-int     main(void)
+static void self_test(void)
 {
-    VSTRING *vp = vstring_alloc(1);
+    static const ssize_t bounds[] = {-1, 1, 2, 7, 31, 32, 33, 100};
+    static const char *names[] = {"get", "get_nonl", "get_null"};
     VSTREAM *fp;
+    VSTREAM *fp2;
+    VSTRING *buf = vstring_alloc(1);
+    VSTRING *buf2 = vstring_alloc(1);
+    int     b;
+    int     f;
+    int     n;
+    int     ch;
+    int     ch2;
+    int     calls;
+
+    if ((fp = vstream_fopen(TEST_FILE, O_CREAT | O_TRUNC | O_WRONLY, 0600)) == 0)
+	msg_fatal("open %s: %m", TEST_FILE);
+    for (n = 0; n < 2000; n++) {
+	VSTREAM_PUTC(n % 97 == 0 ? '\n' : n % 89 == 0 ? 0 :
+		     n % 7 == 0 && n < 200 ? '\n' : 'a' + n % 26, fp);
+	if (n % 500 == 0)
+	    VSTREAM_PUTC('\n', fp);
+    }
+    if (vstream_fclose(fp))
+	msg_fatal("write %s: %m", TEST_FILE);
+
+    for (f = 0; f < 3; f++) {
+	for (b = 0; b < (int) (sizeof(bounds) / sizeof(bounds[0])); b++) {
+	    if ((fp = vstream_fopen(TEST_FILE, O_RDONLY, 0)) == 0
+		|| (fp2 = vstream_fopen(TEST_FILE, O_RDONLY, 0)) == 0)
+		msg_fatal("open %s: %m", TEST_FILE);
+	    vstream_control(fp, CA_VSTREAM_CTL_BUFSIZE(TEST_BUFSIZE),
+			    CA_VSTREAM_CTL_END);
+	    vstream_control(fp2, CA_VSTREAM_CTL_BUFSIZE(TEST_BUFSIZE),
+			    CA_VSTREAM_CTL_END);
+	    for (calls = 0; /* void */ ; calls++) {
+		/* Also exercise the append flag. */
+		if (calls % 5 == 0) {
+		    vstring_strcpy(buf, "x");
+		    vstring_strcpy(buf2, "x");
+		} else {
+		    VSTRING_RESET(buf);
+		    VSTRING_RESET(buf2);
+		}
+		ch = new_get(buf, fp, f == 2 ? 0 : '\n', f == 0, bounds[b]);
+		ch2 = ref_get(buf2, fp2, f == 2 ? 0 : '\n', f == 0, bounds[b]);
+		if (ch != ch2 || VSTRING_LEN(buf) != VSTRING_LEN(buf2)
+		    || memcmp(vstring_str(buf), vstring_str(buf2),
+			      VSTRING_LEN(buf)) != 0)
+		    msg_fatal("%s bound %ld call %d: result %d/%d length %ld/%ld",
+			      names[f], (long) bounds[b], calls, ch, ch2,
+			      (long) VSTRING_LEN(buf),
+			      (long) VSTRING_LEN(buf2));
+		if (ch == VSTREAM_EOF)
+		    break;
+	    }
+	    vstream_printf("%s bound %ld: %d calls ok\n",
+			   names[f], (long) bounds[b], calls);
+	    (void) vstream_fclose(fp);
+	    (void) vstream_fclose(fp2);
+	}
+    }
+    vstream_fflush(VSTREAM_OUT);
+    (void) unlink(TEST_FILE);
+    vstring_free(buf);
+    vstring_free(buf2);
+}
+
+#define TV_USEC(tv)	((tv).tv_sec * 1000000.0 + (tv).tv_usec)
 
-    if ((fp = vstream_fopen(TEXT_VSTREAM, O_RDONLY, 0)) == 0)
-	msg_fatal("open %s: %m", TEXT_VSTREAM);
-    while (vstring_fgets(vp, fp))
-	vstream_fprintf(VSTREAM_OUT, "%s", vstring_str(vp));
-    vstream_fclose(fp);
+static void bench(const char *path, int count)
+{
+    VSTREAM *fp;
+    VSTRING *buf = vstring_alloc(100);
+    struct timeval start, done;
+    double  bytes;
+    double  usec;
+    long    lines;
+    int     pass;
+    int     n;
+
+    if ((fp = vstream_fopen(path, O_RDONLY, 0)) == 0)
+	msg_fatal("open %s: %m", path);
+    for (pass = 0; pass < 2; pass++) {
+	lines = 0;
+	bytes = 0;
+	GETTIMEOFDAY(&start);
+	for (n = 0; n < count; n++) {
+	    if (vstream_fseek(fp, (off_t) 0, SEEK_SET) < 0)
+		msg_fatal("seek %s: %m", path);
+	    for (;;) {
+		VSTRING_RESET(buf);
+		if ((pass == 0 ? ref_get(buf, fp, '\n', 1, -1) :
+		     vstring_get(buf, fp)) == VSTREAM_EOF)
+		    break;
+		bytes += VSTRING_LEN(buf);
+		lines++;
+	    }
+	}
+	GETTIMEOFDAY(&done);
+	usec = TV_USEC(done) - TV_USEC(start);
+	vstream_printf("%s: %s: %ld lines, %.1f ns/line, %.1f MB/s\n", path,
+		       pass == 0 ? "VSTREAM_GETC" : "vstring_get", lines,
+		       lines ? 1000.0 * usec / lines : 0.0,
+		       usec > 0 ? bytes / usec : 0.0);
+    }
     vstream_fflush(VSTREAM_OUT);
-    vstring_free(vp);
+    (void) vstream_fclose(fp);
+    vstring_free(buf);
+}
+
+int     main(int argc, char **argv)
+{
+    int     count = 100;
+    int     ch;
+
+    msg_vstream_init(argv[0], VSTREAM_ERR);
+    while ((ch = GETOPT(argc, argv, "n:")) > 0) {
+	switch (ch) {
+	case 'n':
+	    if ((count = atoi(optarg)) <= 0)
+		msg_fatal("bad count: %s", optarg);
+	    break;
+	default:
+	    msg_fatal("usage: %s [-n count] [file...]", argv[0]);
+	}
+    }
+    if (optind == argc)
+	self_test();
+    for (/* void */ ; optind < argc; optind++)
+	bench(argv[optind], count);
     return (0);
 }
 
@@ -34,6 +34,11 @@
 /*	\fIaddress\fR.
 /*	If the status is unknown, a probe is sent and an "in progress"
 /*	status is returned.
+/* .PP
+/*	Optionally, the server shares deliverable and undeliverable
+/*	results that are not yet due for a refresh probe through a
+/*	memory-mapped file, so that \fBsmtpd\fR(8) processes can look
+/*	them up without sending a query.
 /* SECURITY
 /* .ad
 /* .fi
@@ -57,6 +62,11 @@
 /* DIAGNOSTICS
 /*	Problems and transactions are logged to \fBsyslogd\fR(8)
 /*	or \fBpostlogd\fR(8).
+/*
+/*	Upon exit, and every \fBaddress_verify_status_update_time\fR
+/*	seconds, the server logs the number of queries, status
+/*	updates and probes, and the current and maximal number of
+/*	probes that are waiting for a status update.
 /* BUGS
 /*	Address verification probe messages add additional traffic
 /*	to the mail queue.
@@ -115,6 +125,17 @@
 /* .IP "\fBaddress_verify_cache_cleanup_interval (12h)\fR"
 /*	The amount of time between \fBverify\fR(8) address verification
 /*	database cleanup runs.
+/* .PP
+/*	Available in Postfix 3.11 and later:
+/* .IP "\fBaddress_verify_shared_cache_file (empty)\fR"
+/*	Optional memory-mapped file that shares address verification
+/*	results with Postfix SMTP server processes.
+/* .IP "\fBaddress_verify_shared_cache_slots (100000)\fR"
+/*	The number of addresses that fit in the
+/*	$address_verify_shared_cache_file cache.
+/* .IP "\fBaddress_verify_status_update_time (600s)\fR"
+/*	How frequently the \fBverify\fR(8) server logs address
+/*	verification statistics.
 /* PROBE MESSAGE ROUTING CONTROLS
 /* .ad
 /* .fi
@@ -254,6 +275,7 @@
 #include <data_redirect.h>
 #include <verify_clnt.h>
 #include <verify_sender_addr.h>
+#include <verify_mmap.h>
 
 /* Server skeleton. */
 
@@ -270,11 +292,25 @@ int     var_verify_pos_try;
 int     var_verify_neg_exp;
 int     var_verify_neg_try;
 int     var_verify_scan_cache;
+char   *var_verify_mmap_file;
+int     var_verify_mmap_slots;
+int     var_verify_stat_time;
 
  /*
   * State.
   */
 static DICT_CACHE *verify_map;
+static VERIFY_MMAP *verify_mmap;
+
+ /*
+  * Statistics. Probes are pending from the time that they are sent until
+  * the address status is updated, or until PROBE_TTL has passed.
+  */
+static HTABLE *verify_pending;
+static int verify_queries;
+static int verify_updates;
+static int verify_probes;
+static int verify_max_pending;
 
  /*
   * Silly little macros.
@@ -362,6 +398,33 @@ static const char *verify_stat2name(int addr_status)
     return (0);
 }
 
+/* verify_publish - share fresh address status with clients */
+
+static void verify_publish(const char *addr, int addr_status, long updated,
+			           const char *text)
+{
+    long    fresh_until;
+
+    /*
+     * Clients may use a deliverable or undeliverable status without asking
+     * us, until the address is due for a refresh probe. Other results are
+     * removed, so that clients will ask us and we can send a probe.
+     */
+    if (verify_mmap == 0)
+	return;
+    if (addr_status == DEL_RCPT_STAT_OK)
+	fresh_until = updated + var_verify_pos_try;
+    else if (addr_status == DEL_RCPT_STAT_BOUNCE)
+	fresh_until = updated + var_verify_neg_try;
+    else
+	fresh_until = 0;
+    if (fresh_until > (long) time((time_t *) 0))
+	verify_mmap_update(verify_mmap, addr, addr_status,
+			   (time_t) fresh_until, text);
+    else
+	verify_mmap_delete(verify_mmap, addr);
+}
+
 /* verify_update_service - update address service */
 
 static void verify_update_service(VSTREAM *client_stream)
@@ -407,7 +470,10 @@ static void verify_update_service(VSTREAM *client_stream)
 		    msg_info("PUT %s status=%d probed=%ld updated=%ld text=%s",
 			STR(addr), addr_status, probed, updated, STR(text));
 		dict_cache_update(verify_map, STR(addr), STR(buf));
+		verify_publish(STR(addr), addr_status, updated, STR(text));
 	    }
+	    verify_updates += 1;
+	    htable_delete(verify_pending, STR(addr), (void (*) (void *)) 0);
 	    attr_print(client_stream, ATTR_FLAG_NONE,
 		       SEND_ATTR_INT(MAIL_ATTR_STATUS, VRFY_STAT_OK),
 		       ATTR_TYPE_END);
@@ -481,6 +547,7 @@ static void verify_query_service(VSTREAM *client_stream)
 
 	/* FIX 200501 IPv6 patch did not neuter ":" in address literals. */
 	translit(STR(addr), ":", "_");
+	verify_queries += 1;
 	raw_data = dict_cache_lookup(verify_map, STR(addr));
 	if (dict_cache_error(verify_map) != 0) {
 	    addr_status = DEL_RCPT_STAT_DEFER;
@@ -506,6 +573,13 @@ static void verify_query_service(VSTREAM *client_stream)
 	    msg_info("GOT %s status=%d probed=%ld updated=%ld text=%s",
 		     STR(addr), addr_status, probed, updated, text);
 
+	/*
+	 * Share a usable status with clients, so that they won't have to ask
+	 * us again. This also refills a newly-created shared cache.
+	 */
+	if (updated != 0)
+	    verify_publish(STR(addr), addr_status, updated, text);
+
 	/*
 	 * Respond to the client.
 	 */
@@ -545,6 +619,12 @@ static void verify_query_service(VSTREAM *client_stream)
 				  (VSTRING *) 0,
 				  verify_post_mail_action,
 				  (void *) 0);
+	    verify_probes += 1;
+	    if (htable_find(verify_pending, STR(addr)) == 0) {
+		(void) htable_enter(verify_pending, STR(addr), (void *) now);
+		if (verify_pending->used > verify_max_pending)
+		    verify_max_pending = verify_pending->used;
+	    }
 	    if (updated != 0 || var_verify_neg_cache != 0) {
 		put_buf = vstring_alloc(10);
 		verify_make_entry(put_buf, addr_status, now, updated, text);
@@ -622,10 +702,47 @@ static void verify_service(VSTREAM *client_stream, char *unused_service,
     vstring_free(request);
 }
 
+/* verify_status_dump - log and reset statistics */
+
+static void verify_status_dump(void)
+{
+    HTABLE_INFO **ht_info;
+    HTABLE_INFO **ht;
+    long    now = (long) time((time_t *) 0);
+
+    if (verify_pending == 0)
+	return;
+
+    /*
+     * Forget about probes that will not be answered.
+     */
+    ht_info = htable_list(verify_pending);
+    for (ht = ht_info; *ht; ht++)
+	if (now - (long) ht[0]->value > PROBE_TTL)
+	    htable_delete(verify_pending, ht[0]->key, (void (*) (void *)) 0);
+    myfree((void *) ht_info);
+
+    msg_info("statistics: address verification queries=%d updates=%d "
+	     "probes=%d pending_probes=%ld max_pending_probes=%d",
+	     verify_queries, verify_updates, verify_probes,
+	     (long) verify_pending->used, verify_max_pending);
+    verify_queries = verify_updates = verify_probes = 0;
+    verify_max_pending = verify_pending->used;
+}
+
+/* verify_status_update - log and reset statistics periodically */
+
+static void verify_status_update(int unused_event, void *context)
+{
+    verify_status_dump();
+    event_request_timer(verify_status_update, context, var_verify_stat_time);
+}
+
 /* verify_dump - dump some statistics */
 
 static void verify_dump(char *unused_name, char **unused_argv)
 {
+    verify_status_dump();
 
     /*
      * Dump preliminary cache cleanup statistics when the process commits
@@ -635,6 +752,10 @@ static void verify_dump(char *unused_name, char **unused_argv)
      */
     dict_cache_close(verify_map);
     verify_map = 0;
+    if (verify_mmap) {
+	verify_mmap_close(verify_mmap);
+	verify_mmap = 0;
+    }
 }
 
 /* post_jail_init - post-jail initialization */
@@ -668,6 +789,12 @@ static void post_jail_init(char *unused_name, char **unused_argv)
 		     CA_DICT_CACHE_CTL_CONTEXT((void *) vstring_alloc(100)),
 			   CA_DICT_CACHE_CTL_END);
     }
+
+    /*
+     * Start the statistics logging thread.
+     */
+    verify_pending = htable_create(100);
+    event_request_timer(verify_status_update, (void *) 0, var_verify_stat_time);
 }
 
 /* pre_jail_init - pre-jail initialization */
@@ -723,6 +850,15 @@ static void pre_jail_init(char *unused_name, char **unused_argv)
 			O_CREAT | O_RDWR, VERIFY_DICT_OPEN_FLAGS);
     (void) umask(saved_mask);
 
+    /*
+     * Share fresh results with clients through a memory-mapped file.
+     */
+    if (*var_verify_mmap_file)
+	verify_mmap = verify_mmap_open(data_redirect_file(redirect,
+							  var_verify_mmap_file),
+				       var_verify_mmap_slots,
+				       O_CREAT | O_RDWR);
+
     /*
      * Clean up and restore privilege.
      */
@@ -754,6 +890,11 @@ int     main(int argc, char **argv)
     static const CONFIG_STR_TABLE str_table[] = {
 	VAR_VERIFY_MAP, DEF_VERIFY_MAP, &var_verify_map, 0, 0,
 	VAR_VERIFY_SENDER, DEF_VERIFY_SENDER, &var_verify_sender, 0, 0,
+	VAR_VERIFY_MMAP_FILE, DEF_VERIFY_MMAP_FILE, &var_verify_mmap_file, 0, 0,
+	0,
+    };
+    static const CONFIG_INT_TABLE int_table[] = {
+	VAR_VERIFY_MMAP_SLOTS, DEF_VERIFY_MMAP_SLOTS, &var_verify_mmap_slots, 1, 0,
 	0,
     };
     static const CONFIG_TIME_TABLE time_table[] = {
@@ -763,6 +904,7 @@ int     main(int argc, char **argv)
 	VAR_VERIFY_NEG_TRY, DEF_VERIFY_NEG_TRY, &var_verify_neg_try, 1, 0,
 	VAR_VERIFY_SCAN_CACHE, DEF_VERIFY_SCAN_CACHE, &var_verify_scan_cache, 0, 0,
 	VAR_VERIFY_SENDER_TTL, DEF_VERIFY_SENDER_TTL, &var_verify_sender_ttl, 0, 0,
+	VAR_VERIFY_STAT_TIME, DEF_VERIFY_STAT_TIME, &var_verify_stat_time, 1, 0,
 	0,
     };
 
@@ -773,6 +915,7 @@ int     main(int argc, char **argv)
 
     multi_server_main(argc, argv, verify_service,
 		      CA_MAIL_SERVER_STR_TABLE(str_table),
+		      CA_MAIL_SERVER_INT_TABLE(int_table),
 		      CA_MAIL_SERVER_TIME_TABLE(time_table),
 		      CA_MAIL_SERVER_PRE_INIT(pre_jail_init),
 		      CA_MAIL_SERVER_POST_INIT(post_jail_init),